@@ -1,5 +1,6 @@
 #include <vector>
 #include <set>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -39,7 +40,8 @@ ASMap::ASMap(const Consensus& consensus,
   std::shared_ptr<SenderSpec> senderSpecB,
   std::shared_ptr<RecipientSpec> recipientSpecA,
   std::shared_ptr<RecipientSpec> recipientSpecB,
-  std::string network_file)
+  std::string network_file) : validAfter(consensus.getValidAfter()),
+    consensusHash(consensus.getContentHash())
 {
 
   size_t size = consensus.getSize();
@@ -111,8 +113,10 @@ ASMap::ASMap(const Consensus& consensus,
         BOOST_FOREACH (const std::string t, tokens)
         {
 					counttokens++;
-          this->nodesets[IDMap[t0]][IDMap[t1]].insert(trim_right_copy(t));
-					this->nodesets[IDMap[t1]][IDMap[t0]].insert(trim_right_copy(t));
+          std::string as = trim_right_copy(t);
+          this->nodesets[IDMap[t0]][IDMap[t1]].insert(as);
+					this->nodesets[IDMap[t1]][IDMap[t0]].insert(as);
+          intern_as(as);
         }
 
 				countknown++;
@@ -142,7 +146,9 @@ ASMap::ASMap(const Consensus& consensus,
         BOOST_FOREACH (const std::string t, tokens)
         {
 					counttokens++;
-          this->endpointsets[endpoint][IDMap[nodestr]].insert(trim_right_copy(t));
+          std::string as = trim_right_copy(t);
+          this->endpointsets[endpoint][IDMap[nodestr]].insert(as);
+          intern_as(as);
         }
 				countknown++;
       }
@@ -186,11 +192,35 @@ std::set<std::string>& ASMap::aspath_nodes(size_t nodeA, size_t nodeB)
   return nodesets[nodeA][nodeB];
 }
 
+void ASMap::intern_as(const std::string& as)
+{
+  // IDs are given in order of the first appearance
+  this->asIDs.emplace(as, (uint32_t)this->asIDs.size());
+}
+
+void ASMap::aspath_endpoint_bits(size_t nodeID, const std::string& endpoint_IP, uint64_t* bits) const
+{
+  std::fill(bits, bits + as_words(), 0);
+  auto endpoint = this->endpointsets.find(endpoint_IP);
+  if(endpoint == this->endpointsets.end())
+    return;
+  for(const std::string& as : endpoint->second[nodeID])
+  {
+    uint32_t id = this->asIDs.at(as);
+    bits[id / 64] |= (uint64_t)1 << (id % 64);
+  }
+}
+
 bool ASMap::endpoint_exists(std::string endpoint_IP)
 {
 	return this->endpointsets.find(endpoint_IP) != this->endpointsets.end();
 }
 
+bool ASMap::built_for(const Consensus& consensus) const
+{
+	return consensus.getValidAfter() == validAfter && consensus.getContentHash() == consensusHash;
+}
+
 
 std::set<std::string>& ASMap::aspath_endpoint(size_t nodeID, std::string endpoint_IP)
 {
@@ -6,7 +6,9 @@
 #include <set>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <functional>
+#include <cstdint>
 
 class Consensus;
 class Relay;
@@ -27,9 +29,23 @@ public:
   bool endpoint_exists(std::string endpoint_IP);
   void print_statistics();
 
+  // ASes are interned while reading the network file, so routes can be handled as bitsets over AS IDs
+  size_t as_count() const { return asIDs.size(); }
+  size_t as_words() const { return (asIDs.size() + 63) / 64; }
+  // writes as_words() words, bit k is set iff AS with ID k is on the route between the node and the endpoint
+  void aspath_endpoint_bits(size_t nodeID, const std::string& endpoint_IP, uint64_t* bits) const;
+  // true iff node IDs of the map are positions of relays in the consensus
+  // (the map was built for a consensus with the same valid-after time and content hash, not necessarily the same object)
+  bool built_for(const Consensus& consensus) const;
+
 private:
   std::vector<std::vector<std::set<std::string> > > nodesets;
   std::map<std::string, std::vector<std::set<std::string> > > endpointsets;
+  std::unordered_map<std::string, uint32_t> asIDs;
+  std::string validAfter; // valid-after time of the consensus the map was built for
+  uint64_t consensusHash; // content hash of the consensus the map was built for
+
+  void intern_as(const std::string& as);
 };
 
 
@@ -0,0 +1,609 @@
+#include "circuit_sampler.hpp"
+#include "types/work_manager.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+	const uint64_t NONE = 0xFFFFF; /**< Relay index in observations for relays the adversary does not see (20 bits). */
+
+	// Anonymity games
+	const int SA = 0;
+	const int RA = 1;
+	const int REL = 2;
+
+	// Scenarios (path selections), their senders and recipients
+	const int A1 = 0;
+	const int A2 = 1;
+	const int B1 = 2;
+	const int B2 = 3;
+	const int SENDER[4] = { 0, 0, 1, 1 };
+	const int RECIPIENT[4] = { 0, 1, 0, 1 };
+
+	/**
+	 * Packs observation of a circuit: whether the sender and the recipient are seen
+	 * and indices of seen guard, middle and exit (NONE otherwise).
+	 */
+	inline uint64_t makeObservation(bool senderSeen, bool recipientSeen, uint64_t guard, uint64_t middle, uint64_t exit)
+	{
+		return (uint64_t)senderSeen << 63 | (uint64_t)recipientSeen << 62 | guard << 40 | middle << 20 | exit;
+	}
+
+	inline bool senderSeen(uint64_t observation) { return (observation >> 63) & 1; }
+	inline bool recipientSeen(uint64_t observation) { return (observation >> 62) & 1; }
+	inline size_t guardOf(uint64_t observation) { return (observation >> 40) & NONE; }
+	inline size_t middleOf(uint64_t observation) { return (observation >> 20) & NONE; }
+	inline size_t exitOf(uint64_t observation) { return observation & NONE; }
+
+	/**
+	 * SplitMix64 generator, used to seed streams.
+	 */
+	inline uint64_t splitMix(uint64_t& state)
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	/**
+	 * Stream of random numbers (xoshiro256**).
+	 */
+	class Random
+	{
+		public:
+			/**
+			 * Seeds the stream.
+			 * @param seed seed of all streams.
+			 * @param stream index of the stream.
+			 */
+			Random(uint64_t seed, uint64_t stream)
+			{
+				uint64_t state = seed ^ (stream * 0xD1B54A32D192ED03ull);
+				for(int i = 0; i < 4; ++i)
+					s[i] = splitMix(state);
+			}
+
+			/**
+			 * @return uniformly distributed number in [0, 1).
+			 */
+			double uniform()
+			{
+				uint64_t result = rotate(s[1] * 5, 7) * 9;
+				uint64_t t = s[1] << 17;
+				s[2] ^= s[0];
+				s[3] ^= s[1];
+				s[1] ^= s[2];
+				s[0] ^= s[3];
+				s[2] ^= t;
+				s[3] = rotate(s[3], 45);
+				return (result >> 11) * (1.0 / 9007199254740992.0);
+			}
+
+		private:
+			static uint64_t rotate(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+			uint64_t s[4]; /**< Generator state. */
+	};
+
+	/**
+	 * Observations of the adversary and their probabilities in the scenarios of the games.
+	 * Observations showing at most one relay (the middle is never among them) are served from masses of circuits
+	 * precomputed once per scenario, observations showing two relays are sums over the third one,
+	 * they are computed once and shared by all threads.
+	 */
+	class Observer
+	{
+		public:
+			/**
+			 * Probabilities already looked up by one thread.
+			 */
+			struct Local
+			{
+				std::unordered_map<uint64_t, probability_t> values[12]; /**< Probabilities for every scenario and game. */
+			};
+
+			/**
+			 * Constructor precomputes masses of circuits showing at most one relay in every scenario of every game.
+			 * @param threads number of threads to use.
+			 */
+			Observer(size_t size, const PathSelection* const* pathSelections, const std::vector<probability_t>* const* exitProbs,
+				const const_vector<const_vector<bool>>& observedNodes,
+				const const_vector<bool>& observedSenderA, const const_vector<bool>& observedSenderB,
+				const const_vector<bool>& observedRecipient1, const const_vector<bool>& observedRecipient2, unsigned threads)
+				: size(size), pathSelections(pathSelections), exitProbs(exitProbs), observedNodes(observedNodes),
+				observedSenders{ &observedSenderA, &observedSenderB }, observedRecipients{ &observedRecipient1, &observedRecipient2 },
+				guardLinks(size), exitLinks(size)
+			{
+				// the shorter of the lists of observed and unobserved middles of every guard and exit
+				for(size_t relay = 0; relay < size; ++relay)
+				{
+					size_t guardObserved = 0, exitObserved = 0;
+					for(size_t middle = 0; middle < size; ++middle)
+					{
+						guardObserved += observedNodes[relay][middle];
+						exitObserved += observedNodes[middle][relay];
+					}
+					guardLinks[relay].unobserved = 2 * guardObserved > size;
+					exitLinks[relay].unobserved = 2 * exitObserved > size;
+					for(size_t middle = 0; middle < size; ++middle)
+					{
+						if(observedNodes[relay][middle] != guardLinks[relay].unobserved)
+							guardLinks[relay].relays.push_back(middle);
+						if(observedNodes[middle][relay] != exitLinks[relay].unobserved)
+							exitLinks[relay].relays.push_back(middle);
+					}
+				}
+				for(int scenario : { A1, A2, B1, B2 })
+					computeMarginals(scenario, threads);
+			}
+
+			/**
+			 * @return observation of the circuit in the scenario of the game.
+			 */
+			uint64_t observe(int scenario, int game, size_t guard, size_t middle, size_t exit) const
+			{
+				bool SG = senderLinkSeen(scenario, game, guard);
+				bool XR = recipientLinkSeen(scenario, game, exit);
+				bool GM = observedNodes[guard][middle];
+				bool MX = observedNodes[middle][exit];
+				return makeObservation(SG, XR, SG || GM ? guard : NONE, GM || MX ? middle : NONE, MX || XR ? exit : NONE);
+			}
+
+			/**
+			 * @param scenario scenario of the probability.
+			 * @param game anonymity game.
+			 * @param observation observation made in scenario origin.
+			 * @param origin scenario the observation was made in (determines the seen sender and recipient).
+			 * @param local probabilities looked up by the calling thread.
+			 * @return probability of the observation in the scenario.
+			 */
+			probability_t probability(int scenario, int game, uint64_t observation, int origin, Local& local)
+			{
+				if((senderSeen(observation) && SENDER[scenario] != SENDER[origin]) ||
+					(recipientSeen(observation) && RECIPIENT[scenario] != RECIPIENT[origin]))
+					return 0;
+
+				size_t guard = guardOf(observation), middle = middleOf(observation), exit = exitOf(observation);
+				if(middle == NONE && (guard == NONE || exit == NONE))
+				{
+					// observation of at most one relay, the flags tell whether it is the guard or the exit
+					const Marginals& marginals = this->marginals[scenario * 3 + game];
+					bool sender = senderSeen(observation), recipient = recipientSeen(observation);
+					if(guard != NONE)
+						return sender && !recipient ? marginals.guards[guard] : 0;
+					if(exit != NONE)
+						return !sender && recipient ? marginals.exits[exit] : 0;
+					return !sender && !recipient ? marginals.total : 0;
+				}
+				if(guard != NONE && middle != NONE && exit != NONE)
+				{
+					// observation of the whole circuit
+					if(observe(scenario, game, guard, middle, exit) != observation)
+						return 0;
+					const PathSelection& pathSelection = *pathSelections[scenario];
+					return (*exitProbs[scenario])[exit] * pathSelection.entryProb(guard, exit) * pathSelection.middleProb(middle, guard, exit);
+				}
+
+				int index = scenario * 3 + game;
+				auto found = local.values[index].find(observation);
+				if(found != local.values[index].end())
+					return found->second;
+				probability_t value;
+				{
+					std::lock_guard<std::mutex> lock(shared[index].mutex);
+					auto sharedFound = shared[index].values.find(observation);
+					if(sharedFound != shared[index].values.end())
+					{
+						local.values[index].emplace(observation, sharedFound->second);
+						return sharedFound->second;
+					}
+				}
+				// computed without the lock, threads needing the same observation at once compute the same value
+				value = sum(scenario, game, observation);
+				{
+					std::lock_guard<std::mutex> lock(shared[index].mutex);
+					shared[index].values.emplace(observation, value);
+				}
+				local.values[index].emplace(observation, value);
+				return value;
+			}
+
+		private:
+			/**
+			 * Masses of circuits with unseen middle showing just the guard, just the exit or no relay
+			 * in one scenario of a game.
+			 */
+			struct Marginals
+			{
+				std::vector<probability_t> guards; /**< Mass of circuits showing just the guard, for every guard. */
+				std::vector<probability_t> exits; /**< Mass of circuits showing just the exit, for every exit. */
+				probability_t total = 0; /**< Mass of circuits showing no relay. */
+			};
+
+			/**
+			 * Middles observed with a relay (or unobserved, whichever of them are fewer).
+			 */
+			struct Links
+			{
+				bool unobserved = false; /**< Are the relays the unobserved middles? */
+				std::vector<uint32_t> relays; /**< Listed middles. */
+			};
+
+			/**
+			 * @return does the adversary see the connection between the sender and the guard in the scenario of the game?
+			 */
+			bool senderLinkSeen(int scenario, int game, size_t guard) const
+			{
+				// the sender is the same in both scenarios of recipient anonymity game
+				return game == RA || (*observedSenders[SENDER[scenario]])[guard];
+			}
+
+			/**
+			 * @return does the adversary see the connection between the exit and the recipient in the scenario of the game?
+			 */
+			bool recipientLinkSeen(int scenario, int game, size_t exit) const
+			{
+				// the recipient is the same in both scenarios of sender anonymity game
+				return game == SA || (*observedRecipients[RECIPIENT[scenario]])[exit];
+			}
+
+			/**
+			 * Sums middle probabilities of the circuits of the guard and the exit with the middle unseen from both.
+			 * Middles are iterated over the shorter lists of links, observed middles are subtracted from one
+			 * (middle probabilities of a possible guard and exit sum to one).
+			 * @return probability of an unseen middle.
+			 */
+			probability_t unseenMiddles(const PathSelection& pathSelection, size_t guard, size_t exit) const
+			{
+				const Links& guardSide = guardLinks[guard];
+				const Links& exitSide = exitLinks[exit];
+				if(guardSide.unobserved || exitSide.unobserved)
+				{
+					const Links& shorter = !exitSide.unobserved || (guardSide.unobserved && guardSide.relays.size() <= exitSide.relays.size()) ?
+						guardSide : exitSide;
+					probability_t unseen = 0;
+					for(uint32_t middle : shorter.relays)
+						if(middle != guard && middle != exit && !observedNodes[guard][middle] && !observedNodes[middle][exit])
+							unseen += pathSelection.middleProb(middle, guard, exit);
+					return unseen;
+				}
+				probability_t seen = 0;
+				for(uint32_t middle : guardSide.relays)
+					if(middle != guard && middle != exit)
+						seen += pathSelection.middleProb(middle, guard, exit);
+				for(uint32_t middle : exitSide.relays)
+					if(middle != guard && middle != exit && !observedNodes[guard][middle])
+						seen += pathSelection.middleProb(middle, guard, exit);
+				return std::max<probability_t>(0, 1 - seen);
+			}
+
+			/**
+			 * Computes masses of circuits showing at most one relay in the scenario for every game,
+			 * from a single pass over guards and exits (with few middle probabilities for each of them).
+			 * Exits are split into a fixed number of blocks added up in order, so the masses do not depend on threads.
+			 * @param scenario scenario of the masses.
+			 * @param threads number of threads to use.
+			 */
+			void computeMarginals(int scenario, unsigned threads)
+			{
+				const PathSelection& pathSelection = *pathSelections[scenario];
+				const std::vector<probability_t>& exitProb = *exitProbs[scenario];
+				for(int game : { SA, RA, REL })
+				{
+					marginals[scenario * 3 + game].guards.assign(size, 0);
+					marginals[scenario * 3 + game].exits.assign(size, 0);
+				}
+				struct Partial
+				{
+					std::vector<probability_t> guards[3];
+					probability_t total[3] = { 0, 0, 0 };
+				};
+				size_t blocks = std::min<size_t>(size, 64);
+				std::vector<Partial> partial(blocks);
+				WorkManager::runAll(threads, blocks, [&](size_t block) {
+					Partial& sums = partial[block];
+					for(int game : { SA, RA, REL })
+						sums.guards[game].assign(size, 0);
+					thread_local std::vector<probability_t> entryRow;
+					entryRow.resize(size);
+					for(size_t x = block * size / blocks; x < (block + 1) * size / blocks; ++x)
+					{
+						if(!(exitProb[x] > 0))
+							continue;
+						pathSelection.entryProbRow(x, entryRow.data());
+						for(size_t g = 0; g < size; ++g)
+						{
+							if(g == x || !(entryRow[g] > 0))
+								continue;
+							probability_t mass = exitProb[x] * entryRow[g] * unseenMiddles(pathSelection, g, x);
+							if(!(mass > 0))
+								continue;
+							for(int game : { SA, RA, REL })
+							{
+								bool SG = senderLinkSeen(scenario, game, g), XR = recipientLinkSeen(scenario, game, x);
+								if(SG && !XR)
+									sums.guards[game][g] += mass;
+								else if(!SG && XR)
+									marginals[scenario * 3 + game].exits[x] += mass; // exits of the block are its own
+								else if(!SG && !XR)
+									sums.total[game] += mass;
+							}
+						}
+					}
+				});
+				for(const Partial& sums : partial)
+					for(int game : { SA, RA, REL })
+					{
+						Marginals& marginals = this->marginals[scenario * 3 + game];
+						for(size_t g = 0; g < size; ++g)
+							marginals.guards[g] += sums.guards[game][g];
+						marginals.total += sums.total[game];
+					}
+			}
+
+			/**
+			 * @return sum of probabilities of circuits giving the observation (of two relays) in the scenario of the game.
+			 */
+			probability_t sum(int scenario, int game, uint64_t observation) const
+			{
+				const PathSelection& pathSelection = *pathSelections[scenario];
+				const std::vector<probability_t>& exitProb = *exitProbs[scenario];
+				size_t guard = guardOf(observation), middle = middleOf(observation), exit = exitOf(observation);
+				thread_local std::vector<probability_t> entryRow, middleRow;
+				entryRow.resize(size);
+				middleRow.resize(size);
+
+				// seen relays are fixed, unseen ones are iterated over
+				probability_t total = 0;
+				for(size_t x = (exit == NONE ? 0 : exit); x < (exit == NONE ? size : exit + 1); ++x)
+				{
+					if(!(exitProb[x] > 0))
+						continue;
+					if(guard == NONE)
+						pathSelection.entryProbRow(x, entryRow.data());
+					for(size_t g = (guard == NONE ? 0 : guard); g < (guard == NONE ? size : guard + 1); ++g)
+					{
+						probability_t entryProb = guard == NONE ? entryRow[g] : pathSelection.entryProb(g, x);
+						if(g == x || !(entryProb > 0))
+							continue;
+						if(middle == NONE)
+							pathSelection.middleProbRow(g, x, middleRow.data());
+						probability_t middleSum = 0;
+						for(size_t m = (middle == NONE ? 0 : middle); m < (middle == NONE ? size : middle + 1); ++m)
+						{
+							probability_t middleProb = middle == NONE ? middleRow[m] : pathSelection.middleProb(m, g, x);
+							if(m != g && m != x && middleProb > 0 && observe(scenario, game, g, m, x) == observation)
+								middleSum += middleProb;
+						}
+						total += exitProb[x] * entryProb * middleSum;
+					}
+				}
+				return total;
+			}
+
+			/**
+			 * Probabilities computed by any thread.
+			 */
+			struct Shared
+			{
+				std::mutex mutex; /**< Guards the values. */
+				std::unordered_map<uint64_t, probability_t> values; /**< Probabilities of observations. */
+			};
+
+			size_t size; /**< Number of relays. */
+			const PathSelection* const* pathSelections; /**< Path selections of the scenarios. */
+			const std::vector<probability_t>* const* exitProbs; /**< Exit probabilities of the scenarios. */
+			const const_vector<const_vector<bool>>& observedNodes; /**< Compromised connections between relays. */
+			const const_vector<bool>* observedSenders[2]; /**< Compromised connections between senders and relays. */
+			const const_vector<bool>* observedRecipients[2]; /**< Compromised connections between relays and recipients. */
+			std::vector<Links> guardLinks; /**< Middles observed with every guard. */
+			std::vector<Links> exitLinks; /**< Middles observed with every exit. */
+			Marginals marginals[12]; /**< Masses of circuits showing at most one relay for every scenario and game. */
+			Shared shared[12]; /**< Probabilities for every scenario and game. */
+	};
+
+	/**
+	 * Sums of shares of distinguishing probability (and of their squares).
+	 */
+	struct Sums
+	{
+		double shares[4] = { 0, 0, 0, 0 }; /**< Sender, recipient and relationship anonymity (A1), relationship anonymity (B2). */
+		double squares[4] = { 0, 0, 0, 0 }; /**< Squares of the shares. */
+		uint64_t proposed[2] = { 0, 0 }; /**< Circuits proposed to draw the ones of A1 and B2. */
+		bool failed[2] = { false, false }; /**< Were too many circuits of A1 or B2 rejected in a row? */
+
+		void add(int index, double share)
+		{
+			shares[index] += share;
+			squares[index] += share * share;
+		}
+	};
+
+	/**
+	 * @return share of probability of the observation distinguishing the scenario from the other one.
+	 */
+	inline double distinguishing(probability_t probability, probability_t other)
+	{
+		return other < probability ? 1 - other / probability : 0;
+	}
+}
+
+CircuitSampler::CircuitSampler(
+	const Consensus& consensus,
+	const PathSelection& psA1,
+	const PathSelection& psA2,
+	const PathSelection& psB1,
+	const PathSelection& psB2,
+	unsigned threads) : size(consensus.getSize()), pathSelections{ &psA1, &psA2, &psB1, &psB2 }
+{
+	if(size >= NONE)
+		throw_exception(sampler_exception, sampler_exception::TOO_MANY_RELAYS, size);
+
+	// circuits are drawn from scenarios A1 and B2 only, the other ones are just compared to them
+	buildProposal(psA1, proposals[A1], threads);
+	buildProposal(psB2, proposals[B2], threads);
+	for(int scenario : { A2, B1 })
+	{
+		proposals[scenario].exitProbs.resize(size);
+		pathSelections[scenario]->exitProbRow(proposals[scenario].exitProbs.data());
+	}
+}
+
+void CircuitSampler::buildProposal(const PathSelection& pathSelection, Proposal& proposal, unsigned threads)
+{
+	proposal.exitProbs.resize(size);
+	pathSelection.exitProbRow(proposal.exitProbs.data());
+	proposal.entryBounds.resize(size);
+	proposal.middleBounds.resize(size);
+	pathSelection.probabilityBounds(proposal.entryBounds.data(), proposal.middleBounds.data(), threads);
+
+	proposal.exits = AliasTable(proposal.exitProbs.data(), size);
+	proposal.entries = AliasTable(proposal.entryBounds.data(), size);
+	proposal.middles = AliasTable(proposal.middleBounds.data(), size);
+	proposal.scale = proposal.exits.total() * proposal.entries.total() * proposal.middles.total();
+}
+
+CircuitSampler::Estimate CircuitSampler::estimate(
+	const const_vector<const_vector<bool>>& observedNodes,
+	const const_vector<bool>& observedSenderA,
+	const const_vector<bool>& observedSenderB,
+	const const_vector<bool>& observedRecipient1,
+	const const_vector<bool>& observedRecipient2,
+	const Settings& settings) const
+{
+	const std::vector<probability_t>* exitProbs[4] = { &proposals[A1].exitProbs, &proposals[A2].exitProbs, &proposals[B1].exitProbs, &proposals[B2].exitProbs };
+	Observer observer(size, pathSelections, exitProbs, observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2,
+		settings.threads);
+
+	// draws circuit with probability proportional to its probability in the path selection, counting proposed circuits
+	// (false if too many of them are rejected in a row)
+	size_t maxRejections = std::max<size_t>(settings.maxRejections, 1);
+	auto draw = [maxRejections](const Proposal& proposal, const PathSelection& pathSelection, Random& random,
+		size_t& guard, size_t& middle, size_t& exit, uint64_t& proposed) {
+		for(size_t rejected = 0; rejected < maxRejections; ++rejected)
+		{
+			++proposed;
+			exit = proposal.exits.sample(random.uniform());
+			guard = proposal.entries.sample(random.uniform());
+			middle = proposal.middles.sample(random.uniform());
+			if(guard == exit || middle == guard || middle == exit)
+				continue;
+			if(!(random.uniform() * proposal.entryBounds[guard] < pathSelection.entryProb(guard, exit)))
+				continue;
+			if(random.uniform() * proposal.middleBounds[middle] < pathSelection.middleProb(middle, guard, exit))
+				return true;
+		}
+		return false;
+	};
+
+	// scenarios without circuits (or without tables to draw them) add nothing
+	bool drawn[4] = { false, false, false, false };
+	for(int origin : { A1, B2 })
+	{
+		const Proposal& proposal = proposals[origin];
+		drawn[origin] = proposal.scale > 0 && !proposal.exits.empty() && !proposal.entries.empty() && !proposal.middles.empty();
+	}
+
+	Estimate result;
+	if(!drawn[A1] && !drawn[B2])
+		return result;
+	Sums total;
+	size_t chunks = 0;
+	size_t chunkSamples = std::max<size_t>(settings.chunkSamples, 1);
+	size_t chunksPerBatch = std::max<size_t>(settings.chunksPerBatch, 1);
+	while(true)
+	{
+		std::vector<Sums> partial(chunksPerBatch);
+		WorkManager::runAll(settings.threads, chunksPerBatch, [&](size_t i) {
+			Observer::Local local;
+			Sums& sums = partial[i];
+			size_t guard, middle, exit;
+			for(int origin : { A1, B2 })
+			{
+				if(!drawn[origin])
+					continue;
+				Random random(settings.seed, 2 * (chunks + i) + (origin == B2));
+				for(size_t n = 0; n < chunkSamples; ++n)
+				{
+					if(!draw(proposals[origin], *pathSelections[origin], random, guard, middle, exit, sums.proposed[origin == B2]))
+					{
+						sums.failed[origin == B2] = true;
+						break;
+					}
+					if(origin == A1)
+					{
+						uint64_t observation = observer.observe(A1, SA, guard, middle, exit);
+						sums.add(SA, distinguishing(observer.probability(A1, SA, observation, A1, local), observer.probability(B1, SA, observation, A1, local)));
+						observation = observer.observe(A1, RA, guard, middle, exit);
+						sums.add(RA, distinguishing(observer.probability(A1, RA, observation, A1, local), observer.probability(A2, RA, observation, A1, local)));
+					}
+					// relationship anonymity compares A1 and B2 together with A2 and B1
+					uint64_t observation = observer.observe(origin, REL, guard, middle, exit);
+					probability_t probability = observer.probability(A1, REL, observation, origin, local) + observer.probability(B2, REL, observation, origin, local);
+					probability_t other = observer.probability(A2, REL, observation, origin, local) + observer.probability(B1, REL, observation, origin, local);
+					sums.add(origin == A1 ? REL : REL + 1, distinguishing(probability, other));
+				}
+			}
+		});
+		for(const Sums& sums : partial)
+		{
+			for(int k = 0; k < 4; ++k)
+			{
+				total.shares[k] += sums.shares[k];
+				total.squares[k] += sums.squares[k];
+			}
+			for(int k = 0; k < 2; ++k)
+			{
+				total.proposed[k] += sums.proposed[k];
+				total.failed[k] = total.failed[k] || sums.failed[k];
+			}
+		}
+		// circuits of scenarios rejecting everything are too improbable to matter
+		drawn[A1] = drawn[A1] && !total.failed[0];
+		drawn[B2] = drawn[B2] && !total.failed[1];
+		if(!drawn[A1] && !drawn[B2])
+			return Estimate();
+		chunks += chunksPerBatch;
+		result.samples = chunks * chunkSamples;
+
+		// advantage is the mass of circuits times the mean share, with variance of the mean
+		double samples = (double)result.samples;
+		double mean[4], variance[4];
+		for(int k = 0; k < 4; ++k)
+		{
+			mean[k] = total.shares[k] / samples;
+			variance[k] = std::max(0.0, total.squares[k] / samples - mean[k] * mean[k]) / samples;
+		}
+		// mass is the acceptance rate times the sums of the tables, with binomial variance of the rate
+		double mass[2] = { 0, 0 }, massVariance[2] = { 0, 0 };
+		for(int origin : { A1, B2 })
+		{
+			if(!drawn[origin])
+				continue;
+			int k = origin == B2;
+			double rate = samples / total.proposed[k];
+			mass[k] = proposals[origin].scale * rate;
+			massVariance[k] = proposals[origin].scale * proposals[origin].scale * rate * (1 - rate) / total.proposed[k];
+		}
+		// variance of the product of estimated mass and mean (both estimates are close to their values)
+		auto productVariance = [&](int k, int share) {
+			return mean[share] * mean[share] * massVariance[k] + mass[k] * mass[k] * variance[share];
+		};
+		result.sender.delta = mass[0] * mean[SA];
+		result.sender.halfWidth = settings.z * std::sqrt(productVariance(0, SA));
+		result.recipient.delta = mass[0] * mean[RA];
+		result.recipient.halfWidth = settings.z * std::sqrt(productVariance(0, RA));
+		result.relationship.delta = (mass[0] * mean[REL] + mass[1] * mean[REL + 1]) / 2;
+		result.relationship.halfWidth = settings.z * std::sqrt(productVariance(0, REL) + productVariance(1, REL + 1)) / 2;
+
+		if(result.samples >= settings.maxSamples ||
+			(result.sender.halfWidth <= settings.targetError && result.recipient.halfWidth <= settings.targetError &&
+			result.relationship.halfWidth <= settings.targetError))
+			break;
+	}
+	return result;
+}
@@ -0,0 +1,184 @@
+#ifndef CIRCUIT_SAMPLER_HPP
+#define CIRCUIT_SAMPLER_HPP
+
+/** @file */
+
+#include <vector>
+#include <thread>
+#include <cstdint>
+
+#include "types/alias_table.hpp"
+#include "types/const_vector.hpp"
+#include "types/general_exception.hpp"
+#include "consensus.hpp"
+#include "path_selection.hpp"
+
+/**
+ * Thrown if circuit sampler can not be used for the consensus.
+ */
+class sampler_exception : public general_exception
+{
+	public:
+		/**
+		 * Enum of reasons why sampler exception was thrown.
+		 */
+		enum reason
+		{
+			TOO_MANY_RELAYS /**< Relay indices do not fit into observation keys. */
+		};
+
+		/**
+		 * Constructs exception instance.
+		 * @param why reason for exception.
+		 * @param size number of relays in the consensus.
+		 * @param file name of the file file in which exception has occured.
+		 * @param line line at which exception has occured.
+		 */
+		sampler_exception(reason why, size_t size, const char* file, int line) : general_exception("", file, line)
+		{
+			reasonWhy = why;
+			switch(why)
+			{
+				case TOO_MANY_RELAYS:
+					this->message = "consensus of " + std::to_string(size) + " relays is too large for sampling.";
+					break;
+				default:
+					this->message = "unknown reason.";
+			}
+			commit_message();
+		}
+
+		/**
+		 * @copydoc general_exception::~general_exception()
+		 */
+		virtual ~sampler_exception() throw () { }
+
+		virtual int why() const { return reasonWhy; }
+
+	protected:
+		reason reasonWhy; /**< Exception reason. */
+
+		virtual const std::string& getTag() const
+		{
+			const static std::string tag = "sampler_exception";
+			return tag;
+		}
+};
+
+/**
+ * Monte Carlo estimation of the adversary's advantages computed exactly by GenericPreciseAnonymity.
+ * Circuits (guard, middle, exit) are drawn from the path selections: exits from an alias table over exit probabilities,
+ * guards and middles from alias tables over bounds of their probabilities (see PathSelection::probabilityBounds()),
+ * accepted with the ratio of the actual probability to the bound, so that accepted circuits follow the path selection exactly.
+ * The mass of all circuits (of three distinct relays) is estimated from the acceptance rate as well, as it is the product
+ * of the acceptance rate and the sums of the tables.
+ * For every drawn circuit the observation of the adversary is computed and its probabilities in the compared scenarios
+ * (summed over the relays the adversary does not see) give the share of the circuit's probability distinguishing them.
+ * The mean share estimates the advantage without bias, the sampling stops once it is known with the requested precision.
+ * Samples are drawn in chunks with their own random number streams, so estimates depend only on the seed.
+ * @see GenericPreciseAnonymity
+ */
+class CircuitSampler
+{
+	public:
+		/**
+		 * Parameters of estimation.
+		 */
+		struct Settings
+		{
+			double targetError = 0.001; /**< Half-width of confidence intervals at which sampling stops. */
+			double z = 1.96; /**< Quantile of normal distribution giving the confidence level (95% by default). */
+			uint64_t seed = 0; /**< Seed of random number streams. */
+			size_t chunkSamples = 1 << 14; /**< Number of circuits drawn in one chunk (with one random number stream). */
+			size_t chunksPerBatch = 16; /**< Number of chunks drawn before the stopping rule is checked. */
+			size_t maxSamples = 1 << 26; /**< Number of circuits after which sampling stops regardless of the precision. */
+			size_t maxRejections = 1 << 24; /**< Number of consecutive rejected circuits after which a scenario is taken to have none. */
+			unsigned threads = std::thread::hardware_concurrency(); /**< Number of threads to use. */
+		};
+
+		/**
+		 * Estimated advantage with its confidence interval.
+		 */
+		struct Interval
+		{
+			double delta = 0; /**< Estimated advantage. */
+			double halfWidth = 0; /**< Half-width of the confidence interval around the estimate. */
+		};
+
+		/**
+		 * Estimated advantages in anonymity games.
+		 */
+		struct Estimate
+		{
+			Interval sender; /**< Sender anonymity. */
+			Interval recipient; /**< Recipient anonymity. */
+			Interval relationship; /**< Relationship anonymity. */
+			size_t samples = 0; /**< Number of circuits drawn in every sampled scenario. */
+		};
+
+		// constructors
+		/**
+		 * Constructor builds alias tables for drawing circuits of the path selections.
+		 * @param consensus consensus describing Tor network state.
+		 * @param psA1 path selection for sender A and recipient 1 pair
+		 * @param psA2 path selection for sender A and recipient 2 pair
+		 * @param psB1 path selection for sender B and recipient 1 pair
+		 * @param psB2 path selection for sender B and recipient 2 pair
+		 * @param threads number of threads to use.
+		 */
+		CircuitSampler(
+			const Consensus& consensus,
+			const PathSelection& psA1,
+			const PathSelection& psA2,
+			const PathSelection& psB1,
+			const PathSelection& psB2,
+			unsigned threads = std::thread::hardware_concurrency());
+
+		// functions
+		/**
+		 * Estimates advantages of the adversary given by its observations (as for GenericPreciseAnonymity).
+		 * @param observedNodes defines the compromised connections between Tor nodes
+		 * @param observedSenderA defines the compromised connections between the sender A and Tor nodes
+		 * @param observedSenderB defines the compromised connections between the sender B and Tor nodes
+		 * @param observedRecipient1 defines the compromised connections between Tor nodes and recipient 1
+		 * @param observedRecipient2 defines the compromised connections between Tor nodes and recipient 2
+		 * @param settings parameters of estimation.
+		 * @return estimated advantages.
+		 */
+		Estimate estimate(
+			const const_vector<const_vector<bool>>& observedNodes,
+			const const_vector<bool>& observedSenderA,
+			const const_vector<bool>& observedSenderB,
+			const const_vector<bool>& observedRecipient1,
+			const const_vector<bool>& observedRecipient2,
+			const Settings& settings) const;
+
+	private:
+		/**
+		 * Tables for drawing circuits of one path selection.
+		 */
+		struct Proposal
+		{
+			std::vector<probability_t> exitProbs; /**< Exit probabilities. */
+			std::vector<probability_t> entryBounds; /**< Bound of entry probabilities of every relay. */
+			std::vector<probability_t> middleBounds; /**< Bound of middle probabilities of every relay. */
+			AliasTable exits; /**< Alias table over exit probabilities. */
+			AliasTable entries; /**< Alias table over entry bounds. */
+			AliasTable middles; /**< Alias table over middle bounds. */
+			probability_t scale = 0; /**< Product of sums of the tables, mass of all circuits divided by the acceptance rate. */
+		};
+
+		/**
+		 * Builds tables for drawing circuits of one path selection.
+		 * @param pathSelection path selection.
+		 * @param proposal tables to build.
+		 * @param threads number of threads to use.
+		 */
+		void buildProposal(const PathSelection& pathSelection, Proposal& proposal, unsigned threads);
+
+		size_t size; /**< Number of relays. */
+		const PathSelection* pathSelections[4]; /**< Path selections A1, A2, B1 and B2. */
+		Proposal proposals[4]; /**< Tables for drawing circuits of path selections A1, A2, B1 and B2. */
+};
+
+#endif
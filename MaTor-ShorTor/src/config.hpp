@@ -4,6 +4,7 @@
 /** @file */
 
 #include <string>
+#include <cstdint>
 
 static std::string emptystring("");
 
@@ -16,11 +17,14 @@ class Config : public std::enable_shared_from_this<Config>
 		// variables
 		bool precompute = false; /**< Indicates whether generic anonymity upper bound should be computed before calling any of get*Anonymity() functions. */
 		double epsilon = 1; /**< Multiplicative factor used in computations. */
-		bool fast = false; /**< Indicates whether MATor should be run in fast mode (may affect result precision). */
+		bool fast = false; /**< Indicates whether MATor should be run in fast mode (precise anonymities are estimated by sampling circuits). */
+		double sampleError = 0.001; /**< Half-width of confidence intervals of anonymities estimated in fast mode. */
+		uint64_t sampleSeed = 0; /**< Seed of random numbers used for sampling circuits in fast mode. */
 		bool useVias = false; /**< Indicates whether MATor should select vias for circtuits (if available). */
 		std::string consensusFile; /**< Consensus file name. */
 		std::string databaseFile; /**< Database file name. */
 		std::string viaAllPairsFile; /**< CSV file containing all valid circuits. */
+		std::string snapshotDirectory; /**< Directory for snapshots of computed path selections (empty to always compute them). */
 
 		Config(std::string& consensusFile, std::string& databaseFile = emptystring, std::string& viaAllPairsFile = emptystring, bool useVias = false, bool fast = false, bool precompute = false, double epsilon = 1)
 			: consensusFile(consensusFile), databaseFile(databaseFile), viaAllPairsFile(viaAllPairsFile), useVias(useVias), fast(fast), precompute(precompute), epsilon(epsilon){}
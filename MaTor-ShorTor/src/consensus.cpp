@@ -1,5 +1,9 @@
 #include "consensus.hpp"
 #include "utils.hpp"
+#include "types/mapped_file.hpp"
+#include "types/string_ref.hpp"
+#include "descriptor_pool.hpp"
+#include "relay_metadata.hpp"
 #include <chrono>
 #include <fstream>
 
@@ -9,12 +13,9 @@
 #include <sstream>
 #include <vector>
 #include <string>
-
-std::istream& operator>>(std::istream& str, CSVRow& data)
-{
-    data.readNextRow(str);
-    return str;
-}   
+#include <cstring>
+#include <limits>
+#include <algorithm>
 
 Consensus::Consensus(const std::string& consensusFileName, const std::string& DBFileName, const std::string& viaAllPairsFileName, bool useVias)
 {
@@ -28,69 +29,85 @@ Consensus::Consensus(const std::string& consensusFileName, const std::string& DB
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 
-	relations = std::unique_ptr<SymmetricMatrix<bool>>(new SymmetricMatrix<bool>(relays.size(), true));
+	fingerprintIndex = FingerprintIndex(relays);
+
+	std::vector<std::pair<uint32_t, uint32_t>> noFamilies;
+	setFamilies(noFamilies);
 	
 	if (!DBFileName.empty()) {
-		clogsn("Opening / creating database. If this is the first time this consensus file is used, this step may take a while...");
+		std::string sidecar = RelayMetadataFile::sidecarName(consensusFileName);
 		makeMeasure(start);
-		DBConnection dbConnection(DBFileName, validAfter);
-		makeMeasure(stop);
-		clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+		std::vector<std::vector<uint32_t>> families;
+		if(RelayMetadataFile::load(sidecar, RelayMetadataFile::makeKey(fingerprintIndex, validAfter, DBFileName), relays, families))
+		{
+			std::vector<std::pair<uint32_t, uint32_t>> pairs;
+			for(size_t i = 0; i < families.size(); ++i)
+				for(uint32_t member : families[i])
+					pairs.push_back(std::make_pair((uint32_t)i, member));
+			setFamilies(pairs);
+			makeMeasure(stop);
+			clogsn("Node information read from " << sidecar << " in " << measureTime(start, stop) << " ms.");
+		}
+		else
+		{
+			clogsn("No valid node information sidecar " << sidecar << ", opening database...");
+			DBConnection dbConnection(DBFileName, validAfter);
+			makeMeasure(stop);
+			clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 
-		clogsn("Loading node information...");
-		makeMeasure(start);
-		loadRelaysDBInformation(dbConnection);
-		makeMeasure(stop);
-		clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+			clogsn("Loading node information...");
+			makeMeasure(start);
+			loadRelaysDBInformation(dbConnection);
+			makeMeasure(stop);
+			clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+
+			// keyed after connecting, the connection may have added indexes to the database
+			families.resize(relays.size());
+			for(size_t i = 0; i < relays.size(); ++i)
+				families[i] = getFamily(i);
+			if(!RelayMetadataFile::save(sidecar, RelayMetadataFile::makeKey(fingerprintIndex, validAfter, DBFileName), relays, families))
+			{
+				clogsn("[Warning] Could not write node information sidecar " << sidecar << ".");
+			}
+		}
 	}
 
+	relayTable = RelayTable(relays);
 
-	viaPairs = std::vector<std::vector<std::tuple<size_t, size_t>>>(getSize()); // all pairs of relays that use this relay as a via relay
-	size_t totalNumPairs = 0;
-	size_t minNumPairs = 1 << 64;
-	size_t maxNumPairs = 0;
 
 	if (useVias && !viaAllPairsFileName.empty()) {
 
 		std::cout << "[ShorTor]: via pairs file is: " << viaAllPairsFileName << std::endl;
 
-		std::ifstream       file(viaAllPairsFileName);
-		CSVRow              row;
-		while(file >> row)
-		{
-			std::string relayFP = row[0]; // first element of the row is the via fingerprint 
-			size_t relay = fingerprintMap[relayFP];
-
-			for (size_t i = 1; i < row.size() - 1; i += 2) {
-				std::string fpr1 = row[i]; // fingerprint of first relay in the pair
-				std::string fpr2 = row[i+1]; // fingerprint of second relay in the pair
-
-				// convert fingerprints to indexes
-				size_t r1 = fingerprintMap[fpr1];
-				size_t r2 = fingerprintMap[fpr2];
-
-				// add the pair to the list
-				std::tuple<size_t, size_t> pair = std::make_tuple(r1, r2);
-				viaPairs[relay].push_back(pair);
-				
-				totalNumPairs ++;
-			}
+		makeMeasure(start);
+		viaPairs = std::make_shared<const ViaPairIndex>(viaAllPairsFileName, fingerprintIndex);
+		makeMeasure(stop);
 
-			// bookkeeping
-			if (((row.size() - 1)/2) > maxNumPairs)
-				maxNumPairs = ((row.size() - 1)/2);
-			
-			if (((row.size() - 1)/2) < minNumPairs)
-				minNumPairs = ((row.size() - 1)/2);
+		// bookkeeping
+		size_t viaRelays = 0;
+		size_t minNumPairs = std::numeric_limits<size_t>::max();
+		size_t maxNumPairs = 0;
+		for(size_t i = 0; i < viaPairs->size(); ++i)
+		{
+			size_t numPairs = viaPairs->getPairs(i).size();
+			if(numPairs == 0)
+				continue;
+			++viaRelays;
+			minNumPairs = std::min(minNumPairs, numPairs);
+			maxNumPairs = std::max(maxNumPairs, numPairs);
 		}
 
-		std::cout << "[ShorTor]: finished constructing via pairs: " << viaPairs.size() << " in total." << std::endl;
-		std::cout << "[ShorTor]: average number of pairs per via relay: " << totalNumPairs / viaPairs.size() << "." << std::endl;
-		std::cout << "[ShorTor]: average number of pairs per via relay: " << totalNumPairs / viaPairs.size() << "." << std::endl;
-		std::cout << "[ShorTor]: min number of pairs per via relay: " << minNumPairs << "." << std::endl;
-		std::cout << "[ShorTor]: max number of pairs per via relay: " << maxNumPairs << "." << std::endl;
-
+		std::cout << "[ShorTor]: finished constructing via pairs: " << viaPairs->pairsCount() << " in total (" << measureTime(start, stop) << " ms)." << std::endl;
+		if(viaRelays > 0)
+		{
+			std::cout << "[ShorTor]: average number of pairs per via relay: " << viaPairs->pairsCount() / viaRelays << "." << std::endl;
+			std::cout << "[ShorTor]: min number of pairs per via relay: " << minNumPairs << "." << std::endl;
+			std::cout << "[ShorTor]: max number of pairs per via relay: " << maxNumPairs << "." << std::endl;
+		}
 	}
+	else
+		viaPairs = std::make_shared<const ViaPairIndex>(relays.size());
+	updateContentHash();
 
 	clogsn("Consensus initialized successfully.");	
 }
@@ -100,123 +117,301 @@ Consensus::Consensus(const std::string& binaryFileName)
 	NOT_IMPLEMENTED;
 }
 
+namespace
+{
+	const uint64_t FNV_OFFSET = 14695981039346656037ull; /**< Initial value of FNV-1a hash. */
+
+	/**
+	 * Updates 64-bit FNV-1a hash with bytes.
+	 */
+	inline uint64_t fnv1a(uint64_t hash, const void* data, size_t length)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for(size_t i = 0; i < length; ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	/**
+	 * Updates 64-bit FNV-1a hash with a value.
+	 */
+	template <typename T>
+	inline uint64_t fnv1a(uint64_t hash, const T& value)
+	{
+		return fnv1a(hash, &value, sizeof(T));
+	}
+
+	/**
+	 * Updates 64-bit FNV-1a hash with a string (and its length).
+	 */
+	inline uint64_t fnv1a(uint64_t hash, const std::string& text)
+	{
+		return fnv1a(fnv1a(hash, (uint64_t)text.size()), text.data(), text.size());
+	}
+
+	/**
+	 * Maps a flag word from an "s" line to its RelayFlag bit.
+	 * Flag words are identified by their length and first character (the second character
+	 * separates Valid from V2Dir), so a single switch acts as a perfect hash; memcmp only confirms the candidate.
+	 * @param token flag word.
+	 * @return flag bit or 0 for unknown words.
+	 */
+	inline int relayFlagFromToken(const string_ref& token)
+	{
+		if(token.size() < 4)
+			return 0;
+
+		const char* candidate = nullptr;
+		int flag = 0;
+		switch((token.size() << 8) | (unsigned char)token[0])
+		{
+			case (4 << 8) | 'E': candidate = "Exit"; flag = RelayFlag::EXIT; break;
+			case (4 << 8) | 'F': candidate = "Fast"; flag = RelayFlag::FAST; break;
+			case (5 << 8) | 'G': candidate = "Guard"; flag = RelayFlag::GUARD; break;
+			case (5 << 8) | 'H': candidate = "HSDir"; flag = RelayFlag::HS_DIR; break;
+			case (5 << 8) | 'N': candidate = "Named"; flag = RelayFlag::NAMED; break;
+			case (5 << 8) | 'V':
+				if(token[1] == 'a') { candidate = "Valid"; flag = RelayFlag::VALID; }
+				else { candidate = "V2Dir"; flag = RelayFlag::V2_DIR; }
+				break;
+			case (6 << 8) | 'S': candidate = "Stable"; flag = RelayFlag::STABLE; break;
+			case (7 << 8) | 'B': candidate = "BadExit"; flag = RelayFlag::BAD_EXIT; break;
+			case (7 << 8) | 'R': candidate = "Running"; flag = RelayFlag::RUNNING; break;
+			case (7 << 8) | 'U': candidate = "Unnamed"; flag = RelayFlag::UNNAMED; break;
+			case (9 << 8) | 'A': candidate = "Authority"; flag = RelayFlag::AUTHORITY; break;
+			default: return 0;
+		}
+		return memcmp(token.data(), candidate, token.size()) == 0 ? flag : 0;
+	}
+
+	/**
+	 * Splits a line into whitespace separated tokens, reusing the output vector's storage.
+	 * @param line line to be tokenized.
+	 * @param tokens output vector of token views (cleared first).
+	 */
+	inline void tokenize(const string_ref& line, std::vector<string_ref>& tokens)
+	{
+		tokens.clear();
+		const char* it = line.begin();
+		const char* end = line.end();
+		while(it != end)
+		{
+			while(it != end && (*it == ' ' || *it == '\t' || *it == '\r'))
+				++it;
+			const char* tokenBegin = it;
+			while(it != end && *it != ' ' && *it != '\t' && *it != '\r')
+				++it;
+			if(it != tokenBegin)
+				tokens.emplace_back(tokenBegin, it - tokenBegin);
+		}
+	}
+
+	/**
+	 * Parses a decimal integer occupying the whole token.
+	 * @param token parsed token.
+	 * @param value output value.
+	 * @return false if the token is not a valid integer.
+	 */
+	inline bool parseInteger(const string_ref& token, long long& value)
+	{
+		size_t i = 0;
+		bool negative = false;
+		if(i < token.size() && (token[i] == '-' || token[i] == '+'))
+			negative = token[i++] == '-';
+		if(i == token.size())
+			return false;
+
+		value = 0;
+		for(; i < token.size(); ++i)
+		{
+			if(token[i] < '0' || token[i] > '9')
+				return false;
+			value = value * 10 + (token[i] - '0');
+		}
+		if(negative)
+			value = -value;
+		return true;
+	}
+
+	/**
+	 * Parses "key=value" token into key view and integer value.
+	 * @return false if the token is malformed.
+	 */
+	inline bool parseKeyValue(const string_ref& token, string_ref& key, long long& value)
+	{
+		size_t eq = token.find('=');
+		if(eq == std::string::npos)
+			return false;
+		key = token.substr(0, eq);
+		return parseInteger(token.substr(eq + 1), value);
+	}
+}
+
+void Consensus::updateContentHash()
+{
+	uint64_t hash = FNV_OFFSET;
+	hash = fnv1a(hash, validAfter);
+	hash = fnv1a(hash, (uint64_t)useViaRelays);
+	hash = fnv1a(hash, maxModifier);
+
+	// everything path selections read from relays
+	for(size_t i = 0; i < relays.size(); ++i)
+	{
+		const Relay& relay = relays[i];
+		hash = fnv1a(hash, relay.getFingerprint());
+		hash = fnv1a(hash, relay.getAddress().address);
+		hash = fnv1a(hash, relay.getFlags());
+		hash = fnv1a(hash, relay.getBandwidth());
+		hash = fnv1a(hash, relay.getCountry());
+		hash = fnv1a(hash, relay.getLatitude());
+		hash = fnv1a(hash, relay.getLongitude());
+		for(const Relay::PolicyDescriptor& entry : relay.getPolicy())
+		{
+			hash = fnv1a(hash, entry.isAccept);
+			hash = fnv1a(hash, entry.address.address);
+			hash = fnv1a(hash, entry.address.mask);
+			hash = fnv1a(hash, entry.portBegin);
+			hash = fnv1a(hash, entry.portEnd);
+		}
+		uint64_t familySize = familyEnd(i) - familyBegin(i);
+		hash = fnv1a(hash, familySize);
+		hash = fnv1a(hash, familyBegin(i), familySize * sizeof(uint32_t));
+		if(useViaRelays)
+		{
+			auto pairs = getPairsForVia(i);
+			hash = fnv1a(hash, (uint64_t)pairs.size());
+			hash = fnv1a(hash, pairs.begin(), pairs.size() * sizeof(ViaPair));
+		}
+	}
+	contentHash = hash;
+}
+
 void Consensus::loadConsensusFile(const std::string& fileName)
 {
-	std::ifstream consensusStream(fileName);
-	if (!consensusStream.is_open())
+	MappedFile consensusFile(fileName);
+	if (!consensusFile.is_open())
 		throw_exception(consensus_exception, consensus_exception::OPEN_FILE, fileName);
-	
-	std::string line;
-	
-	// auxiliary variables;
-	std::string name;
-	std::string ipAddr;
-	std::string published;
-	std::string fingerprint;
-	std::string version;
-	int flags, bandwidth;
-	
+
+	// tokens of the current line, storage reused between lines
+	std::vector<string_ref> tokens;
+	tokens.reserve(32);
+
+	// auxiliary variables (views into the mapped file)
+	string_ref name;
+	string_ref ipAddr;
+	string_ref fingerprint;
+	string_ref publishedDate;
+	string_ref publishedTime;
+	string_ref version;
+	int flags = 0;
+	int bandwidth = 0;
+	long long value;
+
 	// initialize max modifier
 	maxModifier = 0;
-	
+
 	// relay's position in relays vector
 	size_t registerNumber = 0;
-	
+
+	auto emitRelay = [&]()
+	{
+		std::string published;
+		published.reserve(publishedDate.size() + 1 + publishedTime.size());
+		published.append(publishedDate.data(), publishedDate.size()).append(1, ' ').append(publishedTime.data(), publishedTime.size());
+		relays.emplace_back(registerNumber, name.str(), b64toHex(fingerprint.data(), fingerprint.size()), published,
+			ipAddr.str(), flags, bandwidth, version.empty() ? std::string("unknown") : version.str());
+		++registerNumber;
+	};
+
+	auto readRelayLine = [&]()
+	{
+		name = tokens[1];
+		fingerprint = tokens[2];
+		publishedDate = tokens[4];
+		publishedTime = tokens[5];
+		ipAddr = tokens[6];
+		version = string_ref();
+		flags = 0;
+		bandwidth = 0;
+	};
+
+	const char* cursor = consensusFile.data();
+	const char* fileEnd = cursor + consensusFile.size();
+
 	// State machine parsing consensus file.
 	int state = 0;
-	while(getline(consensusStream, line))
+	while(cursor != fileEnd && state != 4)
 	{
-		// should we use right trim on line?
+		const char* lineEnd = (const char*)memchr(cursor, '\n', fileEnd - cursor);
+		if(!lineEnd)
+			lineEnd = fileEnd;
+		string_ref line(cursor, lineEnd - cursor);
+		cursor = lineEnd == fileEnd ? fileEnd : lineEnd + 1;
+
 		try
 		{
-			std::vector<std::string> tokens = split(line);
+			tokenize(line, tokens);
 			if(!tokens.size())
 				continue;
-			
+
 			switch(state)
 			{
 				case 0: // parsing header of the consensus file
 					if(tokens[0] == "valid-after")
 					{
 						if(tokens.size() < 3)
-							throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line);
-						
-						validAfter = tokens[1] + " " + tokens[2];
+							throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line.str());
+
+						validAfter = tokens[1].str() + " " + tokens[2].str();
 						state = 1;
-					}						
+					}
 					break;
 				case 1: // looking for the first relay description
 					if(tokens[0] == "r") // beginning relays description
 					{
 						if(tokens.size() < 7)
-							throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line);
-						
+							throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line.str());
+
 						// parse the first relay's r line
-						name = tokens[1];
-						fingerprint = b64toHex(tokens[2]);
-						published = tokens[4] + " " + tokens[5];
-						ipAddr = tokens[6];
-						
+						readRelayLine();
 						state = 2;
-						version = "unknown";
-						flags = 0;
-						bandwidth = 0;
 					}
 					break;
 				case 2: // parsing relays description
 					switch(tokens[0][0])
 					{
 						case 'r': // relay's main description
-							relays.emplace_back(registerNumber, name, fingerprint, published, ipAddr, flags, bandwidth, version);
-							++registerNumber;
-							
+							emitRelay();
+
 							if(tokens.size() < 7)
-								throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line);
-							
-							name = tokens[1];
-							fingerprint = b64toHex(tokens[2]);
-							published = tokens[4] + " " + tokens[5];
-							ipAddr = tokens[6];
-							version = "unknown";
-							flags = 0;
-							bandwidth = 0;
+								throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line.str());
+
+							readRelayLine();
 							break;
 						case 's': // relay's flags
-							flags |= (findToken(tokens, "Authority") ? RelayFlag::AUTHORITY : 0);
-							flags |= (findToken(tokens, "BadExit") ? RelayFlag::BAD_EXIT : 0);
-							flags |= (findToken(tokens, "Exit") ? RelayFlag::EXIT : 0);
-							flags |= (findToken(tokens, "Fast") ? RelayFlag::FAST : 0);
-							flags |= (findToken(tokens, "Guard") ? RelayFlag::GUARD : 0);
-							flags |= (findToken(tokens, "HSDir") ? RelayFlag::HS_DIR : 0);
-							flags |= (findToken(tokens, "Named") ? RelayFlag::NAMED : 0);
-							flags |= (findToken(tokens, "Stable") ? RelayFlag::STABLE : 0);
-							flags |= (findToken(tokens, "Running") ? RelayFlag::RUNNING : 0);
-							flags |= (findToken(tokens, "Unnamed") ? RelayFlag::UNNAMED : 0);
-							flags |= (findToken(tokens, "Valid") ? RelayFlag::VALID : 0);
-							flags |= (findToken(tokens, "V2Dir") ? RelayFlag::V2_DIR : 0);
+							for(size_t i = 1; i < tokens.size(); ++i)
+								flags |= relayFlagFromToken(tokens[i]);
 							break;
 						case 'w': // relay's bandwidth
 							{
 								if(tokens.size() < 2)
-									throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line);
-								
-								std::vector<std::string> parts = split(tokens[1], '=');
-								
-								if(parts.size() < 2)
-									throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line);
-								
-								bandwidth = std::stoi(parts[1]);
+									throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line.str());
+
+								string_ref key;
+								if(!parseKeyValue(tokens[1], key, value))
+									throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line.str());
+
+								bandwidth = (int)value;
 							}
 							break;
 						case 'v': // relay's Tor version
 							if(tokens.size() < 3)
-								throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line);
+								throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line.str());
 							version = tokens[2];
 							break;
 						case 'd': // directory footer
 							// save the last relay
-							relays.emplace_back(registerNumber, name, fingerprint, published, ipAddr, flags, bandwidth, version);
-							++registerNumber;
+							emitRelay();
 							state = 3;
 							break;
 						default:
@@ -227,36 +422,36 @@ void Consensus::loadConsensusFile(const std::string& fileName)
 					{
 						if(tokens[0] == "bandwidth-weights")
 						{
-							for(int i = 1; i < tokens.size(); ++i)
+							for(size_t i = 1; i < tokens.size(); ++i)
 							{
-								std::vector<std::string> mods = split(tokens[i], '=');
-								if(mods.size() < 2)
-									throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line);
-								
-								weight_t weight = (weight_t)std::stoi(mods[1]);
-								if(mods[0] == "Wed")
+								string_ref mod;
+								if(!parseKeyValue(tokens[i], mod, value))
+									throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line.str());
+
+								weight_t weight = (weight_t)value;
+								if(mod == "Wed")
 									weightMods.wed = weight;
-								else if(mods[0] == "Weg")
+								else if(mod == "Weg")
 									weightMods.weg = weight;
-								else if(mods[0] == "Wee")
+								else if(mod == "Wee")
 									weightMods.wee = weight;
-								else if(mods[0] == "Wem")
+								else if(mod == "Wem")
 									weightMods.wem = weight;
-								else if(mods[0] == "Wgd")
+								else if(mod == "Wgd")
 									weightMods.wgd = weight;
-								else if(mods[0] == "Wgg")
+								else if(mod == "Wgg")
 									weightMods.wgg = weight;
-								else if(mods[0] == "Wgm")
+								else if(mod == "Wgm")
 									weightMods.wgm = weight;
-								else if(mods[0] == "Wmd")
+								else if(mod == "Wmd")
 									weightMods.wmd = weight;
-								else if(mods[0] == "Wmg")
+								else if(mod == "Wmg")
 									weightMods.wmg = weight;
-								else if(mods[0] == "Wme")
+								else if(mod == "Wme")
 									weightMods.wme = weight;
-								else if(mods[0] == "Wmm")
+								else if(mod == "Wmm")
 									weightMods.wmm = weight;
-								
+
 								if(weight > maxModifier)
 									maxModifier = weight;
 							}
@@ -268,14 +463,18 @@ void Consensus::loadConsensusFile(const std::string& fileName)
 					break;
 			}
 		}
-		catch(std::exception)
+		catch(consensus_exception&)
 		{
-			throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line);
+			throw;
+		}
+		catch(std::exception&)
+		{
+			throw_exception(consensus_exception, consensus_exception::INVALID_FORMAT, fileName, line.str());
 		}
 	}
 	if(state != 4)
 		throw_exception(consensus_exception, consensus_exception::INSUFFICIENT_FILE, fileName);
-		
+
 	clogvn("There are " << relays.size() << " relays declared.");
 	// parsing done.
 }
@@ -284,47 +483,96 @@ void Consensus::loadRelaysDBInformation(const DBConnection& dbConnection)
 {
 	size_t size = relays.size();
 	
-	// mapping relays' fingerprints to position in relays vector...
 	std::vector<std::string> fingerprintVector = std::vector<std::string>(size);
 	for(size_t i = 0; i < size; ++i)
-	{
 		fingerprintVector[i] = relays[i].getFingerprint();
-		fingerprintMap[relays[i].getFingerprint()] = i;
-	}
-	
-	// reading single relay information from DB in chunks...
-	int chunkSize = 500;
-	clogsn("reading single relay information from DB in chunks...");
-	for(size_t i=0; i < size; i+=chunkSize)
+
+	// reading relays information and families from DB at once...
+	DescriptorPool pool;
+	std::vector<bool> filled(size, false);
+	clogsn("reading relays information from DB...");
+	DBConnection::RelaysInfo info = dbConnection.readRelays(fingerprintVector);
+	for(const auto& record : info.descriptors)
 	{
-		auto resultVector = dbConnection.readRelaysInfo(fingerprintVector.begin() + i, i + chunkSize >= size ? fingerprintVector.end() : fingerprintVector.begin() + i + chunkSize);
-		for(const auto& row : resultVector)
-		{
-			Relay &filledRelay = relays[fingerprintMap[row[0]]];
-			filledRelay.setAveragedBandwidth(std::stoi(row[1]));
-			filledRelay.setPlatform(row[2]);
-			filledRelay.addPolicy(row[3]);
-			clogsn("Found policy: " << row[3] << " for relay " << row[8]);
-			filledRelay.setCountry(row[4]);
-			filledRelay.setLatitude(std::stof(row[5]));
-			filledRelay.setLongitude(std::stof(row[6]));
-			filledRelay.setASNumber("AS" + row[7]);
-			filledRelay.setASName(row[8]);
-		}
+		Relay &filledRelay = relays[record.position];
+		clogsn("Found policy: " << record.exitPolicy << " for relay " << record.ASName);
+		// several descriptors may be valid at once, their policies accumulate
+		if(filled[record.position])
+			filledRelay.setDescriptor(DescriptorPool::merge(filledRelay.getDescriptor(), pool.makeDescriptor(record)));
+		else
+			filledRelay.setDescriptor(pool.makeDescriptor(record));
+		filled[record.position] = true;
 	}
 
 	// assigning families...
 	clogsn("Assigning families");
-	auto resultVector = dbConnection.readFamilies();
-	for(const auto& row : resultVector)
+	assignFamilies(info.families);
+}
+
+void Consensus::assignFamilies(const std::vector<DBConnection::FamilyRecord>& families)
+{
+	std::vector<std::pair<uint32_t, uint32_t>> pairs;
+	for(const auto& family : families)
 	{
-		if(!fingerprintMap.count(row[0]) || !fingerprintMap.count(row[1]))
+		if(!(family.startTime <= validAfter && family.endTime > validAfter))
 			continue;
-		
-		int nodeA = fingerprintMap[row[0]];
-		int nodeB = fingerprintMap[row[1]];
-		(*relations)[nodeA][nodeB] = true;
+
+		pairs.push_back(std::make_pair((uint32_t)family.first, (uint32_t)family.second));
+		pairs.push_back(std::make_pair((uint32_t)family.second, (uint32_t)family.first));
+	}
+	setFamilies(pairs);
+}
+
+void Consensus::setFamilies(std::vector<std::pair<uint32_t, uint32_t>>& pairs)
+{
+	std::sort(pairs.begin(), pairs.end());
+	pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+	size_t size = relays.size();
+	familyOffsets.assign(size + 1, 0);
+	familyMembers.resize(pairs.size());
+	for(size_t p = 0; p < pairs.size(); ++p)
+	{
+		++familyOffsets[pairs[p].first + 1];
+		familyMembers[p] = pairs[p].second;
+	}
+	for(size_t i = 0; i < size; ++i)
+		familyOffsets[i + 1] += familyOffsets[i];
+
+	// union-find over family relations, every relay ends up labelled by the root of its component
+	familyID.resize(size);
+	for(size_t i = 0; i < size; ++i)
+		familyID[i] = (uint32_t)i;
+	auto root = [this](uint32_t relay) {
+		while(familyID[relay] != relay)
+			relay = familyID[relay] = familyID[familyID[relay]];
+		return relay;
+	};
+	for(const auto& pair : pairs)
+	{
+		uint32_t a = root(pair.first), b = root(pair.second);
+		if(a != b)
+			familyID[std::max(a, b)] = std::min(a, b);
 	}
+	for(size_t i = 0; i < size; ++i)
+		familyID[i] = root((uint32_t)i);
+}
+
+size_t Consensus::memoryUsage() const
+{
+	size_t bytes = relays.capacity() * sizeof(Relay);
+	for(const Relay& relay : relays)
+	{
+		bytes += relay.getName().capacity() + relay.getFingerprint().capacity() + relay.getPublishedDate().capacity() + relay.getVersion().capacity();
+		bytes += sizeof(Relay::Descriptor) + relay.getPolicy().size() * sizeof(Relay::PolicyDescriptor);
+	}
+
+	bytes += (familyOffsets.capacity() + familyMembers.capacity() + familyID.capacity()) * sizeof(uint32_t);
+
+	bytes += relayTable.memoryUsage() + fingerprintIndex.memoryUsage();
+	if(viaPairs)
+		bytes += viaPairs->memoryUsage();
+	return bytes;
 }
 
 void Consensus::saveBinary(const std::string& output) const
@@ -8,13 +8,16 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 #include "relay.hpp"
+#include "relay_table.hpp"
+#include "via_pairs.hpp"
+#include "fingerprint_index.hpp"
 #include "db_connection.hpp"
 #include "utils.hpp"
 
 #include "types/general_exception.hpp"
-#include "types/symmetric_matrix.hpp"
 
 
 /**
@@ -131,15 +134,30 @@ class Consensus : public std::enable_shared_from_this<Consensus>
 		 */
 		Consensus(const std::string& binaryFileName);
 
-		Consensus(const Consensus& consensus)
-			: relations(new SymmetricMatrix<bool>(*consensus.relations)), weightMods(consensus.weightMods), 
-			maxModifier(consensus.maxModifier), validAfter(consensus.validAfter), 
-			fingerprintMap(consensus.fingerprintMap), viaPairs(consensus.viaPairs), useViaRelays(consensus.useViaRelays), relays(consensus.relays) {}
+		/**
+		 * Copies all members (the via pair index is shared), the copy is not owned by any shared pointer of the original
+		 * (copying enable_shared_from_this leaves its reference empty).
+		 */
+		Consensus(const Consensus& consensus) = default;
 		
 		
-		const std::vector<std::tuple<size_t,size_t>>& getPairsForVia(size_t via) const 
+		/**
+		 * Returns pairs of relays which may use the relay as a via ([ShorTor]).
+		 * @param via position of the via relay in relays vector.
+		 */
+		ViaPairIndex::Range<ViaPair> getPairsForVia(size_t via) const 
+		{
+			return viaPairs->getPairs(via);
+		}
+
+		/**
+		 * Returns via relays which may be used by a pair of relays ([ShorTor]).
+		 * @param first position of the first relay of the pair in relays vector.
+		 * @param second position of the second relay of the pair in relays vector.
+		 */
+		ViaPairIndex::Range<ViaPairIndex::id_t> getViasForPair(size_t first, size_t second) const
 		{
-			return viaPairs[via];
+			return viaPairs->getVias(first, second);
 		}
 
 
@@ -159,6 +177,8 @@ class Consensus : public std::enable_shared_from_this<Consensus>
 		void forceSetRelayFlag(size_t relayPos, RelayFlag flag, bool v)
 		{
 			relays[relayPos].setFlag(flag, v);
+			relayTable.setFlags(relayPos, relays[relayPos].getFlags());
+			updateContentHash();
 		}
 
 		/**
@@ -169,6 +189,15 @@ class Consensus : public std::enable_shared_from_this<Consensus>
 			return relays;
 		}
 		
+		/**
+		 * Returns columnar view of relays' hot fields (flags, bandwidth, address, position, country, AS).
+		 * Prefer it over getRelays() in loops over all relays.
+		 */
+		const RelayTable& getRelayTable() const
+		{
+			return relayTable;
+		}
+
 		/**
 		 * Returns weight modifier specified in consensus file
 		 * for chosen relay role and flags.
@@ -197,16 +226,63 @@ class Consensus : public std::enable_shared_from_this<Consensus>
 		void saveBinary(const std::string& output) const;
 		
 		/**
-		 * Checks whether relays are related. Relays are related if they are in the same subnet
-		 * or they declare each other as family in descriptors.
+		 * Checks whether relays are related, i.e. they declare each other as family in descriptors.
+		 * Relays of different family components are rejected at once, otherwise the (short) family is searched.
 		 * @param relay1 first relay of the pair to be tested.
 		 * @param relay2 second relay of the pair to be tested.
 		 */
 		bool isRelated(size_t relay1, size_t relay2) const
 		{
-			return (*relations)[relay1][relay2];
+			return familyID[relay1] == familyID[relay2] && std::binary_search(familyBegin(relay1), familyEnd(relay1), (uint32_t)relay2);
 		}
 		
+		/**
+		 * Returns relays declared as family of the relay (in descriptors).
+		 * @param relay position of a relay in relays vector.
+		 * @return sorted positions of the relay's family members.
+		 * @see familyBegin()
+		 */
+		std::vector<uint32_t> getFamily(size_t relay) const
+		{
+			return std::vector<uint32_t>(familyBegin(relay), familyEnd(relay));
+		}
+
+		/**
+		 * @param relay position of a relay in relays vector.
+		 * @return pointer to the first of sorted positions of the relay's family members.
+		 */
+		const uint32_t* familyBegin(size_t relay) const
+		{
+			return familyMembers.data() + familyOffsets[relay];
+		}
+
+		/**
+		 * @param relay position of a relay in relays vector.
+		 * @return pointer after the last position of the relay's family members.
+		 */
+		const uint32_t* familyEnd(size_t relay) const
+		{
+			return familyMembers.data() + familyOffsets[relay + 1];
+		}
+		
+		/**
+		 * @return consensus date declared in consensus file (valid-after) in YYYY-MM-DD hh:mm:ss format.
+		 */
+		const std::string& getValidAfter() const
+		{
+			return validAfter;
+		}
+
+		/**
+		 * Content hash is computed whenever the information of relays changes, so it is cheap to compare.
+		 * @return hash of everything path selections read from the consensus (date, modifiers, relays with their information,
+		 * families and via pairs), equal for consensuses of the same content.
+		 */
+		uint64_t getContentHash() const
+		{
+			return contentHash;
+		}
+
 		/**
 		 * @return number of relays registered in consensus.
 		 */
@@ -230,11 +306,11 @@ class Consensus : public std::enable_shared_from_this<Consensus>
 		 */
 		const Relay* findRelayByFingerprint(const std::string& fingerprint) const
 		{
-			auto found = fingerprintMap.find(fingerprint);
-			if(found == fingerprintMap.end())
+			size_t found = fingerprintIndex.find(fingerprint);
+			if(found == FingerprintIndex::NOT_FOUND)
 				return nullptr;
 			else
-				return &relays[found->second];
+				return &relays[found];
 		}
 
 		/**
@@ -244,11 +320,22 @@ class Consensus : public std::enable_shared_from_this<Consensus>
 		 */
 		const size_t findRelayIndexByFingerprint(const std::string& fingerprint) const
 		{
-			auto found = fingerprintMap.find(fingerprint);
-			if(found == fingerprintMap.end())
-				return -1;
-			else
-				return found->second;
+			return fingerprintIndex.find(fingerprint);
+		}
+
+		/**
+		 * Estimates memory used by the consensus (relays, relations, indexes and via pairs).
+		 * Descriptors shared with other consensuses are counted as well.
+		 * @return approximate number of bytes.
+		 */
+		size_t memoryUsage() const;
+
+		/**
+		 * @return index mapping fingerprints to positions in relays vector.
+		 */
+		const FingerprintIndex& getFingerprintIndex() const
+		{
+			return fingerprintIndex;
 		}
 
 
@@ -264,19 +351,41 @@ class Consensus : public std::enable_shared_from_this<Consensus>
 		/**
 		 * Helper function for loading additional relays information from database.
 		 * Database contains descriptors information (such as platform, country or family relations).
-		 * If no database exists or database seems to be corrupted, this function will also (re)create it.
 		 * @param dbConnection database connection handle
 		 */
 		void loadRelaysDBInformation(const DBConnection& dbConnection);
+
+		/**
+		 * Marks relays declaring each other as family as related.
+		 * Records are used only if the consensus date is within their validity period.
+		 * @param families records with positions of relays in this consensus.
+		 */
+		void assignFamilies(const std::vector<DBConnection::FamilyRecord>& families);
+
+		/**
+		 * Stores family relations as sorted rows and finds family components.
+		 * @param pairs pairs of related relays (in both directions, may repeat).
+		 */
+		void setFamilies(std::vector<std::pair<uint32_t, uint32_t>>& pairs);
+
+		/**
+		 * Recomputes the content hash after relays' information has changed.
+		 * @see getContentHash()
+		 */
+		void updateContentHash();
 		
 		// variables
-		std::vector<std::vector<std::tuple<size_t, size_t>>> viaPairs; /** vector of all valid circuits (G M X) with (V1 V2) vias (if present)**/
-		std::unique_ptr<SymmetricMatrix<bool>> relations; /**< Matrix of relays relations. if (a,b) is true, then relay a is related to relay b. */
+		std::shared_ptr<const ViaPairIndex> viaPairs; /**< Index of via relays of all valid circuits (shared between copies). */
 		std::vector<Relay> relays; /**< Vector of relays in Tor network described by consensus file. */
-		std::map<std::string, size_t> fingerprintMap; /**< Maps relay's fingerprints to their position in relays vector. */
+		RelayTable relayTable; /**< Columnar view of relays, rebuilt whenever relays' information changes. */
+		std::vector<uint32_t> familyOffsets; /**< Start of every relay's family in familyMembers (and their total count at the end). */
+		std::vector<uint32_t> familyMembers; /**< Sorted family members of all relays, relay after relay. */
+		std::vector<uint32_t> familyID; /**< Family component of every relay, relays of different components are never related. */
+		FingerprintIndex fingerprintIndex; /**< Maps relay's fingerprints to their position in relays vector. */
 		std::string validAfter; /**< Consensus date declared in consensus file. */
 		weight_t maxModifier; /**< Maximal modifier specified in consensus file. */
 		bool useViaRelays; 
+		uint64_t contentHash; /**< Hash of the content of the consensus (see getContentHash()). */
 
 
 		struct WeightMods
@@ -339,43 +448,8 @@ class Consensus : public std::enable_shared_from_this<Consensus>
 				}
 			}		
 		} weightMods; /**< Structure remembers weights modifiers specified in consensus and allows easy access to these values. */
-};
-
 
-
-/**
-* [ShorTor] uses this class for parsing CSV files, specifically the valid circuits csv file
-*/
-class CSVRow
-{
-    public:
-        std::string operator[](std::size_t index) const
-        {
-            return std::string(&m_line[m_data[index] + 1], m_data[index + 1] -  (m_data[index] + 1));
-        }
-        std::size_t size() const
-        {
-            return m_data.size() - 1;
-        }
-        void readNextRow(std::istream& str)
-        {
-            std::getline(str, m_line);
-
-            m_data.clear();
-            m_data.emplace_back(-1);
-            std::string::size_type pos = 0;
-            while((pos = m_line.find(',', pos)) != std::string::npos)
-            {
-                m_data.emplace_back(pos);
-                ++pos;
-            }
-            // This checks for a trailing comma with no data after it.
-            pos   = m_line.size();
-            m_data.emplace_back(pos);
-        }
-    private:
-        std::string         m_line;
-        std::vector<int>    m_data;
+		friend class ConsensusSeries;
 };
 
 #endif
@@ -0,0 +1,137 @@
+#include "consensus_cache.hpp"
+
+#include <tuple>
+#include <sys/stat.h>
+
+const size_t ConsensusCache::DEFAULT_BUDGET;
+
+ConsensusCache::FileIdentity::FileIdentity(const std::string& path) : path(path), size(0), mtime(0)
+{
+	struct stat st;
+	if(path.empty() || stat(path.c_str(), &st) != 0)
+		return;
+	size = (uint64_t)st.st_size;
+	mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+bool ConsensusCache::FileIdentity::operator<(const FileIdentity& other) const
+{
+	return std::tie(path, size, mtime) < std::tie(other.path, other.size, other.mtime);
+}
+
+bool ConsensusCache::Key::operator<(const Key& other) const
+{
+	return std::tie(consensus, database, viaPairs, useVias) < std::tie(other.consensus, other.database, other.viaPairs, other.useVias);
+}
+
+ConsensusCache& ConsensusCache::instance()
+{
+	static ConsensusCache cache;
+	return cache;
+}
+
+std::shared_ptr<const Consensus> ConsensusCache::get(const std::string& consensusFileName, const std::string& DBFileName,
+	const std::string& viaAllPairsFileName, bool useVias)
+{
+	Key key = { FileIdentity(consensusFileName), FileIdentity(DBFileName), FileIdentity(viaAllPairsFileName), useVias };
+
+	std::promise<std::shared_ptr<const Consensus>> promise;
+	std::shared_future<std::shared_ptr<const Consensus>> loaded;
+	size_t load = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = entries.find(key);
+		if(found != entries.end())
+		{
+			recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, found->second.use);
+			loaded = found->second.consensus;
+		}
+		else
+		{
+			// other threads asking for the same consensus wait for this one
+			load = ++loads;
+			recentlyUsed.push_front(key);
+			entries[key] = Entry{ promise.get_future().share(), 0, load, recentlyUsed.begin() };
+		}
+	}
+	if(loaded.valid())
+		return loaded.get();
+
+	std::shared_ptr<const Consensus> consensus;
+	try
+	{
+		consensus = std::make_shared<const Consensus>(consensusFileName, DBFileName, viaAllPairsFileName, useVias);
+	}
+	catch(...)
+	{
+		promise.set_exception(std::current_exception());
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = entries.find(key);
+		if(found != entries.end() && found->second.load == load)
+		{
+			recentlyUsed.erase(found->second.use);
+			entries.erase(found);
+		}
+		throw;
+	}
+	promise.set_value(consensus);
+
+	size_t bytes = consensus->memoryUsage();
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = entries.find(key);
+	if(found != entries.end() && found->second.load == load) // not dropped by clear() meanwhile
+	{
+		found->second.bytes = bytes;
+		usage += bytes;
+		evict();
+	}
+	return consensus;
+}
+
+void ConsensusCache::evict()
+{
+	auto it = recentlyUsed.end();
+	while(usage > budget && it != recentlyUsed.begin())
+	{
+		--it;
+		auto found = entries.find(*it);
+		if(found->second.bytes == 0) // still loading
+			continue;
+		usage -= found->second.bytes;
+		entries.erase(found);
+		it = recentlyUsed.erase(it);
+	}
+}
+
+void ConsensusCache::setBudget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	budget = bytes;
+	evict();
+}
+
+size_t ConsensusCache::getBudget() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return budget;
+}
+
+size_t ConsensusCache::memoryUsage() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return usage;
+}
+
+size_t ConsensusCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
+
+void ConsensusCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	recentlyUsed.clear();
+	usage = 0;
+}
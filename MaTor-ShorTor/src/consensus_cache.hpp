@@ -0,0 +1,135 @@
+#ifndef CONSENSUS_CACHE_HPP
+#define CONSENSUS_CACHE_HPP
+
+/** @file */
+
+#include <string>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <cstdint>
+
+#include "consensus.hpp"
+
+/**
+ * Process-wide cache of loaded consensuses.
+ * Consensuses are keyed by identity (path, size and modification time) of the consensus,
+ * database and via pairs files and by the useVias switch, so a file modified on disk is loaded again.
+ * Cached consensuses are shared (and must not be modified) by their users.
+ * Every consensus is loaded once even if requested by many threads at the same time.
+ * When estimated memory of cached consensuses exceeds the budget, least recently used ones are dropped
+ * (they stay alive as long as somebody holds them).
+ */
+class ConsensusCache
+{
+	public:
+		static const size_t DEFAULT_BUDGET = (size_t)4 << 30; /**< Default memory budget (4 GiB). */
+
+		// functions
+		/**
+		 * @return the process-wide cache.
+		 */
+		static ConsensusCache& instance();
+
+		/**
+		 * Returns cached consensus or loads it.
+		 * @param consensusFileName name of consensus file.
+		 * @param DBFileName name of .sqlite database file.
+		 * @param viaAllPairsFileName map of valid circuits (csv file).
+		 * @param useVias whether to use via relays.
+		 * @throw consensus_exception if the consensus cannot be loaded (the failure is not cached).
+		 * @return shared consensus.
+		 */
+		std::shared_ptr<const Consensus> get(const std::string& consensusFileName, const std::string& DBFileName,
+			const std::string& viaAllPairsFileName, bool useVias);
+
+		/**
+		 * Sets memory budget and drops consensuses exceeding it.
+		 * @param bytes memory budget in bytes (0 disables caching).
+		 */
+		void setBudget(size_t bytes);
+
+		/**
+		 * @return memory budget in bytes.
+		 */
+		size_t getBudget() const;
+
+		/**
+		 * @return estimated memory of cached consensuses in bytes.
+		 */
+		size_t memoryUsage() const;
+
+		/**
+		 * @return number of cached (or currently loading) consensuses.
+		 */
+		size_t size() const;
+
+		/**
+		 * Drops all loaded consensuses.
+		 */
+		void clear();
+
+	private:
+		/**
+		 * Identity of a file on disk.
+		 */
+		struct FileIdentity
+		{
+			std::string path; /**< File name. */
+			uint64_t size; /**< File size in bytes (0 for missing files). */
+			int64_t mtime; /**< Modification time in nanoseconds (0 for missing files). */
+
+			/**
+			 * Reads identity of the file.
+			 * @param path file name (may be empty).
+			 */
+			FileIdentity(const std::string& path);
+
+			bool operator<(const FileIdentity& other) const;
+		};
+
+		/**
+		 * Cache key.
+		 */
+		struct Key
+		{
+			FileIdentity consensus; /**< Consensus file. */
+			FileIdentity database; /**< Database file. */
+			FileIdentity viaPairs; /**< Via pairs file. */
+			bool useVias; /**< Whether via relays are used. */
+
+			bool operator<(const Key& other) const;
+		};
+
+		/**
+		 * Cached consensus.
+		 */
+		struct Entry
+		{
+			std::shared_future<std::shared_ptr<const Consensus>> consensus; /**< Consensus (ready once loaded). */
+			size_t bytes; /**< Estimated memory of the consensus (0 while loading). */
+			size_t load; /**< Number of the load which created the entry. */
+			std::list<Key>::iterator use; /**< Position in the recently used list. */
+		};
+
+		ConsensusCache() { }
+		ConsensusCache(const ConsensusCache&) = delete;
+		ConsensusCache& operator=(const ConsensusCache&) = delete;
+
+		/**
+		 * Drops least recently used loaded consensuses until memory fits the budget.
+		 * Expects the mutex to be locked.
+		 */
+		void evict();
+
+		mutable std::mutex mutex; /**< Guards all members. */
+		std::map<Key, Entry> entries; /**< Cached consensuses. */
+		std::list<Key> recentlyUsed; /**< Keys of entries, most recently used first. */
+		size_t budget = DEFAULT_BUDGET; /**< Memory budget in bytes. */
+		size_t usage = 0; /**< Estimated memory of loaded consensuses in bytes. */
+		size_t loads = 0; /**< Number of loads started. */
+};
+
+#endif
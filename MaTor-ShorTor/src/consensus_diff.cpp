@@ -0,0 +1,51 @@
+#include "consensus_diff.hpp"
+
+#include <algorithm>
+
+ConsensusDiff::ConsensusDiff(const Consensus& oldConsensus, const Consensus& newConsensus)
+	: oldPositions(newConsensus.getSize()), changedRelay(newConsensus.getSize(), false), oldRelaysCount(oldConsensus.getSize())
+{
+	size_t size = newConsensus.getSize();
+	const FingerprintIndex& oldIndex = oldConsensus.getFingerprintIndex();
+	const FingerprintIndex& newIndex = newConsensus.getFingerprintIndex();
+
+	std::vector<size_t> newPositions(oldRelaysCount, FingerprintIndex::NOT_FOUND);
+	for(size_t i = 0; i < size; ++i)
+	{
+		oldPositions[i] = oldIndex.find(newIndex.getDigest(i));
+		if(oldPositions[i] != FingerprintIndex::NOT_FOUND)
+			newPositions[oldPositions[i]] = i;
+	}
+	for(size_t i = 0; i < oldRelaysCount; ++i)
+		if(newPositions[i] == FingerprintIndex::NOT_FOUND)
+			removed.push_back(i);
+
+	std::vector<uint32_t> oldFamily, newFamily;
+	for(size_t i = 0; i < size; ++i)
+	{
+		size_t old = oldPositions[i];
+		if(old == FingerprintIndex::NOT_FOUND ||
+			oldConsensus.getRelayTable().getPrefix(old) != newConsensus.getRelayTable().getPrefix(i))
+		{
+			changedRelay[i] = true;
+			changed.push_back(i);
+			continue;
+		}
+
+		// families compared in new positions, relays missing in either consensus do not matter
+		oldFamily.clear();
+		for(const uint32_t* member = oldConsensus.familyBegin(old); member != oldConsensus.familyEnd(old); ++member)
+			if(newPositions[*member] != FingerprintIndex::NOT_FOUND)
+				oldFamily.push_back((uint32_t)newPositions[*member]);
+		newFamily.clear();
+		for(const uint32_t* member = newConsensus.familyBegin(i); member != newConsensus.familyEnd(i); ++member)
+			if(oldPositions[*member] != FingerprintIndex::NOT_FOUND)
+				newFamily.push_back(*member);
+		std::sort(oldFamily.begin(), oldFamily.end());
+		if(oldFamily != newFamily)
+		{
+			changedRelay[i] = true;
+			changed.push_back(i);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef CONSENSUS_DIFF_HPP
+#define CONSENSUS_DIFF_HPP
+
+/** @file */
+
+#include <vector>
+#include <cstdint>
+
+#include "consensus.hpp"
+
+/**
+ * Difference between two consensuses (typically consecutive hourly ones).
+ * Relays of the new consensus are matched with relays of the old one by fingerprint.
+ * A relay is changed if it is new, or if its subnet or its family (restricted to relays
+ * present in both consensuses) differs. Relations between two unchanged relays
+ * are the same in both consensuses and may be carried over.
+ * @see SubnetRelations
+ */
+class ConsensusDiff
+{
+	public:
+		// constructors
+		/**
+		 * Matches relays of both consensuses and finds changed relays.
+		 * Takes O(n + family members) time.
+		 * @param oldConsensus previous consensus.
+		 * @param newConsensus current consensus.
+		 */
+		ConsensusDiff(const Consensus& oldConsensus, const Consensus& newConsensus);
+
+		// functions
+		/**
+		 * @param relay position of a relay in the new consensus.
+		 * @return position of the relay in the old consensus or FingerprintIndex::NOT_FOUND for new relays.
+		 */
+		size_t getOldPosition(size_t relay) const { return oldPositions[relay]; }
+
+		/**
+		 * @param relay position of a relay in the new consensus.
+		 * @return true iff relations of the relay have to be recomputed.
+		 */
+		bool isChanged(size_t relay) const { return changedRelay[relay]; }
+
+		/**
+		 * @return positions (in the new consensus) of changed relays, in increasing order.
+		 */
+		const std::vector<size_t>& getChanged() const { return changed; }
+
+		/**
+		 * @return positions (in the old consensus) of relays missing in the new consensus, in increasing order.
+		 */
+		const std::vector<size_t>& getRemoved() const { return removed; }
+
+		/**
+		 * @return number of relays in the new consensus.
+		 */
+		size_t size() const { return oldPositions.size(); }
+
+		/**
+		 * @return number of relays in the old consensus.
+		 */
+		size_t oldSize() const { return oldRelaysCount; }
+
+	private:
+		std::vector<size_t> oldPositions; /**< Old position of every relay of the new consensus. */
+		std::vector<bool> changedRelay; /**< Is relay (new position) changed? */
+		std::vector<size_t> changed; /**< New positions of changed relays. */
+		std::vector<size_t> removed; /**< Old positions of removed relays. */
+		size_t oldRelaysCount; /**< Number of relays in the old consensus. */
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "consensus_series.hpp"
+#include "types/work_manager.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace
+{
+	/**
+	 * Descriptor valid in a period [start, end).
+	 */
+	struct DescriptorPeriod
+	{
+		std::string start; /**< Beginning of the validity period. */
+		std::string end; /**< End of the validity period (exclusive). */
+		std::shared_ptr<const Relay::Descriptor> descriptor; /**< Shared descriptor. */
+	};
+}
+
+ConsensusSeries::ConsensusSeries(const std::vector<std::string>& consensusFileNames, const std::string& DBFileName, unsigned threads)
+	: consensuses(consensusFileNames.size())
+{
+	initMeasure(start, stop);
+
+	clogsn("Parsing " << consensusFileNames.size() << " consensus files...");
+	makeMeasure(start);
+	WorkManager::runAll(threads, consensusFileNames.size(), [&](size_t i) {
+		consensuses[i] = std::make_shared<Consensus>(consensusFileNames[i], "", "", false);
+	});
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+
+	if(!DBFileName.empty() && !consensuses.empty())
+	{
+		clogsn("Loading node information for the series...");
+		makeMeasure(start);
+		loadDBInformation(DBFileName, threads);
+		makeMeasure(stop);
+		clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+	}
+}
+
+void ConsensusSeries::loadDBInformation(const std::string& DBFileName, unsigned threads)
+{
+	// period covered by the series
+	std::string fromDate = consensuses.front()->getValidAfter();
+	std::string toDate = fromDate;
+	std::unordered_set<std::string> fingerprintSet;
+	for(const auto& consensus : consensuses)
+	{
+		fromDate = std::min(fromDate, consensus->getValidAfter());
+		toDate = std::max(toDate, consensus->getValidAfter());
+		for(const auto& relay : consensus->getRelays())
+			fingerprintSet.insert(relay.getFingerprint());
+	}
+	std::vector<std::string> fingerprints(fingerprintSet.begin(), fingerprintSet.end());
+	FingerprintIndex fingerprintIndex(fingerprints);
+
+	DBConnection dbConnection(DBFileName, fromDate);
+
+	// resolving descriptors once per (fingerprint, descriptor period)
+	size_t size = fingerprints.size();
+	std::vector<std::vector<DescriptorPeriod>> periods(size);
+	DBConnection::RelaysInfo info = dbConnection.readRelays(fingerprints, fromDate, toDate);
+	for(const auto& record : info.descriptors)
+	{
+		periods[record.position].push_back(DescriptorPeriod{record.startTime, record.endTime, pool.makeDescriptor(record)});
+		++descriptors;
+	}
+
+	// assigning shared descriptors and families to every consensus
+	WorkManager::runAll(threads, consensuses.size(), [&](size_t c) {
+		Consensus& consensus = *consensuses[c];
+		const std::string& date = consensus.getValidAfter();
+		std::vector<size_t> localPositions(size, FingerprintIndex::NOT_FOUND);
+		for(size_t i = 0; i < consensus.relays.size(); ++i)
+		{
+			size_t found = fingerprintIndex.find(consensus.fingerprintIndex.getDigest(i));
+			if(found == FingerprintIndex::NOT_FOUND)
+				continue;
+			localPositions[found] = i;
+			Relay& relay = consensus.relays[i];
+			bool filled = false;
+			for(const auto& period : periods[found])
+				if(period.start <= date && period.end > date)
+				{
+					relay.setDescriptor(filled ? DescriptorPool::merge(relay.getDescriptor(), period.descriptor) : period.descriptor);
+					filled = true;
+				}
+		}
+		// families translated from series positions to positions in the consensus
+		std::vector<DBConnection::FamilyRecord> families;
+		for(const auto& family : info.families)
+		{
+			size_t first = localPositions[family.first], second = localPositions[family.second];
+			if(first != FingerprintIndex::NOT_FOUND && second != FingerprintIndex::NOT_FOUND)
+				families.push_back(DBConnection::FamilyRecord{ first, second, family.startTime, family.endTime });
+		}
+		consensus.assignFamilies(families);
+		consensus.relayTable = RelayTable(consensus.relays);
+		consensus.updateContentHash();
+	});
+}
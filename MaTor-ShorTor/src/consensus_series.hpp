@@ -0,0 +1,77 @@
+#ifndef CONSENSUS_SERIES_HPP
+#define CONSENSUS_SERIES_HPP
+
+/** @file */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+
+#include "consensus.hpp"
+#include "descriptor_pool.hpp"
+
+/**
+ * Series of consensuses loaded together (for instance, every hour of a month).
+ * Consensus files are parsed in parallel. Database information is queried once
+ * for the whole period and resolved once per (fingerprint, descriptor period):
+ * relays of different consensuses referring to the same server descriptor share
+ * a single Relay::Descriptor instance, and identical policies are parsed once.
+ * Each element of the series is an ordinary Consensus usable with MATor.
+ */
+class ConsensusSeries
+{
+	public:
+		// constructors
+		/**
+		 * Loads consensuses and additional relays information from given database.
+		 * @param consensusFileNames names of consensus files.
+		 * @param DBFileName name of .sqlite database file (may be empty).
+		 * @param threads number of threads used for parsing.
+		 */
+		ConsensusSeries(const std::vector<std::string>& consensusFileNames, const std::string& DBFileName,
+			unsigned threads = std::thread::hardware_concurrency());
+
+		// functions
+		/**
+		 * @return number of consensuses in the series.
+		 */
+		size_t size() const { return consensuses.size(); }
+
+		/**
+		 * @param index position of the consensus (order of the file names given).
+		 * @return consensus at specified position.
+		 */
+		const std::shared_ptr<Consensus>& get(size_t index) const { return consensuses[index]; }
+
+		/**
+		 * @return all consensuses of the series, in the order of the file names given.
+		 */
+		const std::vector<std::shared_ptr<Consensus>>& getConsensuses() const { return consensuses; }
+
+		/**
+		 * @return number of distinct descriptors loaded from the database.
+		 */
+		size_t descriptorCount() const { return descriptors; }
+
+		/**
+		 * @return number of distinct policies loaded from the database.
+		 */
+		size_t policyCount() const { return pool.policyCount(); }
+
+	private:
+		// functions
+		/**
+		 * Loads descriptors and families for the whole series and assigns them to relays.
+		 * @param DBFileName name of .sqlite database file.
+		 * @param threads number of threads used for assigning.
+		 */
+		void loadDBInformation(const std::string& DBFileName, unsigned threads);
+
+		// variables
+		std::vector<std::shared_ptr<Consensus>> consensuses; /**< Loaded consensuses. */
+		DescriptorPool pool; /**< Pool of parsed policies shared by all descriptors. */
+		size_t descriptors = 0; /**< Number of distinct descriptors. */
+};
+
+#endif
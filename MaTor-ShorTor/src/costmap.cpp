@@ -12,11 +12,17 @@ void Costmap::addPCF(std::shared_ptr<ProgrammableCostFunction> PCF) {
 }
 
 void Costmap::commit(const std::vector<Relay>& relays) {
+	// without PCFs every relay costs 1, no need to touch relays at all
+	if (pcfs.empty()) {
+		costs.assign(relays.size(), 1.0);
+		return;
+	}
+
 	costs.resize(relays.size());
-	int index = 0;
-	for (auto r : relays) {
+	size_t index = 0;
+	for (const Relay& r : relays) {
 		double val = 1.0;
-		for (auto pcf : pcfs) {
+		for (const auto& pcf : pcfs) {
 			val = pcf->apply(r, val);
 		}
 		costs[index++] = val;
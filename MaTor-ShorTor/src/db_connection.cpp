@@ -4,23 +4,187 @@
 #include <fstream>
 #include <chrono>
 #include <thread>
-#include <sstream>
+#include <cstdlib>
+#include <utility>
 
-DBConnection::DBConnection(const std::string& DBPath, const std::string& consensusDate) : consensusDate(consensusDate)
+namespace
 {
-	if(!std::ifstream(DBPath))
+	/**
+	 * Indexes used by the queries (name, definition).
+	 */
+	const std::vector<std::pair<std::string, std::string>> INDEXES = {
+		{ "mator_nodes_fingerprint", "nodes(fingerprint)" },
+		{ "mator_descriptors_node", "descriptors(node_id, start_time)" },
+		{ "mator_families_ida", "families(ida)" },
+		{ "mator_families_idb", "families(idb)" },
+		{ "mator_geoip_ip", "geoip(ip)" }
+	};
+
+	/**
+	 * Prepared statement, finalized on destruction.
+	 */
+	class Statement
+	{
+		public:
+			/**
+			 * Compiles SQL query.
+			 * @param database database connection.
+			 * @param query SQL query.
+			 * @throw db_exception if the query cannot be compiled.
+			 */
+			Statement(sqlite3* database, const std::string& query) : database(database), statement(nullptr)
+			{
+				if(sqlite3_prepare_v2(database, query.c_str(), -1, &statement, NULL) != SQLITE_OK)
+				{
+					int errorCode = sqlite3_errcode(database);
+					std::string errorMessage(sqlite3_errmsg(database));
+					sqlite3_finalize(statement);
+					throw_exception(db_exception, db_exception::DB_SQL_ERROR, errorCode, errorMessage);
+				}
+			}
+
+			~Statement()
+			{
+				sqlite3_finalize(statement);
+			}
+
+			Statement(const Statement&) = delete;
+			Statement& operator=(const Statement&) = delete;
+
+			/**
+			 * Binds text parameter; the text has to stay alive until the statement is stepped.
+			 * @param index index of the parameter starting at 1.
+			 * @param text parameter value.
+			 */
+			void bind(int index, const std::string& text)
+			{
+				sqlite3_bind_text(statement, index, text.data(), (int)text.size(), SQLITE_STATIC);
+			}
+
+			/**
+			 * Binds integer parameter.
+			 * @param index index of the parameter starting at 1.
+			 * @param value parameter value.
+			 */
+			void bind(int index, sqlite3_int64 value)
+			{
+				sqlite3_bind_int64(statement, index, value);
+			}
+
+			/**
+			 * Evaluates the statement up to the next row, waits while the database is busy.
+			 * @throw db_exception if an error occurs.
+			 * @return true if a row is available, false if the statement is done.
+			 */
+			bool step()
+			{
+				while(true)
+				{
+					int stepResult = sqlite3_step(statement);
+					if(stepResult == SQLITE_ROW)
+						return true;
+					if(stepResult == SQLITE_DONE)
+						return false;
+					if(stepResult != SQLITE_BUSY) // if an error has occured, throw exception with detailed message
+						throw_exception(db_exception, db_exception::DB_SQL_ERROR, stepResult, std::string(sqlite3_errmsg(database)));
+					std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				}
+			}
+
+			/**
+			 * Resets the statement to be executed again with new parameters.
+			 */
+			void reset()
+			{
+				sqlite3_reset(statement);
+			}
+
+			/**
+			 * @param column index of the column starting at 0.
+			 * @return column of the current row as integer.
+			 */
+			sqlite3_int64 integer(int column) const
+			{
+				return sqlite3_column_int64(statement, column);
+			}
+
+			/**
+			 * @param column index of the column starting at 0.
+			 * @return column of the current row as text (empty for NULL).
+			 */
+			std::string text(int column) const
+			{
+				const char* value = (const char*)sqlite3_column_text(statement, column);
+				return value ? std::string(value, sqlite3_column_bytes(statement, column)) : std::string();
+			}
+
+			/**
+			 * @param column index of the column starting at 0.
+			 * @return column of the current row parsed as float (values are stored as text).
+			 */
+			float real(int column) const
+			{
+				const char* value = (const char*)sqlite3_column_text(statement, column);
+				return value ? std::strtof(value, nullptr) : 0.0f;
+			}
+
+		private:
+			sqlite3* database; /**< Database connection. */
+			sqlite3_stmt* statement; /**< Compiled statement. */
+	};
+
+	/**
+	 * Executes SQL statement without result rows.
+	 * @param database database connection.
+	 * @param query SQL query.
+	 * @throw db_exception if an error occurs.
+	 */
+	void execute(sqlite3* database, const std::string& query)
 	{
-		clogsn("Running: ./mator-db " << consensusDate.substr(0, 7) << " -n -o " << DBPath);
-		
-		int scriptResult;
-		if(LOG_LEVEL || true)
-			scriptResult = system(("./mator-db " + consensusDate.substr(0, 7) + " -n -o " + DBPath).c_str());
-		else // running script in quite mode
-			scriptResult = system(("./mator-db " + consensusDate.substr(0, 7) + " -n -o -q " + DBPath).c_str());
-		
-		if(scriptResult) // execution returned non-zero status
-			throw_exception(db_exception, db_exception::DB_CREATION);
+		Statement statement(database, query);
+		while(statement.step());
 	}
+
+	/**
+	 * Transaction rolled back on destruction unless committed.
+	 */
+	class Transaction
+	{
+		public:
+			/**
+			 * Begins transaction.
+			 * @param database database connection.
+			 */
+			Transaction(sqlite3* database) : database(database), committed(false)
+			{
+				execute(database, "BEGIN");
+			}
+
+			~Transaction()
+			{
+				if(!committed)
+					sqlite3_exec(database, "ROLLBACK", NULL, NULL, NULL);
+			}
+
+			/**
+			 * Commits transaction.
+			 */
+			void commit()
+			{
+				execute(database, "COMMIT");
+				committed = true;
+			}
+
+		private:
+			sqlite3* database; /**< Database connection. */
+			bool committed; /**< Whether the transaction has been committed. */
+	};
+}
+
+DBConnection::DBConnection(const std::string& DBPath, const std::string& consensusDate) : consensusDate(consensusDate)
+{
+	if(!std::ifstream(DBPath))
+		throw_exception(db_exception, db_exception::DB_MISSING, DBPath);
 	
 	int openResult = sqlite3_open_v2(DBPath.c_str(), &databaseHandler, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, NULL);
 	if(openResult) // opening database returned non-zero status 
@@ -28,6 +192,19 @@ DBConnection::DBConnection(const std::string& DBPath, const std::string& consens
 		sqlite3_close(databaseHandler); // handler should be freed anyway
 		throw_exception(db_exception, db_exception::DB_OPEN, openResult);
 	}
+
+	Statement findIndex(databaseHandler, "SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = ?");
+	for(const auto& index : INDEXES)
+	{
+		findIndex.bind(1, index.first);
+		bool found = findIndex.step();
+		findIndex.reset();
+		if(!found)
+		{
+			createIndexes(DBPath);
+			break;
+		}
+	}
 }
 
 DBConnection::~DBConnection()
@@ -35,80 +212,100 @@ DBConnection::~DBConnection()
 	sqlite3_close(databaseHandler);
 }
 
-QueryResult DBConnection::readRelaysInfo(const std::vector<std::string>::iterator& begin, const std::vector<std::string>::iterator& end) const
+const std::vector<std::string>& DBConnection::indexNames()
 {
-	std::ostringstream inFingerprints;
-	for (auto it = begin; it != end; ++it) 
+	static const std::vector<std::string> names = []() {
+		std::vector<std::string> names;
+		for(const auto& index : INDEXES)
+			names.push_back(index.first);
+		return names;
+	}();
+	return names;
+}
+
+void DBConnection::createIndexes(const std::string& DBPath)
+{
+	clogsn("Creating database indexes...");
+	sqlite3* writableHandler = NULL;
+	int openResult = sqlite3_open_v2(DBPath.c_str(), &writableHandler, SQLITE_OPEN_READWRITE | SQLITE_OPEN_URI, NULL);
+	try
 	{
-		if (it != begin) 
-		{
-			inFingerprints << ",";
-		}
-		inFingerprints << "\"" << *it << "\"";
+		if(openResult)
+			throw_exception(db_exception, db_exception::DB_OPEN, openResult);
+		sqlite3_busy_timeout(writableHandler, 10000);
+		Transaction transaction(writableHandler);
+		for(const auto& index : INDEXES)
+			execute(writableHandler, "CREATE INDEX IF NOT EXISTS " + index.first + " ON " + index.second);
+		transaction.commit();
 	}
-	std::string query = "SELECT nodes.fingerprint, descriptors.bandwidth_avg, descriptors.platform, descriptors.exit_policy, "
-		"geoip.country, geoip.lat, geoip.long, geoip.as_number, geoip.as_name FROM descriptors "
-		"JOIN geoip ON descriptors.address = geoip.ip "
-		"JOIN nodes ON nodes.id = descriptors.node_id "
-		"WHERE descriptors.start_time <= \"" + consensusDate
-		+ "\" AND descriptors.end_time > \"" + consensusDate 
-		+ "\" AND nodes.fingerprint IN (" + inFingerprints.str() + ");";
-	
-	return executeSQLiteQuery(query);
+	catch(const db_exception& ex)
+	{
+		clogsn("Database indexes cannot be created, queries will be slower: " << ex.what());
+	}
+	sqlite3_close(writableHandler);
 }
 
-QueryResult DBConnection::readFamilies() const
+DBConnection::RelaysInfo DBConnection::readRelays(const std::vector<std::string>& fingerprints) const
 {
-	std::string query = "SELECT nA.fingerprint, nB.fingerprint FROM families JOIN nodes AS nA ON nA.id = ida JOIN nodes AS nB ON nB.id = idb WHERE start_time <= \""
-		+ consensusDate + "\" AND end_time > \"" + consensusDate + "\"";
-	return executeSQLiteQuery(query);
+	return readRelays(fingerprints, consensusDate, consensusDate);
 }
 
-QueryResult DBConnection::executeSQLiteQuery(const std::string& query) const
+DBConnection::RelaysInfo DBConnection::readRelays(const std::vector<std::string>& fingerprints, const std::string& fromDate, const std::string& toDate) const
 {
-	sqlite3_stmt *statement = 0;
-	// compiling SQL query.
-	// using sqlite3_prepare instead of sqlite3_prepare_v2 to avoid playing with error messages.
-	int prepareResult = sqlite3_prepare(databaseHandler, query.c_str(), -1, &statement, NULL);
-	if(prepareResult != SQLITE_OK)
-		throw_exception(db_exception, db_exception::DB_SQL_ERROR, sqlite3_errcode(databaseHandler), std::string(sqlite3_errmsg(databaseHandler)));
-	
-	QueryResult queryResult;
-	int stepResult = sqlite3_step(statement);
-	int columns = sqlite3_column_count(statement);
-	
-	while (stepResult != SQLITE_DONE)       
+	RelaysInfo info;
+	Transaction transaction(databaseHandler);
+
+	// temporary table lives in the connection's private database, so it works on read-only files as well
+	execute(databaseHandler, "CREATE TEMP TABLE IF NOT EXISTS mator_relays (position INTEGER PRIMARY KEY, fingerprint TEXT NOT NULL)");
+	execute(databaseHandler, "CREATE INDEX IF NOT EXISTS temp.mator_relays_fingerprint ON mator_relays(fingerprint)");
+	execute(databaseHandler, "DELETE FROM mator_relays");
 	{
-		switch(stepResult)
+		Statement insert(databaseHandler, "INSERT INTO mator_relays (position, fingerprint) VALUES (?, ?)");
+		for(size_t i = 0; i < fingerprints.size(); ++i)
 		{
-			case SQLITE_ROW:
-				{
-					Row row;
-					for (int i = 0; i < columns; ++i) 
-					{
-						const char* cc = (const char*)sqlite3_column_text(statement, i);
-						row.push_back(cc ? std::string(cc) : ""); // if result is not null, then parse it and push, push empty string otherwise.
-					}
-					queryResult.push_back(row);
-				}
-				break;
-				
-			case SQLITE_ERROR: // if an error has occured, throw exception with detailed message
-				{
-					std::string errorMessage(sqlite3_errmsg(databaseHandler));
-					int errorCode = sqlite3_reset(statement);
-					sqlite3_finalize(statement);
-					throw_exception(db_exception, db_exception::DB_SQL_ERROR, errorCode, errorMessage);
-				}
-				break;
-			
-			default: // SQLITE_BUSY
-				std::this_thread::sleep_for(std::chrono::milliseconds(100));
-				break;
+			insert.bind(1, (sqlite3_int64)i);
+			insert.bind(2, fingerprints[i]);
+			insert.step();
+			insert.reset();
 		}
-		
-		stepResult = sqlite3_step(statement);
 	}
-	sqlite3_finalize(statement);
-	return queryResult;
+
+	Statement descriptors(databaseHandler, "SELECT relays.position, descriptors.bandwidth_avg, descriptors.platform, descriptors.exit_policy, "
+		"geoip.country, geoip.lat, geoip.long, geoip.as_number, geoip.as_name, "
+		"descriptors.start_time, descriptors.end_time FROM mator_relays AS relays "
+		"JOIN nodes ON nodes.fingerprint = relays.fingerprint "
+		"JOIN descriptors ON descriptors.node_id = nodes.id "
+		"JOIN geoip ON descriptors.address = geoip.ip "
+		"WHERE descriptors.start_time <= ?1 AND descriptors.end_time > ?2 "
+		"ORDER BY relays.position, descriptors.rowid");
+	descriptors.bind(1, toDate);
+	descriptors.bind(2, fromDate);
+	while(descriptors.step())
+	{
+		DescriptorRecord record;
+		record.position = (size_t)descriptors.integer(0);
+		record.averagedBandwidth = (int)descriptors.integer(1);
+		record.platform = descriptors.text(2);
+		record.exitPolicy = descriptors.text(3);
+		record.country = descriptors.text(4);
+		record.latitude = descriptors.real(5);
+		record.longitude = descriptors.real(6);
+		record.ASNumber = descriptors.text(7);
+		record.ASName = descriptors.text(8);
+		record.startTime = descriptors.text(9);
+		record.endTime = descriptors.text(10);
+		info.descriptors.push_back(std::move(record));
+	}
+
+	Statement families(databaseHandler, "SELECT relaysA.position, relaysB.position, families.start_time, families.end_time FROM families "
+		"JOIN nodes AS nA ON nA.id = families.ida JOIN mator_relays AS relaysA ON relaysA.fingerprint = nA.fingerprint "
+		"JOIN nodes AS nB ON nB.id = families.idb JOIN mator_relays AS relaysB ON relaysB.fingerprint = nB.fingerprint "
+		"WHERE families.start_time <= ?1 AND families.end_time > ?2");
+	families.bind(1, toDate);
+	families.bind(2, fromDate);
+	while(families.step())
+		info.families.push_back(FamilyRecord{ (size_t)families.integer(0), (size_t)families.integer(1), families.text(2), families.text(3) });
+
+	transaction.commit();
+	return info;
 }
@@ -10,10 +10,6 @@
 #include "types/general_exception.hpp"
 #include "utils.hpp"
 
-typedef std::vector<std::string> Row; /**< Row of a query result. All data types set to string. */
-typedef std::vector<Row> QueryResult; /**< Result of a database query as vector of rows. */
-typedef QueryResult *QueryResultP; /**< Pointer to database query result. */
-
 /**
  * Thrown if an error in database connection occurs.
  */
@@ -25,7 +21,7 @@ class db_exception : public general_exception
 		 */
 		enum reason
 		{
-			DB_CREATION, /**< Database creation failure. */
+			DB_MISSING, /**< Database file does not exist. */
 			DB_OPEN, /**< Opening database failure. */
 			DB_SQL_ERROR /**< SQL query error. */
 		};
@@ -41,8 +37,26 @@ class db_exception : public general_exception
 		{
 			switch(why)
 			{
-				case DB_CREATION:
-					this->message = "the process creating database has failed.";			
+				default:
+					this->message = "unknown reason.";
+					break;
+			}
+			commit_message();
+		}
+
+		/**
+		 * Constructs exception instance with a file name.
+		 * @param why reason of throwing exception
+		 * @param fileName name of the database file.
+		 * @param file name of the file file in which exception has occured.
+		 * @param line line at which exception has occured.
+		 */
+		db_exception(reason why, const std::string& fileName, const char* file, int line) : general_exception("", file, line), reasonWhy(why)
+		{
+			switch(why)
+			{
+				case DB_MISSING:
+					this->message = "database file \"" + fileName + "\" does not exist; create it with the mator-db tool (see README) first.";
 					break;
 				default:
 					this->message = "unknown reason.";
@@ -113,13 +127,55 @@ class db_exception : public general_exception
 
 /**
  * Class provides database functionalities and structures.
+ * Relays are looked up through a temporary table filled by a prepared statement and joined
+ * against the descriptor tables, so every call is a single transaction regardless of the number of relays.
  */ 
 class DBConnection
 {
 	public:
+		/**
+		 * Descriptor of a relay as stored in database.
+		 */
+		struct DescriptorRecord
+		{
+			size_t position; /**< Position of the relay's fingerprint in the queried list. */
+			int averagedBandwidth; /**< Averaged observed bandwidth (B/s). */
+			float latitude; /**< Latitude of relay's IP in degrees. */
+			float longitude; /**< Longitude of relay's IP in degrees. */
+			std::string platform; /**< Platform name. */
+			std::string exitPolicy; /**< Exit policy entries separated by new lines. */
+			std::string country; /**< Country of relay's IP. */
+			std::string ASNumber; /**< Autonomous System Number of relay's IP (without leading AS). */
+			std::string ASName; /**< Autonomous System Name of relay's IP. */
+			std::string startTime; /**< Beginning of descriptor's validity in YYYY-MM-DD hh:mm:ss format. */
+			std::string endTime; /**< End of descriptor's validity (exclusive) in YYYY-MM-DD hh:mm:ss format. */
+		};
+
+		/**
+		 * Two relays declaring each other as family.
+		 */
+		struct FamilyRecord
+		{
+			size_t first; /**< Position of the first relay's fingerprint in the queried list. */
+			size_t second; /**< Position of the second relay's fingerprint in the queried list. */
+			std::string startTime; /**< Beginning of family's validity in YYYY-MM-DD hh:mm:ss format. */
+			std::string endTime; /**< End of family's validity (exclusive) in YYYY-MM-DD hh:mm:ss format. */
+		};
+
+		/**
+		 * Database information about a list of relays.
+		 */
+		struct RelaysInfo
+		{
+			std::vector<DescriptorRecord> descriptors; /**< Descriptors ordered by relay position. */
+			std::vector<FamilyRecord> families; /**< Families among the relays. */
+		};
+
 		// constructors
 		/**
 		 * Initializes Database connection.
+		 * Creates indexes used by the queries if they are missing and the database is writable.
+		 * The database has to be created beforehand by the mator-db tool.
 		 * @param DBPath .sqlite database file name.
 		 * @param consensusDate date of the consensus in YYYY-MM-DD hh:mm:ss format.
 		 * @throw db_exception
@@ -133,27 +189,36 @@ class DBConnection
 		
 		// functions
 		/**
-		 * Performs SQL query for relays' fingerprints accessed by iterator.
-		 * @param begin start of the interval.
-		 * @param end end of the interval.
+		 * Reads descriptors and families of relays valid at consensus date.
+		 * @param fingerprints relays' fingerprints.
+		 * @throw db_exception
 		 * @return nodes additional information.
 		 */
-		QueryResult readRelaysInfo(const std::vector<std::string>::iterator& begin, const std::vector<std::string>::iterator& end) const;
-		
+		RelaysInfo readRelays(const std::vector<std::string>& fingerprints) const;
+
+		/**
+		 * Reads descriptors and families of relays valid at any moment of the specified period.
+		 * @param fingerprints relays' fingerprints.
+		 * @param fromDate beginning of the period in YYYY-MM-DD hh:mm:ss format.
+		 * @param toDate end of the period in YYYY-MM-DD hh:mm:ss format.
+		 * @throw db_exception
+		 * @return nodes additional information.
+		 */
+		RelaysInfo readRelays(const std::vector<std::string>& fingerprints, const std::string& fromDate, const std::string& toDate) const;
+
 		/**
-		 * Performs SQL query to read relays families status for specified consensus date.
-		 * @return pairs of nodes considered as families.
+		 * @return names of indexes the queries rely on.
 		 */
-		QueryResult readFamilies() const;
+		static const std::vector<std::string>& indexNames();
 		
 	private:
 		// functions
 		/**
-		 * Executes database query and handles database errors.
-		 * @param query database query.
-		 * @return query result.
+		 * Creates missing indexes using a separate writable connection.
+		 * Failure is not fatal, SQLite builds temporary indexes for the queries instead.
+		 * @param DBPath .sqlite database file name.
 		 */
-		QueryResult executeSQLiteQuery(const std::string& query) const;
+		void createIndexes(const std::string& DBPath);
 		
 		// variables
 		std::string consensusDate; /**< Consensus valid after date */
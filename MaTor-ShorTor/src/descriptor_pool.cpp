@@ -0,0 +1,36 @@
+#include "descriptor_pool.hpp"
+
+std::shared_ptr<const Relay::Descriptor> DescriptorPool::makeDescriptor(const DBConnection::DescriptorRecord& record)
+{
+	auto descriptor = std::make_shared<Relay::Descriptor>();
+	descriptor->averagedBandwidth = record.averagedBandwidth;
+	descriptor->platform = record.platform;
+	descriptor->policy = internPolicy(record.exitPolicy);
+	descriptor->country = record.country;
+	descriptor->latitude = record.latitude;
+	descriptor->longitude = record.longitude;
+	descriptor->ASNumber = "AS" + record.ASNumber;
+	descriptor->ASName = record.ASName;
+	return descriptor;
+}
+
+std::shared_ptr<const std::vector<Relay::PolicyDescriptor>> DescriptorPool::internPolicy(const std::string& policyText)
+{
+	auto found = policies.find(policyText);
+	if(found != policies.end())
+		return found->second;
+
+	auto policy = std::make_shared<const std::vector<Relay::PolicyDescriptor>>(Relay::parsePolicy(policyText));
+	policies.emplace(policyText, policy);
+	return policy;
+}
+
+std::shared_ptr<const Relay::Descriptor> DescriptorPool::merge(const std::shared_ptr<const Relay::Descriptor>& earlier,
+	const std::shared_ptr<const Relay::Descriptor>& later)
+{
+	auto descriptor = std::make_shared<Relay::Descriptor>(*later);
+	auto policy = std::make_shared<std::vector<Relay::PolicyDescriptor>>(*earlier->policy);
+	policy->insert(policy->end(), later->policy->begin(), later->policy->end());
+	descriptor->policy = policy;
+	return descriptor;
+}
@@ -0,0 +1,57 @@
+#ifndef DESCRIPTOR_POOL_HPP
+#define DESCRIPTOR_POOL_HPP
+
+/** @file */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "relay.hpp"
+#include "db_connection.hpp"
+
+/**
+ * Pool of relay descriptors created from database records.
+ * Identical policies are parsed only once and shared between descriptors,
+ * which keeps memory usage low when many consensuses are loaded at once.
+ * The pool is not thread-safe; it is filled before descriptors are handed out.
+ */
+class DescriptorPool
+{
+	public:
+		/**
+		 * Creates descriptor from a record returned by DBConnection::readRelays.
+		 * @param record database record.
+		 * @return new descriptor with interned policy.
+		 */
+		std::shared_ptr<const Relay::Descriptor> makeDescriptor(const DBConnection::DescriptorRecord& record);
+
+		/**
+		 * Parses policy or returns already parsed policy with identical text.
+		 * @param policyText policy entries separated by new lines.
+		 * @return shared policy entries.
+		 */
+		std::shared_ptr<const std::vector<Relay::PolicyDescriptor>> internPolicy(const std::string& policyText);
+
+		/**
+		 * Combines two descriptors found for the same relay and date.
+		 * Later descriptor overrides the single-valued fields, policies are concatenated
+		 * (same as filling the relay row after row).
+		 * @param earlier descriptor assigned first.
+		 * @param later descriptor assigned second.
+		 * @return combined descriptor.
+		 */
+		static std::shared_ptr<const Relay::Descriptor> merge(const std::shared_ptr<const Relay::Descriptor>& earlier,
+			const std::shared_ptr<const Relay::Descriptor>& later);
+
+		/**
+		 * @return number of distinct policies in the pool.
+		 */
+		size_t policyCount() const { return policies.size(); }
+
+	private:
+		std::unordered_map<std::string, std::shared_ptr<const std::vector<Relay::PolicyDescriptor>>> policies; /**< Parsed policies keyed by their text. */
+};
+
+#endif
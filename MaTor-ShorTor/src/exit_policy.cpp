@@ -0,0 +1,125 @@
+#include "exit_policy.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	/**
+	 * @return true iff the entry applies to any port.
+	 */
+	inline bool anyPort(const Relay::PolicyDescriptor& entry)
+	{
+		return !(entry.portBegin && entry.portEnd);
+	}
+
+	/**
+	 * @return true iff the entry applies to the port.
+	 */
+	inline bool coversPort(const Relay::PolicyDescriptor& entry, uint16_t port)
+	{
+		return anyPort(entry) || (port >= entry.portBegin && port <= entry.portEnd);
+	}
+}
+
+ExitPolicy::ExitPolicy(const std::vector<Relay::PolicyDescriptor>& entries) : entries(entries)
+{
+	// entries with equal (prefix, mask) match the same addresses
+	std::vector<int> patternOf(entries.size(), -1);
+	for(size_t e = 0; e < entries.size(); ++e)
+	{
+		const IP& address = entries[e].address;
+		if(!address.mask)
+			continue;
+		IP pattern(address.getPrefix(), address.mask);
+		auto found = std::find_if(patterns.begin(), patterns.end(), [&](const IP& other) {
+			return other.address == pattern.address && other.mask == pattern.mask;
+		});
+		patternOf[e] = (int)(found - patterns.begin());
+		if(found == patterns.end())
+			patterns.push_back(pattern);
+	}
+
+	std::vector<bool> selected(entries.size());
+	for(size_t e = 0; e < entries.size(); ++e)
+		selected[e] = patternOf[e] < 0;
+	anyAddress = compile(selected);
+	for(size_t p = 0; p < patterns.size(); ++p)
+	{
+		for(size_t e = 0; e < entries.size(); ++e)
+			selected[e] = patternOf[e] < 0 || patternOf[e] == (int)p;
+		patternTables.push_back(compile(selected));
+	}
+}
+
+ExitPolicy::PortTable ExitPolicy::compile(const std::vector<bool>& selected) const
+{
+	// ports where a decision may change
+	std::vector<uint16_t> bounds(1, 65535);
+	for(size_t e = 0; e < entries.size(); ++e)
+	{
+		if(!selected[e] || anyPort(entries[e]))
+			continue;
+		if(entries[e].portBegin > 0)
+			bounds.push_back(entries[e].portBegin - 1);
+		bounds.push_back(entries[e].portEnd);
+	}
+	std::sort(bounds.begin(), bounds.end());
+	bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+	PortTable table;
+	uint32_t start = 0;
+	for(uint16_t end : bounds)
+	{
+		// first entry covering the interval decides, connections are allowed if there is none
+		bool accept = true;
+		for(size_t e = 0; e < entries.size(); ++e)
+			if(selected[e] && coversPort(entries[e], (uint16_t)start))
+			{
+				accept = entries[e].isAccept;
+				break;
+			}
+
+		if(!table.accepts.empty() && table.accepts.back() == accept)
+			table.ends.back() = end;
+		else
+		{
+			table.ends.push_back(end);
+			table.accepts.push_back(accept);
+		}
+		start = (uint32_t)end + 1;
+	}
+	return table;
+}
+
+bool ExitPolicy::PortTable::supports(uint16_t port) const
+{
+	return accepts[std::lower_bound(ends.begin(), ends.end(), port) - ends.begin()];
+}
+
+bool ExitPolicy::supports(const IP& ip, uint16_t port) const
+{
+	int matched = -1;
+	for(size_t p = 0; p < patterns.size(); ++p)
+		if(patterns[p] == ip)
+		{
+			if(matched >= 0)
+			{
+				// several patterns apply, entries are evaluated in order
+				for(const auto& entry : entries)
+					if(entry.address == ip && coversPort(entry, port))
+						return entry.isAccept;
+				return true;
+			}
+			matched = (int)p;
+		}
+	return matched < 0 ? anyAddress.supports(port) : patternTables[matched].supports(port);
+}
+
+size_t ExitPolicy::memoryUsage() const
+{
+	size_t bytes = sizeof(ExitPolicy) + entries.capacity() * sizeof(Relay::PolicyDescriptor) + patterns.capacity() * sizeof(IP);
+	bytes += anyAddress.ends.capacity() * sizeof(uint16_t) + anyAddress.accepts.capacity() / 8;
+	for(const auto& table : patternTables)
+		bytes += sizeof(PortTable) + table.ends.capacity() * sizeof(uint16_t) + table.accepts.capacity() / 8;
+	return bytes;
+}
@@ -0,0 +1,78 @@
+#ifndef EXIT_POLICY_HPP
+#define EXIT_POLICY_HPP
+
+/** @file */
+
+#include <vector>
+#include <cstdint>
+
+#include "ip.hpp"
+#include "relay.hpp"
+
+/**
+ * Exit policy compiled for fast lookups.
+ * Entries are evaluated first-match-wins, exactly as Relay::supportsConnection() does.
+ * The policy keeps the distinct address patterns it mentions; for entries applying to any address
+ * and for every single pattern, the matching entries are flattened into a sorted table of port intervals,
+ * so that a lookup is a scan of the (few) patterns and a binary search over intervals.
+ * Addresses matching several patterns at once fall back to evaluating the entries.
+ */
+class ExitPolicy
+{
+	public:
+		// constructors
+		/**
+		 * Compiles policy entries.
+		 * @param entries policy entries in order of evaluation.
+		 */
+		ExitPolicy(const std::vector<Relay::PolicyDescriptor>& entries);
+
+		// functions
+		/**
+		 * Checks whether the policy allows connection to the address and port.
+		 * @param ip destination address.
+		 * @param port destination port.
+		 * @return true iff the connection is allowed (connections not mentioned by any entry are allowed).
+		 */
+		bool supports(const IP& ip, uint16_t port) const;
+
+		/**
+		 * @return policy entries in order of evaluation.
+		 */
+		const std::vector<Relay::PolicyDescriptor>& getEntries() const { return entries; }
+
+		/**
+		 * @return approximate number of bytes used by the policy.
+		 */
+		size_t memoryUsage() const;
+
+	private:
+		/**
+		 * Decisions for all ports, as consecutive intervals.
+		 */
+		struct PortTable
+		{
+			std::vector<uint16_t> ends; /**< Last port of each interval, ascending (the last one is 65535). */
+			std::vector<bool> accepts; /**< Whether connections to ports of each interval are allowed. */
+
+			/**
+			 * @return decision for the port.
+			 */
+			bool supports(uint16_t port) const;
+		};
+
+		/**
+		 * Flattens entries selected by a mask into port intervals.
+		 * @param selected whether each entry applies.
+		 * @return port table.
+		 */
+		PortTable compile(const std::vector<bool>& selected) const;
+
+		// variables
+		std::vector<Relay::PolicyDescriptor> entries; /**< Policy entries (used for addresses matching several patterns). */
+		std::vector<IP> patterns; /**< Distinct address patterns of entries not applying to every address. */
+		PortTable anyAddress; /**< Decisions for addresses matching none of the patterns. */
+		std::vector<PortTable> patternTables; /**< Decisions for addresses matching exactly one pattern. */
+};
+
+#endif
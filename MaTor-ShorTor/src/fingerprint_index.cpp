@@ -0,0 +1,109 @@
+#include "fingerprint_index.hpp"
+
+#include <cstring>
+
+const size_t FingerprintIndex::NOT_FOUND;
+
+namespace
+{
+	const uint32_t EMPTY_SLOT = (uint32_t)-1; /**< Marks empty slot in the hash table. */
+
+	/**
+	 * @return value of hexadecimal digit or -1.
+	 */
+	inline int hexValue(char c)
+	{
+		if(c >= '0' && c <= '9')
+			return c - '0';
+		if(c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		if(c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		return -1;
+	}
+}
+
+FingerprintIndex::FingerprintIndex(const std::vector<Relay>& relays) : digests(relays.size())
+{
+	std::vector<bool> valid(relays.size());
+	for(size_t i = 0; i < relays.size(); ++i)
+		valid[i] = parse(relays[i].getFingerprint(), digests[i]);
+	buildTable(valid);
+}
+
+FingerprintIndex::FingerprintIndex(const std::vector<std::string>& fingerprints) : digests(fingerprints.size())
+{
+	std::vector<bool> valid(fingerprints.size());
+	for(size_t i = 0; i < fingerprints.size(); ++i)
+		valid[i] = parse(fingerprints[i], digests[i]);
+	buildTable(valid);
+}
+
+bool FingerprintIndex::parse(const string_ref& fingerprint, digest_t& digest)
+{
+	if(fingerprint.size() != 2 * digest.size())
+	{
+		digest.fill(0);
+		return false;
+	}
+	for(size_t i = 0; i < digest.size(); ++i)
+	{
+		int high = hexValue(fingerprint[2 * i]);
+		int low = hexValue(fingerprint[2 * i + 1]);
+		if(high < 0 || low < 0)
+		{
+			digest.fill(0);
+			return false;
+		}
+		digest[i] = (uint8_t)((high << 4) | low);
+	}
+	return true;
+}
+
+size_t FingerprintIndex::hash(const digest_t& digest)
+{
+	uint64_t h;
+	memcpy(&h, digest.data(), sizeof(h));
+	return (size_t)h;
+}
+
+void FingerprintIndex::buildTable(const std::vector<bool>& valid)
+{
+	size_t capacity = 16;
+	while(capacity < 2 * digests.size())
+		capacity <<= 1;
+	table.assign(capacity, EMPTY_SLOT);
+	mask = capacity - 1;
+
+	for(size_t position = 0; position < digests.size(); ++position)
+	{
+		if(!valid[position])
+			continue;
+		size_t slot = hash(digests[position]) & mask;
+		// later duplicates replace earlier ones
+		while(table[slot] != EMPTY_SLOT && digests[table[slot]] != digests[position])
+			slot = (slot + 1) & mask;
+		table[slot] = (uint32_t)position;
+	}
+}
+
+size_t FingerprintIndex::find(const digest_t& digest) const
+{
+	if(table.empty())
+		return NOT_FOUND;
+	for(size_t slot = hash(digest) & mask; table[slot] != EMPTY_SLOT; slot = (slot + 1) & mask)
+		if(digests[table[slot]] == digest)
+			return table[slot];
+	return NOT_FOUND;
+}
+
+std::vector<int64_t> FingerprintIndex::findAll(const std::vector<std::string>& fingerprints) const
+{
+	std::vector<int64_t> positions(fingerprints.size());
+	for(size_t i = 0; i < fingerprints.size(); ++i)
+	{
+		size_t position = find(fingerprints[i]);
+		positions[i] = position == NOT_FOUND ? -1 : (int64_t)position;
+	}
+	return positions;
+}
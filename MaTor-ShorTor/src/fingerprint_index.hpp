@@ -0,0 +1,106 @@
+#ifndef FINGERPRINT_INDEX_HPP
+#define FINGERPRINT_INDEX_HPP
+
+/** @file */
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "relay.hpp"
+#include "types/string_ref.hpp"
+
+/**
+ * Maps relay fingerprints to relay positions in consensus.
+ * Fingerprints are stored as 20-byte binary digests in an open-addressing hash table
+ * (linear probing, at most half full). Digests are SHA-1 values, so their leading bytes serve as hash.
+ * Textual lookups accept 40 hexadecimal characters (in either case).
+ */
+class FingerprintIndex
+{
+	public:
+		typedef std::array<uint8_t, 20> digest_t; /**< Binary fingerprint. */
+		static const size_t NOT_FOUND = (size_t)-1; /**< Returned by lookups of unknown fingerprints. */
+
+		// constructors
+		/**
+		 * Creates empty index.
+		 */
+		FingerprintIndex() { }
+
+		/**
+		 * Indexes relays' fingerprints.
+		 * @param relays relays in consensus order.
+		 */
+		FingerprintIndex(const std::vector<Relay>& relays);
+
+		/**
+		 * Indexes fingerprints.
+		 * @param fingerprints hexadecimal fingerprints, the position of a fingerprint is its index in the vector.
+		 */
+		FingerprintIndex(const std::vector<std::string>& fingerprints);
+
+		// functions
+		/**
+		 * Converts hexadecimal fingerprint to digest.
+		 * @param fingerprint 40 hexadecimal characters.
+		 * @param digest output digest.
+		 * @return false if fingerprint is malformed.
+		 */
+		static bool parse(const string_ref& fingerprint, digest_t& digest);
+
+		/**
+		 * @param digest binary fingerprint.
+		 * @return position of the relay with given fingerprint or NOT_FOUND.
+		 */
+		size_t find(const digest_t& digest) const;
+
+		/**
+		 * @param fingerprint hexadecimal fingerprint.
+		 * @return position of the relay with given fingerprint or NOT_FOUND (also for malformed fingerprints).
+		 */
+		size_t find(const string_ref& fingerprint) const
+		{
+			digest_t digest;
+			return parse(fingerprint, digest) ? find(digest) : NOT_FOUND;
+		}
+
+		/**
+		 * Translates many fingerprints at once.
+		 * @param fingerprints hexadecimal fingerprints.
+		 * @return positions of the relays, -1 for unknown fingerprints.
+		 */
+		std::vector<int64_t> findAll(const std::vector<std::string>& fingerprints) const;
+
+		/**
+		 * @param position relay's position in consensus.
+		 * @return digest of the relay's fingerprint (all zeros if the fingerprint was malformed).
+		 */
+		const digest_t& getDigest(size_t position) const { return digests[position]; }
+
+		/**
+		 * @return number of indexed positions.
+		 */
+		size_t size() const { return digests.size(); }
+
+		/**
+		 * @return approximate number of bytes used by the index.
+		 */
+		size_t memoryUsage() const { return digests.capacity() * sizeof(digest_t) + table.capacity() * sizeof(uint32_t); }
+
+	private:
+		/**
+		 * Builds the hash table from digests.
+		 * @param valid whether the digest at given position is a valid fingerprint.
+		 */
+		void buildTable(const std::vector<bool>& valid);
+
+		static size_t hash(const digest_t& digest);
+
+		std::vector<digest_t> digests; /**< Digest for every position. */
+		std::vector<uint32_t> table; /**< Open-addressing table of positions, EMPTY_SLOT for empty slots. */
+		size_t mask = 0; /**< Table size - 1 (table size is a power of two). */
+};
+
+#endif
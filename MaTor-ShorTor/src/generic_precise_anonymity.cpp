@@ -1,8 +1,10 @@
 #include "generic_precise_anonymity.hpp"
 #include "types/const_vector.hpp"
 #include "types/work_manager.hpp"
+#include "types/packed_symmetric_matrix.hpp"
 #include "utils.hpp"
 #include <numeric>
+#include <algorithm>
 #include <math.h>       /* log */
 
 constexpr size_t uint_precision = sizeof(numeric_type) * 8 * 15 / 16; // *15/16 == make 64 -> 60, 32 -> 30, etc...
@@ -29,6 +31,95 @@ static inline probability_t convert_i2d(numeric_type value)
 //	return static_cast<probability_t>(value) * conversion_const_inv;
 }
 
+namespace
+{
+	/**
+	 * Observations of links between consecutive hops (guard and middle, middle and exit) routed through [ShorTor] via relays.
+	 * A pair of relays with vias uses each of its (distinct) vias with the same probability and the link is observed
+	 * if the connection of either relay of the pair to the via is observed.
+	 * Only pairs of the via index are visited, links of all other pairs are observed as given.
+	 */
+	class ViaLinks
+	{
+		public:
+			ViaLinks(const Consensus& consensus, const_vector<const_vector<bool>>& observedNodes)
+				: observedNodes(observedNodes), pairs(consensus.useVias() ? consensus.getSize() : 0)
+			{
+				if(!consensus.useVias())
+					return;
+				size_t size = consensus.getSize();
+				std::vector<uint64_t> keys;
+				for(size_t via = 0; via < size; ++via)
+				{
+					// a pair may be listed more than once for the same via
+					keys.clear();
+					for(const ViaPair& pair : consensus.getPairsForVia(via))
+						if(pair.first != pair.second && pair.first != via && pair.second != via)
+							keys.push_back(key(pair.first, pair.second));
+					std::sort(keys.begin(), keys.end());
+					keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+					for(uint64_t pairKey : keys)
+					{
+						size_t first = pairKey >> 32, second = pairKey & 0xFFFFFFFF;
+						Counts& counts = links[pairKey];
+						++counts.vias;
+						if(observedNodes[first][via] || observedNodes[via][second])
+							++counts.observed;
+						pairs.set(first, second, true);
+					}
+				}
+			}
+
+			/**
+			 * @return true iff no link may be routed through a via.
+			 */
+			bool empty() const
+			{
+				return links.empty();
+			}
+
+			/**
+			 * @return number of pairs of relays with vias.
+			 */
+			size_t size() const
+			{
+				return links.size();
+			}
+
+			/**
+			 * @param first relay of the link.
+			 * @param second relay of the link.
+			 * @return probability that the adversary observes the link.
+			 */
+			probability_t observed(size_t first, size_t second) const
+			{
+				if(links.empty() || !pairs.get(first, second))
+					return observedNodes[first][second];
+				const Counts& counts = links.find(key(first, second))->second;
+				return (probability_t)counts.observed / counts.vias;
+			}
+
+		private:
+			/**
+			 * Numbers of vias of a pair.
+			 */
+			struct Counts
+			{
+				uint32_t vias = 0; /**< Number of vias the pair may use. */
+				uint32_t observed = 0; /**< Number of vias with an observed connection to the pair. */
+			};
+
+			static uint64_t key(size_t first, size_t second)
+			{
+				return ((uint64_t)std::min(first, second) << 32) | std::max(first, second);
+			}
+
+			const_vector<const_vector<bool>>& observedNodes; /**< Compromised connections between relays. */
+			PackedSymmetricMatrix<bool> pairs; /**< Pairs of relays with vias. */
+			std::unordered_map<uint64_t, Counts> links; /**< Vias of the pairs, by (smaller, greater) relay. */
+	};
+}
+
 static bool checkObservation(observation o, const bool& SG, const bool& GM, const bool& MX, const bool& XR)
 {
 	return (o[0] == (SG)) && (o[1] == (SG||GM)) && (o[2] == (GM||MX)) && (o[3] == (MX||XR) && (o[4] == XR));
@@ -234,6 +325,27 @@ GenericPreciseAnonymity::GenericPreciseAnonymity(
 	// Partition the job into chunks
 	// The larger the chunks, the less tasks, but might cause unbalanced work distribution
 	constexpr size_t chunk_size = 16;
+
+	// flags required at each loop level, checked on the columnar relay table
+	const RelayTable& relayTable = consensus.getRelayTable();
+	int requiredFlags[3][3];
+	for (int t = 0; t < 3; t++)
+		for (int level = 0; level < 3; level++)
+			requiredFlags[t][level] = translation[t][level] == LOOP_X ? RelayFlag::EXIT : (translation[t][level] == LOOP_G ? RelayFlag::GUARD : 0);
+	
+	// exit probabilities are looked up instead of being recomputed for every circuit
+	const PathSelection* pathSelections[4] = { &psA1, &psA2, &psB1, &psB2 };
+	std::vector<probability_t> exitProbs[4];
+	for (int k = 0; k < 4; k++)
+	{
+		exitProbs[k].resize(size);
+		pathSelections[k]->exitProbRow(exitProbs[k].data());
+	}
+	
+	// [ShorTor]: observations of links which may use via relays, computed from the pairs of every via
+	ViaLinks viaLinks(consensus, observedNodes);
+	if (!viaLinks.empty())
+		std::cout << "[ShorTor]: " << viaLinks.size() << " links between relays may use vias." << std::endl;
 	
 	WorkManager manager;
 	// Run separate loops for all obstasks, as this defines the order of the loops
@@ -257,6 +369,18 @@ GenericPreciseAnonymity::GenericPreciseAnonymity(
 				const_vector<numeric_type> RELObsProbsB2(4, 0); // Sender B talking to Recipient 2
 
 				const_vector<numeric_type> myDelta(6, 0);
+				
+				// rows of entry (middle) probabilities are computed once the exit (entry and exit) is fixed by outer loops
+				bool entryRows = translation[obstaskindex][2] != LOOP_X;
+				bool middleRows = translation[obstaskindex][2] == LOOP_M;
+				std::vector<probability_t> entryRow[4], middleRow[4];
+				size_t entryRowExit = size, middleRowEntry = size, middleRowExit = size;
+				for (int k = 0; k < 4; k++)
+				{
+					entryRow[k].resize(entryRows ? size : 0);
+					middleRow[k].resize(middleRows ? size : 0);
+				}
+				probability_t circuitProb[4];
 				size_t guard_index;
 				size_t middle_index;
 				size_t exit_index;
@@ -265,18 +389,14 @@ GenericPreciseAnonymity::GenericPreciseAnonymity(
 				for(size_t l0 = begin; l0 < end; ++l0) // Outermost loop -- node type depends on the translation
 				{
 					// [Optimization]: there are fewer exists than guards so worth checking exit relay first
-					if (translation[obstaskindex][0] == LOOP_X && !consensus.getRelay(l0).hasFlags(RelayFlag::EXIT))
-						continue;
-					if (translation[obstaskindex][0] == LOOP_G && !consensus.getRelay(l0).hasFlags(RelayFlag::GUARD))
+					if (!relayTable.hasFlags(l0, requiredFlags[obstaskindex][0]))
 						continue;
 
 					for(size_t l1 = 0; l1 < size; ++l1)
 					{
 						if (l0 == l1)
 							continue;
-						if (translation[obstaskindex][1] == LOOP_X && !consensus.getRelay(l1).hasFlags(RelayFlag::EXIT))
-							continue;
-						if (translation[obstaskindex][1] == LOOP_G && !consensus.getRelay(l1).hasFlags(RelayFlag::GUARD))
+						if (!relayTable.hasFlags(l1, requiredFlags[obstaskindex][1]))
 							continue;
 
 						for(size_t l2 = 0; l2 < size; ++l2)
@@ -284,9 +404,7 @@ GenericPreciseAnonymity::GenericPreciseAnonymity(
 							if (l0 == l2 || l1 == l2)
 								continue;
 
-							if (translation[obstaskindex][2] == LOOP_X && !consensus.getRelay(l2).hasFlags(RelayFlag::EXIT))
-								continue;
-							if (translation[obstaskindex][2] == LOOP_G && !consensus.getRelay(l2).hasFlags(RelayFlag::GUARD))
+							if (!relayTable.hasFlags(l2, requiredFlags[obstaskindex][2]))
 								continue;
 
 							circuit[translation[obstaskindex][0]] = l0;
@@ -296,10 +414,29 @@ GenericPreciseAnonymity::GenericPreciseAnonymity(
 							middle_index = circuit[1];
 							exit_index = circuit[2];
 
-							probability_t circuitProbA1 = psA1.exitProb(exit_index) * psA1.entryProb(guard_index, exit_index) * psA1.middleProb(middle_index, guard_index, exit_index);
-							probability_t circuitProbA2 = psA2.exitProb(exit_index) * psA2.entryProb(guard_index, exit_index) * psA2.middleProb(middle_index, guard_index, exit_index);
-							probability_t circuitProbB1 = psB1.exitProb(exit_index) * psB1.entryProb(guard_index, exit_index) * psB1.middleProb(middle_index, guard_index, exit_index);
-							probability_t circuitProbB2 = psB2.exitProb(exit_index) * psB2.entryProb(guard_index, exit_index) * psB2.middleProb(middle_index, guard_index, exit_index);
+							if (entryRows && entryRowExit != exit_index)
+							{
+								for (int k = 0; k < 4; k++)
+									pathSelections[k]->entryProbRow(exit_index, entryRow[k].data());
+								entryRowExit = exit_index;
+							}
+							if (middleRows && (middleRowEntry != guard_index || middleRowExit != exit_index))
+							{
+								for (int k = 0; k < 4; k++)
+									pathSelections[k]->middleProbRow(guard_index, exit_index, middleRow[k].data());
+								middleRowEntry = guard_index;
+								middleRowExit = exit_index;
+							}
+							for (int k = 0; k < 4; k++)
+							{
+								probability_t entryProb = entryRows ? entryRow[k][guard_index] : pathSelections[k]->entryProb(guard_index, exit_index);
+								probability_t middleProb = middleRows ? middleRow[k][middle_index] : pathSelections[k]->middleProb(middle_index, guard_index, exit_index);
+								circuitProb[k] = exitProbs[k][exit_index] * entryProb * middleProb;
+							}
+							probability_t circuitProbA1 = circuitProb[0];
+							probability_t circuitProbA2 = circuitProb[1];
+							probability_t circuitProbB1 = circuitProb[2];
+							probability_t circuitProbB2 = circuitProb[3];
 						
 							// gmxP is the probability of selecting (g)uard (m)iddle and (e)xit (the circuit
 							// NOT the conditional probability of middleProb.
@@ -318,34 +455,49 @@ GenericPreciseAnonymity::GenericPreciseAnonymity(
 							BG = observedSenderB[guard_index];
 							X1 = observedRecipient1[exit_index];
 							X2 = observedRecipient2[exit_index];
-							GM = observedNodes[guard_index][middle_index];
-							MX = observedNodes[middle_index][exit_index];
 
-							// check whether a relevant observation was made:
-							for (int i = 0; i < 4; i++)
+							// [ShorTor]: links routed through vias may be observed only for some of the vias,
+							// the circuit's probability is split between the observations of its links.
+							probability_t linkGM = viaLinks.observed(guard_index, middle_index);
+							probability_t linkMX = viaLinks.observed(middle_index, exit_index);
+							for (int link = 0; link < 4; link++)
 							{
-								if (obstasks[obstaskindex][i].second == 3) // We have to handle the observation in this innermost loop; no need to sum something up
-								{ 
-									handleInnermost(myDelta, obstasks[obstaskindex][i].first, conv_gmxPA1, conv_gmxPA2, conv_gmxPB1, conv_gmxPB2, AG, BG, GM, MX, X1, X2);
-								}
-								else
+								GM = link & 1;
+								MX = link & 2;
+								probability_t share = (GM ? linkGM : 1 - linkGM) * (MX ? linkMX : 1 - linkMX);
+								if (!(share > 0))
+									continue;
+								numeric_type prA1 = conv_gmxPA1 * share;
+								numeric_type prA2 = conv_gmxPA2 * share;
+								numeric_type prB1 = conv_gmxPB1 * share;
+								numeric_type prB2 = conv_gmxPB2 * share;
+
+								// check whether a relevant observation was made:
+								for (int i = 0; i < 4; i++)
 								{
-									if (checkObservation(obstasks[obstaskindex][i].first, AG, GM, MX, true))
-										SAObsProbsA1[i] += conv_gmxPA1;
-									if (checkObservation(obstasks[obstaskindex][i].first, BG, GM, MX, true))
-										SAObsProbsB1[i] += conv_gmxPB1;
-									if (checkObservation(obstasks[obstaskindex][i].first, true, GM, MX, X1))
-										RAObsProbsA1[i] += conv_gmxPA1;
-									if (checkObservation(obstasks[obstaskindex][i].first, true, GM, MX, X2))
-										RAObsProbsA2[i] += conv_gmxPA2;
-									if (checkObservation(obstasks[obstaskindex][i].first, AG, GM, MX, X1))
-										RELObsProbsA1[i] += conv_gmxPA1;
-									if (checkObservation(obstasks[obstaskindex][i].first, AG, GM, MX, X2))
-										RELObsProbsA2[i] += conv_gmxPA2;
-									if (checkObservation(obstasks[obstaskindex][i].first, BG, GM, MX, X1))
-										RELObsProbsB1[i] += conv_gmxPB1;
-									if (checkObservation(obstasks[obstaskindex][i].first, BG, GM, MX, X2))
-										RELObsProbsB2[i] += conv_gmxPB2;
+									if (obstasks[obstaskindex][i].second == 3) // We have to handle the observation in this innermost loop; no need to sum something up
+									{ 
+										handleInnermost(myDelta, obstasks[obstaskindex][i].first, prA1, prA2, prB1, prB2, AG, BG, GM, MX, X1, X2);
+									}
+									else
+									{
+										if (checkObservation(obstasks[obstaskindex][i].first, AG, GM, MX, true))
+											SAObsProbsA1[i] += prA1;
+										if (checkObservation(obstasks[obstaskindex][i].first, BG, GM, MX, true))
+											SAObsProbsB1[i] += prB1;
+										if (checkObservation(obstasks[obstaskindex][i].first, true, GM, MX, X1))
+											RAObsProbsA1[i] += prA1;
+										if (checkObservation(obstasks[obstaskindex][i].first, true, GM, MX, X2))
+											RAObsProbsA2[i] += prA2;
+										if (checkObservation(obstasks[obstaskindex][i].first, AG, GM, MX, X1))
+											RELObsProbsA1[i] += prA1;
+										if (checkObservation(obstasks[obstaskindex][i].first, AG, GM, MX, X2))
+											RELObsProbsA2[i] += prA2;
+										if (checkObservation(obstasks[obstaskindex][i].first, BG, GM, MX, X1))
+											RELObsProbsB1[i] += prB1;
+										if (checkObservation(obstasks[obstaskindex][i].first, BG, GM, MX, X2))
+											RELObsProbsB2[i] += prB2;
+									}
 								}
 							}
 						} // End of innermost loop (L = 3)
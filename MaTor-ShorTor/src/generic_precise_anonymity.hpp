@@ -43,6 +43,9 @@ class GenericPreciseAnonymity
 		/**
 		 * Constructor computes adversary's advantages in distinguishing the scenarios
 		 * based on variety of observations.
+		 * If the consensus uses [ShorTor] via relays, a link between guard and middle (middle and exit)
+		 * which may use vias is routed through each of them with the same probability,
+		 * and it is observed if a connection of the via to either relay is observed.
 		 * @param consensus consensus describing Tor network state.
 		 * @param psA1 path selection for sender A and recipient 1 pair
 		 * @param psA2 path selection for sender A and recipient 2 pair
@@ -4,6 +4,8 @@
 #include "utils.hpp"
 
 #include <numeric>
+#include <map>
+#include <array>
 
 //constexpr size_t uint_precision = sizeof(numeric_type) * 8 * 15 / 16; // *15/16 == make 64 -> 60, 32 -> 30, etc...
 //constexpr probability_t conversion_const = (1ull << uint_precision);
@@ -65,6 +67,37 @@ static inline void normal_add(Accumulator& accumulator, const Value value)
 	accumulator += value;
 }
 
+// assigns relays to classes of relays interchangeable in all four path selections (relays of the same group in each of them),
+// classes are numbered in the order of their first relays (representatives). Returns the number of classes.
+static size_t relayClasses(bool groupRelays,
+	const PathSelection& psA1, const PathSelection& psA2, const PathSelection& psB1, const PathSelection& psB2,
+	std::vector<size_t>& classOf, std::vector<size_t>& representative, std::vector<numeric_type>& classSize)
+{
+	size_t size = psA1.getConsensus().getSize();
+	std::vector<size_t> groups[4];
+	const PathSelection* pathSelections[4] = { &psA1, &psA2, &psB1, &psB2 };
+	for(size_t k = 0; k < 4; ++k)
+		if(groupRelays)
+			pathSelections[k]->relayGroups(groups[k]);
+		else
+			pathSelections[k]->PathSelection::relayGroups(groups[k]);
+	
+	std::map<std::array<size_t, 4>, size_t> lookup; // groups in path selections to class
+	classOf.resize(size);
+	for(size_t i = 0; i < size; ++i)
+	{
+		auto found = lookup.emplace(std::array<size_t, 4>{{ groups[0][i], groups[1][i], groups[2][i], groups[3][i] }}, representative.size());
+		if(found.second)
+		{
+			representative.push_back(i);
+			classSize.push_back(0);
+		}
+		classOf[i] = found.first->second;
+		++classSize[classOf[i]];
+	}
+	return representative.size();
+}
+
 // TODO: we assume epsilon == 1. Add handling weird, different cases.
 GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 	const Consensus& consensus,
@@ -72,7 +105,8 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 	const PathSelection& psA2,
 	const PathSelection& psB1,
 	const PathSelection& psB2,
-	double epsilon) : 
+	double epsilon,
+	bool groupRelays) : 
 	size(consensus.getSize()),
 	deltaPairs1(size, true), deltaPairs2(size, true),
 	deltaPerNodeSA1(size, 0), deltaPerNodeSA2(size, 0),
@@ -91,6 +125,16 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 		NOT_IMPLEMENTED;
 	}
 	
+	// Relays of the same class are interchangeable in all four path selections: they have the same probabilities
+	// in every circuit and the same observations. The loops below run over classes (through their representative relays)
+	// with the sums over the free positions weighted by sizes of the classes, and the advantages of relays and pairs of relays
+	// are read from their classes. Without grouping (or if no relays are interchangeable) every relay is its own class.
+	std::vector<size_t> classOf; /**< Class of every relay. */
+	std::vector<size_t> representative; /**< First relay of every class. */
+	std::vector<numeric_type> classSize; /**< Number of relays in every class. */
+	size_t classes = relayClasses(groupRelays, psA1, psA2, psB1, psB2, classOf, representative, classSize);
+	clogsn("Relays grouped to " << classes << " classes.");
+	
 	// the following variables are used as accumulators for multi-threaded computation
 	// atomic type for multicore concurrent computation.
 
@@ -98,106 +142,113 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 	clogsn("Resizing vectors...");
 	atomic_type accumDeltaServer1(0); /**< Accumulator for deltaServer1 in thread-safe type. */
 	atomic_type accumDeltaServer2(0); /**< Accumulator for deltaServer2 in thread-safe type. */
-	const_vector<numeric_type> probForExitRA1(size, 0); /**< Advantage obtained by simply compromising this exit = probability of selecting relay as exit (instant recipient anonymity break) if A connects to 1. */
-	const_vector<numeric_type> probForExitRA2(size, 0); /**< Advantage obtained by simply compromising this exit = probability of selecting relay as exit (instant recipient anonymity break) if A connects to 2. */
+	const_vector<numeric_type> probForExitRA1(classes, 0); /**< Advantage obtained by simply compromising this exit = probability of selecting relay as exit (instant recipient anonymity break) if A connects to 1. */
+	const_vector<numeric_type> probForExitRA2(classes, 0); /**< Advantage obtained by simply compromising this exit = probability of selecting relay as exit (instant recipient anonymity break) if A connects to 2. */
 	// (at the end of the loop)
-	const_vector<numeric_type> deltaForExitRelA1(size, 0); /**< Advantage obtained by exit node probability differences for relationship anonymity (phi(A1, B1) + phi(B2, A2)) / 2. */
-	const_vector<numeric_type> deltaForExitRelA2(size, 0); /**< Advantage obtained by exit node probability differences for relationship anonymity (phi(B1, A1) + phi(A2, B2)) / 2. */
+	const_vector<numeric_type> deltaForExitRelA1(classes, 0); /**< Advantage obtained by exit node probability differences for relationship anonymity (phi(A1, B1) + phi(B2, A2)) / 2. */
+	const_vector<numeric_type> deltaForExitRelA2(classes, 0); /**< Advantage obtained by exit node probability differences for relationship anonymity (phi(B1, A1) + phi(A2, B2)) / 2. */
 	
-	const_vector<numeric_type> deltaForExitSA1(size, 0); /**< Advantage obtained by exit node probability differences for sender anonymity (phi(A1, B1)). */
-	const_vector<numeric_type> deltaForExitSA2(size, 0); /**< Advantage obtained by exit node probability differences for sender anonymity (phi(B1, A1)). */
+	const_vector<numeric_type> deltaForExitSA1(classes, 0); /**< Advantage obtained by exit node probability differences for sender anonymity (phi(A1, B1)). */
+	const_vector<numeric_type> deltaForExitSA2(classes, 0); /**< Advantage obtained by exit node probability differences for sender anonymity (phi(B1, A1)). */
 	
 	// for entry loop
-	const_vector<atomic_type> probForEntryA1(size, 0); /**< Sum of probabilities of selecting relay as entry for all exits if A connects to 1 (also advantage for instant sender anonymity break). */
-	const_vector<atomic_type> probForEntryA2(size, 0); /**< Sum of probabilities of selecting relay as entry for all exits if A connects to 2 (also advantage for instant sender anonymity break). */
-	const_vector<atomic_type> probForEntryB1(size, 0); /**< Sum of probabilities of selecting relay as entry for all exits if B connects to 1 (also advantage for instant sender anonymity break). */
-	//const_vector<atomic_type> probForEntryB2(size, 0); /**< Sum of probabilities of selecting relay as entry for all exits if B connects to 2 (also advantage for instant sender anonymity break). */
+	const_vector<atomic_type> probForEntryA1(classes, 0); /**< Sum of probabilities of selecting relay as entry for all exits if A connects to 1 (also advantage for instant sender anonymity break). */
+	const_vector<atomic_type> probForEntryA2(classes, 0); /**< Sum of probabilities of selecting relay as entry for all exits if A connects to 2 (also advantage for instant sender anonymity break). */
+	const_vector<atomic_type> probForEntryB1(classes, 0); /**< Sum of probabilities of selecting relay as entry for all exits if B connects to 1 (also advantage for instant sender anonymity break). */
+	//const_vector<atomic_type> probForEntryB2(classes, 0); /**< Sum of probabilities of selecting relay as entry for all exits if B connects to 2 (also advantage for instant sender anonymity break). */
 	
-	const_vector<const_vector<numeric_type>> probForExitEntryRelA1(size, size, 0); /**< Probability (advantage in relationship anonymity) of selecting the pair of entry and exit nodes (A1 B2). [exit][entry] matrix. */
-	const_vector<const_vector<numeric_type>> probForExitEntryRelA2(size, size, 0); /**< Probability (advantage in relationship anonymity) of selecting the pair of entry and exit nodes (A2 B1). [exit][entry] matrix. */
+	const_vector<const_vector<numeric_type>> probForExitEntryRelA1(classes, classes, 0); /**< Probability (advantage in relationship anonymity) of selecting the pair of entry and exit nodes (A1 B2). [exit][entry] matrix. */
+	const_vector<const_vector<numeric_type>> probForExitEntryRelA2(classes, classes, 0); /**< Probability (advantage in relationship anonymity) of selecting the pair of entry and exit nodes (A2 B1). [exit][entry] matrix. */
 	
 	// for middle loop
-	const_vector<const_vector<atomic_type>> probForEntryMiddlePairA1(size, size, 0); /**< Sum of probabilities (for all exits) of selecting pair of relays as entry and middle when A connects to 1. [entry][middle] matrix. */
-	const_vector<const_vector<atomic_type>> probForEntryMiddlePairA2(size, size, 0); /**< Sum of probabilities (for all exits) of selecting pair of relays as entry and middle when A connects to 2. [entry][middle] matrix. */
-	const_vector<const_vector<atomic_type>> probForEntryMiddlePairB1(size, size, 0); /**< Sum of probabilities (for all exits) of selecting pair of relays as entry and middle when B connects to 1. [entry][middle] matrix. */
-	const_vector<const_vector<atomic_type>> probForEntryMiddlePairB2(size, size, 0); /**< Sum of probabilities (for all exits) of selecting pair of relays as entry and middle when B connects to 2. [entry][middle] matrix. */
+	const_vector<const_vector<atomic_type>> probForEntryMiddlePairA1(classes, classes, 0); /**< Sum of probabilities (for all exits) of selecting pair of relays as entry and middle when A connects to 1. [entry][middle] matrix. */
+	const_vector<const_vector<atomic_type>> probForEntryMiddlePairA2(classes, classes, 0); /**< Sum of probabilities (for all exits) of selecting pair of relays as entry and middle when A connects to 2. [entry][middle] matrix. */
+	const_vector<const_vector<atomic_type>> probForEntryMiddlePairB1(classes, classes, 0); /**< Sum of probabilities (for all exits) of selecting pair of relays as entry and middle when B connects to 1. [entry][middle] matrix. */
+	const_vector<const_vector<atomic_type>> probForEntryMiddlePairB2(classes, classes, 0); /**< Sum of probabilities (for all exits) of selecting pair of relays as entry and middle when B connects to 2. [entry][middle] matrix. */
 	
-	//const_vector<const_vector<numeric_type>> probForExitMiddlePairA1(size, size, 0); /**< Sum of probabilities (for all entries) of selecting pair of relays as exit and middle when A connects to 1. [exit][middle] matrix. */
-	//const_vector<const_vector<numeric_type>> probForExitMiddlePairA2(size, size, 0); /**< Sum of probabilities (for all entries) of selecting pair of relays as exit and middle when A connects to 2. [exit][middle] matrix. */
-	//const_vector<const_vector<numeric_type>> probForExitMiddlePairB1(size, size, 0); /**< Sum of probabilities (for all entries) of selecting pair of relays as exit and middle when B connects to 1. [exit][middle] matrix. */
-	//const_vector<const_vector<numeric_type>> probForExitMiddlePairB2(size, size, 0); /**< Sum of probabilities (for all entries) of selecting pair of relays as exit and middle when B connects to 2. [exit][middle] matrix. */
+	//const_vector<const_vector<numeric_type>> probForExitMiddlePairA1(classes, classes, 0); /**< Sum of probabilities (for all entries) of selecting pair of relays as exit and middle when A connects to 1. [exit][middle] matrix. */
+	//const_vector<const_vector<numeric_type>> probForExitMiddlePairA2(classes, classes, 0); /**< Sum of probabilities (for all entries) of selecting pair of relays as exit and middle when A connects to 2. [exit][middle] matrix. */
+	//const_vector<const_vector<numeric_type>> probForExitMiddlePairB1(classes, classes, 0); /**< Sum of probabilities (for all entries) of selecting pair of relays as exit and middle when B connects to 1. [exit][middle] matrix. */
+	//const_vector<const_vector<numeric_type>> probForExitMiddlePairB2(classes, classes, 0); /**< Sum of probabilities (for all entries) of selecting pair of relays as exit and middle when B connects to 2. [exit][middle] matrix. */
 	
-	const_vector<atomic_type> deltaForMiddleSA1(size, 0); /**< Sum of advantage (for all entries and exits) obtained by observing differences between A1 and B1 scenario as middle node ((phi(A1, B1)). */
-	const_vector<atomic_type> deltaForMiddleSA2(size, 0); /**< Sum of advantage (for all entries and exits) obtained by observing differences between B1 and A1 scenario as middle node ((phi(B1, A1)). */
-	const_vector<atomic_type> deltaForMiddleRA1(size, 0); /**< Sum of advantage (for all entries and exits) obtained by observing differences between A1 and A2 scenario as middle node ((phi(A1, A2)). */
-	const_vector<atomic_type> deltaForMiddleRA2(size, 0); /**< Sum of advantage (for all entries and exits) obtained by observing differences between A2 and A1 scenario as middle node ((phi(A2, A1)). */
-	const_vector<atomic_type> deltaTriple1(size, 0); /**< Sum of advantage (for all entries and exits) obtained by observing whole circuit as middle node in A1 B2 case (for relationship anonymity). */
-	const_vector<atomic_type> deltaTriple2(size, 0); /**< Sum of advantage (for all entries and exits) obtained by observing whole circuit as middle node in B1 A2 case (for relationship anonymity). */
+	const_vector<atomic_type> deltaForMiddleSA1(classes, 0); /**< Sum of advantage (for all entries and exits) obtained by observing differences between A1 and B1 scenario as middle node ((phi(A1, B1)). */
+	const_vector<atomic_type> deltaForMiddleSA2(classes, 0); /**< Sum of advantage (for all entries and exits) obtained by observing differences between B1 and A1 scenario as middle node ((phi(B1, A1)). */
+	const_vector<atomic_type> deltaForMiddleRA1(classes, 0); /**< Sum of advantage (for all entries and exits) obtained by observing differences between A1 and A2 scenario as middle node ((phi(A1, A2)). */
+	const_vector<atomic_type> deltaForMiddleRA2(classes, 0); /**< Sum of advantage (for all entries and exits) obtained by observing differences between A2 and A1 scenario as middle node ((phi(A2, A1)). */
+	const_vector<atomic_type> deltaTriple1(classes, 0); /**< Sum of advantage (for all entries and exits) obtained by observing whole circuit as middle node in A1 B2 case (for relationship anonymity). */
+	const_vector<atomic_type> deltaTriple2(classes, 0); /**< Sum of advantage (for all entries and exits) obtained by observing whole circuit as middle node in B1 A2 case (for relationship anonymity). */
 	
-	const_vector<const_vector<atomic_type>> deltaForEntryMiddleRelA1(size, size, 0); /**< Sum of advantage (for each exit) obtained by observing differences between A1 and A2 or B1 and B2 as entry and middle. [entry][middle] matrix.*/
-	const_vector<const_vector<atomic_type>> deltaForEntryMiddleRelA2(size, size, 0); /**< Sum of advantage (for each exit) obtained by observing differences between A2 and A1 or B2 and B1 as entry and middle. [entry][middle] matrix.*/
-	const_vector<const_vector<numeric_type>> deltaForExitMiddleRelA1(size, size, 0); /**< Sum of advantage (for each entry) obtained by observing differences between A1 and B1 or A2 and B2 as exit and middle. [exit][middle] matrix.*/
-	const_vector<const_vector<numeric_type>> deltaForExitMiddleRelA2(size, size, 0); /**< Sum of advantage (for each entry) obtained by observing differences between B1 and A1 or B2 and A2 as exit and middle. [exit][middle] matrix.*/
+	const_vector<const_vector<atomic_type>> deltaForEntryMiddleRelA1(classes, classes, 0); /**< Sum of advantage (for each exit) obtained by observing differences between A1 and A2 or B1 and B2 as entry and middle. [entry][middle] matrix.*/
+	const_vector<const_vector<atomic_type>> deltaForEntryMiddleRelA2(classes, classes, 0); /**< Sum of advantage (for each exit) obtained by observing differences between A2 and A1 or B2 and B1 as entry and middle. [entry][middle] matrix.*/
+	const_vector<const_vector<numeric_type>> deltaForExitMiddleRelA1(classes, classes, 0); /**< Sum of advantage (for each entry) obtained by observing differences between A1 and B1 or A2 and B2 as exit and middle. [exit][middle] matrix.*/
+	const_vector<const_vector<numeric_type>> deltaForExitMiddleRelA2(classes, classes, 0); /**< Sum of advantage (for each entry) obtained by observing differences between B1 and A1 or B2 and A2 as exit and middle. [exit][middle] matrix.*/
 		
 	// for the outer quadloop
-	const_vector<numeric_type> deltaForEntryRA1(size, 0); /**< Advantage obtained by entry node probability differences for recipient anonymity (phi(A1, A2)). */
-	const_vector<numeric_type> deltaForEntryRA2(size, 0); /**< Advantage obtained by entry node probability differences for recipient anonymity (phi(A2, A1)). */
+	const_vector<numeric_type> deltaForEntryRA1(classes, 0); /**< Advantage obtained by entry node probability differences for recipient anonymity (phi(A1, A2)). */
+	const_vector<numeric_type> deltaForEntryRA2(classes, 0); /**< Advantage obtained by entry node probability differences for recipient anonymity (phi(A2, A1)). */
 	
-	const_vector<numeric_type> deltaForEntryRelA1(size, 0); /**< Advantage obtained by entry node probability differences for relationship anonymity (phi(A1, A2) + phi(B2, B1)) / 2. */
-	const_vector<numeric_type> deltaForEntryRelA2(size, 0); /**< Advantage obtained by entry node probability differences for relationship anonymity (phi(A2, A1) + phi(B1, B2)) / 2. */
+	const_vector<numeric_type> deltaForEntryRelA1(classes, 0); /**< Advantage obtained by entry node probability differences for relationship anonymity (phi(A1, A2) + phi(B2, B1)) / 2. */
+	const_vector<numeric_type> deltaForEntryRelA2(classes, 0); /**< Advantage obtained by entry node probability differences for relationship anonymity (phi(A2, A1) + phi(B1, B2)) / 2. */
 
 	/* Here start the variables for the indirect impact!*/
 
 	// the Guard-Exit impacts Impact_{indirect}^{(ab)(cd)}(n,n')
-	const_vector<const_vector<atomic_type>> impactIndirectA1A2(size, size, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
-	const_vector<const_vector<atomic_type>> impactIndirectA2A1(size, size, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
-	const_vector<const_vector<atomic_type>> impactIndirectB1B2(size, size, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
-	const_vector<const_vector<atomic_type>> impactIndirectB2B1(size, size, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
+	const_vector<const_vector<atomic_type>> impactIndirectA1A2(classes, classes, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
+	const_vector<const_vector<atomic_type>> impactIndirectA2A1(classes, classes, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
+	const_vector<const_vector<atomic_type>> impactIndirectB1B2(classes, classes, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
+	const_vector<const_vector<atomic_type>> impactIndirectB2B1(classes, classes, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
 
-	const_vector<const_vector<atomic_type>> impactIndirectA1B1(size, size, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
-	const_vector<const_vector<atomic_type>> impactIndirectB1A1(size, size, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
-	const_vector<const_vector<atomic_type>> impactIndirectA2B2(size, size, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
-	const_vector<const_vector<atomic_type>> impactIndirectB2A2(size, size, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
+	const_vector<const_vector<atomic_type>> impactIndirectA1B1(classes, classes, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
+	const_vector<const_vector<atomic_type>> impactIndirectB1A1(classes, classes, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
+	const_vector<const_vector<atomic_type>> impactIndirectA2B2(classes, classes, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
+	const_vector<const_vector<atomic_type>> impactIndirectB2A2(classes, classes, 0); /**< Sum (over all middle nodes) of differences in probabilities that n and n' are guard and exit (with the respective middle node). */
 
 	// Indirect impact Rec2
-	const_vector<const_vector<atomic_type>> impactIndirectRec2A1B1(size, size, 0); /**< Sum (over all exit nodes) of differences in probabilities that n and n' are guard and middle or middle and guard (with the respective exit node). */
-	const_vector<const_vector<atomic_type>> impactIndirectRec2B1A1(size, size, 0); /**< Sum (over all exit nodes) of differences in probabilities that n and n' are guard and middle or middle and guard (with the respective exit node). */
+	const_vector<const_vector<atomic_type>> impactIndirectRec2A1B1(classes, classes, 0); /**< Sum (over all exit nodes) of differences in probabilities that n and n' are guard and middle or middle and guard (with the respective exit node). */
+	const_vector<const_vector<atomic_type>> impactIndirectRec2B1A1(classes, classes, 0); /**< Sum (over all exit nodes) of differences in probabilities that n and n' are guard and middle or middle and guard (with the respective exit node). */
 
 	// Indirect impact Sen2
-	const_vector<const_vector<atomic_type>> impactIndirectSen2A1A2(size, size, 0); /**< Sum (over all guard nodes) of differences in probabilities that n and n' are middle and exit or exit and middle (with the respective guard node). */
-	const_vector<const_vector<atomic_type>> impactIndirectSen2A2A1(size, size, 0); /**< Sum (over all guard nodes) of differences in probabilities that n and n' are middle and exit or exit and middle (with the respective guard node). */
+	const_vector<const_vector<atomic_type>> impactIndirectSen2A1A2(classes, classes, 0); /**< Sum (over all guard nodes) of differences in probabilities that n and n' are middle and exit or exit and middle (with the respective guard node). */
+	const_vector<const_vector<atomic_type>> impactIndirectSen2A2A1(classes, classes, 0); /**< Sum (over all guard nodes) of differences in probabilities that n and n' are middle and exit or exit and middle (with the respective guard node). */
 
 	// Accumulating probabilities for Rec1
-	const_vector<const_vector<atomic_type>> gmProbForXA1(size, size, 0); /**< Probability of a node to be guard or middle node for a specific exit node */
-	const_vector<const_vector<atomic_type>> gmProbForXB1(size, size, 0); /**< Probability of a node to be guard or middle node for a specific exit node */
+	const_vector<const_vector<atomic_type>> gmProbForXA1(classes, classes, 0); /**< Probability of a node to be guard or middle node for a specific exit node */
+	const_vector<const_vector<atomic_type>> gmProbForXB1(classes, classes, 0); /**< Probability of a node to be guard or middle node for a specific exit node */
 
 	// Accumulating probabilities for Sen1
-	const_vector<const_vector<atomic_type>> mxProbForGA1(size, size, 0); /**< Probability of a node to be middle node or exit node for a specific guard node */
-	const_vector<const_vector<atomic_type>> mxProbForGA2(size, size, 0); /**< Probability of a node to be middle node or exit node for a specific guard node */
+	const_vector<const_vector<atomic_type>> mxProbForGA1(classes, classes, 0); /**< Probability of a node to be middle node or exit node for a specific guard node */
+	const_vector<const_vector<atomic_type>> mxProbForGA2(classes, classes, 0); /**< Probability of a node to be middle node or exit node for a specific guard node */
 
 
 	// Partition the job into chunks
 	// The larger the chunks, the less tasks, but might cause unbalanced work distribution
 	constexpr size_t chunk_size = 16;
 	WorkManager manager;
-	for(size_t i = 0; i < size; i += chunk_size)
+	for(size_t i = 0; i < classes; i += chunk_size)
 	{
 		size_t begin = i, end = begin + chunk_size;
-		// last chunk: stop at size, don't go further
-		if(end > size) end = size;
+		// last chunk: stop at the number of classes, don't go further
+		if(end > classes) end = classes;
 		manager.addTask([&, begin, end](){
+			// rows of conditional entry (for the exit) and middle (for the entry and exit) probabilities
+			std::vector<probability_t> entryRowA1(size), entryRowA2(size), entryRowB1(size), entryRowB2(size);
+			std::vector<probability_t> middleRowA1(size), middleRowA2(size), middleRowB1(size), middleRowB2(size);
+			// indices of the loops are classes, relays are their representatives
 			for(size_t exit_index = begin; exit_index < end; ++exit_index)
 			{
+				size_t exit = representative[exit_index];
+				numeric_type xWeight = classSize[exit_index];
+				
 				// temporary arrays to store cumulative observations of exit node on (_, _, middle, exit, recipient)
-				const_vector<numeric_type> middleExitSumA1(size, 0);
-				const_vector<numeric_type> middleExitSumA2(size, 0);
-				const_vector<numeric_type> middleExitSumB1(size, 0);
-				const_vector<numeric_type> middleExitSumB2(size, 0);
+				const_vector<numeric_type> middleExitSumA1(classes, 0);
+				const_vector<numeric_type> middleExitSumA2(classes, 0);
+				const_vector<numeric_type> middleExitSumB1(classes, 0);
+				const_vector<numeric_type> middleExitSumB2(classes, 0);
 				
-				probability_t exitProbabilityA1 = psA1.exitProb(exit_index);
-				probability_t exitProbabilityA2 = psA2.exitProb(exit_index);
-				probability_t exitProbabilityB1 = psB1.exitProb(exit_index);
-				probability_t exitProbabilityB2 = psB2.exitProb(exit_index);
+				probability_t exitProbabilityA1 = psA1.exitProb(exit);
+				probability_t exitProbabilityA2 = psA2.exitProb(exit);
+				probability_t exitProbabilityB1 = psB1.exitProb(exit);
+				probability_t exitProbabilityB2 = psB2.exitProb(exit);
 
 				// xP stands for e(x)it(P)robability
 				numeric_type conv_xPA1 = convert_d2i(exitProbabilityA1);
@@ -210,18 +261,27 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 					continue;
 				
 				// compute phi-s for server in both scenarios:
-				phi(conv_xPA1, conv_xPB1, accumDeltaServer1, accumDeltaServer2, atomic_add);
+				phi(xWeight * conv_xPA1, xWeight * conv_xPB1, accumDeltaServer1, accumDeltaServer2, atomic_add);
 				
 				// assign probabilities for distinguishing events for recipient anonymity (same sender) 
 				probForExitRA1[exit_index] = conv_xPA1;
 				probForExitRA2[exit_index] = conv_xPA2;
 				
-				for(size_t entry_index = 0; entry_index < size; ++entry_index)
+				psA1.entryProbRow(exit, entryRowA1.data());
+				psA2.entryProbRow(exit, entryRowA2.data());
+				psB1.entryProbRow(exit, entryRowB1.data());
+				psB2.entryProbRow(exit, entryRowB2.data());
+				
+				for(size_t entry_index = 0; entry_index < classes; ++entry_index)
 				{
-					probability_t entryProbabilityA1 = exitProbabilityA1 * psA1.entryProb(entry_index, exit_index);
-					probability_t entryProbabilityA2 = exitProbabilityA2 * psA2.entryProb(entry_index, exit_index);
-					probability_t entryProbabilityB1 = exitProbabilityB1 * psB1.entryProb(entry_index, exit_index);
-					probability_t entryProbabilityB2 = exitProbabilityB2 * psB2.entryProb(entry_index, exit_index);
+					size_t entry = representative[entry_index];
+					numeric_type gWeight = classSize[entry_index];
+					numeric_type xgWeight = xWeight * gWeight;
+					
+					probability_t entryProbabilityA1 = exitProbabilityA1 * entryRowA1[entry];
+					probability_t entryProbabilityA2 = exitProbabilityA2 * entryRowA2[entry];
+					probability_t entryProbabilityB1 = exitProbabilityB1 * entryRowB1[entry];
+					probability_t entryProbabilityB2 = exitProbabilityB2 * entryRowB2[entry];
 					
 					// gxP is the probability of selecting BOTH (g)uard and (e)xit
 					// NOT the conditional probability of entryProb.
@@ -235,21 +295,29 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 						continue;
 						
 					// add partial probabilities to the probability of selecting entry node
-					probForEntryA1[entry_index].fetch_add(conv_gxPA1);
-					probForEntryA2[entry_index].fetch_add(conv_gxPA2);
-					probForEntryB1[entry_index].fetch_add(conv_gxPB1);
+					probForEntryA1[entry_index].fetch_add(xWeight * conv_gxPA1);
+					probForEntryA2[entry_index].fetch_add(xWeight * conv_gxPA2);
+					probForEntryB1[entry_index].fetch_add(xWeight * conv_gxPB1);
 					//probForEntryB2[entry_index].fetch_add(conv_gxPB2);
 					
 					// assign probabilities for distinguishing events for relationship anonymity (A1 B2 vs A2 B1)
 					probForExitEntryRelA1[exit_index][entry_index] = (conv_gxPA1 + conv_gxPB2) /2;
 					probForExitEntryRelA2[exit_index][entry_index] = (conv_gxPA2 + conv_gxPB1) /2;
 					
-					for(size_t middle_index = 0; middle_index < size; ++middle_index)
+					psA1.middleProbRow(entry, exit, middleRowA1.data());
+					psA2.middleProbRow(entry, exit, middleRowA2.data());
+					psB1.middleProbRow(entry, exit, middleRowB1.data());
+					psB2.middleProbRow(entry, exit, middleRowB2.data());
+					
+					for(size_t middle_index = 0; middle_index < classes; ++middle_index)
 					{
-						probability_t middleProbabilityA1 = entryProbabilityA1 * psA1.middleProb(middle_index, entry_index, exit_index);
-						probability_t middleProbabilityA2 = entryProbabilityA2 * psA2.middleProb(middle_index, entry_index, exit_index);
-						probability_t middleProbabilityB1 = entryProbabilityB1 * psB1.middleProb(middle_index, entry_index, exit_index);
-						probability_t middleProbabilityB2 = entryProbabilityB2 * psB2.middleProb(middle_index, entry_index, exit_index);
+						size_t middle = representative[middle_index];
+						numeric_type mWeight = classSize[middle_index];
+						
+						probability_t middleProbabilityA1 = entryProbabilityA1 * middleRowA1[middle];
+						probability_t middleProbabilityA2 = entryProbabilityA2 * middleRowA2[middle];
+						probability_t middleProbabilityB1 = entryProbabilityB1 * middleRowB1[middle];
+						probability_t middleProbabilityB2 = entryProbabilityB2 * middleRowB2[middle];
 						
 						// gmxP is the probability of selecting (g)uard (m)iddle and (e)xit (the circuit
 						// NOT the conditional probability of middleProb.
@@ -263,16 +331,17 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 							continue;
 
 						// accumulate probabilities of _, _, (middle), exit, (recipient) observations
-						middleExitSumA1[middle_index] += conv_gmxPA1;
-						middleExitSumA2[middle_index] += conv_gmxPA2;
-						middleExitSumB1[middle_index] += conv_gmxPB1;
-						middleExitSumB2[middle_index] += conv_gmxPB2;
+						// (sums over the free positions of the circuit are weighted by sizes of their classes)
+						middleExitSumA1[middle_index] += gWeight * conv_gmxPA1;
+						middleExitSumA2[middle_index] += gWeight * conv_gmxPA2;
+						middleExitSumB1[middle_index] += gWeight * conv_gmxPB1;
+						middleExitSumB2[middle_index] += gWeight * conv_gmxPB2;
 						
 						// accumulate probabilities of (sender), entry, (middle), _, _ observations
-						probForEntryMiddlePairA1[entry_index][middle_index].fetch_add(conv_gmxPA1);
-						probForEntryMiddlePairA2[entry_index][middle_index].fetch_add(conv_gmxPA2);
-						probForEntryMiddlePairB1[entry_index][middle_index].fetch_add(conv_gmxPB1);
-						probForEntryMiddlePairB2[entry_index][middle_index].fetch_add(conv_gmxPB2);
+						probForEntryMiddlePairA1[entry_index][middle_index].fetch_add(xWeight * conv_gmxPA1);
+						probForEntryMiddlePairA2[entry_index][middle_index].fetch_add(xWeight * conv_gmxPA2);
+						probForEntryMiddlePairB1[entry_index][middle_index].fetch_add(xWeight * conv_gmxPB1);
+						probForEntryMiddlePairB2[entry_index][middle_index].fetch_add(xWeight * conv_gmxPB2);
 						
 						// compute probabilities of the circuits in relationship anonymity case:
 						numeric_type conv_gmxRelA1 = (conv_gmxPA1 + conv_gmxPB2) /2; // A1 B2
@@ -280,59 +349,60 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 						
 						// compute the deltas for middle nodes:
 						//  Sender Anonymity (A1 vs B1)
-						phi(conv_gmxPA1, conv_gmxPB1, deltaForMiddleSA1[middle_index], deltaForMiddleSA2[middle_index], atomic_add);
+						phi(xgWeight * conv_gmxPA1, xgWeight * conv_gmxPB1, deltaForMiddleSA1[middle_index], deltaForMiddleSA2[middle_index], atomic_add);
 						//  Recipient Anonymity (A1 vs A2)
-						phi(conv_gmxPA1, conv_gmxPA2, deltaForMiddleRA1[middle_index], deltaForMiddleRA2[middle_index], atomic_add);
+						phi(xgWeight * conv_gmxPA1, xgWeight * conv_gmxPA2, deltaForMiddleRA1[middle_index], deltaForMiddleRA2[middle_index], atomic_add);
 						//  Relationship Anonymity (A1 B2 vs B1 A2)
-						phi(conv_gmxRelA1, conv_gmxRelA2, deltaTriple1[middle_index], deltaTriple2[middle_index], atomic_add);
+						phi(xgWeight * conv_gmxRelA1, xgWeight * conv_gmxRelA2, deltaTriple1[middle_index], deltaTriple2[middle_index], atomic_add);
 						
 						// compute the deltas for pairs of nodes: (remember to divide this by 2 in the end!)
 						//  (sender), entry, middle, (exit), _ 
-						phi(conv_gmxPA1, conv_gmxPA2, 
+						phi(xWeight * conv_gmxPA1, xWeight * conv_gmxPA2, 
 							deltaForEntryMiddleRelA1[entry_index][middle_index], 
 							deltaForEntryMiddleRelA2[entry_index][middle_index], atomic_add);
-						phi(conv_gmxPB2, conv_gmxPB1, 
+						phi(xWeight * conv_gmxPB2, xWeight * conv_gmxPB1, 
 							deltaForEntryMiddleRelA1[entry_index][middle_index], 
 							deltaForEntryMiddleRelA2[entry_index][middle_index], atomic_add);
 						// _, (entry), middle, exit, (recipient) 
-						phi(conv_gmxPA1, conv_gmxPB1, 
+						phi(gWeight * conv_gmxPA1, gWeight * conv_gmxPB1, 
 							deltaForExitMiddleRelA1[exit_index][middle_index], 
 							deltaForExitMiddleRelA2[exit_index][middle_index], normal_add);
-						phi(conv_gmxPB2, conv_gmxPA2, 
+						phi(gWeight * conv_gmxPB2, gWeight * conv_gmxPA2, 
 							deltaForExitMiddleRelA1[exit_index][middle_index], 
 							deltaForExitMiddleRelA2[exit_index][middle_index], normal_add);
 
 						// Compute the (indirect) Guard-Exit impacts Impact_{indirect}^{(ab)(cd)}(n,n')
-						phi(conv_gmxPA1, conv_gmxPA2, impactIndirectA1A2[entry_index][exit_index], impactIndirectA2A1[entry_index][exit_index], atomic_add);
-						phi(conv_gmxPB1, conv_gmxPB2, impactIndirectB1B2[entry_index][exit_index], impactIndirectB2B1[entry_index][exit_index], atomic_add);
-						phi(conv_gmxPA1, conv_gmxPB1, impactIndirectA1B1[entry_index][exit_index], impactIndirectB1A1[entry_index][exit_index], atomic_add);
-						phi(conv_gmxPA2, conv_gmxPB2, impactIndirectA2B2[entry_index][exit_index], impactIndirectB2A2[entry_index][exit_index], atomic_add);
+						phi(mWeight * conv_gmxPA1, mWeight * conv_gmxPA2, impactIndirectA1A2[entry_index][exit_index], impactIndirectA2A1[entry_index][exit_index], atomic_add);
+						phi(mWeight * conv_gmxPB1, mWeight * conv_gmxPB2, impactIndirectB1B2[entry_index][exit_index], impactIndirectB2B1[entry_index][exit_index], atomic_add);
+						phi(mWeight * conv_gmxPA1, mWeight * conv_gmxPB1, impactIndirectA1B1[entry_index][exit_index], impactIndirectB1A1[entry_index][exit_index], atomic_add);
+						phi(mWeight * conv_gmxPA2, mWeight * conv_gmxPB2, impactIndirectA2B2[entry_index][exit_index], impactIndirectB2A2[entry_index][exit_index], atomic_add);
 
 						// Compute the (indirect) Sen2 and Rec2 impacts.
-						phi(conv_gmxPA1, conv_gmxPB1, impactIndirectRec2A1B1[entry_index][middle_index], impactIndirectRec2B1A1[entry_index][middle_index], atomic_add);
-						phi(conv_gmxPA1, conv_gmxPA2, impactIndirectSen2A1A2[middle_index][exit_index], impactIndirectSen2A2A1[middle_index][exit_index], atomic_add);
+						phi(xWeight * conv_gmxPA1, xWeight * conv_gmxPB1, impactIndirectRec2A1B1[entry_index][middle_index], impactIndirectRec2B1A1[entry_index][middle_index], atomic_add);
+						phi(gWeight * conv_gmxPA1, gWeight * conv_gmxPA2, impactIndirectSen2A1A2[middle_index][exit_index], impactIndirectSen2A2A1[middle_index][exit_index], atomic_add);
 
 						// Prepare the (indirect) Rec1 impacts by calculating the probability that a node is guard or middle (for an exit node)
-						gmProbForXA1[entry_index][exit_index].fetch_add(conv_gmxPA1);
-						gmProbForXA1[middle_index][exit_index].fetch_add(conv_gmxPA1);
-						gmProbForXB1[entry_index][exit_index].fetch_add(conv_gmxPB1);
-						gmProbForXB1[middle_index][exit_index].fetch_add(conv_gmxPB1);
+						gmProbForXA1[entry_index][exit_index].fetch_add(mWeight * conv_gmxPA1);
+						gmProbForXA1[middle_index][exit_index].fetch_add(gWeight * conv_gmxPA1);
+						gmProbForXB1[entry_index][exit_index].fetch_add(mWeight * conv_gmxPB1);
+						gmProbForXB1[middle_index][exit_index].fetch_add(gWeight * conv_gmxPB1);
 						// Prepare the (indirect) Sen1 impacts by calculating the probability that a node is middle or exit (for a guard node)
-						mxProbForGA1[middle_index][entry_index].fetch_add(conv_gmxPA1);
-						mxProbForGA1[exit_index][entry_index].fetch_add(conv_gmxPA1);
-						mxProbForGA2[middle_index][entry_index].fetch_add(conv_gmxPA2);
-						mxProbForGA2[exit_index][entry_index].fetch_add(conv_gmxPA2);
+						mxProbForGA1[middle_index][entry_index].fetch_add(xWeight * conv_gmxPA1);
+						mxProbForGA1[exit_index][entry_index].fetch_add(mWeight * conv_gmxPA1);
+						mxProbForGA2[middle_index][entry_index].fetch_add(xWeight * conv_gmxPA2);
+						mxProbForGA2[exit_index][entry_index].fetch_add(mWeight * conv_gmxPA2);
 					}
 				}
 				
 				// for all middles seen by the exit, compute the distinguishing events:
-				for(size_t middle_index = 0; middle_index < size; ++middle_index)
+				for(size_t middle_index = 0; middle_index < classes; ++middle_index)
 				{
+					numeric_type mWeight = classSize[middle_index];
 					// for sender anonymity (same recipient)
-					phi(middleExitSumA1[middle_index], middleExitSumB1[middle_index], deltaForExitSA1[exit_index], deltaForExitSA2[exit_index], normal_add);
+					phi(mWeight * middleExitSumA1[middle_index], mWeight * middleExitSumB1[middle_index], deltaForExitSA1[exit_index], deltaForExitSA2[exit_index], normal_add);
 					// for relationship anonymity (remember to divide this by 2 in the end!)
-					phi(middleExitSumA1[middle_index], middleExitSumB1[middle_index], deltaForExitRelA1[exit_index], deltaForExitRelA2[exit_index], normal_add);
-					phi(middleExitSumB2[middle_index], middleExitSumA2[middle_index], deltaForExitRelA1[exit_index], deltaForExitRelA2[exit_index], normal_add);
+					phi(mWeight * middleExitSumA1[middle_index], mWeight * middleExitSumB1[middle_index], deltaForExitRelA1[exit_index], deltaForExitRelA2[exit_index], normal_add);
+					phi(mWeight * middleExitSumB2[middle_index], mWeight * middleExitSumA2[middle_index], deltaForExitRelA1[exit_index], deltaForExitRelA2[exit_index], normal_add);
 				}
 			}
 		});
@@ -343,28 +413,29 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 	std::cout << "All parallel jobs done (1 of 3)." << std::endl;
 
 	// Iterate over entry middle pairs to compute distinguishing events of entry nodes for recipient anonymity
-	for(size_t i = 0; i < size; i += chunk_size)
+	for(size_t i = 0; i < classes; i += chunk_size)
 	{
 		size_t begin = i, end = begin + chunk_size;
-		// last chunk: stop at size, don't go further
-		if(end > size) end = size;
+		// last chunk: stop at the number of classes, don't go further
+		if(end > classes) end = classes;
 		manager.addTask([&, begin, end](){
 			for(size_t entry_index = begin; entry_index < end; ++entry_index)
 			{
-				for(size_t middle_index = 0; middle_index < size; ++middle_index)
+				for(size_t middle_index = 0; middle_index < classes; ++middle_index)
 				{
+					numeric_type mWeight = classSize[middle_index];
 					// for recipient anonymity (same sender)
-					phi(probForEntryMiddlePairA1[entry_index][middle_index].load(std::memory_order::memory_order_relaxed), 
-						probForEntryMiddlePairA2[entry_index][middle_index].load(std::memory_order::memory_order_relaxed),
+					phi(mWeight * probForEntryMiddlePairA1[entry_index][middle_index].load(std::memory_order::memory_order_relaxed), 
+						mWeight * probForEntryMiddlePairA2[entry_index][middle_index].load(std::memory_order::memory_order_relaxed),
 						deltaForEntryRA1[entry_index], deltaForEntryRA2[entry_index],
 						normal_add);
 					// for relationship anonymity (remember to divide this by 2 in the end!)
-					phi(probForEntryMiddlePairA1[entry_index][middle_index].load(std::memory_order::memory_order_relaxed), 
-						probForEntryMiddlePairB2[entry_index][middle_index].load(std::memory_order::memory_order_relaxed),
+					phi(mWeight * probForEntryMiddlePairA1[entry_index][middle_index].load(std::memory_order::memory_order_relaxed), 
+						mWeight * probForEntryMiddlePairB2[entry_index][middle_index].load(std::memory_order::memory_order_relaxed),
 						deltaForEntryRelA1[entry_index], deltaForEntryRelA2[entry_index],
 						normal_add);
-					phi(probForEntryMiddlePairB1[entry_index][middle_index].load(std::memory_order::memory_order_relaxed), 
-						probForEntryMiddlePairA2[entry_index][middle_index].load(std::memory_order::memory_order_relaxed),
+					phi(mWeight * probForEntryMiddlePairB1[entry_index][middle_index].load(std::memory_order::memory_order_relaxed), 
+						mWeight * probForEntryMiddlePairA2[entry_index][middle_index].load(std::memory_order::memory_order_relaxed),
 						deltaForEntryRelA1[entry_index], deltaForEntryRelA2[entry_index],
 						normal_add);
 				}
@@ -403,30 +474,32 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 		manager.addTask([&, begin, end](){
 			for(size_t i = begin; i < end; ++i)
 			{
+				size_t ci = classOf[i]; // advantages of relays are read from their classes
 				// Divide relationship anonymity deltas where appropriate
-				deltaPerNodeRelA1[i] = (deltaForExitRelA1[i] /2) + (deltaForEntryRelA1[i]) + deltaTriple1[i];
-				deltaPerNodeRelA2[i] = (deltaForExitRelA2[i] /2) + (deltaForEntryRelA2[i]) + deltaTriple2[i];
+				deltaPerNodeRelA1[i] = (deltaForExitRelA1[ci] /2) + (deltaForEntryRelA1[ci]) + deltaTriple1[ci];
+				deltaPerNodeRelA2[i] = (deltaForExitRelA2[ci] /2) + (deltaForEntryRelA2[ci]) + deltaTriple2[ci];
 				for(size_t j = 0; j < size; ++j)
 				{
 					if(i != j)
 					{
-						deltaPairs1[i][j] += ((deltaForEntryMiddleRelA1[i][j] /2) + (deltaForExitMiddleRelA1[i][j] /2) + probForExitEntryRelA1[i][j]); 
-						deltaPairs2[i][j] += ((deltaForEntryMiddleRelA2[i][j] /2) + (deltaForExitMiddleRelA2[i][j] /2) + probForExitEntryRelA2[i][j]);
+						size_t cj = classOf[j];
+						deltaPairs1[i][j] += ((deltaForEntryMiddleRelA1[ci][cj] /2) + (deltaForExitMiddleRelA1[ci][cj] /2) + probForExitEntryRelA1[ci][cj]); 
+						deltaPairs2[i][j] += ((deltaForEntryMiddleRelA2[ci][cj] /2) + (deltaForExitMiddleRelA2[ci][cj] /2) + probForExitEntryRelA2[ci][cj]);
 					} 
 				}
 				
 				// Compute entry distinguishing (recipient anonymity)
-				phi(probForEntryA1[i].load(std::memory_order::memory_order_relaxed), 
-					probForEntryA2[i].load(std::memory_order::memory_order_relaxed), 
+				phi(probForEntryA1[ci].load(std::memory_order::memory_order_relaxed), 
+					probForEntryA2[ci].load(std::memory_order::memory_order_relaxed), 
 					deltaISP1, deltaISP2, normal_add);
 				
 				// Add to the vectors:
 				// (sender anonymity)
-				deltaPerNodeSA1[i] = probForEntryA1[i] + deltaForMiddleSA1[i] + deltaForExitSA1[i];
-				deltaPerNodeSA2[i] = probForEntryA2[i] + deltaForMiddleSA2[i] + deltaForExitSA2[i];
+				deltaPerNodeSA1[i] = probForEntryA1[ci] + deltaForMiddleSA1[ci] + deltaForExitSA1[ci];
+				deltaPerNodeSA2[i] = probForEntryA2[ci] + deltaForMiddleSA2[ci] + deltaForExitSA2[ci];
 				// (recipient anonymity)
-				deltaPerNodeRA1[i] = probForExitRA1[i] + deltaForMiddleRA1[i] + deltaForEntryRA1[i];
-				deltaPerNodeRA2[i] = probForExitRA2[i] + deltaForMiddleRA2[i] + deltaForEntryRA2[i];
+				deltaPerNodeRA1[i] = probForExitRA1[ci] + deltaForMiddleRA1[ci] + deltaForEntryRA1[ci];
+				deltaPerNodeRA2[i] = probForExitRA2[ci] + deltaForMiddleRA2[ci] + deltaForEntryRA2[ci];
 
 				// Indirect Impact(!)
 				// 
@@ -436,38 +509,39 @@ GenericWorstCaseAnonymity::GenericWorstCaseAnonymity(
 					{
 						if (i != j)
 						{
+							size_t cj = classOf[j];
 							// Indirect Impacts per node (for sender anonymity and recipient anonymity)
 
 							// Impact_Rec1 (for sender anonymity)
 							// Note that here the inputs of the phi function are flipped (consider the formula in the paper for an explanation)!
-							phi(gmProbForXB1[i][j].load(std::memory_order::memory_order_relaxed), 
-								gmProbForXA1[i][j].load(std::memory_order::memory_order_relaxed), 
+							phi(gmProbForXB1[ci][cj].load(std::memory_order::memory_order_relaxed), 
+								gmProbForXA1[ci][cj].load(std::memory_order::memory_order_relaxed), 
 								deltaIndirectPerNodeSA1[i],deltaIndirectPerNodeSA2[i],normal_add);
-							//myassert(gmProbForXB1[i][j].load(std::memory_order::memory_order_relaxed) - gmProbForXA1[i][j].load(std::memory_order::memory_order_relaxed) == 0);
+							//myassert(gmProbForXB1[ci][cj].load(std::memory_order::memory_order_relaxed) - gmProbForXA1[ci][cj].load(std::memory_order::memory_order_relaxed) == 0);
 
 							// Impact_Sen1 (for recipient anonymity)
 							// Note that here the inputs of the phi function are flipped (consider the formula in the paper for an explanation)!
-							phi(mxProbForGA2[i][j].load(std::memory_order::memory_order_relaxed),
-								mxProbForGA1[i][j].load(std::memory_order::memory_order_relaxed),
+							phi(mxProbForGA2[ci][cj].load(std::memory_order::memory_order_relaxed),
+								mxProbForGA1[ci][cj].load(std::memory_order::memory_order_relaxed),
 								deltaIndirectPerNodeRA1[i], deltaIndirectPerNodeRA2[i], normal_add);
-							//myassert(abs(mxProbForGA2[i][j].load(std::memory_order::memory_order_relaxed) - mxProbForGA1[i][j].load(std::memory_order::memory_order_relaxed)) < 0.0001);
+							//myassert(abs(mxProbForGA2[ci][cj].load(std::memory_order::memory_order_relaxed) - mxProbForGA1[ci][cj].load(std::memory_order::memory_order_relaxed)) < 0.0001);
 
 
 							// Indirect Impacts per pair of nodes (for all three notions)
 
 							// Indirect impact for sender anonymity is: Impact_indirect^(10)(00) + Impact_Rec2
-							deltaIndirectPairsSA1[i][j] = impactIndirectB1A1[i][j].load(std::memory_order::memory_order_relaxed) + impactIndirectRec2A1B1[i][j].load(std::memory_order::memory_order_relaxed);
-							deltaIndirectPairsSA2[i][j] = impactIndirectA1B1[i][j].load(std::memory_order::memory_order_relaxed) + impactIndirectRec2B1A1[i][j].load(std::memory_order::memory_order_relaxed);
+							deltaIndirectPairsSA1[i][j] = impactIndirectB1A1[ci][cj].load(std::memory_order::memory_order_relaxed) + impactIndirectRec2A1B1[ci][cj].load(std::memory_order::memory_order_relaxed);
+							deltaIndirectPairsSA2[i][j] = impactIndirectA1B1[ci][cj].load(std::memory_order::memory_order_relaxed) + impactIndirectRec2B1A1[ci][cj].load(std::memory_order::memory_order_relaxed);
 
 							// Indirect impact for recipient anonymity is: Impact_indirect^(01)(00) + Impact_Sen2
-							deltaIndirectPairsRA1[i][j] = impactIndirectA2A1[i][j].load(std::memory_order::memory_order_relaxed) + impactIndirectSen2A1A2[i][j].load(std::memory_order::memory_order_relaxed);
-							deltaIndirectPairsRA2[i][j] = impactIndirectA1A2[i][j].load(std::memory_order::memory_order_relaxed) + impactIndirectSen2A2A1[i][j].load(std::memory_order::memory_order_relaxed);
+							deltaIndirectPairsRA1[i][j] = impactIndirectA2A1[ci][cj].load(std::memory_order::memory_order_relaxed) + impactIndirectSen2A1A2[ci][cj].load(std::memory_order::memory_order_relaxed);
+							deltaIndirectPairsRA2[i][j] = impactIndirectA1A2[ci][cj].load(std::memory_order::memory_order_relaxed) + impactIndirectSen2A2A1[ci][cj].load(std::memory_order::memory_order_relaxed);
 
 							// Indirect impact for relationship anonymity is: 1/2 * (Impact_indirect^(01)(00) + Impact_indirect^(10)(11) + Impact_indirect^(01)(11) + Impact_indirect^(10)(00))
-							deltaIndirectPairsREL1[i][j] = (impactIndirectA2A1[i][j].load(std::memory_order::memory_order_relaxed) + impactIndirectB1B2[i][j].load(std::memory_order::memory_order_relaxed)
-														+   impactIndirectA2B2[i][j].load(std::memory_order::memory_order_relaxed) + impactIndirectB1A1[i][j].load(std::memory_order::memory_order_relaxed)) /2;
-							deltaIndirectPairsREL2[i][j] = (impactIndirectA1A2[i][j].load(std::memory_order::memory_order_relaxed) + impactIndirectB2B1[i][j].load(std::memory_order::memory_order_relaxed)
-														+   impactIndirectB2A2[i][j].load(std::memory_order::memory_order_relaxed) + impactIndirectA1B1[i][j].load(std::memory_order::memory_order_relaxed)) /2;
+							deltaIndirectPairsREL1[i][j] = (impactIndirectA2A1[ci][cj].load(std::memory_order::memory_order_relaxed) + impactIndirectB1B2[ci][cj].load(std::memory_order::memory_order_relaxed)
+														+   impactIndirectA2B2[ci][cj].load(std::memory_order::memory_order_relaxed) + impactIndirectB1A1[ci][cj].load(std::memory_order::memory_order_relaxed)) /2;
+							deltaIndirectPairsREL2[i][j] = (impactIndirectA1A2[ci][cj].load(std::memory_order::memory_order_relaxed) + impactIndirectB2B1[ci][cj].load(std::memory_order::memory_order_relaxed)
+														+   impactIndirectB2A2[ci][cj].load(std::memory_order::memory_order_relaxed) + impactIndirectA1B1[ci][cj].load(std::memory_order::memory_order_relaxed)) /2;
 							deltaPairs1[i][j] += deltaIndirectPairsREL1[i][j];
 							deltaPairs2[i][j] += deltaIndirectPairsREL2[i][j];
 						}
@@ -50,12 +50,15 @@ class GenericWorstCaseAnonymity
 		/**
 		 * Constructor computes adversary's advantages in distinguishing scenarios
 		 * based on variety of observations.
+		 * Relays interchangeable in all path selections (see PathSelection::relayGroups()) are grouped to classes,
+		 * circuits are then enumerated over classes rather than relays.
 		 * @param consensus consensus describing Tor network state.
 		 * @param psA1 path selection for sender A and recipient 1 pair
 		 * @param psA2 path selection for sender A and recipient 2 pair
 		 * @param psB1 path selection for sender B and recipient 1 pair
 		 * @param psB2 path selection for sender B and recipient 2 pair
 		 * @param epsilon multiplicative factor
+		 * @param groupRelays whether relays should be grouped (otherwise circuits are enumerated relay by relay).
 		 */
 		GenericWorstCaseAnonymity(
 			const Consensus& consensus,
@@ -63,7 +66,8 @@ class GenericWorstCaseAnonymity
 			const PathSelection& psA2,
 			const PathSelection& psB1,
 			const PathSelection& psB2,
-			double epsilon = 1);
+			double epsilon = 1,
+			bool groupRelays = true);
 		
 		// functions
 		/**
@@ -0,0 +1,145 @@
+#include "latency_matrix.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+const uint32_t LatencyMatrix::NOT_FOUND;
+
+namespace
+{
+	const char MAGIC[8] = { 'M', 'A', 'T', 'O', 'R', 'R', 'T', 'T' }; /**< Binary matrix file signature. */
+	const uint32_t VERSION = 1; /**< Binary matrix format version. */
+	const size_t FINGERPRINT_LENGTH = sizeof(FingerprintIndex::digest_t); /**< Length of a stored fingerprint. */
+	const size_t HEADER_SIZE = sizeof(MAGIC) + 4 * sizeof(uint32_t);
+
+	/**
+	 * @return offset rounded up to a multiple of 8 (alignment of the values).
+	 */
+	inline size_t align8(size_t offset)
+	{
+		return (offset + 7) & ~(size_t)7;
+	}
+}
+
+bool LatencyMatrix::load(const std::string& fileName, const FingerprintIndex& fingerprints)
+{
+	mapping.close();
+	translation.assign(fingerprints.size(), NOT_FOUND);
+	relaysCount = 0;
+	values = nullptr;
+	maxKnown = 0;
+
+	MappedFile file;
+	if(!file.open(fileName) || file.size() < HEADER_SIZE || memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0)
+		return false;
+
+	const char* data = file.data();
+	uint32_t header[4];
+	memcpy(header, data + sizeof(MAGIC), sizeof(header));
+	uint32_t version = header[0], count = header[1], size = header[2];
+	if(version != VERSION || (size != FLOAT16 && size != FLOAT32))
+		return false;
+
+	uint64_t cells = (uint64_t)count * (count - (count > 0)) / 2;
+	const char* storedFingerprints = data + HEADER_SIZE;
+	const char* storedValues = data + align8(HEADER_SIZE + (size_t)count * FINGERPRINT_LENGTH);
+	if(file.size() != (size_t)(storedValues - data) + cells * size)
+		return false;
+
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		FingerprintIndex::digest_t digest;
+		memcpy(digest.data(), storedFingerprints + (size_t)i * FINGERPRINT_LENGTH, FINGERPRINT_LENGTH);
+		size_t position = fingerprints.find(digest);
+		if(position != FingerprintIndex::NOT_FOUND)
+			translation[position] = i;
+	}
+
+	file.adviseRandom();
+	mapping = std::move(file);
+	relaysCount = count;
+	valueSize = size;
+	values = storedValues;
+
+	// unknown values give the maximum found so far
+	for(uint64_t cell = 0; cell < cells; ++cell)
+		maxKnown = std::max(maxKnown, value(cell));
+	return true;
+}
+
+bool LatencyMatrix::save(const std::string& fileName, const std::vector<std::string>& fingerprints,
+	const std::vector<float>& rtts, Precision precision)
+{
+	uint32_t count = (uint32_t)fingerprints.size();
+	if(rtts.size() != (size_t)count * (count - (count > 0)) / 2)
+		return false;
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if(!file.is_open())
+		return false;
+
+	uint32_t header[4] = { VERSION, count, (uint32_t)precision, 0 };
+	file.write(MAGIC, sizeof(MAGIC));
+	file.write((const char*)header, sizeof(header));
+	for(const std::string& fingerprint : fingerprints)
+	{
+		FingerprintIndex::digest_t digest;
+		if(!FingerprintIndex::parse(fingerprint, digest))
+			return false;
+		file.write((const char*)digest.data(), FINGERPRINT_LENGTH);
+	}
+	const char padding[8] = { 0 };
+	size_t written = HEADER_SIZE + (size_t)count * FINGERPRINT_LENGTH;
+	file.write(padding, align8(written) - written);
+	if(precision == FLOAT16)
+	{
+		std::vector<uint16_t> halves(rtts.size());
+		for(size_t i = 0; i < rtts.size(); ++i)
+			halves[i] = floatToHalf(rtts[i]);
+		file.write((const char*)halves.data(), halves.size() * sizeof(uint16_t));
+	}
+	else
+		file.write((const char*)rtts.data(), rtts.size() * sizeof(float));
+	return file.good();
+}
+
+float LatencyMatrix::halfToFloat(uint16_t value)
+{
+	int exponent = (value >> 10) & 0x1f;
+	int mantissa = value & 0x3ff;
+	float result;
+	if(exponent == 0)
+		result = std::ldexp((float)mantissa, -24); // zero or subnormal
+	else if(exponent == 0x1f)
+		result = mantissa ? std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::infinity();
+	else
+		result = std::ldexp((float)(mantissa | 0x400), exponent - 25);
+	return (value & 0x8000) ? -result : result;
+}
+
+uint16_t LatencyMatrix::floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = (bits >> 16) & 0x8000;
+	if((bits & 0x7fffffff) > 0x7f800000)
+		return 0x7e00; // NaN
+	float magnitude = std::fabs(value);
+	if(magnitude < std::ldexp(1.0f, -14))
+		return sign | (uint16_t)std::lround(std::ldexp(magnitude, 24)); // subnormal (rounds up to the smallest normal value)
+
+	int exponent;
+	float fraction = std::frexp(magnitude, &exponent); // magnitude = fraction * 2^exponent, fraction in [0.5, 1)
+	long mantissa = std::lround(std::ldexp(fraction, 11)) - 0x400;
+	int field = exponent + 14;
+	if(mantissa == 0x400)
+	{
+		mantissa = 0;
+		++field;
+	}
+	if(field >= 0x1f)
+		return sign | 0x7c00; // infinity
+	return sign | (uint16_t)(field << 10) | (uint16_t)mantissa;
+}
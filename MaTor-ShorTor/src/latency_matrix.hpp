@@ -0,0 +1,138 @@
+#ifndef LATENCY_MATRIX_HPP
+#define LATENCY_MATRIX_HPP
+
+/** @file */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <cstring>
+
+#include "fingerprint_index.hpp"
+#include "types/mapped_file.hpp"
+
+/**
+ * Round trip times between pairs of relays (in milliseconds), as measured by [ShorTor] latency measurements.
+ * The matrix is memory-mapped from a binary file and is never copied, processes loading the same file
+ * share a single copy of it in the page cache. Relays are identified by their position in consensus,
+ * they are translated to the relays of the file by fingerprints.
+ *
+ * Format (native byte order): magic "MATORRTT", uint32 version, uint32 relays count n, uint32 bytes per value (2 or 4),
+ * uint32 reserved (0), n fingerprints (20-byte digests), padding to 8 bytes and the strict upper triangle
+ * of the symmetric matrix by rows ([0][1], [0][2], ..., [0][n-1], [1][2], ...) as float16 or float32 values.
+ * Unknown round trip times are stored as NaN (infinite values are unknown as well).
+ * Unknown values are recognized by their bits, as floating point comparisons of NaN are not reliable with -ffast-math.
+ */
+class LatencyMatrix
+{
+	public:
+		/**
+		 * Precision of stored values.
+		 */
+		enum Precision
+		{
+			FLOAT16 = 2, /**< IEEE 754 half precision (2 bytes per value). */
+			FLOAT32 = 4 /**< IEEE 754 single precision (4 bytes per value). */
+		};
+
+		// constructors
+		/**
+		 * Creates empty matrix (all round trip times are unknown and 0).
+		 */
+		LatencyMatrix() : relaysCount(0), valueSize(0), values(nullptr), maxKnown(0) { }
+
+		LatencyMatrix(const LatencyMatrix&) = delete;
+		LatencyMatrix& operator=(const LatencyMatrix&) = delete;
+
+		// functions
+		/**
+		 * Maps the binary file, releasing the previous one (if any).
+		 * Relays of the file unknown to the consensus are ignored, consensus relays missing in the file have unknown round trip times.
+		 * @param fileName name of the binary file.
+		 * @param fingerprints fingerprints of consensus relays.
+		 * @return false if the file does not exist or is not a valid latency matrix.
+		 */
+		bool load(const std::string& fileName, const FingerprintIndex& fingerprints);
+
+		/**
+		 * @return true iff a file is loaded.
+		 */
+		bool loaded() const { return mapping.is_open(); }
+
+		/**
+		 * @param first position of a relay in consensus.
+		 * @param second position of another relay in consensus.
+		 * @return round trip time between the relays, maxRtt() if it is unknown (also for a relay and itself).
+		 */
+		float rtt(size_t first, size_t second) const
+		{
+			uint32_t i = translation[first], j = translation[second];
+			if(i == NOT_FOUND || j == NOT_FOUND || i == j)
+				return maxKnown;
+			if(i > j)
+				std::swap(i, j);
+			return value((uint64_t)i * (2 * (uint64_t)relaysCount - i - 1) / 2 + (j - i - 1));
+		}
+
+		/**
+		 * @return the greatest known round trip time of the file (0 if none is known).
+		 */
+		float maxRtt() const { return maxKnown; }
+
+		/**
+		 * @return number of relays stored in the file.
+		 */
+		size_t storedRelays() const { return relaysCount; }
+
+		/**
+		 * Saves a matrix in binary format.
+		 * @param fileName name of the output file.
+		 * @param fingerprints hexadecimal fingerprints of the relays of the matrix.
+		 * @param rtts strict upper triangle of the matrix by rows (n * (n - 1) / 2 values, NaN for unknown values).
+		 * @param precision precision of stored values.
+		 * @return true iff the file was written successfully.
+		 */
+		static bool save(const std::string& fileName, const std::vector<std::string>& fingerprints,
+			const std::vector<float>& rtts, Precision precision = FLOAT16);
+
+		/**
+		 * @param value IEEE 754 half precision value.
+		 * @return the value converted to float.
+		 */
+		static float halfToFloat(uint16_t value);
+
+		/**
+		 * @param value float value.
+		 * @return the value rounded to IEEE 754 half precision.
+		 */
+		static uint16_t floatToHalf(float value);
+
+	private:
+		/**
+		 * @param cell index of a value in the upper triangle.
+		 * @return the value, maxRtt() if it is unknown.
+		 */
+		float value(uint64_t cell) const
+		{
+			if(valueSize == FLOAT16)
+			{
+				uint16_t half = ((const uint16_t*)values)[cell];
+				return (half & 0x7c00) == 0x7c00 ? maxKnown : halfToFloat(half);
+			}
+			uint32_t bits;
+			memcpy(&bits, values + cell * sizeof(float), sizeof(bits));
+			return (bits & 0x7f800000) == 0x7f800000 ? maxKnown : ((const float*)values)[cell];
+		}
+
+		static const uint32_t NOT_FOUND = std::numeric_limits<uint32_t>::max(); /**< Translation of consensus relays missing in the file. */
+
+		uint32_t relaysCount; /**< Number of relays of the file. */
+		uint32_t valueSize; /**< Bytes per value. */
+		const char* values; /**< Upper triangle in the mapped file. */
+		float maxKnown; /**< Greatest known round trip time. */
+		std::vector<uint32_t> translation; /**< Position in the file of every consensus relay. */
+		MappedFile mapping; /**< Mapped file. */
+};
+
+#endif
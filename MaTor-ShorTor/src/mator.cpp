@@ -1,13 +1,17 @@
 #include <iostream>
 #include <fstream>
+#include <unordered_map>
+#include <algorithm>
 #include <boost/foreach.hpp>
 
 #include "mator.hpp"
 #include "utils.hpp"
 #include "consensus.hpp"
+#include "consensus_cache.hpp"
 #include "asmap.hpp"
 #include "pcf.hpp"
 #include "types/const_vector.hpp"
+#include "types/work_manager.hpp"
 
 using namespace std;
 
@@ -25,7 +29,11 @@ MATor::MATor(
 	pathSelectionSpec1(pathSelectionSpec1), pathSelectionSpec2(pathSelectionSpec2)
 {
 	epsilon = config.epsilon;
-	consensus = make_shared<Consensus>(config.consensusFile, config.databaseFile, config.viaAllPairsFile, config.useVias);
+	snapshotDirectory = config.snapshotDirectory;
+	fast = config.fast;
+	sampleSettings.targetError = config.sampleError;
+	sampleSettings.seed = config.sampleSeed;
+	consensus = ConsensusCache::instance().get(config.consensusFile, config.databaseFile, config.viaAllPairsFile, config.useVias);
 	clogsn("Recipientspecs: #ports for R1: " << recipientSpec1->ports.size() << ", R2: " << recipientSpec2->ports.size());
 	clogsn(recipientSpec1->address.address);
 }
@@ -41,7 +49,7 @@ MATor::MATor(
 	: senderSpec1(senderSpec1), senderSpec2(senderSpec2),
 	recipientSpec1(recipientSpec1), recipientSpec2(recipientSpec2),
 	pathSelectionSpec1(pathSelectionSpec1), pathSelectionSpec2(pathSelectionSpec2),
-	consensus(consensus) {
+	consensus(consensus), fast(fast) {
 	clogsn("Recipientspecs: #ports for R1: " << recipientSpec1->ports.size() << ", R2: " << recipientSpec2->ports.size());
 	clogsn("R0 addr: " << recipientSpec1->address.address << ", R1 addr: " << recipientSpec2->address.address);
 }
@@ -93,11 +101,33 @@ void MATor::preparePreciseCalculation(
 	}
 
 	std::cout << "Preparing precise calculation..." << std::endl;
-	gpra = unique_ptr<GenericPreciseAnonymity>(new GenericPreciseAnonymity(*consensus, *pathSelectionA1, *pathSelectionA2, *pathSelectionB1, *pathSelectionB2,
-			observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2, epsilon));
+	computePreciseAnonymity(observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2);
 	std::cout << "done preparing precise calculation." << std::endl;
 }
 
+void MATor::computePreciseAnonymity(
+	const_vector<const_vector<bool>>& observedNodes,
+	const_vector<bool>& observedSenderA,
+	const_vector<bool>& observedSenderB,
+	const_vector<bool>& observedRecipient1,
+	const_vector<bool>& observedRecipient2) {
+	if (!fast) {
+		preciseEstimate = nullptr;
+		gpra = unique_ptr<GenericPreciseAnonymity>(new GenericPreciseAnonymity(*consensus, *pathSelectionA1, *pathSelectionA2, *pathSelectionB1, *pathSelectionB2,
+				observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2, epsilon));
+		return;
+	}
+	// alias tables depend only on path selections, adversaries are sampled with the same ones
+	if (sampler == nullptr)
+		sampler = unique_ptr<CircuitSampler>(new CircuitSampler(*consensus, *pathSelectionA1, *pathSelectionA2, *pathSelectionB1, *pathSelectionB2, sampleSettings.threads));
+	gpra = nullptr;
+	preciseEstimate = unique_ptr<CircuitSampler::Estimate>(new CircuitSampler::Estimate(
+		sampler->estimate(observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2, sampleSettings)));
+	clogsn("Estimated from " << preciseEstimate->samples << " circuits: SA " << preciseEstimate->sender.delta << " +- " << preciseEstimate->sender.halfWidth <<
+		", RA " << preciseEstimate->recipient.delta << " +- " << preciseEstimate->recipient.halfWidth <<
+		", REL " << preciseEstimate->relationship.delta << " +- " << preciseEstimate->relationship.halfWidth);
+}
+
 bool vector_in_set(std::vector<std::string>& myvec, std::set<std::string>& myset)
 {
 	//myassert(myvec.size()==3 && myvec[0]=="AS0" && myvec[1]=="AS1" && myvec[2]=="AS2");
@@ -119,6 +149,13 @@ void MATor::prepareNetworkCalculation(std::vector<std::string> compromisedASes)
 
 	debugfile << "done." << std::endl;
 
+	// path selections taking Autonomous Systems into account are recomputed with routes from the map
+	if (Scenario::isASAware(pathSelectionSpec1->getType()))
+		computeFlags |= 3; // | 0b0011
+	if (Scenario::isASAware(pathSelectionSpec2->getType()))
+		computeFlags |= 12; // | 0b1100
+	commitSpecification();
+
 
 	if(!asmap->endpoint_exists((std::string)senderSpec1->address))
 		debugfile << "Missing entry for Sender 1" << std::endl;
@@ -167,8 +204,7 @@ void MATor::prepareNetworkCalculation(std::vector<std::string> compromisedASes)
 			observedRecipient2[i] = true;
 
 	}
-	gpra = unique_ptr<GenericPreciseAnonymity>(new GenericPreciseAnonymity(*consensus, *pathSelectionA1, *pathSelectionA2, *pathSelectionB1, *pathSelectionB2,
-			observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2, epsilon));
+	computePreciseAnonymity(observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2);
 
 
 }
@@ -207,6 +243,8 @@ void MATor::getGreedyListForRelationshipAnonymity(std::vector<size_t>& output) {
 
 
 double MATor::getPreciseSenderAnonymity() {
+	if (preciseEstimate != nullptr)
+		return preciseEstimate->sender.delta;
 	if (gpra == nullptr) {
 		clogsn("You have to first call 'preparePreciseCalculation' with a description of a (fixed) adversary");
 		return -1;
@@ -215,6 +253,8 @@ double MATor::getPreciseSenderAnonymity() {
 }
 
 double MATor::getPreciseRecipientAnonymity() {
+	if (preciseEstimate != nullptr)
+		return preciseEstimate->recipient.delta;
 	if (gpra == nullptr) {
 		clogsn("You have to first call 'preparePreciseCalculation' with a description of a (fixed) adversary");
 		return -1;
@@ -223,6 +263,8 @@ double MATor::getPreciseRecipientAnonymity() {
 }
 
 double MATor::getPreciseRelationshipAnonymity() {
+	if (preciseEstimate != nullptr)
+		return preciseEstimate->relationship.delta;
 	if (gpra == nullptr) {
 		clogsn("You have to first call 'preparePreciseCalculation' with a description of a (fixed) adversary");
 		return -1;
@@ -230,28 +272,42 @@ double MATor::getPreciseRelationshipAnonymity() {
 	return gpra->relationshipAnonymity();
 }
 
+bool MATor::getPreciseEstimate(CircuitSampler::Estimate& output) const {
+	if (preciseEstimate == nullptr)
+		return false;
+	output = *preciseEstimate;
+	return true;
+}
+
+std::shared_ptr<const PathSelection> MATor::getPathSelection(bool senderB, bool recipient2) {
+	commitSpecification();
+	if (senderB)
+		return recipient2 ? pathSelectionB2 : pathSelectionB1;
+	return recipient2 ? pathSelectionA2 : pathSelectionA1;
+}
+
 double MATor::getNetworkSenderAnonymity() {
-	if (gpra == nullptr || asmap == nullptr) {
+	if ((gpra == nullptr && preciseEstimate == nullptr) || asmap == nullptr) {
 		clogsn("You have to first call 'prepareNetworkCalculation' with a description of a (fixed) network adversary");
 		return -1;
 	}
-	return gpra->senderAnonymity();
+	return getPreciseSenderAnonymity();
 }
 
 double MATor::getNetworkRecipientAnonymity() {
-	if (gpra == nullptr || asmap == nullptr) {
+	if ((gpra == nullptr && preciseEstimate == nullptr) || asmap == nullptr) {
 		clogsn("You have to first call 'prepareNetworkCalculation' with a description of a (fixed) network adversary");
 		return -1;
 	}
-	return gpra->recipientAnonymity();
+	return getPreciseRecipientAnonymity();
 }
 
 double MATor::getNetworkRelationshipAnonymity() {
-	if (gpra == nullptr || asmap == nullptr) {
+	if ((gpra == nullptr && preciseEstimate == nullptr) || asmap == nullptr) {
 		clogsn("You have to first call 'prepareNetworkCalculation' with a description of a (fixed) network adversary");
 		return -1;
 	}
-	return gpra->relationshipAnonymity();
+	return getPreciseRelationshipAnonymity();
 }
 
 
@@ -260,7 +316,7 @@ double MATor::lowerBoundSenderAnonymity() {
 	std::vector<size_t> greedylist;
 	getGreedyListForSenderAnonymity(greedylist);
 	preparePreciseCalculation(greedylist);
-	return gpra->senderAnonymity();
+	return getPreciseSenderAnonymity();
 }
 
 double MATor::lowerBoundRecipientAnonymity() {
@@ -268,7 +324,7 @@ double MATor::lowerBoundRecipientAnonymity() {
 	std::vector<size_t> greedylist;
 	getGreedyListForRecipientAnonymity(greedylist);
 	preparePreciseCalculation(greedylist);
-	return gpra->recipientAnonymity();
+	return getPreciseRecipientAnonymity();
 }
 
 double MATor::lowerBoundRelationshipAnonymity() {
@@ -276,7 +332,7 @@ double MATor::lowerBoundRelationshipAnonymity() {
 	std::vector<size_t> greedylist;
 	getGreedyListForRelationshipAnonymity(greedylist);
 	preparePreciseCalculation(greedylist);
-	return gpra->relationshipAnonymity();
+	return getPreciseRelationshipAnonymity();
 }
 
 
@@ -311,22 +367,50 @@ void MATor::setAdversaryBudget(double budget) {
 
 void MATor::commitSpecification() {
 	if (!computeFlags) return;
-	if (computeFlags & 1) {
-		// Path selection computed from specification for sender A, path selection 1 and recipient 1
-		pathSelectionA1 = Scenario::makePathSelection(pathSelectionSpec1, senderSpec1, recipientSpec1, *consensus);
-	}
-	if (computeFlags & 2) {
-		// Path selection computed from specification for sender A, path selection 1 and recipient 2
-		pathSelectionA2 = Scenario::makePathSelection(pathSelectionSpec1, senderSpec1, recipientSpec2, *consensus);
-	}
-	if (computeFlags & 4) {
-		// Path selection computed from specification for sender B, path selection 2 and recipient 1
-		pathSelectionB1 = Scenario::makePathSelection(pathSelectionSpec2, senderSpec2, recipientSpec1, *consensus);
-	}
-	if (computeFlags & 8) {
-		// Path selection computed from specification for sender B, path selection 2 and recipient 2
-		pathSelectionB2 = Scenario::makePathSelection(pathSelectionSpec2, senderSpec2, recipientSpec2, *consensus);
+	// path selections A1, A2, B1, B2 (in order of bits of computeFlags)
+	std::shared_ptr<PathSelection>* pathSelections[4] = { &pathSelectionA1, &pathSelectionA2, &pathSelectionB1, &pathSelectionB2 };
+	std::shared_ptr<PathSelectionSpec> pathSelectionSpecs[4] = { pathSelectionSpec1, pathSelectionSpec1, pathSelectionSpec2, pathSelectionSpec2 };
+	std::shared_ptr<SenderSpec> senderSpecs[4] = { senderSpec1, senderSpec1, senderSpec2, senderSpec2 };
+	std::shared_ptr<RecipientSpec> recipientSpecs[4] = { recipientSpec1, recipientSpec2, recipientSpec1, recipientSpec2 };
+
+	// path selections of identical scenarios are computed once
+	std::unordered_map<std::string, size_t> scenarios;
+	std::vector<size_t> computed; // path selections to be computed
+	std::vector<std::shared_ptr<RelationshipManager>> relations(4);
+	size_t sameAs[4]; // path selection computed for the same scenario
+	std::shared_ptr<RelationshipManager> subnetRelations; // relations of path selections unaware of ASes depend only on consensus
+	for (size_t i = 0; i < 4; ++i) {
+		if (!(computeFlags & (1 << i)))
+			continue;
+		auto scenario = scenarios.emplace(Scenario::getKey(pathSelectionSpecs[i], senderSpecs[i], recipientSpecs[i]), i);
+		sameAs[i] = scenario.first->second;
+		if (!scenario.second)
+			continue;
+		computed.push_back(i);
+
+		bool asAware = Scenario::isASAware(pathSelectionSpecs[i]->getType());
+		if (!asAware && subnetRelations != nullptr)
+			relations[i] = subnetRelations;
+		else
+			relations[i] = Scenario::makeRelations(pathSelectionSpecs[i], senderSpecs[i], recipientSpecs[i], *consensus, asmap);
+		if (!asAware)
+			subnetRelations = relations[i];
 	}
+
+	// remaining path selections are independent, they split hardware threads among their own work managers
+	std::vector<std::shared_ptr<PathSelection>> results(computed.size());
+	unsigned budget = WorkManager().getHardwareConcurrency() / std::max<size_t>(computed.size(), 1);
+	WorkManager::runAll(computed.size(), computed.size(), [&](size_t c) {
+		WorkManager::Budget threads(budget);
+		size_t i = computed[c];
+		results[c] = Scenario::makeFromRelations(pathSelectionSpecs[i], senderSpecs[i], recipientSpecs[i], *consensus, relations[i], snapshotDirectory);
+	});
+	for (size_t c = 0; c < computed.size(); ++c)
+		*pathSelections[computed[c]] = results[c];
+	for (size_t i = 0; i < 4; ++i)
+		if ((computeFlags & (1 << i)) && sameAs[i] != i)
+			*pathSelections[i] = *pathSelections[sameAs[i]];
 	gwca = nullptr;
+	sampler = nullptr;
 	computeFlags = 0;
 }
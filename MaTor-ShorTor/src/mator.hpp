@@ -15,6 +15,7 @@
 #include "scenario.hpp"
 #include "generic_worst_case_anonymity.hpp"
 #include "generic_precise_anonymity.hpp"
+#include "circuit_sampler.hpp"
 
 
 class ASMap;
@@ -90,6 +91,7 @@ class MATor : public std::enable_shared_from_this<MATor>
 		 * @param pathSelectionSpec1 specification of path selection used by sender A.
 		 * @param pathSelectionSpec2 specification of path selection used by sender B.
 		 * @param config other configuration container.
+		 * The consensus is obtained from the process-wide ConsensusCache (shared with other instances using the same files).
 		 */
 		MATor(
 			std::shared_ptr<SenderSpec> senderSpec1,
@@ -206,7 +208,6 @@ class MATor : public std::enable_shared_from_this<MATor>
 			this->consensus = consensus;
 		}
 
-
 		void addMicrodesc(std::string& microdesc) {
 			computeFlags |= 15;
 			NOT_IMPLEMENTED;
@@ -278,6 +279,23 @@ class MATor : public std::enable_shared_from_this<MATor>
 		*/
 		double getPreciseRelationshipAnonymity();
 
+		/**
+		* Provides precise anonymity guarantees estimated in fast mode with their confidence intervals.
+		* @param output the estimate is stored in this parameter.
+		* @return true iff the guarantees were estimated (fast mode), false if they were computed exactly or not at all.
+		* @see CircuitSampler::estimate()
+		*/
+		bool getPreciseEstimate(CircuitSampler::Estimate& output) const;
+
+		/**
+		* Computes path selections if the specification has changed since the last commit.
+		* Senders and recipients with identical scenarios share a single path selection.
+		* @param senderB false for sender A, true for sender B.
+		* @param recipient2 false for recipient 1, true for recipient 2.
+		* @return path selection of the sender connecting to the recipient.
+		*/
+		std::shared_ptr<const PathSelection> getPathSelection(bool senderB, bool recipient2);
+
 		/**
 		* Computes precise anonymity guarantees for a greedily choosing adversary for sender anonymity.
 		* If generic adversary advantage hasn't been computed for current specifications yet, it gets calculated.
@@ -359,17 +377,36 @@ class MATor : public std::enable_shared_from_this<MATor>
 
 
 	private:
+		// functions
+		/**
+		 * Computes precise anonymity guarantees for the adversary's observations,
+		 * in fast mode estimates them by sampling circuits.
+		 * @see GenericPreciseAnonymity
+		 * @see CircuitSampler
+		 */
+		void computePreciseAnonymity(
+			const_vector<const_vector<bool>>& observedNodes,
+			const_vector<bool>& observedSenderA,
+			const_vector<bool>& observedSenderB,
+			const_vector<bool>& observedRecipient1,
+			const_vector<bool>& observedRecipient2);
+
 		// variables
 		int computeFlags = 15; /**< Set of flags (x|...|x|PSB2|PSB1|PSA2|PSA1) indicating whether any of Path Selection instances should be recomputed. */
 		std::shared_ptr<PathSelection> pathSelectionA1; /**< Path selection computed from specification for sender A, path selection 1 and recipient 1. */
 		std::shared_ptr<PathSelection> pathSelectionA2; /**< Path selection computed from specification for sender A, path selection 1 and recipient 2. */
 		std::shared_ptr<PathSelection> pathSelectionB1; /**< Path selection computed from specification for sender B, path selection 2 and recipient 1. */
 		std::shared_ptr<PathSelection> pathSelectionB2; /**< Path selection computed from specification for sender B, path selection 2 and recipient 2. */
-		std::shared_ptr<Consensus> consensus; /**< Consensus describing current state of Tor network. */
+		std::shared_ptr<const Consensus> consensus; /**< Consensus describing current state of Tor network (possibly shared with other instances). */
 		Adversary adversary; /**< Adversary instance. */
 		std::unique_ptr<GenericWorstCaseAnonymity> gwca; /** Class for computing generic worst case anonymities. Since it may be uninitialized, pointer is used. */
 		std::unique_ptr<GenericPreciseAnonymity> gpra; /** Class for computing generic precise anonymities. Since it may be uninitialized, pointer is used. */
+		std::unique_ptr<CircuitSampler> sampler; /** Class for estimating precise anonymities in fast mode, built once for current path selections. */
+		std::unique_ptr<CircuitSampler::Estimate> preciseEstimate; /** Precise anonymities estimated in fast mode. */
+		bool fast = false; /**< Indicates whether precise anonymities are estimated. @see Config::fast */
+		CircuitSampler::Settings sampleSettings; /**< Parameters of estimating precise anonymities in fast mode. */
 		double epsilon = 1; /** Multiplicative factor used in computations. */
+		std::string snapshotDirectory; /**< Directory for snapshots of computed path selections (empty if not used). @see Config::snapshotDirectory */
 
 		std::shared_ptr<ASMap> asmap; /**< Consensus describing current state of Tor network. */
 		std::shared_ptr<SenderSpec> senderSpec1; /** Specification of sender A. */
@@ -0,0 +1,46 @@
+#include "path_selection.hpp"
+#include "types/work_manager.hpp"
+
+#include <algorithm>
+
+void PathSelection::probabilityBounds(probability_t* entryBounds, probability_t* middleBounds, unsigned threads) const
+{
+	size_t size = consensus.getSize();
+	std::vector<probability_t> exitProbs(size);
+	exitProbRow(exitProbs.data());
+
+	// maxima over blocks of exits, merged afterwards
+	size_t blocks = std::min<size_t>(size, 64);
+	std::vector<std::vector<probability_t>> entryMaxima(blocks), middleMaxima(blocks);
+	WorkManager::runAll(threads, blocks, [&](size_t b) {
+		std::vector<probability_t>& entryMax = entryMaxima[b];
+		std::vector<probability_t>& middleMax = middleMaxima[b];
+		entryMax.assign(size, 0);
+		middleMax.assign(size, 0);
+		std::vector<probability_t> entryRow(size), middleRow(size);
+		for(size_t exit = b * size / blocks; exit < (b + 1) * size / blocks; ++exit)
+		{
+			if(!(exitProbs[exit] > 0))
+				continue;
+			entryProbRow(exit, entryRow.data());
+			for(size_t entry = 0; entry < size; ++entry)
+			{
+				if(entry == exit || !(entryRow[entry] > 0))
+					continue;
+				entryMax[entry] = std::max(entryMax[entry], entryRow[entry]);
+				middleProbRow(entry, exit, middleRow.data());
+				for(size_t middle = 0; middle < size; ++middle)
+					middleMax[middle] = std::max(middleMax[middle], middleRow[middle]);
+			}
+		}
+	});
+
+	std::fill(entryBounds, entryBounds + size, 0);
+	std::fill(middleBounds, middleBounds + size, 0);
+	for(size_t b = 0; b < blocks; ++b)
+		for(size_t i = 0; i < size; ++i)
+		{
+			entryBounds[i] = std::max(entryBounds[i], entryMaxima[b][i]);
+			middleBounds[i] = std::max(middleBounds[i], middleMaxima[b][i]);
+		}
+}
@@ -12,6 +12,7 @@
 #include "consensus.hpp"
 #include "utils.hpp"
 #include "relationship_manager.hpp"
+#include "path_selection_snapshot.hpp"
 
 /**
  * This virtual class allows to obtain probabilities for selecting relays (for exit, entry or middle node)
@@ -87,7 +88,130 @@ class PathSelection
 		 */
 		virtual probability_t middleProb(size_t middle, size_t entry, size_t exit) const = 0;
 		
+		/**
+		 * Computes exit probabilities of all relays at once.
+		 * @param probs array of consensus size, probs[i] is set to exitProb(i).
+		 */
+		virtual void exitProbRow(probability_t* probs) const
+		{
+			size_t size = consensus.getSize();
+			for(size_t i = 0; i < size; ++i)
+				probs[i] = exitProb(i);
+		}
+		
+		/**
+		 * Computes entry probabilities of all relays for a fixed exit at once.
+		 * By default, probabilities are computed relay by relay, derived classes compute the whole row
+		 * from their factors (weights, normalizers and relation bitsets) with plain indexing.
+		 * @param exit index of relay used as an exit node.
+		 * @param probs array of consensus size, probs[i] is set to entryProb(i, exit).
+		 */
+		virtual void entryProbRow(size_t exit, probability_t* probs) const
+		{
+			size_t size = consensus.getSize();
+			for(size_t i = 0; i < size; ++i)
+				probs[i] = entryProb(i, exit);
+		}
+		
+		/**
+		 * Computes middle probabilities of all relays for a fixed entry and exit at once.
+		 * @param entry index of relay used as an entry node.
+		 * @param exit index of relay used as an exit node.
+		 * @param probs array of consensus size, probs[i] is set to middleProb(i, entry, exit).
+		 * @see entryProbRow()
+		 */
+		virtual void middleProbRow(size_t entry, size_t exit, probability_t* probs) const
+		{
+			size_t size = consensus.getSize();
+			for(size_t i = 0; i < size; ++i)
+				probs[i] = middleProb(i, entry, exit);
+		}
+		
+		/**
+		 * Partitions relays into groups of interchangeable relays: replacing any relay of a circuit by another relay
+		 * of the same group changes none of the selection probabilities (exit, entry or middle) of the circuit.
+		 * By default, every relay forms a group of its own.
+		 * @param groups vector resized to consensus size, groups[i] is set to the group of relay i.
+		 * @return number of groups (groups are numbered from 0).
+		 */
+		virtual size_t relayGroups(std::vector<size_t>& groups) const
+		{
+			size_t size = consensus.getSize();
+			groups.resize(size);
+			for(size_t i = 0; i < size; ++i)
+				groups[i] = i;
+			return size;
+		}
+		
+		/**
+		 * Computes upper bounds of entry and middle probabilities of every relay, e.g. for drawing circuits by rejection.
+		 * Bounds have to hold for circuits with possible exits (of positive exit probability) only.
+		 * By default, bounds are maxima over all rows of probabilities (cubic in consensus size),
+		 * derived classes derive them from their factors.
+		 * @param entryBounds array of consensus size, entryBounds[i] >= entryProb(i, exit) for every possible exit.
+		 * @param middleBounds array of consensus size, middleBounds[i] >= middleProb(i, entry, exit) for every possible exit and its possible entries.
+		 * @param threads number of threads to use.
+		 */
+		virtual void probabilityBounds(probability_t* entryBounds, probability_t* middleBounds, unsigned threads) const;
+		
+		/**
+		 * @return definitions of relations between relays used by this path selection.
+		 */
+		std::shared_ptr<RelationshipManager> getRelationshipManager() const
+		{
+			return relations;
+		}
+		
+		/**
+		 * @return consensus the path selection was computed for.
+		 */
+		const Consensus& getConsensus() const
+		{
+			return consensus;
+		}
+		
+		/**
+		 * Writes computed state of the path selection (everything probabilities are computed from) to a snapshot.
+		 * Derived classes append their own state after the state of their parent.
+		 * @param snapshot snapshot to be written.
+		 * @see PathSelectionSnapshot
+		 */
+		virtual void saveState(PathSelectionSnapshot& snapshot) const
+		{
+			snapshot.put(exitPossible);
+			snapshot.put(entryPossible);
+			snapshot.put(middlePossible);
+			snapshot.put(middlePossibleBecauseVia);
+		}
+		
 	protected:
+		// functions
+		/**
+		 * Reads state written by saveState() from a snapshot.
+		 * @param snapshot snapshot to be read.
+		 * @return true iff the snapshot contained state matching the consensus.
+		 */
+		virtual bool loadState(PathSelectionSnapshot& snapshot)
+		{
+			size_t size = consensus.getSize();
+			return snapshot.get(exitPossible) && exitPossible.size() == size &&
+				snapshot.get(entryPossible) && entryPossible.size() == size &&
+				snapshot.get(middlePossible) && middlePossible.size() == size &&
+				snapshot.get(middlePossibleBecauseVia) && (middlePossibleBecauseVia.empty() || middlePossibleBecauseVia.size() == size);
+		}
+		
+		/**
+		 * Restores the path selection from a snapshot (instead of computing it).
+		 * Called by restoring constructors once the parameters of the path selection are set.
+		 * @param snapshot snapshot with the state of the path selection.
+		 * @throws snapshot_exception if the snapshot does not contain exactly the state of the path selection.
+		 */
+		void restoreState(PathSelectionSnapshot& snapshot)
+		{
+			if(!loadState(snapshot) || !snapshot.finished())
+				throw_exception(snapshot_exception, snapshot_exception::INVALID_STATE);
+		}
+		
 		// variables
 		const Consensus &consensus; /**< Consensus describing state of the Tor network. */
 		std::vector<bool> exitPossible; /**< Vector keeps possibilities for a relay to be an exit node on position corresponding to position in consensus. */
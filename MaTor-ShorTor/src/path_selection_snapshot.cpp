@@ -0,0 +1,162 @@
+#include "path_selection_snapshot.hpp"
+#include "consensus.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <functional>
+
+#include <unistd.h>
+
+namespace
+{
+	const char MAGIC[8] = { 'M', 'A', 'T', 'O', 'R', 'P', 'S', 'S' }; /**< Snapshot file signature. */
+	const uint32_t VERSION = 1; /**< Snapshot format version. */
+
+	/**
+	 * Snapshot header, followed by the data.
+	 */
+	struct Header
+	{
+		char magic[8]; /**< File signature. */
+		uint32_t version; /**< Format version. */
+		uint32_t type; /**< Type of the path selection. */
+		uint64_t consensusHash; /**< @copydoc PathSelectionSnapshot::Key::consensusHash */
+		uint64_t scenarioHash; /**< @copydoc PathSelectionSnapshot::Key::scenarioHash */
+		uint64_t bytes; /**< Length of the data. */
+		uint64_t checksum; /**< Hash of the data. */
+	};
+	static_assert(sizeof(Header) == 48, "snapshot header must not be padded");
+
+	/**
+	 * Updates 64-bit FNV-1a hash with bytes.
+	 */
+	inline uint64_t fnv1a(uint64_t hash, const void* data, size_t length)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for(size_t i = 0; i < length; ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	/**
+	 * Updates 64-bit FNV-1a hash with a value.
+	 */
+	template <typename T>
+	inline uint64_t fnv1a(uint64_t hash, const T& value)
+	{
+		return fnv1a(hash, &value, sizeof(T));
+	}
+
+	/**
+	 * Updates 64-bit FNV-1a hash with a string (and its length).
+	 */
+	inline uint64_t fnv1a(uint64_t hash, const std::string& text)
+	{
+		return fnv1a(fnv1a(hash, (uint64_t)text.size()), text.data(), text.size());
+	}
+
+	const uint64_t FNV_OFFSET = 14695981039346656037ull; /**< Initial value of FNV-1a hash. */
+}
+
+PathSelectionSnapshot::Key PathSelectionSnapshot::makeKey(const Consensus& consensus, const std::string& scenarioKey)
+{
+	Key key = { consensus.getContentHash(), fnv1a(FNV_OFFSET, scenarioKey) };
+	return key;
+}
+
+std::string PathSelectionSnapshot::fileName(const std::string& directory, const Key& key)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "ps-%016llx-%016llx.snapshot", (unsigned long long)key.consensusHash, (unsigned long long)key.scenarioHash);
+	if(directory.empty() || directory.back() == '/')
+		return directory + name;
+	return directory + "/" + name;
+}
+
+void PathSelectionSnapshot::put(const std::vector<bool>& values)
+{
+	std::vector<uint8_t> bytes((values.size() + 7) / 8, 0);
+	for(size_t i = 0; i < values.size(); ++i)
+		if(values[i])
+			bytes[i / 8] |= 1 << (i % 8);
+	put((uint64_t)values.size());
+	put(bytes.data(), bytes.size());
+}
+
+bool PathSelectionSnapshot::get(std::vector<bool>& values)
+{
+	uint64_t count;
+	if(!get(count) || (count + 7) / 8 > data.size() - position)
+		return false;
+	std::vector<uint8_t> bytes((count + 7) / 8);
+	get(bytes.data(), bytes.size());
+	values.resize(count);
+	for(size_t i = 0; i < count; ++i)
+		values[i] = (bytes[i / 8] >> (i % 8)) & 1;
+	return true;
+}
+
+bool PathSelectionSnapshot::save(const std::string& fileName, const Key& key, PathSelectionType type) const
+{
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.type = (uint32_t)type;
+	header.consensusHash = key.consensusHash;
+	header.scenarioHash = key.scenarioHash;
+	header.bytes = data.size();
+	header.checksum = fnv1a(FNV_OFFSET, data.data(), data.size());
+
+	// written aside and renamed, processes loading the same path selection never see a partial file
+	// (named by process and thread, so concurrent writers of the same snapshot never share the temporary file)
+	std::string temporary = fileName + "." + std::to_string(getpid()) + "." +
+		std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if(!file.is_open())
+			return false;
+		file.write((const char*)&header, sizeof(header));
+		file.write(data.data(), data.size());
+		file.close();
+		if(!file.good())
+		{
+			std::remove(temporary.c_str());
+			return false;
+		}
+	}
+	if(std::rename(temporary.c_str(), fileName.c_str()) != 0)
+	{
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool PathSelectionSnapshot::load(const std::string& fileName, const Key& key, PathSelectionType type)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if(!file.is_open())
+		return false;
+
+	Header header;
+	if(!file.read((char*)&header, sizeof(header)))
+		return false;
+	Key stored = { header.consensusHash, header.scenarioHash };
+	if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.type != (uint32_t)type || !(stored == key))
+		return false;
+
+	// the data must fill the rest of the file exactly
+	std::streamoff start = file.tellg();
+	file.seekg(0, std::ios::end);
+	if(!file || (uint64_t)(file.tellg() - start) != header.bytes)
+		return false;
+	file.seekg(start);
+
+	std::vector<char> read(header.bytes);
+	if(!file.read(read.data(), read.size()) || fnv1a(FNV_OFFSET, read.data(), read.size()) != header.checksum)
+		return false;
+	data.swap(read);
+	position = 0;
+	return true;
+}
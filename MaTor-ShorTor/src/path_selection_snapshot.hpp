@@ -0,0 +1,229 @@
+#ifndef PATH_SELECTION_SNAPSHOT_HPP
+#define PATH_SELECTION_SNAPSHOT_HPP
+
+/** @file */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "path_selection_spec.hpp"
+#include "types/general_exception.hpp"
+
+class Consensus;
+
+/**
+ * Thrown if a path selection can not be restored from a snapshot.
+ */
+class snapshot_exception : public general_exception
+{
+	public:
+		/**
+		 * Enum of reasons why snapshot exception was thrown.
+		 */
+		enum reason
+		{
+			INVALID_STATE /**< Snapshot does not contain state of the path selection. */
+		};
+
+		/**
+		 * Constructs exception instance.
+		 * @param why reason for exception.
+		 * @param file name of the file file in which exception has occured.
+		 * @param line line at which exception has occured.
+		 */
+		snapshot_exception(reason why, const char* file, int line) : general_exception("", file, line)
+		{
+			reasonWhy = why;
+			switch(why)
+			{
+				case INVALID_STATE:
+					this->message = "snapshot does not match the path selection.";
+					break;
+				default:
+					this->message = "unknown reason.";
+			}
+			commit_message();
+		}
+
+		/**
+		 * @copydoc general_exception::~general_exception()
+		 */
+		virtual ~snapshot_exception() throw () { }
+
+		virtual int why() const { return reasonWhy; }
+
+	protected:
+		reason reasonWhy; /**< Exception reason. */
+
+		virtual const std::string& getTag() const
+		{
+			const static std::string tag = "snapshot_exception";
+			return tag;
+		}
+};
+
+/**
+ * Binary snapshot of computed state of a path selection (possibilities, weights and related-weight structures),
+ * so that identical path selections are not recomputed in every process.
+ * Path selections write their state with put() and read it back in the same order with get().
+ * The snapshot file is keyed by a hash of the consensus (relays with their information) and by a hash of the scenario
+ * (path selection specification, sender and recipient), so it becomes stale when either of them changes.
+ * @see PathSelection::saveState()
+ */
+class PathSelectionSnapshot
+{
+	public:
+		/**
+		 * Identity of path selection stored in the snapshot.
+		 */
+		struct Key
+		{
+			uint64_t consensusHash; /**< Content hash of the consensus (see Consensus::getContentHash()). */
+			uint64_t scenarioHash; /**< Hash of the scenario key. */
+
+			bool operator==(const Key& other) const
+			{
+				return consensusHash == other.consensusHash && scenarioHash == other.scenarioHash;
+			}
+		};
+
+		// functions
+		/**
+		 * Computes key of a path selection.
+		 * @param consensus consensus of the path selection.
+		 * @param scenarioKey key of the scenario (path selection specification, sender and recipient).
+		 * @return key of the snapshot.
+		 * @see Scenario::getKey()
+		 */
+		static Key makeKey(const Consensus& consensus, const std::string& scenarioKey);
+
+		/**
+		 * @param directory directory of snapshots.
+		 * @param key key of the snapshot.
+		 * @return name of the snapshot file in the directory.
+		 */
+		static std::string fileName(const std::string& directory, const Key& key);
+
+		/**
+		 * Appends a value to the snapshot.
+		 * @param value value of trivially copyable type.
+		 */
+		template <typename T>
+		void put(const T& value)
+		{
+			put(&value, 1);
+		}
+
+		/**
+		 * Appends values to the snapshot.
+		 * @param values values of trivially copyable type.
+		 * @param count number of values.
+		 */
+		template <typename T>
+		void put(const T* values, size_t count)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be put into snapshot");
+			const char* bytes = (const char*)values;
+			data.insert(data.end(), bytes, bytes + count * sizeof(T));
+		}
+
+		/**
+		 * Appends vector (with its size) to the snapshot.
+		 * @param values vector of trivially copyable type.
+		 */
+		template <typename T>
+		void put(const std::vector<T>& values)
+		{
+			put((uint64_t)values.size());
+			put(values.data(), values.size());
+		}
+
+		/**
+		 * Appends vector of bools (with its size) to the snapshot, packed into bytes.
+		 * @param values vector of bools.
+		 */
+		void put(const std::vector<bool>& values);
+
+		/**
+		 * Reads a value written by put().
+		 * @param value read value.
+		 * @return true iff the snapshot had enough data.
+		 */
+		template <typename T>
+		bool get(T& value)
+		{
+			return get(&value, 1);
+		}
+
+		/**
+		 * Reads values written by put().
+		 * @param values array for count values.
+		 * @param count number of values.
+		 * @return true iff the snapshot had enough data.
+		 */
+		template <typename T>
+		bool get(T* values, size_t count)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be read from snapshot");
+			if(count > (data.size() - position) / sizeof(T))
+				return false;
+			memcpy(values, data.data() + position, count * sizeof(T));
+			position += count * sizeof(T);
+			return true;
+		}
+
+		/**
+		 * Reads vector written by put().
+		 * @param values read vector.
+		 * @return true iff the snapshot had enough data.
+		 */
+		template <typename T>
+		bool get(std::vector<T>& values)
+		{
+			uint64_t count;
+			if(!get(count) || count > (data.size() - position) / sizeof(T))
+				return false;
+			values.resize(count);
+			return get(values.data(), values.size());
+		}
+
+		/**
+		 * Reads vector of bools written by put().
+		 * @param values read vector.
+		 * @return true iff the snapshot had enough data.
+		 */
+		bool get(std::vector<bool>& values);
+
+		/**
+		 * @return true iff all the data was read.
+		 */
+		bool finished() const { return position == data.size(); }
+
+		/**
+		 * Writes the snapshot (through a temporary file, so concurrent readers never see it half written).
+		 * @param fileName name of the snapshot file.
+		 * @param key key of the path selection.
+		 * @param type type of the path selection.
+		 * @return true iff the snapshot was written.
+		 */
+		bool save(const std::string& fileName, const Key& key, PathSelectionType type) const;
+
+		/**
+		 * Reads the snapshot if it exists, is valid and matches the key and type.
+		 * The data is replaced only if the whole file is valid, reading starts from its beginning.
+		 * @param fileName name of the snapshot file.
+		 * @param key expected key.
+		 * @param type expected type of the path selection.
+		 * @return true iff the snapshot was read.
+		 */
+		bool load(const std::string& fileName, const Key& key, PathSelectionType type);
+
+	private:
+		std::vector<char> data; /**< Written state. */
+		size_t position = 0; /**< Position of the next read. */
+};
+
+#endif
@@ -4,7 +4,10 @@
 /** @file */
 
 #include <set>
+#include <memory>
 #include <string>
+#include <sstream>
+#include <cstdint>
 
 /**
  * @enum PathSelectionType
@@ -21,7 +24,9 @@ enum PathSelectionType
 	PS_AS_DISTRIBUTOR, /**< Autonomous System aware version of DistribuTor path selection algorithm. */
 	PS_AS_LASTOR, /**< Autonomous System aware version of LASTor path selection algorithm. */
 	PS_AS_UNIFORM, /**< Autonomous System aware version of uniform Tor path selection algorithm. */
-	PS_AS_SELEKTOR /**< Autonomous System aware version of SelekTOR. */
+	PS_AS_SELEKTOR, /**< Autonomous System aware version of SelekTOR. */
+	PS_LATENCY, /**< Latency-aware Tor path selection algorithm. */
+	PS_AS_LATENCY /**< Autonomous System aware version of latency-aware Tor path selection algorithm. */
 };
 
 /**
@@ -34,6 +39,12 @@ class PathSelectionSpec// : public std::enable_shared_from_this<PathSelectionSpe
 		 * @return path selection type.
 		 */
 		virtual PathSelectionType getType() { return type; }
+		
+		/**
+		 * @return text describing path selection type and all its parameters
+		 * (specifications are equal iff their keys are equal).
+		 */
+		virtual std::string getKey() { return std::to_string(type); }
 	protected:
 		PathSelectionType type; /**< Type of a path selection. */
 };
@@ -57,6 +68,19 @@ class StandardSpec : public PathSelectionSpec
 		bool requireStableFlags { false }; /**< Indicates whether "stable" flag is required for all nodes in a circuit. */
 		std::set<std::string> guards; /**< Set of guards (format: name\@ip_address). */
 		std::set<uint16_t> longLivedPorts { 21, 22, 706, 1863, 5050, 5190, 5222, 5223, 6523, 6667, 6697, 8300 }; /**< Set of numbers of long lived ports (if exit node supports any of long lived ports, path selection requires all nodes in a circuit to have "stable" flag. */
+		
+		virtual std::string getKey()
+		{
+			std::ostringstream key;
+			key << PathSelectionSpec::getKey() << "|" << allowNonValidEntry << allowNonValidMiddle << allowNonValidExit
+				<< requireExitFlag << requireFastFlags << requireStableFlags << "|";
+			for(const std::string& guard : guards)
+				key << guard << ",";
+			key << "|";
+			for(uint16_t port : longLivedPorts)
+				key << port << ",";
+			return key.str();
+		}
 };
 
 /**
@@ -78,6 +102,14 @@ class PSDistribuTorSpec : public TorLikeSpec, public std::enable_shared_from_thi
 		 */
 		PSDistribuTorSpec(double bandwidthPerc = 1, bool asAware = false) : bandwidthPerc(bandwidthPerc) { type = asAware ? PS_AS_DISTRIBUTOR : PS_DISTRIBUTOR; }
 		
+		virtual std::string getKey()
+		{
+			std::ostringstream key;
+			key.precision(17);
+			key << StandardSpec::getKey() << "|" << bandwidthPerc;
+			return key.str();
+		}
+		
 		double bandwidthPerc; /**< The percentage of total exit bandwidth that DistribuTor preserves (should be a value from 0 to 1). */
 };
 
@@ -122,6 +154,8 @@ public:
 	*/
 	PSSelektorSpec(std::string tCountry = "US", bool asAware = false) : targetCountry(tCountry){ type = asAware ? PS_AS_SELEKTOR : PS_SELEKTOR;}
 
+	virtual std::string getKey() { return StandardSpec::getKey() + "|" + targetCountry; }
+
 	std::string targetCountry;
 };
 
@@ -140,8 +174,43 @@ class PSLASTorSpec : public StandardSpec, public std::enable_shared_from_this<PS
 		 */
 		PSLASTorSpec(double alpha = 0, int cellSize = 10, bool asAware = false) : alpha(alpha), cellSize(cellSize) { type = asAware ? PS_AS_LASTOR : PS_LASTOR; }
 		
+		virtual std::string getKey()
+		{
+			std::ostringstream key;
+			key.precision(17);
+			key << StandardSpec::getKey() << "|" << alpha << "|" << cellSize;
+			return key.str();
+		}
+		
 		double alpha; /**< Alpha coefficient; minimal value: 0 for lowest latency, maximal: 1 for highest relays selection entropy. */ 
 		int cellSize; /**< Size of cell in tenths of degrees (represents length of cell side); min: 1, max: 50. Only values that split Earth to equal clusters are allowed.*/
 };
 
+/**
+ * Specification of latency-aware Tor path selection algorithm.
+ */
+class PSLatencySpec : public TorLikeSpec, public std::enable_shared_from_this<PSLatencySpec>
+{
+	public:
+		/**
+		 * Sets path selection type to PSLatency type.
+		 * By default, AS unaware algorithm is used.
+		 * @param latencyFile binary file with round trip times between relays (see LatencyMatrix).
+		 * @param alpha latency preference, minimal: 0 for vanilla Tor weights, maximal: 1 for strongest preference of fast circuits (0.5 as default)
+		 * @param asAware should path selection be AS aware?
+		 */
+		PSLatencySpec(std::string latencyFile = "", double alpha = 0.5, bool asAware = false) : latencyFile(latencyFile), alpha(alpha) { type = asAware ? PS_AS_LATENCY : PS_LATENCY; }
+		
+		virtual std::string getKey()
+		{
+			std::ostringstream key;
+			key.precision(17);
+			key << StandardSpec::getKey() << "|" << alpha << "|" << latencyFile;
+			return key.str();
+		}
+		
+		std::string latencyFile; /**< Binary file with round trip times between relays. */
+		double alpha; /**< Latency preference; minimal value: 0 for vanilla Tor weights, maximal: 1 for strongest preference of fast circuits. */
+};
+
 #endif
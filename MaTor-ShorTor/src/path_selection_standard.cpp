@@ -129,21 +129,40 @@ void PathSelectionStandard::computeRelaysPossibilities(std::shared_ptr<StandardS
 		| RelayFlag::RUNNING);
 	
 	// compute relays possibilities
+	// relays lacking required flags are rejected using the columnar view only
 	clogvn("Assigning possibilities...");
+	const RelayTable& table = consensus.getRelayTable();
+	std::vector<int> policySupport(table.policiesCount(), -1); // supported ports of every policy, -1 if not computed yet
 	for(size_t i = 0; i < size; ++i)
 	{
+		int flags = table.getFlags(i);
+		bool exitFlags = (flags & exitRequiredFlags) == exitRequiredFlags && !(flags & RelayFlag::BAD_EXIT);
+		bool entryFlags = (flags & entryRequiredFlags) == entryRequiredFlags;
+		bool middleFlags = (flags & middleRequiredFlags) == middleRequiredFlags;
+		if(!exitFlags && !entryFlags && !middleFlags)
+		{
+			exitPossible[i] = entryPossible[i] = middlePossible[i] = false;
+			continue;
+		}
+
 		const Relay& relay = consensus.getRelay(i);
-		exitPossible[i] = canBeExit(relay, exitRequiredFlags, guards); 
-		entryPossible[i] = canBeEntry(relay, entryRequiredFlags, guards); 
-		middlePossible[i] = canBeMiddle(relay, middleRequiredFlags, guards);
+		exitPossible[i] = exitFlags && canBeExit(relay, exitRequiredFlags, guards);
+		entryPossible[i] = entryFlags && canBeEntry(relay, entryRequiredFlags, guards);
+		middlePossible[i] = middleFlags && canBeMiddle(relay, middleRequiredFlags, guards);
 		
 		if(!exitPossible[i])
 			continue;
 		
-		int relaySupport = 0;
-		for(uint16_t port : recipient->ports)
-			if(relay.supportsConnection(recipient->address, port))
-				++relaySupport;
+		// ports are checked once per distinct policy
+		int& relaySupport = policySupport[table.getPolicyID(i)];
+		if(relaySupport < 0)
+		{
+			const ExitPolicy& policy = table.getPolicy(table.getPolicyID(i));
+			relaySupport = 0;
+			for(uint16_t port : recipient->ports)
+				if(policy.supports(recipient->address, port))
+					++relaySupport;
+		}
 		
 		supportedPortsCardinalities[i] = relaySupport;
 		
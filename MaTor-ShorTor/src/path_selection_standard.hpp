@@ -35,9 +35,20 @@ class PathSelectionStandard : public PathSelection
 		{
 			requireStable = pathSelectionSpec->requireStableFlags | LLPRequiresStable(pathSelectionSpec->longLivedPorts); 
 		}
+		
+		// functions
+		virtual void saveState(PathSelectionSnapshot& snapshot) const
+		{
+			PathSelection::saveState(snapshot);
+			snapshot.put(requireStable);
+		}
 	
 	protected:
 		// functions
+		virtual bool loadState(PathSelectionSnapshot& snapshot)
+		{
+			return PathSelection::loadState(snapshot) && snapshot.get(requireStable);
+		}
 		/**
 		 * Checks whether recipient server's ports overlap sender's long lived ports set.
 		 * @param llports sender's long lived ports set.
@@ -28,9 +28,9 @@ double ProgrammableCostFunction::apply(const Relay& r, double initialRelayCost)
 	if (subPCFs.empty())
 		return initialRelayCost;
 
-	for (std::pair<pcfPredicate, pcfEffect> pair : subPCFs) {
-		pcfPredicate predicate = pair.first;
-		pcfEffect effect = pair.second;
+	for (const std::pair<pcfPredicate, pcfEffect>& pair : subPCFs) {
+		const pcfPredicate& predicate = pair.first;
+		const pcfEffect& effect = pair.second;
 
 		// This is a hack. We should have a better parser. Seriously.
 		/*if (predicate(r))
@@ -42,6 +42,7 @@ PSDistribuTor::PSDistribuTor(std::shared_ptr<PSDistribuTorSpec> pathSelectionSpe
 	clogsn("Preinitializing weights... ");
 	makeMeasure(start);
 	computeRelaysPossibilities(pathSelectionSpec, false);
+	relations->assignConstraints(exitPossible, entryPossible);
 	
 	weight_t exitWeightSum = 0;
 	weight_t entryWeightSum = 0;
@@ -158,12 +159,6 @@ PSDistribuTor::PSDistribuTor(std::shared_ptr<PSDistribuTorSpec> pathSelectionSpe
 	makeMeasure(stop);	
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 	
-	clogsn("Assigning additional relations constraints...");
-	makeMeasure(start);
-	relations->assignConstraints(entryPossible, exitPossible);
-	makeMeasure(stop);
-	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
-	
 	clogsn("Computing related weights...");
 	makeMeasure(start);
 	assignRelatedWeight(entryWeightSum, middleWeightSum);
@@ -171,6 +166,29 @@ PSDistribuTor::PSDistribuTor(std::shared_ptr<PSDistribuTorSpec> pathSelectionSpe
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 }
 
+PSDistribuTor::PSDistribuTor(std::shared_ptr<PSDistribuTorSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec, 
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	std::shared_ptr<RelationshipManager> relationshipManager,
+	const Consensus& consensus,
+	PathSelectionSnapshot& snapshot) : TorLike(senderSpec, recipientSpec, pathSelectionSpec, relationshipManager, consensus),
+		maxEntryWeight(0), maxExitWeight(0), modifier(consensus.getMaxModifier())
+{
+	restoreState(snapshot);
+}
+
+void PSDistribuTor::saveState(PathSelectionSnapshot& snapshot) const
+{
+	TorLike::saveState(snapshot);
+	snapshot.put(maxEntryWeight);
+	snapshot.put(maxExitWeight);
+}
+
+bool PSDistribuTor::loadState(PathSelectionSnapshot& snapshot)
+{
+	return TorLike::loadState(snapshot) && snapshot.get(maxEntryWeight) && snapshot.get(maxExitWeight);
+}
+
 weight_t PSDistribuTor::getExitWeight(const Relay& relay)const
 {
 	weight_t relayWeight = (weight_t)relay.getBandwidth() * modifier;
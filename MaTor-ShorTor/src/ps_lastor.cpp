@@ -3,6 +3,10 @@
 #include <algorithm>
 #include <tuple>
 #include <cmath>
+#include <unordered_map>
+
+#include "types/work_manager.hpp"
+#include "types/packed_symmetric_matrix.hpp"
 
 
 
@@ -45,14 +49,16 @@ PSLASTor::PSLASTor(
 	size_t size = consensus.getSize();
 	
 	std::vector<Cluster> invClusters; // Vector of unique clusters.
-	std::map<uint32_t, size_t> clustersLookup; // Map from cluster's ID to cluster's record number in invClusters vector.
+	std::unordered_map<uint32_t, size_t> clustersLookup(size); // Map from cluster's ID (its grid cell) to cluster's record number in invClusters vector.
+	WorkManager workManager;
+	unsigned threads = workManager.getHardwareConcurrency();
 	
 	initMeasure(start, stop);
 	
 	clogsn("Computing single relay's roles possibilities..."); 
 	makeMeasure(start);
 	computeRelaysPossibilities(pathSelectionSpec);
-	relations->assignConstraints(entryPossible, exitPossible);
+	relations->assignConstraints(exitPossible, entryPossible);
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 	
@@ -67,15 +73,11 @@ PSLASTor::PSLASTor(
 		// computing in which cluster relay is located
 		uint32_t cluster = getClusterID(relay.getLatitude(), relay.getLongitude());
 		
-		size_t clusterIndex;
-		if(clustersLookup.count(cluster)) // cluster already registered
-			clusterIndex = clustersLookup[cluster];
-		else // create new cluster
-		{
-			clusterIndex = invClusters.size();
+		// registering a new cluster unless there already is one for the cell
+		auto lookup = clustersLookup.emplace(cluster, invClusters.size());
+		size_t clusterIndex = lookup.first->second;
+		if(lookup.second)
 			invClusters.emplace_back(cluster, cellSize);
-			clustersLookup[cluster] = clusterIndex;
-		}
 		if(invClusters[clusterIndex].centerLat > 1800 || invClusters[clusterIndex].centerLong > 3600)
 		{
 			std::cout << "Cluster got weird lat/long: " << invClusters[clusterIndex].centerLat << "/" << invClusters[clusterIndex].centerLong << std::endl;
@@ -103,34 +105,25 @@ PSLASTor::PSLASTor(
 	
 	clogsn("Computing cluster relations...");
 	makeMeasure(start);
-	clusterASRelations.resize(clustersNumber);
-	clusterRelations.resize(clustersNumber);
-	for(size_t i = 0; i < clustersNumber; ++i)
-	{
-		clusterRelations[i].resize(clustersNumber, false);
-		clusterASRelations[i].resize(clustersNumber, false);
-		for(size_t j = 0; j < clustersNumber; ++j)
+	clusterASRelations.assign(clustersNumber, std::vector<bool>(clustersNumber, false));
+	clusterRelations.assign(clustersNumber, std::vector<bool>(clustersNumber, false));
+	
+	// relations of the cluster's relays are taken as bitsets and projected to clusters of their relatives,
+	// each task fills only the rows of its own cluster
+	typedef PackedSymmetricMatrix<bool> BitMatrix;
+	size_t words = BitMatrix::wordsFor(size);
+	WorkManager::runAll(threads, clustersNumber, [&](size_t i) {
+		std::vector<uint64_t> row(words);
+		std::vector<bool>& asRelated = clusterASRelations[i];
+		std::vector<bool>& related = clusterRelations[i];
+		for(size_t a : invClusters[i].relays)
 		{
-			bool related = false;
-			bool asRelated = false;
-			for(size_t a : invClusters[i].relays)
-			{
-				for(size_t b : invClusters[j].relays)
-				{
-					if(relations->exitEntryRelated(a, b))
-						asRelated = true;
-					if(relations->entryMiddleRelated(a, b))
-						related = true;
-					if(related && asRelated)
-						break;
-				}
-				if(related && asRelated)
-					break;
-			}
-			clusterRelations[i][j] = related;
-			clusterASRelations[i][j] = asRelated;
+			relations->relatedRow(RelationshipManager::Relation::EXIT_ENTRY, a, size, row.data());
+			BitMatrix::forEachBit(row.data(), nullptr, words, [&](size_t b) { asRelated[clusterOf[b]] = true; });
+			relations->relatedRow(RelationshipManager::Relation::ENTRY_MIDDLE, a, size, row.data());
+			BitMatrix::forEachBit(row.data(), nullptr, words, [&](size_t b) { related[clusterOf[b]] = true; });
 		}
-	}
+	});
 	
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
@@ -174,48 +167,61 @@ PSLASTor::PSLASTor(
 	clogsn("Computing circuit distances...");
 	makeMeasure(start);
 	
-	probability_t maxDistance = 0;
+	// distances between cluster centers (from row cluster to column cluster) are computed once,
+	// circuits of every exit cluster then only sum them
+	std::vector<probability_t> centerDistances(clustersNumber * clustersNumber);
+	WorkManager::runAll(threads, clustersNumber, [&](size_t i) {
+		probability_t* distances = &centerDistances[i * clustersNumber];
+		for(size_t j = 0; j < clustersNumber; ++j)
+			distances[j] = distance(invClusters[i].centerLat, invClusters[i].centerLong, invClusters[j].centerLat, invClusters[j].centerLong);
+	});
+	
 	exitClusters.resize(clustersNumber);
-	for(auto &exit : invClusters)
-		if(exit.exitCount)
+	std::vector<probability_t> maxDistances(clustersNumber, 0); // longest circuit of every exit cluster
+	WorkManager::runAll(threads, clustersNumber, [&](size_t e) {
+		const Cluster& exit = invClusters[e];
+		if(!exit.exitCount)
+			return;
+		exitClusters[exit.index].entries.resize(clustersNumber);
+		probability_t recipientExitDist = distance(recipient->latitude, recipient->longitude, exit.centerLat, exit.centerLong);
+		const probability_t* exitMiddleDists = &centerDistances[exit.index * clustersNumber];
+		for(size_t i = 0; i < totalClosest; ++i) // take entries from previously sorted distances vector
 		{
-			exitClusters[exit.index].entries.resize(clustersNumber);
-			probability_t recipientExitDist = distance(recipient->latitude, recipient->longitude, exit.centerLat, exit.centerLong);
-			for(size_t i = 0; i < totalClosest; ++i) // take entries from previously sorted distances vector
+			auto& entry = invClusters[entryDistances[i].second];
+			if(clusterASRelations[exit.index][entry.index])
+				continue; // skip related cluster
+			if(entry.entryCount)
 			{
-				auto& entry = invClusters[entryDistances[i].second];
-				if(clusterASRelations[exit.index][entry.index])
-					continue; // skip related cluster
-				if(entry.entryCount)
+				std::vector<probability_t>& middleProbs = exitClusters[exit.index].entries[entry.index].middleProbs;
+				middleProbs.resize(clustersNumber, 0);
+				const probability_t* entryMiddleDists = &centerDistances[entry.index * clustersNumber];
+				for(auto &middle : invClusters)
 				{
-					exitClusters[exit.index].entries[entry.index].middleProbs.resize(clustersNumber, 0);
-					for(auto &middle : invClusters)
+					if(clusterRelations[exit.index][middle.index] || clusterRelations[entry.index][middle.index])
+						continue;
+					if(middle.middleCount)
 					{
-						if(clusterRelations[exit.index][middle.index] || clusterRelations[entry.index][middle.index])
-							continue;
-						if(middle.middleCount)
-						{
-							probability_t exitMiddleDist = distance(exit.centerLat, exit.centerLong, middle.centerLat, middle.centerLong);
-							probability_t middleEntryDist = distance(entry.centerLat, entry.centerLong, middle.centerLat, middle.centerLong);
-							
-							probability_t circuitDistance = recipientExitDist + exitMiddleDist + middleEntryDist + entryDistances[i].first;
-							exitClusters[exit.index].entries[entry.index].middleProbs[middle.index] = circuitDistance;
-							if(circuitDistance > maxDistance)
-								maxDistance = circuitDistance;
-						}
+						probability_t circuitDistance = recipientExitDist + exitMiddleDists[middle.index] + entryMiddleDists[middle.index] + entryDistances[i].first;
+						middleProbs[middle.index] = circuitDistance;
+						if(circuitDistance > maxDistances[e])
+							maxDistances[e] = circuitDistance;
 					}
 				}
 			}
 		}
+	});
+	probability_t maxDistance = 0;
+	for(probability_t circuitDistance : maxDistances)
+		if(circuitDistance > maxDistance)
+			maxDistance = circuitDistance;
 	
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 	
 	clogsn("Computing weights and probabilities...");
 	makeMeasure(start);
-	probability_t exitWeightSum = 0;
-	
-	for(size_t exit = 0; exit < clustersNumber; ++exit)
+	// weights of exit clusters are independent, the total weight is summed from them in order
+	WorkManager::runAll(threads, clustersNumber, [&](size_t exit) {
 		if(exitClusters[exit].entries.size())
 			for(size_t entry = 0; entry < clustersNumber; ++entry)
 				if(exitClusters[exit].entries[entry].middleProbs.size())
@@ -226,12 +232,14 @@ PSLASTor::PSLASTor(
 							exitClusters[exit].exitProb += weight; // increasing exit probability
 							exitClusters[exit].entries[entry].entryProb += weight;  // increasing entry probability
 							exitClusters[exit].entries[entry].middleProbs[middle] = weight; // assigning middle probability
-							exitWeightSum += weight; // increasing total weight	
 						}
-	
+	});
+	probability_t exitWeightSum = 0;
+	for(size_t exit = 0; exit < clustersNumber; ++exit)
+		exitWeightSum += exitClusters[exit].exitProb; // increasing total weight
 
 	// computing probabilities...
-	for(size_t exit=0; exit < clustersNumber; ++exit)
+	WorkManager::runAll(threads, clustersNumber, [&](size_t exit) {
 		if(exitClusters[exit].exitProb > 0)
 		{
 			exitClusters[exit].exitProb /= exitWeightSum;
@@ -252,6 +260,7 @@ PSLASTor::PSLASTor(
 				}
 			exitClusters[exit].exitProb /= invClusters[exit].exitCount;
 		}
+	});
 	
 	if (consensus.useVias()) {
 		
@@ -280,7 +289,7 @@ PSLASTor::PSLASTor(
 
 							for (auto &relay : invClusters[middle].relays)
 							{
-								std::vector<std::tuple<size_t, size_t>> allPairs = consensus.getPairsForVia(relay);
+								auto allPairs = consensus.getPairsForVia(relay);
 
 								if (allPairs.size() > 0) {
 									if(!middlePossible[relay])
@@ -289,8 +298,8 @@ PSLASTor::PSLASTor(
 								}
 									
 								for(size_t j = 0; j < allPairs.size(); ++j) {
-									size_t r1 = std::get<0>(allPairs[j]);
-									size_t r2 = std::get<1>(allPairs[j]);
+									size_t r1 = allPairs[j].first;
+									size_t r2 = allPairs[j].second;
 									
 									// if any of the current entry/exits are in the pairs for this relay, increase cluster probability
 									if (clusterOf[r1] == entry || clusterOf[r2] == entry) {
@@ -337,6 +346,76 @@ PSLASTor::PSLASTor(
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 }
 
+PSLASTor::PSLASTor(std::shared_ptr<PSLASTorSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec, 
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	std::shared_ptr<RelationshipManager> relationshipManager,
+	const Consensus& consensus,
+	PathSelectionSnapshot& snapshot) :
+		PathSelectionStandard(senderSpec, recipientSpec, pathSelectionSpec, relationshipManager, consensus),
+		alpha(pathSelectionSpec->alpha),
+		cellSize(pathSelectionSpec->cellSize)
+{
+	restoreState(snapshot);
+}
+
+void PSLASTor::saveState(PathSelectionSnapshot& snapshot) const
+{
+	PathSelectionStandard::saveState(snapshot);
+	snapshot.put(clusterOf);
+	snapshot.put((uint64_t)exitClusters.size());
+	for(const ExitCluster& exit : exitClusters)
+	{
+		snapshot.put(exit.exitProb);
+		snapshot.put((uint64_t)exit.entries.size());
+		for(const EntryCluster& entry : exit.entries)
+		{
+			snapshot.put(entry.entryProb);
+			snapshot.put(entry.middleProbs);
+		}
+	}
+	for(const std::vector<bool>& row : clusterASRelations)
+		snapshot.put(row);
+	for(const std::vector<bool>& row : clusterRelations)
+		snapshot.put(row);
+}
+
+bool PSLASTor::loadState(PathSelectionSnapshot& snapshot)
+{
+	if(!PathSelectionStandard::loadState(snapshot) || !snapshot.get(clusterOf) || clusterOf.size() != consensus.getSize())
+		return false;
+	
+	// every relay has to be in one of the clusters
+	uint64_t clustersNumber;
+	if(!snapshot.get(clustersNumber) || clustersNumber > clusterOf.size())
+		return false;
+	for(size_t cluster : clusterOf)
+		if(cluster >= clustersNumber)
+			return false;
+	
+	exitClusters.resize(clustersNumber);
+	for(ExitCluster& exit : exitClusters)
+	{
+		uint64_t entries;
+		if(!snapshot.get(exit.exitProb) || !snapshot.get(entries) || (entries != 0 && entries != clustersNumber))
+			return false;
+		exit.entries.resize(entries);
+		for(EntryCluster& entry : exit.entries)
+			if(!snapshot.get(entry.entryProb) || !snapshot.get(entry.middleProbs) || (!entry.middleProbs.empty() && entry.middleProbs.size() != clustersNumber))
+				return false;
+	}
+	
+	clusterASRelations.resize(clustersNumber);
+	for(std::vector<bool>& row : clusterASRelations)
+		if(!snapshot.get(row) || row.size() != clustersNumber)
+			return false;
+	clusterRelations.resize(clustersNumber);
+	for(std::vector<bool>& row : clusterRelations)
+		if(!snapshot.get(row) || row.size() != clustersNumber)
+			return false;
+	return true;
+}
+
 uint32_t PSLASTor::getClusterID(double latitude, double longitude) const
 {	
 	// Coordinates are multiplied by 10 because minimal cell size is 0.1 (convertion to "integer" form).
@@ -373,6 +452,91 @@ probability_t PSLASTor::middleProb(size_t middle, size_t entry, size_t exit) con
 	return 0;
 }
 
+void PSLASTor::entryProbRow(size_t exit, probability_t* probs) const
+{
+	// probabilities are shared by relays of the same cluster
+	size_t size = consensus.getSize();
+	const ExitCluster& exitCluster = exitClusters[clusterOf[exit]];
+	if(!exitPossible[exit] || !(exitCluster.exitProb > 0))
+	{
+		std::fill(probs, probs + size, 0);
+		return;
+	}
+	for(size_t i = 0; i < size; ++i)
+		probs[i] = entryPossible[i] ? exitCluster.entries[clusterOf[i]].entryProb : 0;
+}
+
+void PSLASTor::probabilityBounds(probability_t* entryBounds, probability_t* middleBounds, unsigned threads) const
+{
+	// relays of a cluster share probabilities, maxima are taken over clusters of possible exits (and their entries)
+	size_t clustersNumber = exitClusters.size();
+	std::vector<std::vector<probability_t>> entryMaxima(clustersNumber), middleMaxima(clustersNumber);
+	WorkManager::runAll(threads, clustersNumber, [&](size_t exit) {
+		const ExitCluster& exitCluster = exitClusters[exit];
+		if(!(exitCluster.exitProb > 0))
+			return;
+		entryMaxima[exit].assign(clustersNumber, 0);
+		middleMaxima[exit].assign(clustersNumber, 0);
+		for(size_t entry = 0; entry < exitCluster.entries.size(); ++entry)
+		{
+			const EntryCluster& entryCluster = exitCluster.entries[entry];
+			if(!(entryCluster.entryProb > 0))
+				continue;
+			entryMaxima[exit][entry] = entryCluster.entryProb;
+			for(size_t middle = 0; middle < entryCluster.middleProbs.size(); ++middle)
+				middleMaxima[exit][middle] = std::max(middleMaxima[exit][middle], entryCluster.middleProbs[middle]);
+		}
+	});
+
+	std::vector<probability_t> entryMax(clustersNumber, 0), middleMax(clustersNumber, 0);
+	for(size_t exit = 0; exit < clustersNumber; ++exit)
+		for(size_t i = 0; i < entryMaxima[exit].size(); ++i)
+		{
+			entryMax[i] = std::max(entryMax[i], entryMaxima[exit][i]);
+			middleMax[i] = std::max(middleMax[i], middleMaxima[exit][i]);
+		}
+	size_t size = consensus.getSize();
+	for(size_t i = 0; i < size; ++i)
+	{
+		entryBounds[i] = entryPossible[i] ? entryMax[clusterOf[i]] : 0;
+		middleBounds[i] = middlePossible[i] ? middleMax[clusterOf[i]] : 0;
+	}
+}
+
+void PSLASTor::middleProbRow(size_t entry, size_t exit, probability_t* probs) const
+{
+	size_t size = consensus.getSize();
+	size_t exitIndex = clusterOf[exit], entryIndex = clusterOf[entry];
+	if(!(exitPossible[exit] && entryPossible[entry] && exitClusters[exitIndex].exitProb > 0 && exitClusters[exitIndex].entries[entryIndex].entryProb > 0))
+	{
+		std::fill(probs, probs + size, 0);
+		return;
+	}
+	
+	// middle clusters related to the entry or the exit cluster are excluded
+	const std::vector<probability_t>& clusterProbs = exitClusters[exitIndex].entries[entryIndex].middleProbs;
+	const std::vector<bool>& entryRelated = clusterRelations[entryIndex];
+	const std::vector<bool>& exitRelated = clusterRelations[exitIndex];
+	for(size_t i = 0; i < size; ++i)
+	{
+		size_t middleIndex = clusterOf[i];
+		probs[i] = (middlePossible[i] && !(entryRelated[middleIndex] || exitRelated[middleIndex])) ? clusterProbs[middleIndex] : 0;
+	}
+}
+
+size_t PSLASTor::relayGroups(std::vector<size_t>& groups) const
+{
+	size_t size = consensus.getSize();
+	std::map<std::pair<size_t, int>, size_t> lookup; // (cluster, roles) to group
+	groups.resize(size);
+	for(size_t i = 0; i < size; ++i)
+	{
+		int roles = exitPossible[i] | (entryPossible[i] << 1) | (middlePossible[i] << 2);
+		groups[i] = lookup.emplace(std::make_pair(clusterOf[i], roles), lookup.size()).first->second;
+	}
+	return lookup.size();
+}
+
 bool PSLASTor::entryExitAllowed(size_t entry, size_t exit) const
 {
 	return !(clusterASRelations[clusterOf[exit]][clusterOf[entry]]);
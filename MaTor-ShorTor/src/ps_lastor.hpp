@@ -122,6 +122,23 @@ class PSLASTor : public PathSelectionStandard
 			std::shared_ptr<RecipientSpec> recipientSpec,
 			std::shared_ptr<RelationshipManager> relationshipManager,
 			const Consensus &consensus);
+
+		/**
+		 * Restores path selection from a snapshot instead of computing it.
+		 * @param pathSelectionSpec specification of the path selection the snapshot was saved for.
+		 * @param senderSpec description of a sender using this path selection.
+		 * @param recipientSpec description of a recipient which sender connects to.
+		 * @param relationshipManager definition of relations between relays.
+		 * @param consensus consensus describing the state of the Tor network.
+		 * @param snapshot snapshot written by saveState() of the same path selection.
+		 * @throws snapshot_exception if the snapshot does not contain the state of the path selection.
+		 */
+		PSLASTor(std::shared_ptr<PSLASTorSpec> pathSelectionSpec,
+			std::shared_ptr<SenderSpec> senderSpec, 
+			std::shared_ptr<RecipientSpec> recipientSpec,
+			std::shared_ptr<RelationshipManager> relationshipManager,
+			const Consensus& consensus,
+			PathSelectionSnapshot& snapshot);
 		
 		// functions
 		virtual probability_t exitProb(size_t exit) const;
@@ -130,9 +147,29 @@ class PSLASTor : public PathSelectionStandard
 		
 		virtual bool entryExitAllowed(size_t entry, size_t exit) const;		
 		virtual bool middleEntryExitAllowed(size_t middle, size_t entry, size_t exit) const;
+		
+		virtual void entryProbRow(size_t exit, probability_t* probs) const;
+		virtual void middleProbRow(size_t entry, size_t exit, probability_t* probs) const;
+		
+		/**
+		 * Bounds are maxima of cluster probabilities over exit (and entry) clusters, cubic in the number of clusters only.
+		 * @copydoc PathSelection::probabilityBounds()
+		 */
+		virtual void probabilityBounds(probability_t* entryBounds, probability_t* middleBounds, unsigned threads) const;
+		
+		/**
+		 * Relays are grouped by their cluster and the roles (exit, entry, middle) they may take,
+		 * probabilities are shared by all such relays.
+		 * @copydoc PathSelection::relayGroups()
+		 */
+		virtual size_t relayGroups(std::vector<size_t>& groups) const;
+		
+		virtual void saveState(PathSelectionSnapshot& snapshot) const;
 	
 	protected:
 		// functions
+		virtual bool loadState(PathSelectionSnapshot& snapshot);
+		
 		/**
 		 * Computes cluster ID for specified coordinates.
 		 * ID packs information about converted (unsigned integer) coordinates at which cluster starts.
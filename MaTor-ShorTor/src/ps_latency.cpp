@@ -0,0 +1,202 @@
+#include "ps_latency.hpp"
+
+#include <algorithm>
+
+PSLatency::PSLatency(std::shared_ptr<PSLatencySpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec,
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	std::shared_ptr<RelationshipManager> relationshipManager,
+	const Consensus& consensus) : TorLike(senderSpec, recipientSpec, pathSelectionSpec, relationshipManager, consensus)
+{
+	if(!(pathSelectionSpec->alpha >= 0 && pathSelectionSpec->alpha <= 1))
+		throw_exception(latency_init_exception, latency_init_exception::INVALID_ALPHA, std::to_string(pathSelectionSpec->alpha));
+
+	initMeasure(start, stop);
+
+	clogsn("Loading latency matrix...");
+	makeMeasure(start);
+	loadLatencies(pathSelectionSpec);
+	latencyScale = maxRtt > 0 ? pathSelectionSpec->alpha / (2 * maxRtt) : 0;
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+
+	clogsn("Computing relay's roles possibilities...");
+	makeMeasure(start);
+	computeRelaysPossibilities(pathSelectionSpec);
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+
+	clogsn("Assigning additional relations constraints...");
+	makeMeasure(start);
+	relations->assignConstraints(exitPossible, entryPossible);
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+
+	size_t size = consensus.getSize();
+
+	weight_t exitWeightSum = 0;
+	weight_t entryWeightSum = 0;
+	weight_t middleWeightSum = 0;
+
+	clogsn("Assigning single weights...");
+	makeMeasure(start);
+	for(size_t i = 0; i < size; ++i)
+	{
+		const Relay& relay = consensus.getRelay(i);
+		exitWeights[i] = getExitWeight(relay);
+		entryWeights[i] = getEntryWeight(relay);
+		middleWeights[i] = getMiddleWeight(relay);
+
+		exitWeightSum += exitWeights[i];
+		entryWeightSum += entryWeights[i];
+		middleWeightSum += middleWeights[i];
+	}
+	exitSumInv = (weight_t) 1 / exitWeightSum;
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+
+	clogsn("Computing latency sums...");
+	makeMeasure(start);
+	std::vector<size_t> middles;
+	for(size_t m = 0; m < size; ++m)
+		if(middleWeights[m] > 0)
+			middles.push_back(m);
+	latencySums.assign(size, 0);
+	WorkManager workManager;
+	unsigned threads = workManager.getHardwareConcurrency();
+	WorkManager::runAll(threads, size, [&](size_t i) {
+		weight_t sum = 0;
+		for(size_t m : middles)
+			sum += middleWeights[m] * latency(i, m);
+		latencySums[i] = sum;
+	});
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+
+	clogsn("Computing related weights...");
+	makeMeasure(start);
+	assignRelatedWeight(entryWeightSum, middleWeightSum);
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+}
+
+PSLatency::PSLatency(std::shared_ptr<PSLatencySpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec,
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	std::shared_ptr<RelationshipManager> relationshipManager,
+	const Consensus& consensus,
+	PathSelectionSnapshot& snapshot) : TorLike(senderSpec, recipientSpec, pathSelectionSpec, relationshipManager, consensus)
+{
+	loadLatencies(pathSelectionSpec);
+	restoreState(snapshot);
+}
+
+void PSLatency::loadLatencies(std::shared_ptr<PSLatencySpec> pathSelectionSpec)
+{
+	if(!latencies.load(pathSelectionSpec->latencyFile, consensus.getFingerprintIndex()))
+		throw_exception(latency_init_exception, latency_init_exception::INVALID_LATENCY_FILE, pathSelectionSpec->latencyFile);
+	maxRtt = latencies.maxRtt();
+}
+
+probability_t PSLatency::middleProb(size_t middle, size_t entry, size_t exit) const
+{
+	if(middleWeights[middle] > 0 && middleEntryExitAllowed(middle, entry, exit))
+		return middleWeights[middle] * latencyFactor(middle, entry, exit) * middleSumRelatedInv.get(entry, exit);
+	return 0;
+}
+
+void PSLatency::middleProbRow(size_t entry, size_t exit, probability_t* probs) const
+{
+	// weight * latency factor * inverse sum of the pair, except for relatives of the entry or the exit
+	size_t size = consensus.getSize();
+	size_t words = PackedSymmetricMatrix<bool>::wordsFor(size);
+	thread_local std::vector<uint64_t> related, exitRelated;
+	related.resize(words);
+	exitRelated.resize(words);
+	relations->relatedRow(RelationshipManager::Relation::ENTRY_MIDDLE, entry, size, related.data());
+	relations->relatedRow(RelationshipManager::Relation::EXIT_MIDDLE, exit, size, exitRelated.data());
+	for(size_t w = 0; w < words; ++w)
+		related[w] |= exitRelated[w];
+
+	weight_t pairInv = middleSumRelatedInv.get(entry, exit);
+	for(size_t i = 0; i < size; ++i)
+	{
+		bool allowed = !((related[i / 64] >> (i % 64)) & 1);
+		if(middleWeights[i] > 0 && allowed)
+			probs[i] = middleWeights[i] * latencyFactor(i, entry, exit) * pairInv;
+		else
+			probs[i] = 0;
+	}
+}
+
+void PSLatency::saveState(PathSelectionSnapshot& snapshot) const
+{
+	TorLike::saveState(snapshot);
+	snapshot.put(latencyScale);
+	snapshot.put(maxRtt);
+	snapshot.put((uint64_t)latencies.storedRelays());
+}
+
+bool PSLatency::loadState(PathSelectionSnapshot& snapshot)
+{
+	// the snapshot is valid only for the same latency matrix
+	weight_t savedMaxRtt;
+	uint64_t savedRelays;
+	return TorLike::loadState(snapshot) && snapshot.get(latencyScale) &&
+		snapshot.get(savedMaxRtt) && savedMaxRtt == maxRtt &&
+		snapshot.get(savedRelays) && savedRelays == latencies.storedRelays();
+}
+
+void PSLatency::assignRelatedWeightChunk(size_t start, size_t stop, weight_t entryWeightSum, weight_t middleWeightSum,
+	const Relatives& exitEntryRelatives, const Relatives& exitMiddleRelatives, const Relatives& entryMiddleRelatives)
+{
+	// normalizer of a pair: sum over allowed middles of weight * (1 - latencyScale * (rtt(entry, middle) + rtt(middle, exit))),
+	// i. e., all middles minus related ones, for both the weights and the weights multiplied by round trip times
+	size_t size = consensus.getSize();
+	for(size_t ex = start; ex < stop; ++ex) // for all relays in the interval
+	{
+		weight_t relatedEntryWeight = 0;
+
+		// sum up exit-entry-related relays entry weights
+		for(const uint32_t* relative = exitEntryRelatives.begin(ex); relative != exitEntryRelatives.end(ex); ++relative)
+			relatedEntryWeight += entryWeights[*relative];
+
+		entrySumRelatedInv[ex] = (weight_t)1 / (entryWeightSum - relatedEntryWeight);
+
+		// computing middle related weights and latencies
+		const uint32_t* exitBegin = exitMiddleRelatives.begin(ex);
+		const uint32_t* exitEnd = exitMiddleRelatives.end(ex);
+		weight_t* middleRow = middleSumRelatedInv.row(ex);
+		for(size_t en = ex + 1; en < size; ++en) // ex != en and edgemap properties
+		{
+			// merging two relay's sorted relatives, common relatives are counted once
+			weight_t relatedMiddleWeight = 0;
+			weight_t relatedLatency = 0;
+			auto add = [&](uint32_t middle) {
+				relatedMiddleWeight += middleWeights[middle];
+				relatedLatency += middleWeights[middle] * (latency(ex, middle) + latency(middle, en));
+			};
+			const uint32_t* a = exitBegin;
+			const uint32_t* b = entryMiddleRelatives.begin(en);
+			const uint32_t* bEnd = entryMiddleRelatives.end(en);
+			while(a != exitEnd && b != bEnd)
+			{
+				if(*b < *a)
+					add(*b++);
+				else
+				{
+					if(*a == *b)
+						++b;
+					add(*a++);
+				}
+			}
+			for(; a != exitEnd; ++a)
+				add(*a);
+			for(; b != bEnd; ++b)
+				add(*b);
+
+			weight_t pairLatency = latencySums[ex] + latencySums[en] - relatedLatency;
+			middleRow[en] = (weight_t)1 / (middleWeightSum - relatedMiddleWeight - latencyScale * pairLatency);
+		}
+	}
+}
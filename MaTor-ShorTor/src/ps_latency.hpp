@@ -0,0 +1,168 @@
+#ifndef PS_LATENCY_HPP
+#define PS_LATENCY_HPP
+
+/** @file */
+
+#include <memory>
+
+#include "tor_like.hpp"
+#include "latency_matrix.hpp"
+#include "relay.hpp"
+#include "utils.hpp"
+#include "types/general_exception.hpp"
+
+/**
+ * Latency-aware path selection initialization exception.
+ */
+class latency_init_exception : public general_exception
+{
+	public:
+		/**
+		 * Exception reasons.
+		 */
+		enum reason
+		{
+			INVALID_ALPHA, /**< Invalid alpha value (should be floating point value v such that 0 <= v <= 1). */
+			INVALID_LATENCY_FILE /**< Latency file does not exist or is not a valid latency matrix. */
+		};
+
+		// constructors
+		/**
+		 * Constructs exception instance caused by invalid value.
+		 * @param why reason of throwing exception
+		 * @param value invalid value that caused exception.
+		 * @param file name of the file file in which exception has occured.
+		 * @param line line at which exception has occured.
+		 */
+		latency_init_exception(reason why, const std::string& value, const char* file, int line) : general_exception("", file, line)
+		{
+			reasonWhy = why;
+			switch(why)
+			{
+				case INVALID_ALPHA:
+					this->message = "Invalid alpha value: \"" + value + "\". Should be value v such that 0 <= v <= 1.";
+					break;
+				case INVALID_LATENCY_FILE:
+					this->message = "Latency file \"" + value + "\" does not exist or is not a valid latency matrix.";
+					break;
+				default:
+					this->message = "unknown latency-aware path selection failure reason.";
+			}
+			commit_message();
+		}
+
+		/**
+		 * @copydoc general_exception::~general_exception()
+		 */
+		virtual ~latency_init_exception() throw () { }
+
+		virtual int why() const { return reasonWhy; }
+
+	protected:
+		reason reasonWhy; /**< Exception reason. */
+
+		virtual const std::string& getTag() const
+		{
+			const static std::string tag = "latency_init_exception";
+			return tag;
+		}
+};
+
+/**
+ * Class for latency-aware Tor path selection algorithm.
+ * Relays get vanilla Tor weights, the weight of a middle relay is then scaled by the latency of the circuit:
+ * by 1 - alpha * (rtt(entry, middle) + rtt(middle, exit)) / (2 * maxRtt), i. e., linearly from 1 for instant hops
+ * down to 1 - alpha for the slowest ones. Round trip times between relays are read from a memory-mapped LatencyMatrix,
+ * unknown round trip times count as the slowest ones.
+ * Since the factor is linear, normalizers of middle probabilities are additive: latency sums of every relay
+ * combine with sums over related relays to one normalizer per (entry, exit) pair, so middle probabilities are computed in O(1).
+ */
+class PSLatency : public TorLike
+{
+	public:
+		// constructors
+		/**
+		 * Constructor calls parent classes constructors. Then, it computes possibilities of selecting
+		 * a relay for specified role, maps the latency matrix and assigns weights for relays.
+		 * @param pathSelectionSpec specification of latency-aware path selection preferences.
+		 * @param senderSpec description of a sender using this path selection.
+		 * @param recipientSpec description of a recipient which sender connects to.
+		 * @param relationshipManager definition of relations between relays.
+		 * @param consensus consensus describing the state of the Tor network.
+		 * @throws latency_init_exception if alpha is out of range or the latency file can not be loaded.
+		 * @see PathSelection
+		 * @see TorLike
+		 */
+		PSLatency(std::shared_ptr<PSLatencySpec> pathSelectionSpec,
+			std::shared_ptr<SenderSpec> senderSpec,
+			std::shared_ptr<RecipientSpec> recipientSpec,
+			std::shared_ptr<RelationshipManager> relationshipManager,
+			const Consensus& consensus);
+
+		/**
+		 * Restores path selection from a snapshot instead of computing it.
+		 * @param pathSelectionSpec specification of the path selection the snapshot was saved for.
+		 * @param senderSpec description of a sender using this path selection.
+		 * @param recipientSpec description of a recipient which sender connects to.
+		 * @param relationshipManager definition of relations between relays.
+		 * @param consensus consensus describing the state of the Tor network.
+		 * @param snapshot snapshot written by saveState() of the same path selection.
+		 * @throws latency_init_exception if the latency file can not be loaded.
+		 * @throws snapshot_exception if the snapshot does not contain the state of the path selection.
+		 */
+		PSLatency(std::shared_ptr<PSLatencySpec> pathSelectionSpec,
+			std::shared_ptr<SenderSpec> senderSpec,
+			std::shared_ptr<RecipientSpec> recipientSpec,
+			std::shared_ptr<RelationshipManager> relationshipManager,
+			const Consensus& consensus,
+			PathSelectionSnapshot& snapshot);
+
+		// functions
+		virtual probability_t middleProb(size_t middle, size_t entry, size_t exit) const;
+		virtual void middleProbRow(size_t entry, size_t exit, probability_t* probs) const;
+
+		virtual void saveState(PathSelectionSnapshot& snapshot) const;
+
+	protected:
+		// functions
+		virtual bool loadState(PathSelectionSnapshot& snapshot);
+
+		virtual void assignRelatedWeightChunk(size_t start, size_t stop, weight_t entryWeightSum, weight_t middleWeightSum,
+			const Relatives& exitEntryRelatives, const Relatives& exitMiddleRelatives, const Relatives& entryMiddleRelatives);
+
+		/**
+		 * Loads the latency matrix of the specification.
+		 * @param pathSelectionSpec specification of latency-aware path selection preferences.
+		 * @throws latency_init_exception if the latency file can not be loaded.
+		 */
+		void loadLatencies(std::shared_ptr<PSLatencySpec> pathSelectionSpec);
+
+		/**
+		 * @param first position of a relay in consensus.
+		 * @param second position of another relay in consensus.
+		 * @return round trip time between the relays, the greatest known one if it is unknown.
+		 */
+		weight_t latency(size_t first, size_t second) const
+		{
+			return latencies.rtt(first, second);
+		}
+
+		/**
+		 * @param middle index of middle relay.
+		 * @param entry index of entry relay.
+		 * @param exit index of exit relay.
+		 * @return factor of the middle weight given by the latency of the circuit.
+		 */
+		weight_t latencyFactor(size_t middle, size_t entry, size_t exit) const
+		{
+			return 1 - latencyScale * (latency(entry, middle) + latency(middle, exit));
+		}
+
+		// variables
+		LatencyMatrix latencies; /**< Round trip times between relays. */
+		weight_t maxRtt; /**< Greatest known round trip time (used for unknown round trip times). */
+		weight_t latencyScale; /**< Latency weight of one millisecond, alpha / (2 * maxRtt). */
+		std::vector<weight_t> latencySums; /**< Sum of middle weight * round trip time to the relay over all middle relays, for every relay. */
+};
+
+#endif
@@ -17,6 +17,12 @@ PSSelektor::PSSelektor(std::shared_ptr<PSSelektorSpec> pathSelectionSpec,
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 	
+	clogsn("Assigning additional relations constraints...");
+	makeMeasure(start);
+	relations->assignConstraints(exitPossible, entryPossible);
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+	
 	size_t size = consensus.getSize();
 	
 	weight_t exitWeightSum = 0;
@@ -40,15 +46,20 @@ PSSelektor::PSSelektor(std::shared_ptr<PSSelektorSpec> pathSelectionSpec,
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 	
-	clogsn("Assigning additional relations constraints...");
-	makeMeasure(start);
-	relations->assignConstraints(entryPossible, exitPossible);
-	makeMeasure(stop);
-	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
-	
 	clogsn("Computing related weights...");
 	makeMeasure(start);
 	assignRelatedWeight(entryWeightSum, middleWeightSum);
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");	
 }
+
+PSSelektor::PSSelektor(std::shared_ptr<PSSelektorSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec, 
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	std::shared_ptr<RelationshipManager> relationshipManager,
+	const Consensus& consensus,
+	PathSelectionSnapshot& snapshot) : TorLike(senderSpec, recipientSpec, pathSelectionSpec, relationshipManager, consensus)
+{
+	ExitCountry = pathSelectionSpec->targetCountry;
+	restoreState(snapshot);
+}
@@ -17,6 +17,12 @@ PSTor::PSTor(std::shared_ptr<PSTorSpec> pathSelectionSpec,
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 	
+	clogsn("Assigning additional relations constraints...");
+	makeMeasure(start);
+	relations->assignConstraints(exitPossible, entryPossible);
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+	
 	size_t size = consensus.getSize();
 	
 	weight_t exitWeightSum = 0;
@@ -55,7 +61,7 @@ PSTor::PSTor(std::shared_ptr<PSTorSpec> pathSelectionSpec,
 		// used as a via for some pair
 		for(size_t i = 0; i < size; ++i)
 		{
-			std::vector<std::tuple<size_t, size_t>> allPairs = consensus.getPairsForVia(i);
+			auto allPairs = consensus.getPairsForVia(i);
 
 			// IMPORTANT: set middlePossible to true *before* getting the relay weight
 			// because otherwise the weight is zero! 
@@ -81,7 +87,7 @@ PSTor::PSTor(std::shared_ptr<PSTorSpec> pathSelectionSpec,
 		weight_t newMiddleWeightSum = 0;
 		for(size_t i = 0; i < size; ++i)
 		{
-			std::vector<std::tuple<size_t, size_t>> allPairs = consensus.getPairsForVia(i);
+			auto allPairs = consensus.getPairsForVia(i);
 
 			probability_t middleProb = (probability_t) middleWeights[i] * middleSumInv;
 			newMiddleWeights[i] = middleWeights[i];
@@ -91,8 +97,8 @@ PSTor::PSTor(std::shared_ptr<PSTorSpec> pathSelectionSpec,
 			
 			probability_t newMiddleProb = middleProb; // to be computed in the loop below
 			for(size_t j = 0; j < allPairs.size(); ++j) {
-				size_t r1 = std::get<0>(allPairs[j]);
-				size_t r2 = std::get<1>(allPairs[j]);
+				size_t r1 = allPairs[j].first;
+				size_t r2 = allPairs[j].second;
 			
 				probability_t entryProbR1 = (probability_t) entryWeights[r1] * entrySumInv;
 				probability_t entryProbR2 = (probability_t) entryWeights[r2] * entrySumInv;
@@ -125,12 +131,6 @@ PSTor::PSTor(std::shared_ptr<PSTorSpec> pathSelectionSpec,
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 	
-	clogsn("Assigning additional relations constraints...");
-	makeMeasure(start);
-	relations->assignConstraints(entryPossible, exitPossible);
-	makeMeasure(stop);
-	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
-	
 	clogsn("Computing related weights...");
 	makeMeasure(start);
 	assignRelatedWeight(entryWeightSum, middleWeightSum);
@@ -138,3 +138,12 @@ PSTor::PSTor(std::shared_ptr<PSTorSpec> pathSelectionSpec,
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");	
 }
 
+PSTor::PSTor(std::shared_ptr<PSTorSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec, 
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	std::shared_ptr<RelationshipManager> relationshipManager,
+	const Consensus& consensus,
+	PathSelectionSnapshot& snapshot) : TorLike(senderSpec, recipientSpec, pathSelectionSpec, relationshipManager, consensus)
+{
+	restoreState(snapshot);
+}
@@ -17,6 +17,12 @@ PSUniform::PSUniform(std::shared_ptr<PSUniformSpec> pathSelectionSpec,
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 	
+	clogsn("Assigning additional relations constraints...");
+	makeMeasure(start);
+	relations->assignConstraints(exitPossible, entryPossible);
+	makeMeasure(stop);
+	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
+	
 	size_t size = consensus.getSize();
 	
 	weight_t exitWeightSum = 0;
@@ -49,15 +55,19 @@ PSUniform::PSUniform(std::shared_ptr<PSUniformSpec> pathSelectionSpec,
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
 	
-	clogsn("Assigning additional relations constraints...");
-	makeMeasure(start);
-	relations->assignConstraints(entryPossible, exitPossible);
-	makeMeasure(stop);
-	clogsn("\tDone in " << measureTime(start, stop) << " ms.");
-	
 	clogsn("Computing related weights...");
 	makeMeasure(start);
 	assignRelatedWeight(entryWeightSum, middleWeightSum);
 	makeMeasure(stop);
 	clogsn("\tDone in " << measureTime(start, stop) << " ms.");	
 }
+
+PSUniform::PSUniform(std::shared_ptr<PSUniformSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec, 
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	std::shared_ptr<RelationshipManager> relationshipManager,
+	const Consensus& consensus,
+	PathSelectionSnapshot& snapshot) : TorLike(senderSpec, recipientSpec, pathSelectionSpec, relationshipManager, consensus)
+{
+	restoreState(snapshot);
+}
@@ -33,6 +33,23 @@ class PSUniform : public TorLike
 			std::shared_ptr<RecipientSpec> recipientSpec,
 			std::shared_ptr<RelationshipManager> relationshipManager,
 			const Consensus& consensus);
+
+		/**
+		 * Restores path selection from a snapshot instead of computing it.
+		 * @param pathSelectionSpec specification of the path selection the snapshot was saved for.
+		 * @param senderSpec description of a sender using this path selection.
+		 * @param recipientSpec description of a recipient which sender connects to.
+		 * @param relationshipManager definition of relations between relays.
+		 * @param consensus consensus describing the state of the Tor network.
+		 * @param snapshot snapshot written by saveState() of the same path selection.
+		 * @throws snapshot_exception if the snapshot does not contain the state of the path selection.
+		 */
+		PSUniform(std::shared_ptr<PSUniformSpec> pathSelectionSpec,
+			std::shared_ptr<SenderSpec> senderSpec, 
+			std::shared_ptr<RecipientSpec> recipientSpec,
+			std::shared_ptr<RelationshipManager> relationshipManager,
+			const Consensus& consensus,
+			PathSelectionSnapshot& snapshot);
 };
 
 #endif
@@ -47,6 +47,8 @@ protected:
 
 
 #include "mator.hpp"
+#include "consensus_series.hpp"
+#include "consensus_cache.hpp"
 #include "pcf.hpp"
 #include "relay.hpp"
 
@@ -206,6 +208,11 @@ PYBIND11_PLUGIN(pymator) {
 		.def(py::init<double, int>())
 		.def(py::init<double, int, bool>())
 		;
+	py::class_<PSLatencySpec, shared_ptr<PSLatencySpec>>(m, "PSLatencySpec", py::base<PathSelectionSpec>())
+		.def(py::init())
+		.def(py::init<string&, double>())
+		.def(py::init<string&, double, bool>())
+		;
 
 	py::class_<Consensus, shared_ptr<Consensus>>(m, "Consensus")
 		.def("__init__", [](Consensus &instance, string& consensus, string& dbname, string& viaAllPairs, bool useVias) {
@@ -215,10 +222,35 @@ PYBIND11_PLUGIN(pymator) {
 		.def("clone", [](Consensus& instance) {
 				return make_shared<Consensus>(instance);
 		})
+		.def("findRelayIndex", [](Consensus& instance, string& fingerprint) {
+				size_t position = instance.findRelayIndexByFingerprint(fingerprint);
+				return position == FingerprintIndex::NOT_FOUND ? (int64_t)-1 : (int64_t)position;
+		})
+		.def("findRelayIndices", [](Consensus& instance, vector<string>& fingerprints) {
+				return instance.getFingerprintIndex().findAll(fingerprints);
+		})
+		;
+
+	py::class_<ConsensusSeries, shared_ptr<ConsensusSeries>>(m, "ConsensusSeries")
+		.def("__init__", [](ConsensusSeries &instance, vector<string>& consensuses, string& dbname) {
+				py::gil_scoped_release release;
+				new (&instance) ConsensusSeries(consensuses, dbname);
+		})
+		.def("size", &ConsensusSeries::size)
+		.def("get", &ConsensusSeries::get)
+		.def("descriptorCount", &ConsensusSeries::descriptorCount)
+		.def("policyCount", &ConsensusSeries::policyCount)
 		;
 
 	PythonBinder::bindRelay(m);
 
+	m.def("setConsensusCacheBudget", [](size_t bytes) {
+		ConsensusCache::instance().setBudget(bytes);
+	});
+	m.def("clearConsensusCache", []() {
+		ConsensusCache::instance().clear();
+	});
+
 	m.def("hardwareConcurrency", []() {
 		return std::thread::hardware_concurrency();
 	});
@@ -234,15 +266,15 @@ void PythonBinder::bindRelay(pybind11::module m) {
 		.def_readonly("publishedDate", &Relay::publishedDate)
 		.def_readonly("fingerprint", &Relay::fingerprint)
 		.def_readonly("version", &Relay::version)
-		.def_readonly("country", &Relay::country)
-		.def_readonly("ASNumber", &Relay::ASNumber)
-		.def_readonly("ASName", &Relay::ASName)
-		.def_readonly("platform", &Relay::platform)
+		.def_property_readonly("country", &Relay::getCountry)
+		.def_property_readonly("ASNumber", &Relay::getASNumber)
+		.def_property_readonly("ASName", &Relay::getASName)
+		.def_property_readonly("platform", &Relay::getPlatform)
 		.def_readonly("bandwidth", &Relay::bandwidth)
-		.def_readonly("averagedBandwidth", &Relay::averagedBandwidth)
+		.def_property_readonly("averagedBandwidth", &Relay::getAveragedBandwidth)
 		.def_readonly("flags", &Relay::flags)
-		.def_readonly("latitude", &Relay::latitude)
-		.def_readonly("longitude", &Relay::longitude)
+		.def_property_readonly("latitude", &Relay::getLatitude)
+		.def_property_readonly("longitude", &Relay::getLongitude)
 		.def_readonly("registeredAt", &Relay::registeredAt)
 		.def_property_readonly("ip", [](Relay& r) { return (string)r.getAddress(); })
 
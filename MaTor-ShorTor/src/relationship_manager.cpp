@@ -2,73 +2,108 @@
 
 #include <algorithm>
 
-SubnetRelations::SubnetRelations(const Consensus& consensus) : consensus(consensus), relations(consensus.getSize(), true)
+void RelationshipManager::relatedRow(Relation relation, size_t position, size_t size, uint64_t* row)
 {
-	size_t size = consensus.getSize();
-	for(size_t i = 0; i < size; ++i)
+	std::fill(row, row + PackedSymmetricMatrix<bool>::wordsFor(size), 0);
+	for(size_t j = 0; j < size; ++j)
+		if(related(relation, position, j))
+			row[j / 64] |= (uint64_t)1 << (j % 64);
+}
+
+bool RelationshipManager::related(Relation relation, size_t first, size_t second)
+{
+	switch(relation)
 	{
-		relations[i][i] = true;
-		for(size_t j = i + 1; j < size; ++j)
-			if(consensus.isRelated(i, j) || consensus.getRelay(i).getAddress().isSubnet(consensus.getRelay(j).getAddress()))
-				relations[i][j] = true;
+		case Relation::EXIT_ENTRY:
+			return exitEntryRelated(first, second);
+		case Relation::EXIT_MIDDLE:
+			return exitMiddleRelated(first, second);
+		default:
+			return entryMiddleRelated(first, second);
 	}
 }
 
-ASRelations::ASRelations(const Consensus& consensus, const IP& senderIP, const IP& recipientIP)
+void SubnetRelations::relatedRow(Relation relation, size_t position, size_t size, uint64_t* row)
+{
+	// members of the family and of the subnet
+	std::fill(row, row + PackedSymmetricMatrix<bool>::wordsFor(size), 0);
+	for(const uint32_t* member = consensus.familyBegin(position); member != consensus.familyEnd(position); ++member)
+		row[*member / 64] |= (uint64_t)1 << (*member % 64);
+	RelayTable::id_t subnet = table.getSubnetID(position);
+	for(const uint32_t* member = table.subnetBegin(subnet); member != table.subnetEnd(subnet); ++member)
+		row[*member / 64] |= (uint64_t)1 << (*member % 64);
+}
+
+ASRelations::ASRelations(const Consensus& consensus, const IP& senderIP, const IP& recipientIP, std::shared_ptr<ASMap> asmap)
 	: SubnetRelations(consensus), senderIP(senderIP), recipientIP(recipientIP)
+{
+	initialize(asmap);
+}
+
+void ASRelations::initialize(std::shared_ptr<ASMap> asmap)
 {
 	size_t size = consensus.getSize();
+	entryWords = PackedSymmetricMatrix<bool>::wordsFor(size);
+	routeWords = 0;
 	
-	// resize all vectors
-	canBeExit.resize(size, false);
-	canBeEntry.resize(size, false);
-	ASrelations.resize(size);
-	for(size_t i = 0; i < size; ++i)
-		ASrelations[i].resize(size);
+	// without paths to both endpoints, routes are empty and no relays are AS related
+	if(asmap == nullptr || !asmap->built_for(consensus) || !asmap->endpoint_exists(senderIP) || !asmap->endpoint_exists(recipientIP))
+		return;
 	
-	// assign standard relationships for exit and entry
+	// routes of each relay, computed once per exit and once per entry
+	routeWords = asmap->as_words();
+	exitRoutes.resize(size * routeWords);
+	entryRoutes.resize(size * routeWords);
+	crossingEntries.assign(asmap->as_count() * entryWords, 0);
 	for(size_t i = 0; i < size; ++i)
-		for(size_t j = 0; j < size; ++j)
-			ASrelations[i][j] = relations[i][j];
+	{
+		asmap->aspath_endpoint_bits(i, recipientIP, &exitRoutes[i * routeWords]);
+		asmap->aspath_endpoint_bits(i, senderIP, &entryRoutes[i * routeWords]);
+		PackedSymmetricMatrix<bool>::forEachBit(&entryRoutes[i * routeWords], nullptr, routeWords, [&](size_t as) {
+			crossingEntries[as * entryWords + i / 64] |= (uint64_t)1 << (i % 64);
+		});
+	}
+}
+
+void ASRelations::relatedRow(Relation relation, size_t position, size_t size, uint64_t* row)
+{
+	SubnetRelations::relatedRow(relation, position, size, row);
+	if(relation != Relation::EXIT_ENTRY || routeWords == 0)
+		return;
+	
+	// entries crossing any AS of the exit route
+	PackedSymmetricMatrix<bool>::forEachBit(&exitRoutes[position * routeWords], nullptr, routeWords, [&](size_t as) {
+		const uint64_t* entries = &crossingEntries[as * entryWords];
+		for(size_t w = 0; w < entryWords; ++w)
+			row[w] |= entries[w];
+	});
 }
 
 void ASRelations::assignConstraints(std::vector<bool>& exitPossible, std::vector<bool>& entryPossible) 
 {
 	size_t size = consensus.getSize();
 	
-	// assigning AS relationships for exit and entry
+	// exit can be chosen iff some entry is unrelated to it, entry iff it is unrelated to some possible exit
+	std::vector<uint64_t> row(entryWords), canBeEntry(entryWords, 0);
+	std::vector<bool> canBeExit(size, false);
+	uint64_t lastMask = size % 64 ? ((uint64_t)1 << (size % 64)) - 1 : ~(uint64_t)0;
 	for(size_t i = 0; i < size; ++i)
 		if(exitPossible[i])
 		{
-			// for each possible exit, obtain route
-			std::set<std::string> exitRoute = tracert(consensus.getRelay(i).getAddress(), recipientIP);
-			for(size_t j = 0; j < size; ++j)
-				if(!ASrelations[i][j])
-				{
-					// for each possible entry (for exit specified), obtain route
-					std::set<std::string> entryRoute = tracert(senderIP, consensus.getRelay(j).getAddress());
-					
-					// intersect both routes
-					std::vector<std::string> intersection (entryRoute.size() + exitRoute.size());
-					auto end = std::set_intersection(entryRoute.begin(), entryRoute.end(), exitRoute.begin(), exitRoute.end(), intersection.begin());
-					
-					if(end != intersection.begin()) // if routes intersection is not empty
-						ASrelations[i][j] = true;					
-					else
-						canBeExit[i] = canBeEntry[j] = true; // entry and exit allowed
-				}
+			relatedRow(Relation::EXIT_ENTRY, i, size, row.data());
+			row[entryWords - 1] |= ~lastMask;
+			for(size_t w = 0; w < entryWords; ++w)
+			{
+				if(~row[w])
+					canBeExit[i] = true;
+				canBeEntry[w] |= ~row[w];
+			}
 		}
 	
 	// reassign possibilities
 	for(size_t i = 0; i < size; ++i)
 	{
 		exitPossible[i] = exitPossible[i] & canBeExit[i];
-		entryPossible[i] = entryPossible[i] & canBeEntry[i];
+		entryPossible[i] = entryPossible[i] & (bool)((canBeEntry[i / 64] >> (i % 64)) & 1);
 	}
 }
-
-std::set<std::string> ASRelations::tracert(const IP& startIP, const IP& endIP)
-{
-	std::set<std::string> route;
-	return route;
-}
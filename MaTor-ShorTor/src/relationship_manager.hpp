@@ -6,11 +6,13 @@
 #include <vector>
 #include <set>
 #include <memory>
+#include <cstdint>
 
 #include "ip.hpp"
 #include "consensus.hpp"
+#include "asmap.hpp"
 
-#include "types/symmetric_matrix.hpp"
+#include "types/packed_symmetric_matrix.hpp"
 
 /**
  * Virtual utility class for managing relay's relationships in Path Selection algorithm.
@@ -20,6 +22,16 @@
 class RelationshipManager
 {
 	public:
+		/**
+		 * Kinds of relations between positions in a circuit.
+		 */
+		enum class Relation
+		{
+			EXIT_ENTRY, /**< @see exitEntryRelated() */
+			EXIT_MIDDLE, /**< @see exitMiddleRelated() */
+			ENTRY_MIDDLE /**< @see entryMiddleRelated() */
+		};
+		
 		/**
 		 * Assigns additional constraints to relations and modifies relays' possibilities.
 		 * By default, it does nothing.
@@ -46,6 +58,24 @@ class RelationshipManager
 		 * @return true iff there is a relation between entry and middle relay.
 		 */
 		virtual bool entryMiddleRelated(size_t entryPosition, size_t middlePosition) = 0;
+		
+		/**
+		 * Writes all relations of a relay as a bitset, bit j is set iff the relay is related to relay j.
+		 * By default, relations are queried relay by relay.
+		 * @param relation kind of relation, the relay takes the first position of it.
+		 * @param position relay index in consensus.
+		 * @param size number of relays in consensus.
+		 * @param row PackedSymmetricMatrix<bool>::wordsFor(size) words to be written.
+		 */
+		virtual void relatedRow(Relation relation, size_t position, size_t size, uint64_t* row);
+		
+		/**
+		 * @param relation kind of relation.
+		 * @param first relay index in consensus (at the first position of the relation).
+		 * @param second relay index in consensus (at the second position of the relation).
+		 * @return true iff the relays are in the relation.
+		 */
+		bool related(Relation relation, size_t first, size_t second);
 };
 
 /**
@@ -73,6 +103,12 @@ class ConsensusRelations : public RelationshipManager
 		{
 			return consensus.isRelated(entryPosition, middlePosition);
 		}
+		virtual void relatedRow(Relation relation, size_t position, size_t size, uint64_t* row)
+		{
+			std::fill(row, row + PackedSymmetricMatrix<bool>::wordsFor(size), 0);
+			for(const uint32_t* member = consensus.familyBegin(position); member != consensus.familyEnd(position); ++member)
+				row[*member / 64] |= (uint64_t)1 << (*member % 64);
+		}
 		
 	protected:
 		const Consensus& consensus; /**< Referecnce to consensus instance. */
@@ -81,32 +117,45 @@ class ConsensusRelations : public RelationshipManager
 /**
  * Computes relations based on consensus families and relays' subnets.
  * (two relays from the same subnet are regarded as related).
+ * Relays are grouped by subnet prefix once per consensus (in its RelayTable), so relations take no memory
+ * of their own and are shared by all path selections (and MATor instances) using the consensus.
  */
 class SubnetRelations : public RelationshipManager
 {
 	public:
 		/**
 		 * Constructor saves consensus which will be used for relationship computations.
-		 * Relationship is initialized.
 		 * @param consensus Consensus instance
 		 */
-		SubnetRelations(const Consensus& consensus);
+		SubnetRelations(const Consensus& consensus) : consensus(consensus), table(consensus.getRelayTable()) { }
 		
 		virtual bool exitEntryRelated(size_t exitPosition, size_t entryPosition)
 		{
-			return relations[exitPosition][entryPosition];
+			return related(exitPosition, entryPosition);
 		}
 		virtual bool exitMiddleRelated(size_t exitPosition, size_t middlePosition)
 		{
-			return relations[exitPosition][middlePosition];
+			return related(exitPosition, middlePosition);
 		}
 		virtual bool entryMiddleRelated(size_t entryPosition, size_t middlePosition)
 		{
-			return relations[entryPosition][middlePosition];
+			return related(entryPosition, middlePosition);
 		}
+		virtual void relatedRow(Relation relation, size_t position, size_t size, uint64_t* row);
 	protected:
+		/**
+		 * @param relay1 position of a relay in consensus.
+		 * @param relay2 position of another relay in consensus.
+		 * @return true iff relays are in the same subnet or in the same family.
+		 */
+		bool related(size_t relay1, size_t relay2)
+		{
+			return table.getSubnetID(relay1) == table.getSubnetID(relay2) || consensus.isRelated(relay1, relay2);
+		}
+		using RelationshipManager::related;
+		
 		const Consensus& consensus; /**< Referecnce to consensus instance. */
-		SymmetricMatrix<bool> relations; /**< Precomputed relations matrix. */
+		const RelayTable& table; /**< Relay table of the consensus (with relays grouped by subnets). */
 };
 
 /**
@@ -114,42 +163,65 @@ class SubnetRelations : public RelationshipManager
  * Computed relations are not necesarilly symmetric.
  * Only exit and entry relations are affected by autonomous systems,
  * other relations are standard subnet relations.
- * Relays are AS related, if paths sender-entry and exit-recipient cross at least one same AS. 
+ * Relays are AS related, if paths sender-entry and exit-recipient cross at least one same AS.
+ * Paths are taken from an AS map (as bitsets over its AS IDs), without it no relays are AS related.
+ * @see ASMap
  */
 class ASRelations : public SubnetRelations
 {
 	public:
 		/**
-		 * Initializes variables. Standard subnet relations are computed.
+		 * Initializes variables. Routes of relays are obtained from AS map.
 		 * @param consensus consensus instance
 		 * @param senderIP IP adress of a sender in a circuit.
 		 * @param recipientIP recipient IP address in a circuit.
+		 * @param asmap AS paths between relays and endpoints, ignored if it was built for another consensus.
 		 */
-		ASRelations(const Consensus& consensus, const IP& senderIP, const IP& recipientIP);
+		ASRelations(const Consensus& consensus, const IP& senderIP, const IP& recipientIP, std::shared_ptr<ASMap> asmap = nullptr);
 		
 		virtual void assignConstraints(std::vector<bool>& exitPossible, std::vector<bool>& entryPossible);
 		
 		virtual bool exitEntryRelated(size_t exitPosition, size_t entryPosition)
 		{
-			return ASrelations[exitPosition][entryPosition];
+			return related(exitPosition, entryPosition) || routesCross(exitPosition, entryPosition);
 		}
+		virtual void relatedRow(Relation relation, size_t position, size_t size, uint64_t* row);
+		
+		/**
+		 * @return true iff relations use AS paths (otherwise they are equal to subnet relations).
+		 */
+		bool hasRoutes() const { return routeWords > 0; }
 	
 	private:
-		std::vector<std::vector<bool>> ASrelations; /**< AS relations matrix. */
-		std::vector<bool> canBeExit; /**< Can relay be an exit node? */
-		std::vector<bool> canBeEntry; /**< Can relay be an entry node? */
+		size_t routeWords; /**< Number of words of every route bitset (0 without AS paths). */
+		size_t entryWords; /**< Number of words of every entry bitset. */
+		std::vector<uint64_t> exitRoutes; /**< [exit] bitsets of ASes crossed between exit and recipient. */
+		std::vector<uint64_t> entryRoutes; /**< [entry] bitsets of ASes crossed between sender and entry. */
+		std::vector<uint64_t> crossingEntries; /**< [AS] bitsets of entries which routes from sender cross the AS. */
 		
 		const IP& senderIP; /**< Sender's IP address. */
 		const IP& recipientIP; /**< Recipient's IP address. */
 		
 		/**
-		 * Symmulates route between two IP addresses in a network.
-		 * // TODO: since we have no nice way of achieving this goal at the moment, this function returns empty set.
-		 * @param startIP start IP address
-		 * @param endIP end IP address
-		 * @return set of AS names crossed in a route.
+		 * Computes routes of all relays (once per relay) from AS map.
+		 * @param asmap AS paths between relays and endpoints (possibly null).
+		 */
+		void initialize(std::shared_ptr<ASMap> asmap);
+		
+		/**
+		 * @param exitPosition exit relay index in consensus
+		 * @param entryPosition entry relay index in consensus
+		 * @return true iff routes exit-recipient and sender-entry cross the same AS.
 		 */
-		std::set<std::string> tracert(const IP& startIP, const IP& endIP);
+		bool routesCross(size_t exitPosition, size_t entryPosition) const
+		{
+			const uint64_t* exitRoute = &exitRoutes[exitPosition * routeWords];
+			const uint64_t* entryRoute = &entryRoutes[entryPosition * routeWords];
+			for(size_t w = 0; w < routeWords; ++w)
+				if(exitRoute[w] & entryRoute[w])
+					return true;
+			return false;
+		}
 };
 
 /**
@@ -174,11 +246,20 @@ class CombinedRelations : public RelationshipManager
 		}
 		virtual bool exitMiddleRelated(size_t exitPosition, size_t middlePosition)
 		{
-			return r1->exitEntryRelated(exitPosition, middlePosition) || r2->exitEntryRelated(exitPosition, middlePosition);
+			return r1->exitMiddleRelated(exitPosition, middlePosition) || r2->exitMiddleRelated(exitPosition, middlePosition);
 		}
 		virtual bool entryMiddleRelated(size_t entryPosition, size_t middlePosition)
 		{
-			return r1->exitEntryRelated(entryPosition, middlePosition) || r2->exitEntryRelated(entryPosition, middlePosition);
+			return r1->entryMiddleRelated(entryPosition, middlePosition) || r2->entryMiddleRelated(entryPosition, middlePosition);
+		}
+		virtual void relatedRow(Relation relation, size_t position, size_t size, uint64_t* row)
+		{
+			// union of both rows, word by word
+			std::vector<uint64_t> other(PackedSymmetricMatrix<bool>::wordsFor(size));
+			r1->relatedRow(relation, position, size, row);
+			r2->relatedRow(relation, position, size, other.data());
+			for(size_t w = 0; w < other.size(); ++w)
+				row[w] |= other[w];
 		}
 };
 
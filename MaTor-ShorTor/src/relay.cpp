@@ -7,15 +7,37 @@ Relay::Relay(size_t reg, const std::string& name, const std::string& fingerprint
 	bool isValid, bool isStable, bool isRunning, int bandwidth,
 	const std::string& version) 
 		: name(name), fingerprint(fingerprint), publishedDate(publishedDate),
-		ipAddress(stringIPAddress), version(version), bandwidth(bandwidth), registeredAt(reg)
+		ipAddress(stringIPAddress), version(version), descriptor(emptyDescriptor()), bandwidth(bandwidth), registeredAt(reg)
 {
 	flags = (isGuard ? RelayFlag::GUARD : 0) | (isExit ? RelayFlag::EXIT : 0) | (isBadExit ? RelayFlag::BAD_EXIT : 0)
 		| (isFast ? RelayFlag::FAST : 0) | (isValid ? RelayFlag::VALID : 0) | (isStable ? RelayFlag::STABLE : 0)
 		| (isRunning ? RelayFlag::RUNNING : 0);
 }
 
+const std::shared_ptr<const Relay::Descriptor>& Relay::emptyDescriptor()
+{
+	static const std::shared_ptr<const Descriptor> empty = std::make_shared<Descriptor>();
+	return empty;
+}
+
+const std::shared_ptr<const std::vector<Relay::PolicyDescriptor>>& Relay::emptyPolicy()
+{
+	static const std::shared_ptr<const std::vector<PolicyDescriptor>> empty = std::make_shared<std::vector<PolicyDescriptor>>();
+	return empty;
+}
+
 void Relay::addPolicy(const std::string& entry)
 {
+	std::vector<PolicyDescriptor> parsed = parsePolicy(entry);
+	Descriptor& d = editDescriptor();
+	auto policy = std::make_shared<std::vector<PolicyDescriptor>>(*d.policy);
+	policy->insert(policy->end(), parsed.begin(), parsed.end());
+	d.policy = policy;
+}
+
+std::vector<Relay::PolicyDescriptor> Relay::parsePolicy(const std::string& entry)
+{
+	std::vector<PolicyDescriptor> policy;
 	std::vector<std::string> policies = split(entry, '\n');
 	for(std::string line : policies)
 	{
@@ -54,11 +76,12 @@ void Relay::addPolicy(const std::string& entry)
 		clogvn(from << " - " << to << " IP " << (accept ? "accept " : "reject") << " policy with address " << addr);
 		policy.push_back(PolicyDescriptor(accept, IP(addr), from, to));
 	}
+	return policy;
 }
 
 bool Relay::supportsConnection(const IP& ip, uint16_t port) const
 {
-	for(auto entry : policy)
+	for(const auto& entry : *descriptor->policy)
 	{
 		if(entry.address == ip)
 		{
@@ -79,8 +79,8 @@ class Relay : public std::enable_shared_from_this<Relay>
 			const std::string& publishedDate, const std::string& stringIPAddress,
 			int flags, int bandwidth, const std::string& version)
 			: name(name), fingerprint(fingerprint), publishedDate(publishedDate),
-			ipAddress(stringIPAddress), version(version), bandwidth(bandwidth),
-			flags(flags), registeredAt(reg) { }
+			ipAddress(stringIPAddress), version(version), descriptor(emptyDescriptor()),
+			bandwidth(bandwidth), flags(flags), registeredAt(reg) { }
 
 		// subclasses
 		/**
@@ -103,6 +103,29 @@ class Relay : public std::enable_shared_from_this<Relay>
 			PolicyDescriptor(bool isAccept, IP address, int portBegin, int portEnd)
 				: isAccept(isAccept), address(address), portBegin(portBegin), portEnd(portEnd) { };
 		};
+
+		/**
+		 * Relay information obtained from server descriptors and GeoIP data (database).
+		 * Descriptors are immutable once shared: relays of different consensuses referring
+		 * to the same server descriptor hold the same instance.
+		 * @see ConsensusSeries
+		 */
+		struct Descriptor
+		{
+			int averagedBandwidth = 0; /**< Relay's averaged observed bandwidth. */
+			float latitude = 0; /**< Relay's IP latitude in degrees. */
+			float longitude = 0; /**< Relay's IP longitude in degrees. */
+			std::string country; /**< The country relay's IP address is located in. */
+			std::string ASNumber; /**< Relay's IP Autonomous System Number. */
+			std::string ASName; /**< Relay's IP Autonomous System Name. */
+			std::string platform; /**< The name of the relay's platform. */
+			std::shared_ptr<const std::vector<PolicyDescriptor>> policy; /**< Relay's policy entries (possibly shared by many descriptors). */
+
+			/**
+			 * Creates descriptor with empty policy.
+			 */
+			Descriptor() : policy(emptyPolicy()) { }
+		};
 		
 		//getters
 		/**
@@ -137,7 +160,7 @@ class Relay : public std::enable_shared_from_this<Relay>
 		/**
 		 * @return vector of parsed policy entries.
 		 */
-		const std::vector<PolicyDescriptor>& getPolicy() const { return policy; }
+		const std::vector<PolicyDescriptor>& getPolicy() const { return *descriptor->policy; }
 		/**
 		 * @return Tor version used by the relay.
 		 */
@@ -149,31 +172,35 @@ class Relay : public std::enable_shared_from_this<Relay>
 		/**
 		 * @return relay's averaged observed bandwidth (B/s).
 		 */
-		int getAveragedBandwidth() const { return averagedBandwidth; }
+		int getAveragedBandwidth() const { return descriptor->averagedBandwidth; }
 		/**
 		 * @ return the country relay's IP address is located in.
 		 */
-		const std::string& getCountry() const { return country; }
+		const std::string& getCountry() const { return descriptor->country; }
 		/**
 		 * @return relay's IP Autonomous System Number.
 		 */
-		const std::string& getASNumber() const { return ASNumber; }
+		const std::string& getASNumber() const { return descriptor->ASNumber; }
 		/**
 		 * @return relay's IP Autonomous System Name.
 		 */
-		const std::string& getASName() const { return ASName; }
+		const std::string& getASName() const { return descriptor->ASName; }
 		/**
 		 * @return relay's platform name.
 		 */
-		const std::string& getPlatform() const { return platform; }
+		const std::string& getPlatform() const { return descriptor->platform; }
 		/**
 		 * @return relay's IP latitude in degrees.
 		 */
-		float getLatitude() const { return latitude; }
+		float getLatitude() const { return descriptor->latitude; }
 		/**
 		 * @return relay's IP longitude in degrees.
 		 */
-		float getLongitude() const { return longitude; }
+		float getLongitude() const { return descriptor->longitude; }
+		/**
+		 * @return descriptor information shared with other relays referring to the same server descriptor.
+		 */
+		const std::shared_ptr<const Descriptor>& getDescriptor() const { return descriptor; }
 		
 		//setters
 		/**
@@ -203,7 +230,7 @@ class Relay : public std::enable_shared_from_this<Relay>
 		/**
 		 * @param bandwidth relay's averaged observed bandwidth
 		 */
-		void setAveragedBandwidth(int bandwidth) { this->averagedBandwidth = bandwidth; }
+		void setAveragedBandwidth(int bandwidth) { editDescriptor().averagedBandwidth = bandwidth; }
 		/**
 		 * Setting flags to 0.
 		 */
@@ -256,27 +283,32 @@ class Relay : public std::enable_shared_from_this<Relay>
 		/**
 		 * @param country the country relay's IP address is located in.
 		 */
-		void setCountry(const std::string& country) { this->country = country; }
+		void setCountry(const std::string& country) { editDescriptor().country = country; }
 		/**
 		 * @param ASNumber relay's IP Autonomous System Number.
 		 */
-		void setASNumber(const std::string& ASNumber) { this->ASNumber = ASNumber; }
+		void setASNumber(const std::string& ASNumber) { editDescriptor().ASNumber = ASNumber; }
 		/**
 		 * @param ASName relay's IP Autonomous System Name.
 		 */
-		void setASName(const std::string& ASName) { this->ASName = ASName; }
+		void setASName(const std::string& ASName) { editDescriptor().ASName = ASName; }
 		/**
 		 * @param platform Relay's platform.
 		 */
-		void setPlatform(const std::string& platform) { this->platform = platform; }
+		void setPlatform(const std::string& platform) { editDescriptor().platform = platform; }
 		/**
 		 * @param latitude relay's IP latitude in degrees.
 		 */
-		void setLatitude(float latitude) { this->latitude = latitude; }
+		void setLatitude(float latitude) { editDescriptor().latitude = latitude; }
 		/**
 		 * @param longitude relay's IP longitude in degrees.
 		 */
-		void setLongitude(float longitude) { this->longitude = longitude; }		
+		void setLongitude(float longitude) { editDescriptor().longitude = longitude; }
+		/**
+		 * Replaces descriptor information with (possibly shared) descriptor.
+		 * @param descriptor new descriptor, must not be null.
+		 */
+		void setDescriptor(const std::shared_ptr<const Descriptor>& descriptor) { this->descriptor = descriptor; }
 		
 		// functions
 		/**
@@ -297,6 +329,13 @@ class Relay : public std::enable_shared_from_this<Relay>
 		 * @return true, if policy allows for communication with IP address, false otherwise.
 		 */
 		bool supportsConnection(const IP& ip, uint16_t port) const;
+
+		/**
+		 * Parses policy entries separated by new lines.
+		 * @param entry policy entries to be parsed.
+		 * @return vector of parsed entries.
+		 */
+		static std::vector<PolicyDescriptor> parsePolicy(const std::string& entry);
 		
 		/**
 		 * @return relay's position in consensus. 
@@ -309,19 +348,33 @@ class Relay : public std::enable_shared_from_this<Relay>
 		IP ipAddress; /**< Relay's IP address. */
 		std::string publishedDate; /**< Date of publishing descriptors referenced by consensus in YYYY-MM-DD hh:mm:ss format. */
 		std::string fingerprint; /**< Relay's fingerprint in hexadecimal string format without leading 0x. */
-		std::vector<PolicyDescriptor> policy; /**< Vector of relay's policy entries. */
 		std::string version; /**< Version Tor version used by the relay. */	
-		std::string country; /**< The country relay's IP address is located in. */
-		std::string ASNumber; /**< Relay's IP Autonomous System Number. */
-		std::string ASName; /**< Relay's IP Autonomous System Name. */
-		std::string platform; /**< The name of the relay's platform. */
+		std::shared_ptr<const Descriptor> descriptor; /**< Server descriptor and GeoIP information, copied on write. */
 		int bandwidth; /**< Relay's bandwidth assigned in consensus file. */
-		int averagedBandwidth = 0; /**< Relay's averaged observed bandwidth. */
 		int flags; /**< Node's flags set, @see hasFlag(). */
-		float latitude; /**< Relay's IP latitude in degrees. */
-		float longitude; /**< Relay's IP longitude in degrees. */
 		size_t registeredAt; /**< Position in relays vector in consensus. */ // for O(1) access
 
+		// functions
+		/**
+		 * @return descriptor owned exclusively by this relay (copied first if it is shared).
+		 */
+		Descriptor& editDescriptor()
+		{
+			if(descriptor.use_count() != 1)
+				descriptor = std::make_shared<Descriptor>(*descriptor);
+			return const_cast<Descriptor&>(*descriptor); // never shared at this point
+		}
+
+		/**
+		 * @return shared descriptor without any information (used by freshly parsed relays).
+		 */
+		static const std::shared_ptr<const Descriptor>& emptyDescriptor();
+
+		/**
+		 * @return shared empty policy.
+		 */
+		static const std::shared_ptr<const std::vector<PolicyDescriptor>>& emptyPolicy();
+
 #ifdef USE_PYTHON
 		friend class PythonBinder;
 #endif
@@ -0,0 +1,291 @@
+#include "relay_metadata.hpp"
+#include "types/mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	const char MAGIC[8] = { 'M', 'A', 'T', 'O', 'R', 'M', 'E', 'T' }; /**< Sidecar file signature. */
+	const uint32_t VERSION = 1; /**< Sidecar format version. */
+
+	/**
+	 * Sidecar header, followed by sections in the order of the counts.
+	 */
+	struct Header
+	{
+		char magic[8]; /**< File signature. */
+		uint32_t version; /**< Format version. */
+		uint32_t relays; /**< Number of relays. */
+		uint64_t consensusHash; /**< @copydoc RelayMetadataFile::Key::consensusHash */
+		uint64_t databaseSize; /**< @copydoc RelayMetadataFile::Key::databaseSize */
+		int64_t databaseTime; /**< @copydoc RelayMetadataFile::Key::databaseTime */
+		uint32_t descriptors; /**< Number of distinct descriptors. */
+		uint32_t policies; /**< Number of distinct policies. */
+		uint32_t policyEntries; /**< Number of entries of all policies. */
+		uint32_t strings; /**< Number of distinct strings. */
+		uint64_t stringBytes; /**< Length of all strings. */
+		uint64_t familyMembers; /**< Number of family members of all relays. */
+	};
+	static_assert(sizeof(Header) == 72, "sidecar header must not be padded");
+
+	/**
+	 * Stored descriptor, strings and policy are referred by their indexes.
+	 */
+	struct StoredDescriptor
+	{
+		int32_t averagedBandwidth;
+		float latitude;
+		float longitude;
+		uint32_t country;
+		uint32_t ASNumber;
+		uint32_t ASName;
+		uint32_t platform;
+		uint32_t policy;
+	};
+
+	/**
+	 * Stored policy entry.
+	 */
+	struct StoredPolicyEntry
+	{
+		uint32_t address;
+		uint32_t mask;
+		uint16_t portBegin;
+		uint16_t portEnd;
+		uint32_t isAccept;
+	};
+
+	/**
+	 * Updates 64-bit FNV-1a hash with bytes.
+	 */
+	inline uint64_t fnv1a(uint64_t hash, const void* data, size_t length)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for(size_t i = 0; i < length; ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	/**
+	 * @return true iff offsets start at 0, do not decrease and end at total.
+	 */
+	bool validOffsets(const uint32_t* offsets, size_t count, uint64_t total)
+	{
+		return offsets[0] == 0 && offsets[count] == total && std::is_sorted(offsets, offsets + count + 1);
+	}
+
+	/**
+	 * Writes vector's elements to stream.
+	 */
+	template <typename T>
+	void write(std::ofstream& file, const std::vector<T>& data)
+	{
+		file.write((const char*)data.data(), data.size() * sizeof(T));
+	}
+}
+
+RelayMetadataFile::Key RelayMetadataFile::makeKey(const FingerprintIndex& fingerprints, const std::string& validAfter, const std::string& DBFileName)
+{
+	Key key = { 14695981039346656037ull, 0, 0 };
+	key.consensusHash = fnv1a(key.consensusHash, validAfter.data(), validAfter.size());
+	for(size_t i = 0; i < fingerprints.size(); ++i)
+		key.consensusHash = fnv1a(key.consensusHash, fingerprints.getDigest(i).data(), sizeof(FingerprintIndex::digest_t));
+
+	struct stat st;
+	if(stat(DBFileName.c_str(), &st) == 0)
+	{
+		key.databaseSize = (uint64_t)st.st_size;
+		key.databaseTime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	}
+	return key;
+}
+
+bool RelayMetadataFile::save(const std::string& fileName, const Key& key, const std::vector<Relay>& relays,
+	const std::vector<std::vector<uint32_t>>& families)
+{
+	std::vector<uint32_t> relayDescriptors(relays.size());
+	std::vector<StoredDescriptor> descriptors;
+	std::vector<uint32_t> policyOffsets(1, 0);
+	std::vector<StoredPolicyEntry> policyEntries;
+	std::vector<uint32_t> stringOffsets(1, 0);
+	std::string stringData;
+
+	std::unordered_map<std::string, uint32_t> stringIds;
+	auto intern = [&](const std::string& text) {
+		auto inserted = stringIds.emplace(text, (uint32_t)stringIds.size());
+		if(inserted.second)
+		{
+			stringData += text;
+			stringOffsets.push_back((uint32_t)stringData.size());
+		}
+		return inserted.first->second;
+	};
+
+	// descriptors and policies are shared by pointer
+	std::unordered_map<const Relay::Descriptor*, uint32_t> descriptorIds;
+	std::unordered_map<const std::vector<Relay::PolicyDescriptor>*, uint32_t> policyIds;
+	for(size_t i = 0; i < relays.size(); ++i)
+	{
+		const Relay::Descriptor& descriptor = *relays[i].getDescriptor();
+		auto inserted = descriptorIds.emplace(&descriptor, (uint32_t)descriptors.size());
+		relayDescriptors[i] = inserted.first->second;
+		if(!inserted.second)
+			continue;
+
+		auto policy = policyIds.emplace(descriptor.policy.get(), (uint32_t)policyIds.size());
+		if(policy.second)
+		{
+			for(const auto& entry : *descriptor.policy)
+				policyEntries.push_back(StoredPolicyEntry{ entry.address.address, entry.address.mask, entry.portBegin, entry.portEnd, entry.isAccept });
+			policyOffsets.push_back((uint32_t)policyEntries.size());
+		}
+		descriptors.push_back(StoredDescriptor{ descriptor.averagedBandwidth, descriptor.latitude, descriptor.longitude,
+			intern(descriptor.country), intern(descriptor.ASNumber), intern(descriptor.ASName), intern(descriptor.platform), policy.first->second });
+	}
+
+	std::vector<uint32_t> familyOffsets(1, 0);
+	std::vector<uint32_t> familyMembers;
+	for(const auto& family : families)
+	{
+		familyMembers.insert(familyMembers.end(), family.begin(), family.end());
+		familyOffsets.push_back((uint32_t)familyMembers.size());
+	}
+
+	const uint64_t limit = std::numeric_limits<uint32_t>::max();
+	if(families.size() != relays.size() || relays.size() > limit || policyEntries.size() > limit || familyMembers.size() > limit || stringData.size() > limit)
+		return false;
+
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.relays = (uint32_t)relays.size();
+	header.consensusHash = key.consensusHash;
+	header.databaseSize = key.databaseSize;
+	header.databaseTime = key.databaseTime;
+	header.descriptors = (uint32_t)descriptors.size();
+	header.policies = (uint32_t)policyOffsets.size() - 1;
+	header.policyEntries = (uint32_t)policyEntries.size();
+	header.strings = (uint32_t)stringOffsets.size() - 1;
+	header.stringBytes = stringData.size();
+	header.familyMembers = familyMembers.size();
+
+	// written aside and renamed, processes loading the same consensus never see a partial file
+	std::string temporary = fileName + "." + std::to_string(getpid()) + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if(!file.is_open())
+			return false;
+		file.write((const char*)&header, sizeof(header));
+		write(file, relayDescriptors);
+		write(file, descriptors);
+		write(file, policyOffsets);
+		write(file, policyEntries);
+		write(file, familyOffsets);
+		write(file, familyMembers);
+		write(file, stringOffsets);
+		file.write(stringData.data(), stringData.size());
+		file.close();
+		if(!file.good())
+		{
+			std::remove(temporary.c_str());
+			return false;
+		}
+	}
+	if(std::rename(temporary.c_str(), fileName.c_str()) != 0)
+	{
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool RelayMetadataFile::load(const std::string& fileName, const Key& key, std::vector<Relay>& relays,
+	std::vector<std::vector<uint32_t>>& families)
+{
+	MappedFile file;
+	if(!file.open(fileName) || file.size() < sizeof(Header))
+		return false;
+
+	Header header;
+	memcpy(&header, file.data(), sizeof(header));
+	Key stored = { header.consensusHash, header.databaseSize, header.databaseTime };
+	if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.relays != relays.size() || !(stored == key))
+		return false;
+	if(header.stringBytes > file.size() || header.familyMembers > file.size())
+		return false;
+
+	// all sections are 4-byte aligned relative to the (page aligned) start of the file
+	size_t n = header.relays;
+	const char* data = file.data();
+	const uint32_t* relayDescriptors = (const uint32_t*)(data + sizeof(Header));
+	const StoredDescriptor* descriptors = (const StoredDescriptor*)(relayDescriptors + n);
+	const uint32_t* policyOffsets = (const uint32_t*)(descriptors + header.descriptors);
+	const StoredPolicyEntry* policyEntries = (const StoredPolicyEntry*)(policyOffsets + header.policies + 1);
+	const uint32_t* familyOffsets = (const uint32_t*)(policyEntries + header.policyEntries);
+	const uint32_t* familyMembers = familyOffsets + n + 1;
+	const uint32_t* stringOffsets = familyMembers + header.familyMembers;
+	const char* stringData = (const char*)(stringOffsets + header.strings + 1);
+	if(file.size() != (size_t)(stringData - data) + header.stringBytes)
+		return false;
+
+	if(!validOffsets(policyOffsets, header.policies, header.policyEntries) || !validOffsets(familyOffsets, n, header.familyMembers)
+		|| !validOffsets(stringOffsets, header.strings, header.stringBytes))
+		return false;
+	for(size_t i = 0; i < n; ++i)
+		if(relayDescriptors[i] >= header.descriptors)
+			return false;
+	for(uint64_t i = 0; i < header.familyMembers; ++i)
+		if(familyMembers[i] >= n)
+			return false;
+	for(size_t d = 0; d < header.descriptors; ++d)
+	{
+		const StoredDescriptor& descriptor = descriptors[d];
+		if(descriptor.policy >= header.policies || std::max({ descriptor.country, descriptor.ASNumber, descriptor.ASName, descriptor.platform }) >= header.strings)
+			return false;
+	}
+
+	std::vector<std::shared_ptr<const std::vector<Relay::PolicyDescriptor>>> policies(header.policies);
+	for(size_t p = 0; p < header.policies; ++p)
+	{
+		auto policy = std::make_shared<std::vector<Relay::PolicyDescriptor>>();
+		policy->reserve(policyOffsets[p + 1] - policyOffsets[p]);
+		for(uint32_t e = policyOffsets[p]; e < policyOffsets[p + 1]; ++e)
+			policy->push_back(Relay::PolicyDescriptor(policyEntries[e].isAccept != 0, IP(policyEntries[e].address, policyEntries[e].mask),
+				policyEntries[e].portBegin, policyEntries[e].portEnd));
+		policies[p] = policy;
+	}
+
+	auto text = [&](uint32_t id) {
+		return std::string(stringData + stringOffsets[id], stringOffsets[id + 1] - stringOffsets[id]);
+	};
+	std::vector<std::shared_ptr<const Relay::Descriptor>> shared(header.descriptors);
+	for(size_t d = 0; d < header.descriptors; ++d)
+	{
+		auto descriptor = std::make_shared<Relay::Descriptor>();
+		descriptor->averagedBandwidth = descriptors[d].averagedBandwidth;
+		descriptor->latitude = descriptors[d].latitude;
+		descriptor->longitude = descriptors[d].longitude;
+		descriptor->country = text(descriptors[d].country);
+		descriptor->ASNumber = text(descriptors[d].ASNumber);
+		descriptor->ASName = text(descriptors[d].ASName);
+		descriptor->platform = text(descriptors[d].platform);
+		descriptor->policy = policies[descriptors[d].policy];
+		shared[d] = descriptor;
+	}
+
+	for(size_t i = 0; i < n; ++i)
+		relays[i].setDescriptor(shared[relayDescriptors[i]]);
+	families.assign(n, std::vector<uint32_t>());
+	for(size_t i = 0; i < n; ++i)
+		families[i].assign(familyMembers + familyOffsets[i], familyMembers + familyOffsets[i + 1]);
+	return true;
+}
@@ -0,0 +1,79 @@
+#ifndef RELAY_METADATA_HPP
+#define RELAY_METADATA_HPP
+
+/** @file */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "relay.hpp"
+#include "fingerprint_index.hpp"
+
+/**
+ * Binary sidecar holding relays' database information (descriptors with policies and families) of a consensus.
+ * The sidecar is written next to the consensus after the database has been queried once,
+ * later loads read it from a single mapping instead of querying the database.
+ * It is keyed by a hash of the consensus relays and date and by identity of the database file,
+ * so it becomes stale when either of them changes.
+ * Descriptors and policies shared by several relays are stored once, strings are stored in a deduplicated table.
+ */
+class RelayMetadataFile
+{
+	public:
+		/**
+		 * Identity of data stored in the sidecar.
+		 */
+		struct Key
+		{
+			uint64_t consensusHash; /**< Hash of consensus date and relays' fingerprints (in order). */
+			uint64_t databaseSize; /**< Size of the database file in bytes. */
+			int64_t databaseTime; /**< Modification time of the database file in nanoseconds. */
+
+			bool operator==(const Key& other) const
+			{
+				return consensusHash == other.consensusHash && databaseSize == other.databaseSize && databaseTime == other.databaseTime;
+			}
+		};
+
+		// functions
+		/**
+		 * Computes key of consensus data.
+		 * @param fingerprints fingerprints of consensus relays.
+		 * @param validAfter consensus date in YYYY-MM-DD hh:mm:ss format.
+		 * @param DBFileName name of .sqlite database file.
+		 * @return key of the sidecar.
+		 */
+		static Key makeKey(const FingerprintIndex& fingerprints, const std::string& validAfter, const std::string& DBFileName);
+
+		/**
+		 * @param consensusFileName name of consensus file.
+		 * @return name of the sidecar of the consensus.
+		 */
+		static std::string sidecarName(const std::string& consensusFileName) { return consensusFileName + ".meta"; }
+
+		/**
+		 * Writes the sidecar (through a temporary file, so concurrent readers never see it half written).
+		 * @param fileName name of the sidecar.
+		 * @param key key of the data.
+		 * @param relays consensus relays with descriptors.
+		 * @param families sorted family members of every relay.
+		 * @return true iff the sidecar was written.
+		 */
+		static bool save(const std::string& fileName, const Key& key, const std::vector<Relay>& relays,
+			const std::vector<std::vector<uint32_t>>& families);
+
+		/**
+		 * Reads the sidecar if it exists, is valid and matches the key.
+		 * Relays and families are modified only if the whole sidecar is valid.
+		 * @param fileName name of the sidecar.
+		 * @param key expected key.
+		 * @param relays consensus relays, their descriptors are replaced.
+		 * @param families family members of every relay, replaced.
+		 * @return true iff the sidecar was read.
+		 */
+		static bool load(const std::string& fileName, const Key& key, std::vector<Relay>& relays,
+			std::vector<std::vector<uint32_t>>& families);
+};
+
+#endif
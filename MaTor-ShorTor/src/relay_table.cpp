@@ -0,0 +1,109 @@
+#include "relay_table.hpp"
+
+#include <unordered_map>
+
+constexpr RelayTable::id_t RelayTable::NOT_FOUND;
+
+namespace
+{
+	RelayTable::id_t intern(const std::string& value, std::unordered_map<std::string, RelayTable::id_t>& ids, std::vector<std::string>& values)
+	{
+		auto inserted = ids.emplace(value, (RelayTable::id_t)values.size());
+		if(inserted.second)
+			values.push_back(value);
+		return inserted.first->second;
+	}
+
+	/**
+	 * @return key identifying policy entries (equal iff the entries are equal).
+	 */
+	std::string policyKey(const std::vector<Relay::PolicyDescriptor>& policy)
+	{
+		std::string key;
+		key.reserve(policy.size() * 13);
+		for(const auto& entry : policy)
+		{
+			uint32_t fields[3] = { entry.address.address, entry.address.mask, ((uint32_t)entry.portBegin << 16) | entry.portEnd };
+			key.append((const char*)fields, sizeof(fields));
+			key.push_back(entry.isAccept ? 1 : 0);
+		}
+		return key;
+	}
+
+	RelayTable::id_t find(const std::string& value, const std::vector<std::string>& values)
+	{
+		for(size_t i = 0; i < values.size(); ++i)
+			if(values[i] == value)
+				return (RelayTable::id_t)i;
+		return RelayTable::NOT_FOUND;
+	}
+}
+
+RelayTable::RelayTable(const std::vector<Relay>& relays)
+{
+	size_t size = relays.size();
+	flags.resize(size);
+	bandwidth.resize(size);
+	averagedBandwidth.resize(size);
+	address.resize(size);
+	prefix.resize(size);
+	latitude.resize(size);
+	longitude.resize(size);
+	countryID.resize(size);
+	ASID.resize(size);
+	policyID.resize(size);
+	subnetID.resize(size);
+
+	std::unordered_map<std::string, id_t> countryIDs;
+	std::unordered_map<std::string, id_t> ASIDs;
+	// policies are usually shared already, equal policies parsed separately are merged by content
+	std::unordered_map<const std::vector<Relay::PolicyDescriptor>*, id_t> policyIDs;
+	std::unordered_map<std::string, id_t> policyKeyIDs;
+	std::unordered_map<uint32_t, id_t> subnetIDs;
+	for(size_t i = 0; i < size; ++i)
+	{
+		const Relay& relay = relays[i];
+		flags[i] = relay.getFlags();
+		bandwidth[i] = relay.getBandwidth();
+		averagedBandwidth[i] = relay.getAveragedBandwidth();
+		address[i] = relay.getAddress().address;
+		prefix[i] = relay.getAddress().getPrefix();
+		subnetID[i] = subnetIDs.emplace(prefix[i], (id_t)subnetIDs.size()).first->second;
+		latitude[i] = relay.getLatitude();
+		longitude[i] = relay.getLongitude();
+		countryID[i] = intern(relay.getCountry(), countryIDs, countries);
+		ASID[i] = intern(relay.getASNumber(), ASIDs, ASNumbers);
+
+		const std::vector<Relay::PolicyDescriptor>& policy = relay.getPolicy();
+		auto shared = policyIDs.find(&policy);
+		if(shared == policyIDs.end())
+		{
+			auto inserted = policyKeyIDs.emplace(policyKey(policy), (id_t)policies.size());
+			if(inserted.second)
+				policies.push_back(std::make_shared<const ExitPolicy>(policy));
+			shared = policyIDs.emplace(&policy, inserted.first->second).first;
+		}
+		policyID[i] = shared->second;
+	}
+
+	// members of subnets by counting sort, positions stay ascending
+	subnetOffsets.assign(subnetIDs.size() + 1, 0);
+	for(size_t i = 0; i < size; ++i)
+		++subnetOffsets[subnetID[i] + 1];
+	for(size_t s = 0; s < subnetIDs.size(); ++s)
+		subnetOffsets[s + 1] += subnetOffsets[s];
+	subnetMembers.resize(size);
+	std::vector<uint32_t> next(subnetOffsets.begin(), subnetOffsets.end() - 1);
+	for(size_t i = 0; i < size; ++i)
+		subnetMembers[next[subnetID[i]]++] = (uint32_t)i;
+}
+
+RelayTable::id_t RelayTable::findCountryID(const std::string& country) const
+{
+	return find(country, countries);
+}
+
+RelayTable::id_t RelayTable::findASID(const std::string& ASNumber) const
+{
+	return find(ASNumber, ASNumbers);
+}
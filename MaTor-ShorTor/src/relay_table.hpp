@@ -0,0 +1,220 @@
+#ifndef RELAY_TABLE_HPP
+#define RELAY_TABLE_HPP
+
+/** @file */
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+
+#include "relay.hpp"
+#include "exit_policy.hpp"
+
+/**
+ * Read-only columnar (structure of arrays) view of consensus relays.
+ * Keeps fields used in hot loops in contiguous arrays, so that iterating over
+ * all relays does not drag whole Relay objects (with their strings and policies) through cache.
+ * Countries and Autonomous Systems are interned: relays share an identifier iff they share the value.
+ * Exit policies are interned (relays with identical entries share one) and compiled, see ExitPolicy.
+ * Subnet prefixes are interned as well and members of every subnet are listed, see SubnetRelations.
+ * @see Consensus::getRelayTable()
+ */
+class RelayTable
+{
+	public:
+		typedef uint32_t id_t; /**< Identifier of an interned value. */
+
+		// constructors
+		/**
+		 * Creates empty table.
+		 */
+		RelayTable() { }
+
+		/**
+		 * Builds table from relays vector.
+		 * @param relays relays in consensus order.
+		 */
+		RelayTable(const std::vector<Relay>& relays);
+
+		// functions
+		/**
+		 * @return number of relays in the table.
+		 */
+		size_t size() const { return flags.size(); }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return relay's flags set.
+		 */
+		int getFlags(size_t relay) const { return flags[relay]; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @param testFlags tested set of flags.
+		 * @return true iff relay has all specified flags.
+		 */
+		bool hasFlags(size_t relay, int testFlags) const { return (flags[relay] & testFlags) == testFlags; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return relay's bandwidth assigned in consensus file.
+		 */
+		int getBandwidth(size_t relay) const { return bandwidth[relay]; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return relay's averaged observed bandwidth.
+		 */
+		int getAveragedBandwidth(size_t relay) const { return averagedBandwidth[relay]; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return relay's IPv4 address.
+		 */
+		uint32_t getAddress(size_t relay) const { return address[relay]; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return relay's IPv4 subnet prefix (address & mask), @see IP::getPrefix().
+		 */
+		uint32_t getPrefix(size_t relay) const { return prefix[relay]; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return interned identifier of relay's subnet prefix.
+		 */
+		id_t getSubnetID(size_t relay) const { return subnetID[relay]; }
+
+		/**
+		 * @param id identifier of subnet prefix.
+		 * @return pointer to the first of ascending positions of relays in the subnet.
+		 */
+		const uint32_t* subnetBegin(id_t id) const { return subnetMembers.data() + subnetOffsets[id]; }
+
+		/**
+		 * @param id identifier of subnet prefix.
+		 * @return pointer after the last position of relays in the subnet.
+		 */
+		const uint32_t* subnetEnd(id_t id) const { return subnetMembers.data() + subnetOffsets[id + 1]; }
+
+		/**
+		 * @return number of distinct subnet prefixes.
+		 */
+		size_t subnetsCount() const { return subnetOffsets.empty() ? 0 : subnetOffsets.size() - 1; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return relay's IP latitude in degrees.
+		 */
+		float getLatitude(size_t relay) const { return latitude[relay]; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return relay's IP longitude in degrees.
+		 */
+		float getLongitude(size_t relay) const { return longitude[relay]; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return interned identifier of relay's country.
+		 */
+		id_t getCountryID(size_t relay) const { return countryID[relay]; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return interned identifier of relay's Autonomous System Number.
+		 */
+		id_t getASID(size_t relay) const { return ASID[relay]; }
+
+		/**
+		 * @param relay relay's position in consensus.
+		 * @return interned identifier of relay's exit policy.
+		 */
+		id_t getPolicyID(size_t relay) const { return policyID[relay]; }
+
+		/**
+		 * @param id identifier of exit policy.
+		 * @return compiled exit policy.
+		 */
+		const ExitPolicy& getPolicy(id_t id) const { return *policies[id]; }
+
+		/**
+		 * @return number of distinct exit policies.
+		 */
+		size_t policiesCount() const { return policies.size(); }
+
+		/**
+		 * @param country country code.
+		 * @return identifier of the country or NOT_FOUND, if no relay is located in the country.
+		 */
+		id_t findCountryID(const std::string& country) const;
+
+		/**
+		 * @param ASNumber Autonomous System Number (with leading "AS").
+		 * @return identifier of the Autonomous System or NOT_FOUND, if no relay is located in the Autonomous System.
+		 */
+		id_t findASID(const std::string& ASNumber) const;
+
+		/**
+		 * @return interned country codes indexed by identifiers.
+		 */
+		const std::vector<std::string>& getCountries() const { return countries; }
+
+		/**
+		 * @return interned Autonomous System Numbers indexed by identifiers.
+		 */
+		const std::vector<std::string>& getASNumbers() const { return ASNumbers; }
+
+		/**
+		 * Updates flags column (used when relay's flags are forced).
+		 * @param relay relay's position in consensus.
+		 * @param newFlags new flags set.
+		 */
+		void setFlags(size_t relay, int newFlags) { flags[relay] = newFlags; }
+
+		// raw columns for vectorizable loops
+		const int* flagsData() const { return flags.data(); }
+		const int* bandwidthData() const { return bandwidth.data(); }
+		const uint32_t* prefixData() const { return prefix.data(); }
+
+		/**
+		 * @return approximate number of bytes used by the table.
+		 */
+		size_t memoryUsage() const
+		{
+			size_t bytes = flags.capacity() * (sizeof(int) * 3 + sizeof(uint32_t) * 2 + sizeof(float) * 2 + sizeof(id_t) * 2);
+			for(const std::string& country : countries)
+				bytes += sizeof(std::string) + country.capacity();
+			for(const std::string& ASNumber : ASNumbers)
+				bytes += sizeof(std::string) + ASNumber.capacity();
+			bytes += policyID.capacity() * sizeof(id_t) + subnetID.capacity() * sizeof(id_t);
+			bytes += (subnetOffsets.capacity() + subnetMembers.capacity()) * sizeof(uint32_t);
+			for(const auto& policy : policies)
+				bytes += policy->memoryUsage();
+			return bytes;
+		}
+
+		static constexpr id_t NOT_FOUND = (id_t)-1; /**< Identifier returned for values not present in the table. */
+
+	private:
+		// variables
+		std::vector<int> flags; /**< Relays' flags sets. */
+		std::vector<int> bandwidth; /**< Relays' consensus bandwidths. */
+		std::vector<int> averagedBandwidth; /**< Relays' averaged observed bandwidths. */
+		std::vector<uint32_t> address; /**< Relays' IPv4 addresses. */
+		std::vector<uint32_t> prefix; /**< Relays' IPv4 subnet prefixes. */
+		std::vector<float> latitude; /**< Relays' latitudes. */
+		std::vector<float> longitude; /**< Relays' longitudes. */
+		std::vector<id_t> countryID; /**< Relays' interned countries. */
+		std::vector<id_t> ASID; /**< Relays' interned Autonomous Systems. */
+		std::vector<id_t> policyID; /**< Relays' interned exit policies. */
+		std::vector<id_t> subnetID; /**< Relays' interned subnet prefixes. */
+		std::vector<uint32_t> subnetOffsets; /**< Start of every subnet's members (and their total count at the end). */
+		std::vector<uint32_t> subnetMembers; /**< Positions of relays grouped by subnet. */
+		std::vector<std::string> countries; /**< Interned countries. */
+		std::vector<std::string> ASNumbers; /**< Interned Autonomous System Numbers. */
+		std::vector<std::shared_ptr<const ExitPolicy>> policies; /**< Interned compiled exit policies. */
+};
+
+#endif
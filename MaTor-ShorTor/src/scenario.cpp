@@ -4,59 +4,192 @@
 #include "ps_lastor.hpp"
 #include "ps_uniform.hpp"
 #include "ps_selektor.hpp"
+#include "ps_latency.hpp"
 #include "relationship_manager.hpp"
 
+#include <sstream>
+
+bool Scenario::isASAware(PathSelectionType type)
+{
+	switch(type)
+	{
+		case PS_AS_TOR:
+		case PS_AS_DISTRIBUTOR:
+		case PS_AS_LASTOR:
+		case PS_AS_UNIFORM:
+		case PS_AS_SELEKTOR:
+		case PS_AS_LATENCY:
+			return true;
+		default:
+			return false;
+	}
+}
+
+std::string Scenario::getKey(
+	std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec,
+	std::shared_ptr<RecipientSpec> recipientSpec)
+{
+	std::ostringstream key;
+	key.precision(17);
+	key << pathSelectionSpec->getKey() << "|" << (std::string)senderSpec->address << "|" << senderSpec->latitude << "|" << senderSpec->longitude
+		<< "|" << (std::string)recipientSpec->address << "|" << recipientSpec->latitude << "|" << recipientSpec->longitude << "|";
+	for(uint16_t port : recipientSpec->ports)
+		key << port << ",";
+	return key.str();
+}
+
+std::shared_ptr<RelationshipManager> Scenario::makeRelations(
+	std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec,
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	const Consensus& consensus,
+	std::shared_ptr<ASMap> asmap)
+{
+	if(isASAware(pathSelectionSpec->getType()))
+		return std::make_shared<ASRelations>(consensus, senderSpec->address, recipientSpec->address, asmap);
+	else
+		return std::make_shared<SubnetRelations>(consensus);
+}
+
 std::shared_ptr<PathSelection> Scenario::makePathSelection(
 	std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
 	std::shared_ptr<SenderSpec> senderSpec,
 	std::shared_ptr<RecipientSpec> recipientSpec,
-	const Consensus& consensus)
+	const Consensus& consensus,
+	std::shared_ptr<ASMap> asmap)
+{
+	return makeFromRelations(pathSelectionSpec, senderSpec, recipientSpec, consensus,
+		makeRelations(pathSelectionSpec, senderSpec, recipientSpec, consensus, asmap));
+}
+
+std::shared_ptr<PathSelection> Scenario::makeFromRelations(
+	std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec,
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	const Consensus& consensus,
+	std::shared_ptr<RelationshipManager> relationship)
 {
-	std::shared_ptr<RelationshipManager> relationship;
-	
 	switch((*pathSelectionSpec).getType())
 	{
 		case PS_TOR:
-			relationship = std::make_shared<SubnetRelations>(consensus);
 			return std::make_shared<PSTor>(std::dynamic_pointer_cast<PSTorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 		
 		case PS_DISTRIBUTOR:
-			relationship = std::make_shared<SubnetRelations>(consensus);
 			return std::make_shared<PSDistribuTor>(std::dynamic_pointer_cast<PSDistribuTorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 		
 		case PS_LASTOR:
-			relationship = std::make_shared<SubnetRelations>(consensus);
 			return std::make_shared<PSLASTor>(std::dynamic_pointer_cast<PSLASTorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 
 		case PS_UNIFORM:
-			relationship = std::make_shared<SubnetRelations>(consensus);
 			return std::make_shared<PSUniform>(std::dynamic_pointer_cast<PSUniformSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 
 		case PS_SELEKTOR:
-			relationship = std::make_shared<SubnetRelations>(consensus);
 			return std::make_shared<PSSelektor>(std::dynamic_pointer_cast<PSSelektorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 
+		case PS_LATENCY:
+			return std::make_shared<PSLatency>(std::dynamic_pointer_cast<PSLatencySpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
+
 		case PS_AS_TOR:
-			relationship = std::make_shared<ASRelations>(consensus, senderSpec->address, recipientSpec->address);
 			return std::make_shared<PSTor>( std::dynamic_pointer_cast<PSTorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 		
 		case PS_AS_DISTRIBUTOR:
-			relationship = std::make_shared<ASRelations>(consensus, senderSpec->address, recipientSpec->address);
 			return std::make_shared<PSDistribuTor>(std::dynamic_pointer_cast<PSDistribuTorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 		
 		case PS_AS_LASTOR:
-			relationship = std::make_shared<ASRelations>(consensus, senderSpec->address, recipientSpec->address);
 			return std::make_shared<PSLASTor>(std::dynamic_pointer_cast<PSLASTorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 
 		case PS_AS_UNIFORM:
-			relationship = std::make_shared<ASRelations>(consensus, senderSpec->address, recipientSpec->address);
 			return std::make_shared<PSUniform>(std::dynamic_pointer_cast<PSUniformSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 
 		case PS_AS_SELEKTOR:
-			relationship = std::make_shared<ASRelations>(consensus, senderSpec->address, recipientSpec->address);
 			return std::make_shared<PSSelektor>(std::dynamic_pointer_cast<PSSelektorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
 
+		case PS_AS_LATENCY:
+			return std::make_shared<PSLatency>(std::dynamic_pointer_cast<PSLatencySpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus);
+
 		default:
 			return NULL;
 	}
 }
+
+std::shared_ptr<PathSelection> Scenario::makeFromRelations(
+	std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec,
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	const Consensus& consensus,
+	std::shared_ptr<RelationshipManager> relationship,
+	const std::string& snapshotDirectory)
+{
+	std::shared_ptr<ASRelations> asRelations = std::dynamic_pointer_cast<ASRelations>(relationship);
+	if(snapshotDirectory.empty() || (asRelations && asRelations->hasRoutes()))
+		return makeFromRelations(pathSelectionSpec, senderSpec, recipientSpec, consensus, relationship);
+	
+	PathSelectionType type = pathSelectionSpec->getType();
+	PathSelectionSnapshot::Key key = PathSelectionSnapshot::makeKey(consensus, getKey(pathSelectionSpec, senderSpec, recipientSpec));
+	std::string fileName = PathSelectionSnapshot::fileName(snapshotDirectory, key);
+	
+	PathSelectionSnapshot snapshot;
+	if(snapshot.load(fileName, key, type))
+	{
+		try
+		{
+			std::shared_ptr<PathSelection> restored = restoreFromSnapshot(pathSelectionSpec, senderSpec, recipientSpec, consensus, relationship, snapshot);
+			clogsn("Path selection restored from " << fileName);
+			return restored;
+		}
+		catch(snapshot_exception& e)
+		{
+			clogsn("Snapshot " << fileName << " is not valid, computing path selection.");
+		}
+	}
+	
+	std::shared_ptr<PathSelection> pathSelection = makeFromRelations(pathSelectionSpec, senderSpec, recipientSpec, consensus, relationship);
+	if(pathSelection != nullptr)
+	{
+		PathSelectionSnapshot computed;
+		pathSelection->saveState(computed);
+		if(!computed.save(fileName, key, type))
+			clogsn("Path selection could not be saved to " << fileName);
+	}
+	return pathSelection;
+}
+
+std::shared_ptr<PathSelection> Scenario::restoreFromSnapshot(
+	std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+	std::shared_ptr<SenderSpec> senderSpec,
+	std::shared_ptr<RecipientSpec> recipientSpec,
+	const Consensus& consensus,
+	std::shared_ptr<RelationshipManager> relationship,
+	PathSelectionSnapshot& snapshot)
+{
+	switch(pathSelectionSpec->getType())
+	{
+		case PS_TOR:
+		case PS_AS_TOR:
+			return std::make_shared<PSTor>(std::dynamic_pointer_cast<PSTorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus, snapshot);
+		
+		case PS_DISTRIBUTOR:
+		case PS_AS_DISTRIBUTOR:
+			return std::make_shared<PSDistribuTor>(std::dynamic_pointer_cast<PSDistribuTorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus, snapshot);
+		
+		case PS_LASTOR:
+		case PS_AS_LASTOR:
+			return std::make_shared<PSLASTor>(std::dynamic_pointer_cast<PSLASTorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus, snapshot);
+		
+		case PS_UNIFORM:
+		case PS_AS_UNIFORM:
+			return std::make_shared<PSUniform>(std::dynamic_pointer_cast<PSUniformSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus, snapshot);
+		
+		case PS_SELEKTOR:
+		case PS_AS_SELEKTOR:
+			return std::make_shared<PSSelektor>(std::dynamic_pointer_cast<PSSelektorSpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus, snapshot);
+		
+		case PS_LATENCY:
+		case PS_AS_LATENCY:
+			return std::make_shared<PSLatency>(std::dynamic_pointer_cast<PSLatencySpec>(pathSelectionSpec), senderSpec, recipientSpec, relationship, consensus, snapshot);
+		
+		default:
+			throw_exception(snapshot_exception, snapshot_exception::INVALID_STATE);
+	}
+}
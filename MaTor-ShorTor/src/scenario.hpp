@@ -11,6 +11,8 @@
 #include "path_selection.hpp"
 #include "consensus.hpp"
 
+class ASMap;
+
 /**
  * Factory for classes inheriting from PathSelection.
  * @see PathSelection
@@ -25,12 +27,83 @@ class Scenario
 		 * @param senderSpec description of a sender (client) connecting to recipient in this scenario.
 		 * @param recipientSpec description of a recipient (server) which sender connects to in this scenario.
 		 * @param consensus consensus for Path Selection instance.
+		 * @param asmap AS paths used by path selections taking Autonomous Systems into account (optional).
 		 */
 		static std::shared_ptr<PathSelection> makePathSelection(
 			std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
 			std::shared_ptr<SenderSpec> senderSpec,
 			std::shared_ptr<RecipientSpec> recipientSpec,
-			const Consensus& consensus);
+			const Consensus& consensus,
+			std::shared_ptr<ASMap> asmap = nullptr);
+		
+		/**
+		 * @param type type of a path selection.
+		 * @return true iff path selection takes Autonomous Systems into account.
+		 */
+		static bool isASAware(PathSelectionType type);
+		
+		/**
+		 * @param pathSelectionSpec description of a path selection.
+		 * @param senderSpec description of a sender.
+		 * @param recipientSpec description of a recipient.
+		 * @return text describing the scenario, path selections of scenarios with equal keys are identical.
+		 */
+		static std::string getKey(
+			std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+			std::shared_ptr<SenderSpec> senderSpec,
+			std::shared_ptr<RecipientSpec> recipientSpec);
+		
+		/**
+		 * Creates relations used by path selection from specification given.
+		 * Relations of path selections not taking Autonomous Systems into account depend only on consensus,
+		 * so they may be shared by such path selections.
+		 * @see makePathSelection()
+		 */
+		static std::shared_ptr<RelationshipManager> makeRelations(
+			std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+			std::shared_ptr<SenderSpec> senderSpec,
+			std::shared_ptr<RecipientSpec> recipientSpec,
+			const Consensus& consensus,
+			std::shared_ptr<ASMap> asmap = nullptr);
+		
+		/**
+		 * Creates path selection of the specified type with given relations.
+		 */
+		static std::shared_ptr<PathSelection> makeFromRelations(
+			std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+			std::shared_ptr<SenderSpec> senderSpec,
+			std::shared_ptr<RecipientSpec> recipientSpec,
+			const Consensus& consensus,
+			std::shared_ptr<RelationshipManager> relationship);
+		
+		/**
+		 * Creates path selection of the specified type with given relations,
+		 * restoring it from a snapshot in the directory if there is one for the consensus and the scenario.
+		 * Computed path selections are saved to the directory, so that other runs may restore them.
+		 * Path selections with relations based on AS paths are always computed (the AS map is not a part of the snapshot key).
+		 * @param snapshotDirectory directory of snapshots (if empty, path selection is always computed).
+		 * @see PathSelectionSnapshot
+		 */
+		static std::shared_ptr<PathSelection> makeFromRelations(
+			std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+			std::shared_ptr<SenderSpec> senderSpec,
+			std::shared_ptr<RecipientSpec> recipientSpec,
+			const Consensus& consensus,
+			std::shared_ptr<RelationshipManager> relationship,
+			const std::string& snapshotDirectory);
+	
+	private:
+		/**
+		 * Creates path selection of the specified type from its snapshot.
+		 * @throws snapshot_exception if the snapshot does not contain state of the path selection.
+		 */
+		static std::shared_ptr<PathSelection> restoreFromSnapshot(
+			std::shared_ptr<PathSelectionSpec> pathSelectionSpec,
+			std::shared_ptr<SenderSpec> senderSpec,
+			std::shared_ptr<RecipientSpec> recipientSpec,
+			const Consensus& consensus,
+			std::shared_ptr<RelationshipManager> relationship,
+			PathSelectionSnapshot& snapshot);
 };
 
 #endif
@@ -17,14 +17,123 @@ probability_t TorLike::entryProb(size_t entry, size_t exit) const
 probability_t TorLike::middleProb(size_t middle, size_t entry, size_t exit) const
 {
 	if (consensus.useVias() && middlePossibleBecauseVia[middle])
-		return middleWeights[middle] * middleSumRelatedInv[entry][exit];
+		return middleWeights[middle] * middleSumRelatedInv.get(entry, exit);
 
 	if(middleWeights[middle] > 0 && middleEntryExitAllowed(middle, entry, exit))
-		return middleWeights[middle] * middleSumRelatedInv[entry][exit];
+		return middleWeights[middle] * middleSumRelatedInv.get(entry, exit);
 	
 	return 0;
 }
 
+void TorLike::probabilityBounds(probability_t* entryBounds, probability_t* middleBounds, unsigned threads) const
+{
+	// probabilities are weights times normalizers of the exit (entries) or of the entry and exit (middles),
+	// so the bound of a relay is its weight times the greatest normalizer of possible exits (and their entries)
+	size_t size = consensus.getSize();
+	size_t words = PackedSymmetricMatrix<bool>::wordsFor(size);
+	std::vector<weight_t> middleMaxima(size, 0);
+	WorkManager::runAll(threads, size, [&](size_t exit) {
+		if(!(exitWeights[exit] > 0))
+			return;
+		thread_local std::vector<uint64_t> related;
+		related.resize(words);
+		relations->relatedRow(RelationshipManager::Relation::EXIT_ENTRY, exit, size, related.data());
+		weight_t maximum = 0;
+		for(size_t entry = 0; entry < size; ++entry)
+		{
+			bool allowed = !((related[entry / 64] >> (entry % 64)) & 1);
+			if(entry != exit && entryWeights[entry] > 0 && allowed)
+				maximum = std::max(maximum, middleSumRelatedInv.get(entry, exit));
+		}
+		middleMaxima[exit] = maximum;
+	});
+
+	weight_t entryNormalizer = 0, middleNormalizer = 0;
+	for(size_t exit = 0; exit < size; ++exit)
+	{
+		if(exitWeights[exit] > 0)
+			entryNormalizer = std::max(entryNormalizer, entrySumRelatedInv[exit]);
+		middleNormalizer = std::max(middleNormalizer, middleMaxima[exit]);
+	}
+	for(size_t i = 0; i < size; ++i)
+	{
+		entryBounds[i] = entryWeights[i] * entryNormalizer;
+		middleBounds[i] = middleWeights[i] * middleNormalizer;
+	}
+}
+
+void TorLike::saveState(PathSelectionSnapshot& snapshot) const
+{
+	PathSelectionStandard::saveState(snapshot);
+	snapshot.put(exitSumInv);
+	snapshot.put(entrySumRelatedInv);
+	snapshot.put(exitWeights);
+	snapshot.put(entryWeights);
+	snapshot.put(middleWeights);
+	snapshot.put((uint64_t)middleSumRelatedInv.dataSize());
+	snapshot.put(middleSumRelatedInv.data(), middleSumRelatedInv.dataSize());
+}
+
+bool TorLike::loadState(PathSelectionSnapshot& snapshot)
+{
+	size_t size = consensus.getSize();
+	uint64_t cells;
+	return PathSelectionStandard::loadState(snapshot) && snapshot.get(exitSumInv) &&
+		snapshot.get(entrySumRelatedInv) && entrySumRelatedInv.size() == size &&
+		snapshot.get(exitWeights) && exitWeights.size() == size &&
+		snapshot.get(entryWeights) && entryWeights.size() == size &&
+		snapshot.get(middleWeights) && middleWeights.size() == size &&
+		snapshot.get(cells) && cells == middleSumRelatedInv.dataSize() &&
+		snapshot.get(middleSumRelatedInv.data(), middleSumRelatedInv.dataSize());
+}
+
+void TorLike::exitProbRow(probability_t* probs) const
+{
+	size_t size = consensus.getSize();
+	for(size_t i = 0; i < size; ++i)
+		probs[i] = exitWeights[i] * exitSumInv;
+}
+
+void TorLike::entryProbRow(size_t exit, probability_t* probs) const
+{
+	// weight * normalizer of the exit, except for relatives of the exit
+	size_t size = consensus.getSize();
+	thread_local std::vector<uint64_t> related;
+	related.resize(PackedSymmetricMatrix<bool>::wordsFor(size));
+	relations->relatedRow(RelationshipManager::Relation::EXIT_ENTRY, exit, size, related.data());
+	weight_t normalizer = entrySumRelatedInv[exit];
+	for(size_t i = 0; i < size; ++i)
+	{
+		bool allowed = !((related[i / 64] >> (i % 64)) & 1);
+		probs[i] = (entryWeights[i] > 0 && allowed) ? entryWeights[i] * normalizer : 0;
+	}
+}
+
+void TorLike::middleProbRow(size_t entry, size_t exit, probability_t* probs) const
+{
+	// weight * inverse sum of the pair, except for relatives of the entry or the exit (unless relay is a via)
+	size_t size = consensus.getSize();
+	size_t words = PackedSymmetricMatrix<bool>::wordsFor(size);
+	thread_local std::vector<uint64_t> related, exitRelated;
+	related.resize(words);
+	exitRelated.resize(words);
+	relations->relatedRow(RelationshipManager::Relation::ENTRY_MIDDLE, entry, size, related.data());
+	relations->relatedRow(RelationshipManager::Relation::EXIT_MIDDLE, exit, size, exitRelated.data());
+	for(size_t w = 0; w < words; ++w)
+		related[w] |= exitRelated[w];
+	
+	weight_t pairInv = middleSumRelatedInv.get(entry, exit);
+	bool vias = consensus.useVias();
+	for(size_t i = 0; i < size; ++i)
+	{
+		bool allowed = !((related[i / 64] >> (i % 64)) & 1);
+		if((vias && middlePossibleBecauseVia[i]) || (middleWeights[i] > 0 && allowed))
+			probs[i] = middleWeights[i] * pairInv;
+		else
+			probs[i] = 0;
+	}
+}
+
 weight_t TorLike::getExitWeight(const Relay& relay) const
 {
 	int index = relay.position();
@@ -56,34 +165,47 @@ weight_t TorLike::getMiddleWeight(const Relay& relay) const
 }
 
 void TorLike::assignRelatedWeightChunk(size_t start, size_t stop, weight_t entryWeightSum, weight_t middleWeightSum, 
-	std::vector<std::set<size_t>> exitEntryRelatives, std::vector<std::set<size_t>> exitMiddleRelatives, std::vector<std::set<size_t>> entryMiddleRelatives)
+	const Relatives& exitEntryRelatives, const Relatives& exitMiddleRelatives, const Relatives& entryMiddleRelatives)
 {
 	size_t size = consensus.getSize();
 	for(size_t ex = start; ex < stop; ++ex) // for all relays in the interval
 	{
 		weight_t relatedEntryWeight = 0;
-		weight_t relatedMiddleWeight = 0;
 		
 		// sum up exit-entry-related relays entry weights
-		for(size_t relative : exitEntryRelatives[ex])
-			relatedEntryWeight += entryWeights[relative];
+		for(const uint32_t* relative = exitEntryRelatives.begin(ex); relative != exitEntryRelatives.end(ex); ++relative)
+			relatedEntryWeight += entryWeights[*relative];
 		
 		entrySumRelatedInv[ex] = (weight_t)1 / (entryWeightSum - relatedEntryWeight);
 		
 		// computing middle related weights
+		const uint32_t* exitBegin = exitMiddleRelatives.begin(ex);
+		const uint32_t* exitEnd = exitMiddleRelatives.end(ex);
+		weight_t* middleRow = middleSumRelatedInv.row(ex);
 		for(size_t en = ex + 1; en < size; ++en) // ex != en and edgemap properties
 		{
-			relatedMiddleWeight = 0;
-			
-			// extract two relay's relatives without duplicating entries in case of common relatives
-			std::vector<size_t> pairRelatives(exitMiddleRelatives[ex].size() + entryMiddleRelatives[en].size());
-			auto end = std::set_union(exitMiddleRelatives[ex].begin(), exitMiddleRelatives[ex].end(),
-				entryMiddleRelatives[en].begin(), entryMiddleRelatives[en].end(), pairRelatives.begin());
-			pairRelatives.resize(end - pairRelatives.begin());
-			for(size_t r : pairRelatives)
-				relatedMiddleWeight += middleWeights[r];
+			// merging two relay's sorted relatives, common relatives are counted once (in the same order as their union)
+			weight_t relatedMiddleWeight = 0;
+			const uint32_t* a = exitBegin;
+			const uint32_t* b = entryMiddleRelatives.begin(en);
+			const uint32_t* bEnd = entryMiddleRelatives.end(en);
+			while(a != exitEnd && b != bEnd)
+			{
+				if(*b < *a)
+					relatedMiddleWeight += middleWeights[*b++];
+				else
+				{
+					if(*a == *b)
+						++b;
+					relatedMiddleWeight += middleWeights[*a++];
+				}
+			}
+			for(; a != exitEnd; ++a)
+				relatedMiddleWeight += middleWeights[*a];
+			for(; b != bEnd; ++b)
+				relatedMiddleWeight += middleWeights[*b];
 			
-			middleSumRelatedInv[ex][en] = (weight_t)1 / (middleWeightSum - relatedMiddleWeight);
+			middleRow[en] = (weight_t)1 / (middleWeightSum - relatedMiddleWeight);
 		}
 	}
 }
@@ -91,27 +213,51 @@ void TorLike::assignRelatedWeightChunk(size_t start, size_t stop, weight_t entry
 void TorLike::assignRelatedWeight(weight_t entryWeightSum, weight_t middleWeightSum)
 {
 	size_t size = consensus.getSize();
-	std::vector<std::set<size_t>> exitEntryRelatives(size);
-	std::vector<std::set<size_t>> exitMiddleRelatives(size);
-	std::vector<std::set<size_t>> entryMiddleRelatives(size);
-	
-	for(size_t i = 0; i < size; ++i)
-		for(size_t j = 0; j < size; ++j)
+	WorkManager workManager;
+	unsigned threads = workManager.getHardwareConcurrency();
+
+	// only relays with non-zero entry (middle) weight are added
+	typedef PackedSymmetricMatrix<bool> BitMatrix;
+	size_t words = BitMatrix::wordsFor(size);
+	std::vector<uint64_t> entryMask(words, 0), middleMask(words, 0);
+	for(size_t j = 0; j < size; ++j)
+	{
+		if(entryWeights[j] > 0)
+			entryMask[j / 64] |= (uint64_t)1 << (j % 64);
+		if(middleWeights[j] > 0)
+			middleMask[j / 64] |= (uint64_t)1 << (j % 64);
+	}
+
+	// relatives found in parallel from relation bitsets, then packed into shared rows
+	std::vector<std::vector<uint32_t>> exitEntryRows(size), exitMiddleRows(size), entryMiddleRows(size);
+	WorkManager::runAll(threads, size, [&](size_t i) {
+		std::vector<uint64_t> row(words);
+		auto collect = [&](RelationshipManager::Relation relation, const std::vector<uint64_t>& mask, std::vector<uint32_t>& relatives) {
+			relations->relatedRow(relation, i, size, row.data());
+			BitMatrix::forEachBit(row.data(), mask.data(), words, [&](size_t j) { relatives.push_back((uint32_t)j); });
+		};
+		collect(RelationshipManager::Relation::EXIT_ENTRY, entryMask, exitEntryRows[i]);
+		collect(RelationshipManager::Relation::EXIT_MIDDLE, middleMask, exitMiddleRows[i]);
+		collect(RelationshipManager::Relation::ENTRY_MIDDLE, middleMask, entryMiddleRows[i]);
+	});
+	auto pack = [size](std::vector<std::vector<uint32_t>>& rows) {
+		Relatives relatives;
+		relatives.offsets.assign(size + 1, 0);
+		for(size_t i = 0; i < size; ++i)
+			relatives.offsets[i + 1] = relatives.offsets[i] + rows[i].size();
+		relatives.members.reserve(relatives.offsets[size]);
+		for(auto& row : rows)
 		{
-			if(entryWeights[j] > 0) // add relays with non-zero entry weight
-				if(relations->exitEntryRelated(i, j))
-					exitEntryRelatives[i].insert(j);
-			if(middleWeights[j] > 0) // add relays with non-zero middle weight
-			{
-				if(relations->exitMiddleRelated(i, j))
-					exitMiddleRelatives[i].insert(j);
-				if(relations->entryMiddleRelated(i, j))
-					entryMiddleRelatives[i].insert(j);
-			}
+			relatives.members.insert(relatives.members.end(), row.begin(), row.end());
+			std::vector<uint32_t>().swap(row);
 		}
+		return relatives;
+	};
+	const Relatives exitEntryRelatives = pack(exitEntryRows);
+	const Relatives exitMiddleRelatives = pack(exitMiddleRows);
+	const Relatives entryMiddleRelatives = pack(entryMiddleRows);
 	
-	WorkManager workManager;
-	size_t chunkSize = (size / workManager.getHardwareConcurrency()) / 2 + 1;
+	size_t chunkSize = (size / threads) / 2 + 1;
 	for(size_t i = 0; i < size; i += chunkSize)
 	{
 		workManager.addTask([&,i]() { this->assignRelatedWeightChunk(i, ((i + chunkSize < size) ? (i + chunkSize) : size),
@@ -13,7 +13,7 @@
 #include "recipient_spec.hpp"
 #include "path_selection_spec.hpp"
 #include "utils.hpp"
-#include "types/symmetric_matrix.hpp"
+#include "types/packed_symmetric_matrix.hpp"
 #include "types/work_manager.hpp"
 
 /**
@@ -46,8 +46,18 @@ class TorLike : public PathSelectionStandard
 		virtual probability_t entryProb(size_t entry, size_t exit) const;
 		virtual probability_t middleProb(size_t middle, size_t entry, size_t exit) const;
 		
+		virtual void exitProbRow(probability_t* probs) const;
+		virtual void entryProbRow(size_t exit, probability_t* probs) const;
+		virtual void middleProbRow(size_t entry, size_t exit, probability_t* probs) const;
+		
+		virtual void probabilityBounds(probability_t* entryBounds, probability_t* middleBounds, unsigned threads) const;
+		
+		virtual void saveState(PathSelectionSnapshot& snapshot) const;
+		
 	protected:
 		// functions
+		virtual bool loadState(PathSelectionSnapshot& snapshot);
+		
 		/** 
 		 * Computes relay weight based on relay's flags for exit node role.
 		 * @param relay the relay which weight is computed
@@ -73,23 +83,36 @@ class TorLike : public PathSelectionStandard
 		 */
 		virtual void assignRelatedWeight(weight_t entryWeightSum, weight_t middleWeightSum);
 				
+		/**
+		 * Relatives of every relay as compressed sparse rows:
+		 * sorted relatives of relay i are members[offsets[i]], ..., members[offsets[i + 1] - 1].
+		 */
+		struct Relatives
+		{
+			std::vector<size_t> offsets; /**< Start of every relay's row, followed by the total count. */
+			std::vector<uint32_t> members; /**< Relatives of all relays. */
+
+			const uint32_t* begin(size_t relay) const { return members.data() + offsets[relay]; }
+			const uint32_t* end(size_t relay) const { return members.data() + offsets[relay + 1]; }
+		};
+
 		/**
 		 * Computes related weights(entry-, middle- related inverses) in chunks (to enable multithreaded computation).
 		 * @param start chunk start index
 		 * @param stop chunk end index
 		 * @param entryWeightSum sum of path selection entry weight
 		 * @param middleWeightSum sum of path selection middle weight
-		 * @param exitEntryRelatives sets of relatives indices in relation exit-entry
-		 * @param exitMiddleRelatives sets of relatives indices in relation exit-middle
-		 * @param entryMiddleRelatives sets of relatives indices in relation entry-middle
+		 * @param exitEntryRelatives relatives in relation exit-entry (with non-zero entry weight)
+		 * @param exitMiddleRelatives relatives in relation exit-middle (with non-zero middle weight)
+		 * @param entryMiddleRelatives relatives in relation entry-middle (with non-zero middle weight)
 		 */
 		virtual void assignRelatedWeightChunk(size_t start, size_t stop, weight_t entryWeightSum, weight_t middleWeightSum,
-			std::vector<std::set<size_t>> exitEntryRelatives, std::vector<std::set<size_t>> exitMiddleRelatives, std::vector<std::set<size_t>> entryMiddleRelatives);	
+			const Relatives& exitEntryRelatives, const Relatives& exitMiddleRelatives, const Relatives& entryMiddleRelatives);
 		
 		// variables 
 		weight_t exitSumInv; /**< 1 / Total sum of all relay's exit weight. */
 		std::vector<weight_t> entrySumRelatedInv; /**< 1 / (entry sum - related entry bandwidth) for a relay at corresponding position. */
-		SymmetricMatrix<weight_t> middleSumRelatedInv; /**< 1 / (middle sum - related middle bandwidth) for a pair [i][j] of relays' positions. */
+		PackedSymmetricMatrix<weight_t> middleSumRelatedInv; /**< 1 / (middle sum - related middle bandwidth) for a pair [i][j] of relays' positions. */
 		
 		std::vector<weight_t> exitWeights; /**< Exit weights of relays on positions corresponding to consensus positions. */
 		std::vector<weight_t> entryWeights; /**< Entry weights of relays on positions corresponding to consensus positions. */
@@ -0,0 +1,108 @@
+#ifndef ALIAS_TABLE_HPP
+#define ALIAS_TABLE_HPP
+
+/** @file */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Walker's alias table for sampling indices from a discrete distribution in constant time.
+ * Built in linear time by Vose's method: every slot keeps probability of its own index and an alias,
+ * which is taken otherwise.
+ */
+class AliasTable
+{
+	public:
+		// constructors
+		/**
+		 * Constructs empty table (with no index to sample).
+		 */
+		AliasTable() : sum(0) { }
+
+		/**
+		 * Builds the table from (not necessarily normalized) weights.
+		 * Negative and non-finite weights are taken as zero.
+		 * @param weights weights of indices.
+		 * @param count number of weights.
+		 */
+		AliasTable(const double* weights, size_t count) : sum(0)
+		{
+			for(size_t i = 0; i < count; ++i)
+				if(weights[i] > 0 && weights[i] <= 1e300)
+					sum += weights[i];
+			if(!(sum > 0))
+			{
+				sum = 0;
+				return;
+			}
+
+			// scaled weights: slots with less than average are filled by aliases of heavier slots
+			slots.resize(count);
+			std::vector<size_t> small, large;
+			std::vector<double> scaled(count);
+			for(size_t i = 0; i < count; ++i)
+			{
+				scaled[i] = (weights[i] > 0 && weights[i] <= 1e300) ? weights[i] * count / sum : 0;
+				(scaled[i] < 1 ? small : large).push_back(i);
+			}
+			while(!small.empty() && !large.empty())
+			{
+				size_t lighter = small.back(), heavier = large.back();
+				small.pop_back();
+				slots[lighter] = Slot{ scaled[lighter], (uint32_t)heavier };
+				scaled[heavier] -= 1 - scaled[lighter];
+				if(scaled[heavier] < 1)
+				{
+					large.pop_back();
+					small.push_back(heavier);
+				}
+			}
+			// remaining slots are (up to rounding) full
+			for(size_t i : large)
+				slots[i] = Slot{ 1, (uint32_t)i };
+			for(size_t i : small)
+				slots[i] = Slot{ 1, (uint32_t)i };
+		}
+
+		// functions
+		/**
+		 * Samples an index.
+		 * @param uniform random number uniformly distributed in [0, 1).
+		 * @return index with probability proportional to its weight.
+		 */
+		size_t sample(double uniform) const
+		{
+			double scaled = uniform * slots.size();
+			size_t slot = (size_t)scaled;
+			if(slot >= slots.size())
+				slot = slots.size() - 1;
+			return (scaled - slot < slots[slot].probability) ? slot : slots[slot].alias;
+		}
+
+		/**
+		 * @return true iff there is no index to sample (no positive weight).
+		 */
+		bool empty() const { return slots.empty(); }
+
+		/**
+		 * @return sum of the weights the table was built from.
+		 */
+		double total() const { return sum; }
+
+	private:
+		/**
+		 * Slot of the table.
+		 */
+		struct Slot
+		{
+			double probability; /**< Probability of the index of the slot (otherwise alias is taken). */
+			uint32_t alias; /**< Index taken with the remaining probability. */
+		};
+
+		std::vector<Slot> slots; /**< Slot of every index. */
+		double sum; /**< Sum of the weights. */
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& fileName)
+{
+	close();
+#ifdef _WIN32
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if(!file.is_open())
+		return false;
+	length = (size_t)file.tellg();
+	file.seekg(0);
+	char* buffer = length ? new char[length] : nullptr;
+	if(length && !file.read(buffer, length))
+	{
+		delete[] buffer;
+		length = 0;
+		return false;
+	}
+	ptr = buffer;
+#else
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		::close(fd);
+		return false;
+	}
+
+	length = (size_t)st.st_size;
+	if(length)
+	{
+		void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(mapping == MAP_FAILED)
+		{
+			::close(fd);
+			length = 0;
+			return false;
+		}
+		madvise(mapping, length, MADV_SEQUENTIAL);
+		ptr = (const char*)mapping;
+	}
+	::close(fd); // the mapping keeps its own reference to the file
+#endif
+	opened = true;
+	return true;
+}
+
+void MappedFile::adviseRandom()
+{
+#ifndef _WIN32
+	if(ptr)
+		madvise((void*)ptr, length, MADV_RANDOM);
+#endif
+}
+
+void MappedFile::close()
+{
+	if(ptr)
+	{
+#ifdef _WIN32
+		delete[] ptr;
+#else
+		munmap((void*)ptr, length);
+#endif
+	}
+	ptr = nullptr;
+	length = 0;
+	opened = false;
+}
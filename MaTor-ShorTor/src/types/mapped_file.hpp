@@ -0,0 +1,101 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+/** @file */
+
+#include <string>
+#include <cstddef>
+
+#include "string_ref.hpp"
+
+/**
+ * Read-only memory mapping of a whole file.
+ * The mapping is released when the object is destroyed.
+ * On platforms without mmap the file is read into a private buffer instead.
+ */
+class MappedFile
+{
+	public:
+		/**
+		 * Creates an empty (closed) mapping.
+		 */
+		MappedFile() : ptr(nullptr), length(0) { }
+
+		/**
+		 * Maps the whole file for reading.
+		 * @param fileName name of the file to be mapped.
+		 */
+		MappedFile(const std::string& fileName) : MappedFile() { open(fileName); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) : ptr(other.ptr), length(other.length), opened(other.opened)
+		{
+			other.ptr = nullptr;
+			other.length = 0;
+			other.opened = false;
+		}
+
+		MappedFile& operator=(MappedFile&& other)
+		{
+			if(this != &other)
+			{
+				close();
+				ptr = other.ptr;
+				length = other.length;
+				opened = other.opened;
+				other.ptr = nullptr;
+				other.length = 0;
+				other.opened = false;
+			}
+			return *this;
+		}
+
+		~MappedFile() { close(); }
+
+		/**
+		 * Maps the whole file for reading, releasing the previous mapping (if any).
+		 * @param fileName name of the file to be mapped.
+		 * @return true iff the file was mapped successfully.
+		 */
+		bool open(const std::string& fileName);
+
+		/**
+		 * Hints that the mapping will be accessed randomly rather than sequentially
+		 * (for files used in place rather than parsed).
+		 */
+		void adviseRandom();
+
+		/**
+		 * Releases the mapping.
+		 */
+		void close();
+
+		/**
+		 * @return true iff a file is currently mapped.
+		 */
+		bool is_open() const { return opened; }
+
+		/**
+		 * @return pointer to the first byte of the file (nullptr for empty files).
+		 */
+		const char* data() const { return ptr; }
+
+		/**
+		 * @return size of the mapped file in bytes.
+		 */
+		size_t size() const { return length; }
+
+		/**
+		 * @return view of the whole file content.
+		 */
+		string_ref view() const { return string_ref(ptr, length); }
+
+	private:
+		const char* ptr; /**< First byte of the mapping. */
+		size_t length; /**< Length of the mapping in bytes. */
+		bool opened = false; /**< Whether a file is mapped. */
+};
+
+#endif
@@ -0,0 +1,571 @@
+#ifndef PACKED_SYMMETRIC_MATRIX_HPP
+#define PACKED_SYMMETRIC_MATRIX_HPP
+
+/** @file */
+
+#include <vector>
+#include <bitset>
+#include <algorithm>
+#include <type_traits>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+
+#include "symmetric_matrix.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * Symmetric N x N matrix stored as a packed upper triangle in a single contiguous, cache line aligned block.
+ * Cells of row i (columns i..N-1, or i+1..N-1 without diagonal) are consecutive, so a row can be accessed
+ * through a plain pointer and cell [i][j] is found without branches as row(min(i, j))[max(i, j)].
+ * Unlike SymmetricMatrix, cells carry no defined flag: all of them are initialized with T(),
+ * definedness is tracked in a separate bitmap only if requested.
+ * Accesses through get() and operator[] are not checked, at() checks bounds and diagonal.
+ * @tparam T trivial cell type (bool is specialized as a bit matrix).
+ */
+template<typename T>
+class PackedSymmetricMatrix
+{
+	static_assert(std::is_trivial<T>::value, "packed symmetric matrix cells must be trivial");
+
+	public:
+		static const size_t ALIGNMENT = 64; /**< Alignment of the cells block (cache line). */
+
+		/**
+		 * Row accessor providing [i][j] syntax.
+		 */
+		template<typename POINTER_TYPE, typename TYPE>
+		struct Accessor
+		{
+			POINTER_TYPE parent; /**< The instance accessor is accessing. */
+			size_t i; /**< Accessor row in instance. */
+
+			/**
+			 * Accesses chosen cell in a row.
+			 * @param j column number
+			 * @return reference to the cell.
+			 */
+			TYPE& operator [] (size_t j) const { return parent->get(i, j); }
+		};
+
+		typedef Accessor<PackedSymmetricMatrix<T>*, T> accessor; /**< Packed matrix cells accessor. */
+		typedef Accessor<const PackedSymmetricMatrix<T>*, const T> const_accessor; /**< Packed matrix constant cells accessor. */
+
+		// constructors
+		/**
+		 * Constructs instance of order size x size with all cells set to T().
+		 * @param size number of rows / number of columns.
+		 * @param allowDiagonal are diagonal cells allowed?
+		 * @param trackDefined should cells written with set() be remembered as defined?
+		 */
+		PackedSymmetricMatrix(size_t size = 0, bool allowDiagonal = false, bool trackDefined = false)
+			: matrixSize(size), allowDiagonal(allowDiagonal), rows(size), cells(nullptr)
+		{
+			// row i starts at index offset + skip (the first skip cells are padding keeping rows[i] non-negative)
+			size_t skip = allowDiagonal ? 0 : 1;
+			size_t offset = 0;
+			for(size_t i = 0; i < size; ++i)
+			{
+				rows[i] = offset - i;
+				offset += size - i - std::min(size - i, skip);
+			}
+			cellCount = offset;
+			allocate(allocated(*this));
+			std::fill(cells, cells + allocated(*this), T());
+			if(trackDefined)
+				definedBits.assign((allocated(*this) + 63) / 64, 0);
+		}
+
+		/**
+		 * Copy constructor.
+		 * @param other copied matrix.
+		 */
+		PackedSymmetricMatrix(const PackedSymmetricMatrix<T>& other)
+			: matrixSize(other.matrixSize), allowDiagonal(other.allowDiagonal), rows(other.rows), cellCount(other.cellCount),
+			definedBits(other.definedBits), cells(nullptr)
+		{
+			allocate(allocated(other));
+			std::copy(other.cells, other.cells + allocated(other), cells);
+		}
+
+		/**
+		 * Move constructor.
+		 * @param other moved matrix, left empty.
+		 */
+		PackedSymmetricMatrix(PackedSymmetricMatrix<T>&& other)
+			: matrixSize(other.matrixSize), allowDiagonal(other.allowDiagonal), rows(std::move(other.rows)), cellCount(other.cellCount),
+			definedBits(std::move(other.definedBits)), cells(other.cells)
+		{
+			other.cells = nullptr;
+			other.matrixSize = other.cellCount = 0;
+		}
+
+		~PackedSymmetricMatrix()
+		{
+			release();
+		}
+
+		// operators
+		/**
+		 * Copy assignment.
+		 * @param other copied matrix.
+		 * @return this matrix.
+		 */
+		PackedSymmetricMatrix<T>& operator = (const PackedSymmetricMatrix<T>& other)
+		{
+			if(this != &other)
+				*this = PackedSymmetricMatrix<T>(other);
+			return *this;
+		}
+
+		/**
+		 * Move assignment.
+		 * @param other moved matrix, left empty.
+		 * @return this matrix.
+		 */
+		PackedSymmetricMatrix<T>& operator = (PackedSymmetricMatrix<T>&& other)
+		{
+			std::swap(matrixSize, other.matrixSize);
+			std::swap(allowDiagonal, other.allowDiagonal);
+			std::swap(rows, other.rows);
+			std::swap(cellCount, other.cellCount);
+			std::swap(definedBits, other.definedBits);
+			std::swap(cells, other.cells);
+			return *this;
+		}
+
+		/**
+		 * Wrapper for get(i, j) function, using a [i][j] syntax.
+		 * @param i row number
+		 * @return matrix row accessor
+		 */
+		accessor operator [] (size_t i) { return accessor{ this, i }; }
+
+		/**
+		 * Wrapper for get(i, j) const function, using a [i][j] syntax.
+		 * @param i row number
+		 * @return matrix row constant accessor
+		 */
+		const_accessor operator [] (size_t i) const { return const_accessor{ this, i }; }
+
+		// functions
+		/**
+		 * Returns row i of the upper triangle.
+		 * Only columns j > i (j >= i if diagonal is allowed) may be accessed through the pointer.
+		 * @param i row number.
+		 * @return pointer p such that p[j] is the cell [i][j].
+		 */
+		T* row(size_t i) { return cells + rows[i]; }
+
+		/**
+		 * @copydoc row()
+		 */
+		const T* row(size_t i) const { return cells + rows[i]; }
+
+		/**
+		 * Returns the whole block of cells (rows in order, including padding), e.g. for serialization.
+		 * @return pointer to dataSize() cells.
+		 */
+		T* data() { return cells; }
+
+		/**
+		 * @copydoc data()
+		 */
+		const T* data() const { return cells; }
+
+		/**
+		 * @return number of cells of the block returned by data().
+		 */
+		size_t dataSize() const { return allocated(*this); }
+
+		/**
+		 * Returns reference to the item at [i][j] without any checks.
+		 * Accessing [i][i] when diagonal is not allowed is undefined.
+		 * @param i row number.
+		 * @param j column number.
+		 * @return item at [i][j].
+		 */
+		T& get(size_t i, size_t j) { return cells[rows[std::min(i, j)] + std::max(i, j)]; }
+
+		/**
+		 * @copydoc get()
+		 */
+		const T& get(size_t i, size_t j) const { return cells[rows[std::min(i, j)] + std::max(i, j)]; }
+
+		/**
+		 * Returns reference to the item at [i][j].
+		 * Accessing [i][i] when not allowed or accessing index out of bounds will result in symmetric_matrix_exception throw.
+		 * @param i row number.
+		 * @param j column number.
+		 * @throw symmetric_matrix_exception
+		 * @return item at [i][j].
+		 */
+		T& at(size_t i, size_t j)
+		{
+			check(i, j);
+			return get(i, j);
+		}
+
+		/**
+		 * @copydoc at()
+		 */
+		const T& at(size_t i, size_t j) const
+		{
+			check(i, j);
+			return get(i, j);
+		}
+
+		/**
+		 * Stores value at [i][j] and marks the cell as defined if definedness is tracked.
+		 * @param i row number.
+		 * @param j column number.
+		 * @param value stored value.
+		 */
+		void set(size_t i, size_t j, const T& value)
+		{
+			size_t index = rows[std::min(i, j)] + std::max(i, j);
+			cells[index] = value;
+			if(!definedBits.empty())
+				definedBits[index / 64] |= (uint64_t)1 << (index % 64);
+		}
+
+		/**
+		 * Checks whether such pair is defined in the matrix.
+		 * Without tracking, all cells within bounds (except disallowed diagonal) are defined.
+		 * @param i row number.
+		 * @param j column number.
+		 * @return true, if cell was defined.
+		 */
+		bool defined(size_t i, size_t j) const
+		{
+			if(i >= matrixSize || j >= matrixSize || (i == j && !allowDiagonal))
+				return false;
+			if(definedBits.empty())
+				return true;
+			size_t index = rows[std::min(i, j)] + std::max(i, j);
+			return (definedBits[index / 64] >> (index % 64)) & 1;
+		}
+
+		/**
+		 * @return true iff set() remembers defined cells.
+		 */
+		bool tracksDefined() const { return !definedBits.empty(); }
+
+		/**
+		 * @return number of rows / number of columns.
+		 */
+		size_t size() const { return matrixSize; }
+
+		/**
+		 * @return true iff diagonal cells are allowed.
+		 */
+		bool diagonalAllowed() const { return allowDiagonal; }
+
+		/**
+		 * @return number of defined cells.
+		 */
+		size_t count() const
+		{
+			if(definedBits.empty())
+				return cellCount;
+			size_t counter = 0;
+			for(uint64_t word : definedBits)
+				counter += std::bitset<64>(word).count();
+			return counter;
+		}
+
+		/**
+		 * @return number of bytes used by the matrix.
+		 */
+		size_t memoryUsage() const
+		{
+			return sizeof(*this) + allocated(*this) * sizeof(T) + rows.capacity() * sizeof(size_t) + definedBits.capacity() * sizeof(uint64_t);
+		}
+
+	private:
+		/**
+		 * @return number of cells allocated by the matrix (including padding).
+		 */
+		static size_t allocated(const PackedSymmetricMatrix<T>& matrix)
+		{
+			return matrix.cellCount + (matrix.allowDiagonal || !matrix.matrixSize ? 0 : 1);
+		}
+
+		/**
+		 * Allocates aligned block of cells.
+		 * @param count number of cells.
+		 */
+		void allocate(size_t count)
+		{
+			size_t bytes = std::max<size_t>(count * sizeof(T), 1);
+			bytes = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+			#ifdef _WIN32
+			cells = (T*)_aligned_malloc(bytes, ALIGNMENT);
+			#else
+			void* block = nullptr;
+			cells = posix_memalign(&block, ALIGNMENT, bytes) == 0 ? (T*)block : nullptr;
+			#endif
+			if(!cells)
+				throw std::bad_alloc();
+		}
+
+		/**
+		 * Frees the block of cells.
+		 */
+		void release()
+		{
+			#ifdef _WIN32
+			_aligned_free(cells);
+			#else
+			free(cells);
+			#endif
+			cells = nullptr;
+		}
+
+		/**
+		 * Throws if [i][j] is not a cell of the matrix.
+		 * @throw symmetric_matrix_exception
+		 */
+		void check(size_t i, size_t j) const
+		{
+			if(i >= matrixSize || j >= matrixSize)
+				throw_exception(symmetric_matrix_exception, symmetric_matrix_exception::OUT_OF_BOUNDS, (int)i, (int)j);
+			if(i == j && !allowDiagonal)
+				throw_exception(symmetric_matrix_exception, symmetric_matrix_exception::DIAGONAL_NOT_ALLOWED, (int)i, (int)j);
+		}
+
+		// variables
+		size_t matrixSize; /**< Number of rows / number of columns. */
+		bool allowDiagonal; /**< Are diagonal cells allowed? */
+		std::vector<size_t> rows; /**< Index of (not necessarily existing) cell [i][0] of every row i. */
+		size_t cellCount; /**< Number of cells of the triangle. */
+		std::vector<uint64_t> definedBits; /**< Defined flags by cell index, empty if not tracked. */
+		T* cells; /**< Aligned block of cells. */
+};
+
+/**
+ * Bit-packed symmetric matrix of booleans (such as relations between relays).
+ * Every row is stored as a bitset of whole 64-bit words, both [i][j] and [j][i] are kept,
+ * so a row of relatives is available at once and rows can be combined word by word.
+ * A cell takes 1 bit instead of the (defined, value) pair of bytes of SymmetricMatrix<bool>.
+ */
+template<>
+class PackedSymmetricMatrix<bool>
+{
+	public:
+		typedef uint64_t word_t; /**< Type of bitset words. */
+		static const size_t WORD_BITS = 64; /**< Number of bits in a word. */
+
+		/**
+		 * Constant row accessor providing [i][j] syntax.
+		 */
+		struct const_accessor
+		{
+			const PackedSymmetricMatrix<bool>* parent; /**< The instance accessor is accessing. */
+			size_t i; /**< Accessor row in instance. */
+
+			/**
+			 * Accesses chosen cell in a row.
+			 * @param j column number
+			 * @return value of the cell.
+			 */
+			bool operator [] (size_t j) const { return parent->get(i, j); }
+		};
+
+		// constructors
+		/**
+		 * Constructs instance of order size x size with all cells false.
+		 * @param size number of rows / number of columns.
+		 * @param allowDiagonal are diagonal cells allowed?
+		 */
+		PackedSymmetricMatrix(size_t size = 0, bool allowDiagonal = false)
+			: matrixSize(size), allowDiagonal(allowDiagonal), rowWords(wordsFor(size)), bits(size * rowWords, 0) { }
+
+		// operators
+		/**
+		 * Wrapper for get(i, j) function, using a [i][j] syntax.
+		 * @param i row number
+		 * @return matrix row constant accessor
+		 */
+		const_accessor operator [] (size_t i) const { return const_accessor{ this, i }; }
+
+		// functions
+		/**
+		 * @param size number of columns.
+		 * @return number of words of a row bitset.
+		 */
+		static size_t wordsFor(size_t size) { return (size + WORD_BITS - 1) / WORD_BITS; }
+
+		/**
+		 * Returns bitset of row i, bit j (bit j % 64 of word j / 64) is the cell [i][j].
+		 * @param i row number.
+		 * @return pointer to words() words of the row.
+		 */
+		const word_t* row(size_t i) const { return bits.data() + i * rowWords; }
+
+		/**
+		 * @return number of words of every row.
+		 */
+		size_t words() const { return rowWords; }
+
+		/**
+		 * Returns item at [i][j] without any checks.
+		 * @param i row number.
+		 * @param j column number.
+		 * @return item at [i][j].
+		 */
+		bool get(size_t i, size_t j) const { return (row(i)[j / WORD_BITS] >> (j % WORD_BITS)) & 1; }
+
+		/**
+		 * Returns item at [i][j].
+		 * Accessing [i][i] when not allowed or accessing index out of bounds will result in symmetric_matrix_exception throw.
+		 * @param i row number.
+		 * @param j column number.
+		 * @throw symmetric_matrix_exception
+		 * @return item at [i][j].
+		 */
+		bool at(size_t i, size_t j) const
+		{
+			if(i >= matrixSize || j >= matrixSize)
+				throw_exception(symmetric_matrix_exception, symmetric_matrix_exception::OUT_OF_BOUNDS, (int)i, (int)j);
+			if(i == j && !allowDiagonal)
+				throw_exception(symmetric_matrix_exception, symmetric_matrix_exception::DIAGONAL_NOT_ALLOWED, (int)i, (int)j);
+			return get(i, j);
+		}
+
+		/**
+		 * Stores value at [i][j] (and [j][i]).
+		 * @param i row number.
+		 * @param j column number.
+		 * @param value stored value.
+		 */
+		void set(size_t i, size_t j, bool value)
+		{
+			assign(i, j, value);
+			assign(j, i, value);
+		}
+
+		/**
+		 * Sets every cell which is true in the other matrix of the same order, word by word.
+		 * @param other united matrix.
+		 */
+		void unite(const PackedSymmetricMatrix<bool>& other)
+		{
+			for(size_t w = 0; w < bits.size(); ++w)
+				bits[w] |= other.bits[w];
+		}
+
+		/**
+		 * @param i row number.
+		 * @return number of true cells in row i.
+		 */
+		size_t rowCount(size_t i) const
+		{
+			size_t counter = 0;
+			for(const word_t* word = row(i); word != row(i) + rowWords; ++word)
+				counter += std::bitset<WORD_BITS>(*word).count();
+			return counter;
+		}
+
+		/**
+		 * Calls function for every column of true cell in row i (in ascending order), which is also set in mask.
+		 * @param i row number.
+		 * @param mask bitset of words() words of allowed columns, or nullptr for all columns.
+		 * @param function called with column number.
+		 */
+		template<typename FUNCTION>
+		void forEachInRow(size_t i, const word_t* mask, FUNCTION function) const
+		{
+			forEachBit(row(i), mask, rowWords, function);
+		}
+
+		/**
+		 * Calls function for every bit set in both bitsets (in ascending order).
+		 * @param bitset bitset of words.
+		 * @param mask bitset of words, or nullptr for all bits.
+		 * @param words number of words of bitsets.
+		 * @param function called with bit number.
+		 */
+		template<typename FUNCTION>
+		static void forEachBit(const word_t* bitset, const word_t* mask, size_t words, FUNCTION function)
+		{
+			for(size_t w = 0; w < words; ++w)
+			{
+				word_t word = mask ? bitset[w] & mask[w] : bitset[w];
+				while(word)
+				{
+					function(w * WORD_BITS + lowestBit(word));
+					word &= word - 1;
+				}
+			}
+		}
+
+		/**
+		 * Changes order of the matrix, cells of both orders keep their values.
+		 * @param size new number of rows / number of columns.
+		 */
+		void resize(size_t size)
+		{
+			PackedSymmetricMatrix<bool> resized(size, allowDiagonal);
+			size_t words = std::min(rowWords, resized.rowWords);
+			for(size_t i = 0; i < std::min(size, matrixSize); ++i)
+				std::copy(row(i), row(i) + words, resized.bits.data() + i * resized.rowWords);
+			if(size < matrixSize && size % WORD_BITS)
+				for(size_t i = 0; i < size; ++i)
+					resized.bits[i * resized.rowWords + words - 1] &= ((word_t)1 << (size % WORD_BITS)) - 1;
+			*this = std::move(resized);
+		}
+
+		/**
+		 * @return number of rows / number of columns.
+		 */
+		size_t size() const { return matrixSize; }
+
+		/**
+		 * @return true iff diagonal cells are allowed.
+		 */
+		bool diagonalAllowed() const { return allowDiagonal; }
+
+		/**
+		 * @return number of bytes used by the matrix.
+		 */
+		size_t memoryUsage() const { return sizeof(*this) + bits.capacity() * sizeof(word_t); }
+
+	private:
+		/**
+		 * Sets the bit [i][j] only.
+		 */
+		void assign(size_t i, size_t j, bool value)
+		{
+			word_t& word = bits[i * rowWords + j / WORD_BITS];
+			word_t bit = (word_t)1 << (j % WORD_BITS);
+			word = value ? word | bit : word & ~bit;
+		}
+
+		/**
+		 * @param word non-zero word.
+		 * @return index of the lowest set bit.
+		 */
+		static size_t lowestBit(word_t word)
+		{
+			#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward64(&index, word);
+			return index;
+			#else
+			return __builtin_ctzll(word);
+			#endif
+		}
+
+		// variables
+		size_t matrixSize; /**< Number of rows / number of columns. */
+		bool allowDiagonal; /**< Are diagonal cells allowed? */
+		size_t rowWords; /**< Number of words of every row. */
+		std::vector<word_t> bits; /**< Row bitsets, one after another. */
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef STRING_REF_HPP
+#define STRING_REF_HPP
+
+/** @file */
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+
+/**
+ * Non-owning view of a character range (pointer + length).
+ * Used for tokenizing memory mapped files without allocating intermediate strings.
+ * The referenced memory has to outlive the view.
+ */
+class string_ref
+{
+	public:
+		/**
+		 * Creates an empty view.
+		 */
+		string_ref() : ptr(nullptr), len(0) { }
+
+		/**
+		 * Creates a view of the given character range.
+		 * @param data first character of the range.
+		 * @param length number of characters in the range.
+		 */
+		string_ref(const char* data, size_t length) : ptr(data), len(length) { }
+
+		/**
+		 * Creates a view of the whole string (the string has to outlive the view).
+		 * @param str viewed string.
+		 */
+		string_ref(const std::string& str) : ptr(str.data()), len(str.size()) { }
+
+		/**
+		 * @return pointer to the first character (not null-terminated).
+		 */
+		const char* data() const { return ptr; }
+
+		/**
+		 * @return number of characters in the view.
+		 */
+		size_t size() const { return len; }
+
+		/**
+		 * @return true iff the view contains no characters.
+		 */
+		bool empty() const { return len == 0; }
+
+		const char* begin() const { return ptr; }
+		const char* end() const { return ptr + len; }
+
+		char operator[](size_t i) const { return ptr[i]; }
+
+		/**
+		 * @param pos position of the first character.
+		 * @param count maximal number of characters.
+		 * @return view of the subrange.
+		 */
+		string_ref substr(size_t pos, size_t count = std::string::npos) const
+		{
+			if(pos > len)
+				pos = len;
+			if(count > len - pos)
+				count = len - pos;
+			return string_ref(ptr + pos, count);
+		}
+
+		/**
+		 * @param c searched character.
+		 * @return position of the first occurence of c or std::string::npos.
+		 */
+		size_t find(char c) const
+		{
+			const void* found = len ? memchr(ptr, c, len) : nullptr;
+			return found ? (const char*)found - ptr : std::string::npos;
+		}
+
+		/**
+		 * @return copy of the viewed characters.
+		 */
+		std::string str() const { return std::string(ptr, len); }
+
+		bool operator==(const string_ref& other) const
+		{
+			return len == other.len && (len == 0 || memcmp(ptr, other.ptr, len) == 0);
+		}
+
+		bool operator!=(const string_ref& other) const { return !(*this == other); }
+
+		/**
+		 * Compares with null-terminated literal.
+		 */
+		bool operator==(const char* literal) const
+		{
+			return strlen(literal) == len && (len == 0 || memcmp(ptr, literal, len) == 0);
+		}
+
+		bool operator!=(const char* literal) const { return !(*this == literal); }
+
+	private:
+		const char* ptr; /**< First character of the view. */
+		size_t len; /**< Number of characters in the view. */
+};
+
+#endif
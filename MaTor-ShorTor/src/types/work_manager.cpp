@@ -1,11 +1,31 @@
 #include "work_manager.hpp"
 
+#include <exception>
+#include <algorithm>
+
+namespace
+{
+	thread_local unsigned threadBudget = 0; /**< Maximal number of threads of work managers of the thread (0 for unlimited). */
+}
+
+WorkManager::Budget::Budget(unsigned threads) : previous(threadBudget)
+{
+	threadBudget = (threads < 1) ? 1 : threads;
+}
+
+WorkManager::Budget::~Budget()
+{
+	threadBudget = previous;
+}
+
 WorkManager::WorkManager(unsigned hardwareConcurrency)
 {
 	if(hardwareConcurrency < 1)
 		this->hardwareConcurrency = 1;
 	else
 		this->hardwareConcurrency = hardwareConcurrency;
+	if(threadBudget > 0 && this->hardwareConcurrency > threadBudget)
+		this->hardwareConcurrency = threadBudget;
 }
 
 void WorkManager::addTask(std::function<void()> fun)
@@ -25,19 +45,62 @@ void WorkManager::run()
 	while(fun);	
 }
 
+#ifdef MATOR_LOCK_PARALLEL_CODE
+namespace
+{
+	thread_local bool insideTask = false; /**< Is the thread spawned by a work manager? */
+}
+#endif
+
 void WorkManager::startAndJoinAll()
 {
 #ifdef MATOR_LOCK_PARALLEL_CODE
-	std::lock_guard<std::mutex> locker(wmLock);
+	// work managers started from tasks of another work manager run under its lock
+	std::unique_lock<std::mutex> locker(wmLock, std::defer_lock);
+	if(!insideTask)
+		locker.lock();
 #endif
+	// every thread gets its share of the budget
+	unsigned budget = (threadBudget > 0) ? std::max(1u, threadBudget / hardwareConcurrency) : 0;
 	for(unsigned int i = 0; i < hardwareConcurrency; ++i)
-		jobs.emplace_back([this]() { run(); });
+		jobs.emplace_back([this, budget]() {
+#ifdef MATOR_LOCK_PARALLEL_CODE
+			insideTask = true;
+#endif
+			threadBudget = budget;
+			run();
+		});
 	
 	for(auto& j : jobs)
 		j.join();
 	jobs.clear();
 }
 
+void WorkManager::runAll(unsigned threads, size_t count, const std::function<void(size_t)>& task)
+{
+	WorkManager workManager(threads);
+	std::exception_ptr error;
+	std::mutex errorLock;
+	for(size_t i = 0; i < count; ++i)
+	{
+		workManager.addTask([&, i]() {
+			try
+			{
+				task(i);
+			}
+			catch(...)
+			{
+				std::lock_guard<std::mutex> lock(errorLock);
+				if(!error)
+					error = std::current_exception();
+			}
+		});
+	}
+	workManager.startAndJoinAll();
+	if(error)
+		std::rethrow_exception(error);
+}
+
 #ifdef MATOR_LOCK_PARALLEL_CODE
 std::mutex WorkManager::wmLock;
 #endif
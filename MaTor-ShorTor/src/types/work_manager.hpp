@@ -19,8 +19,34 @@
 class WorkManager
 {
 	public:
+		/**
+		 * Limits the number of threads of work managers constructed by the calling thread while it exists.
+		 * Threads of a work manager split the budget of the thread that started it, so nested work managers stay within it.
+		 */
+		class Budget
+		{
+			public:
+				/**
+				 * Sets the thread budget of the calling thread.
+				 * @param threads maximal number of threads of its work managers.
+				 */
+				explicit Budget(unsigned threads);
+
+				/**
+				 * Restores the previous thread budget of the calling thread.
+				 */
+				~Budget();
+
+				Budget(const Budget&) = delete;
+				Budget& operator=(const Budget&) = delete;
+
+			private:
+				unsigned previous; /**< Replaced budget (0 for none). */
+		};
+
 		/**
 		 * Constructor initializes thread queue and obtains available hardware threads number.
+		 * The number of threads is limited by the Budget of the calling thread (if any).
 		 */
 		WorkManager(unsigned = std::thread::hardware_concurrency());
 		
@@ -32,6 +58,7 @@ class WorkManager
 		
 		/**
 		 * Starts threads executing queued functions and waits until the job is done.
+		 * Work managers may be nested, i.e. started from tasks of another work manager.
 		 */
 		void startAndJoinAll();
 		
@@ -39,6 +66,15 @@ class WorkManager
 		 * @return number of available hardware thread contexts.
 		 */
 		int getHardwareConcurrency() const { return hardwareConcurrency; }
+
+		/**
+		 * Runs task(0), ..., task(count - 1) on a new work manager and waits until all of them finish.
+		 * If any task throws, the first exception caught is rethrown after all tasks are done.
+		 * @param threads number of threads to use.
+		 * @param count number of tasks.
+		 * @param task function called with the task index.
+		 */
+		static void runAll(unsigned threads, size_t count, const std::function<void(size_t)>& task);
 	
 	private:
 	
@@ -16,32 +16,47 @@ std::vector<std::string> split(const std::string& str, char delim)
 
 std::string b64toHex(std::string b64)
 {
-	const std::string keyStr = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=";
-    int chr1, chr2, chr3;
-    char enc1, enc2, enc3, enc4;
-    int i = 0;
+	return b64toHex(b64.data(), b64.size());
+}
 
-    while (b64.length() % 4) b64 = b64 + "="; // add missing padding if neccessary
-    
-	std::stringstream ss;
-	while (i < b64.length())
+std::string b64toHex(const char* b64, size_t length)
+{
+	static const char hexDigits[] = "0123456789ABCDEF";
+	static const struct DecodeTable
 	{
-		enc1 = keyStr.find(b64[i++]);
-		enc2 = keyStr.find(b64[i++]);
-		enc3 = keyStr.find(b64[i++]);
-		enc4 = keyStr.find(b64[i++]);
+		signed char value[256];
+		DecodeTable()
+		{
+			const char* keyStr = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			for(int i = 0; i < 256; ++i)
+				value[i] = -1;
+			for(int i = 0; i < 64; ++i)
+				value[(unsigned char)keyStr[i]] = i;
+		}
+	} table;
+
+	// strip explicit padding, missing padding is handled implicitly
+	while(length && b64[length - 1] == '=')
+		--length;
 
-		chr1 = (enc1 << 2) | (enc2 >> 4);
-		chr2 = ((enc2 & 15) << 4) | (enc3 >> 2);
-		chr3 = ((enc3 & 3) << 6) | enc4;
-		
-		ss << std::hex << std::setw(2) << std::setfill('0') << std::uppercase << chr1;
-		if (enc3 != 64)
-			ss << std::hex << std::setw(2) << std::setfill('0') << std::uppercase << chr2;
-		if (enc4 != 64)
-			ss << std::hex << std::setw(2) << std::setfill('0') << std::uppercase << chr3;
+	std::string hex;
+	hex.reserve(length * 3 / 2 + 2);
+
+	unsigned int buffer = 0;
+	int bits = 0;
+	for(size_t i = 0; i < length; ++i)
+	{
+		buffer = (buffer << 6) | (unsigned int)(table.value[(unsigned char)b64[i]] & 63);
+		bits += 6;
+		if(bits >= 8)
+		{
+			bits -= 8;
+			unsigned int byte = (buffer >> bits) & 0xff;
+			hex.push_back(hexDigits[byte >> 4]);
+			hex.push_back(hexDigits[byte & 15]);
+		}
 	}
-	return ss.str();
+	return hex;
 }
 
 bool findToken(const std::vector<std::string>& tokens, std::string searchItem)
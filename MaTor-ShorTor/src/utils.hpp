@@ -122,6 +122,14 @@ std::vector<std::string> split(const std::string& str, char delim = ' ');
  */
 std::string b64toHex(std::string b64);
 
+/**
+ * Converts base64 character range to hex string without intermediate allocations.
+ * @param b64 first character of the base64 encoded data (no trailing "=" required)
+ * @param length number of base64 characters
+ * @return converted hex string.
+ */
+std::string b64toHex(const char* b64, size_t length);
+
 /**
  * Finds specified token in tokens vector.
  * @param tokens tested vector
@@ -0,0 +1,398 @@
+#include "via_pairs.hpp"
+#include "utils.hpp"
+#include "types/mapped_file.hpp"
+#include "types/string_ref.hpp"
+#include "types/work_manager.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+#include <sys/stat.h>
+
+namespace
+{
+	const char MAGIC[8] = { 'M', 'A', 'T', 'O', 'R', 'V', 'I', 'A' }; /**< Binary index file signature. */
+	const uint32_t VERSION = 3; /**< Binary index format version. */
+	const size_t FINGERPRINT_LENGTH = sizeof(FingerprintIndex::digest_t); /**< Length of a stored fingerprint. */
+	const size_t HEADER_SIZE = sizeof(MAGIC) + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+	const ViaPairIndex::id_t NOT_FOUND = std::numeric_limits<ViaPairIndex::id_t>::max();
+
+	/**
+	 * @return offset rounded up to a multiple of 8 (alignment of 64-bit sections of binary index).
+	 */
+	inline size_t align8(size_t offset)
+	{
+		return (offset + 7) & ~(size_t)7;
+	}
+
+	/**
+	 * @return true iff row offsets start at 0, do not decrease and end at total.
+	 */
+	bool validOffsets(const uint64_t* offsets, size_t rows, uint64_t total)
+	{
+		return offsets[0] == 0 && offsets[rows] == total && std::is_sorted(offsets, offsets + rows + 1);
+	}
+
+	/**
+	 * @return position of the relay with given fingerprint or NOT_FOUND.
+	 */
+	inline ViaPairIndex::id_t findRelay(const FingerprintIndex& fingerprints, const string_ref& fingerprint)
+	{
+		size_t position = fingerprints.find(fingerprint);
+		return position == FingerprintIndex::NOT_FOUND ? NOT_FOUND : (ViaPairIndex::id_t)position;
+	}
+
+	/**
+	 * Pair read from the CSV file, together with its via.
+	 */
+	struct ParsedPair
+	{
+		ViaPairIndex::id_t via;
+		ViaPair pair;
+	};
+
+	/**
+	 * @return true iff file a exists and was modified before file b.
+	 */
+	bool olderThan(const std::string& a, const std::string& b)
+	{
+		struct stat statA, statB;
+		if(stat(a.c_str(), &statA) != 0 || stat(b.c_str(), &statB) != 0)
+			return false;
+		return statA.st_mtime < statB.st_mtime;
+	}
+}
+
+ViaPairIndex::ViaPairIndex(size_t relaysCount) : offsets(relaysCount + 1, 0), reverseOffsets(relaysCount + 1, 0)
+{
+	usePrivateStorage();
+}
+
+ViaPairIndex::ViaPairIndex(const std::string& fileName, const FingerprintIndex& fingerprints, unsigned threads)
+	: ViaPairIndex(fingerprints.size())
+{
+	std::string sidecar = sidecarName(fileName);
+	bool reverseBuilt = false;
+	if(loadBinary(fileName, fingerprints))
+	{
+		clogsn("Via pairs read from binary index " << fileName << (isMapped() ? " (mapped)." : "."));
+	}
+	else if(!olderThan(sidecar, fileName) && loadBinary(sidecar, fingerprints))
+	{
+		clogsn("Via pairs read from binary index " << sidecar << (isMapped() ? " (mapped)." : "."));
+	}
+	else if(loadCSV(fileName, fingerprints, threads))
+	{
+		buildReverse(threads);
+		reverseBuilt = true;
+		if(!save(sidecar, fingerprints))
+		{
+			clogsn("[Warning] Could not write via pairs index " << sidecar << ".");
+		}
+	}
+	else
+	{
+		clogsn("[Warning] Could not open via pairs file " << fileName << ".");
+	}
+
+	if(!isMapped() && !reverseBuilt)
+		buildReverse(threads);
+}
+
+ViaPairIndex::Range<ViaPairIndex::id_t> ViaPairIndex::getVias(size_t first, size_t second) const
+{
+	if(first > second)
+		std::swap(first, second);
+	const id_t* rowBegin = reversePartnersData + reverseOffsetsData[first];
+	const id_t* rowEnd = reversePartnersData + reverseOffsetsData[first + 1];
+	auto found = std::equal_range(rowBegin, rowEnd, (id_t)second);
+	return Range<id_t>(reverseViasData + (found.first - reversePartnersData), reverseViasData + (found.second - reversePartnersData));
+}
+
+void ViaPairIndex::usePrivateStorage()
+{
+	mapping.close();
+	relaysCount = offsets.size() - 1;
+	pairsTotal = pairs.size();
+	offsetsData = offsets.data();
+	pairsData = pairs.data();
+	reverseOffsetsData = reverseOffsets.data();
+	reversePartnersData = reversePartners.data();
+	reverseViasData = reverseVias.data();
+}
+
+bool ViaPairIndex::loadCSV(const std::string& fileName, const FingerprintIndex& fingerprints, unsigned threads)
+{
+	MappedFile file;
+	if(!file.open(fileName))
+		return false;
+
+	size_t relaysCount = fingerprints.size();
+	const char* data = file.data();
+	size_t length = file.size();
+
+	// split the file into chunks of whole lines
+	size_t chunks = std::max(1u, threads) * 4;
+	std::vector<size_t> bounds(chunks + 1, length);
+	bounds[0] = 0;
+	for(size_t c = 1; c < chunks; ++c)
+	{
+		size_t pos = std::max(bounds[c - 1], length / chunks * c);
+		const char* eol = pos < length ? (const char*)memchr(data + pos, '\n', length - pos) : nullptr;
+		bounds[c] = eol ? eol - data + 1 : length;
+	}
+
+	// parse chunks in parallel
+	std::vector<std::vector<ParsedPair>> parsed(chunks);
+	std::vector<size_t> skippedRows(chunks, 0), skippedPairs(chunks, 0);
+	WorkManager::runAll(threads, chunks, [&](size_t c) {
+		const char* pos = data + bounds[c];
+		const char* end = data + bounds[c + 1];
+		std::vector<string_ref> fields;
+		while(pos < end)
+		{
+			const char* eol = (const char*)memchr(pos, '\n', end - pos);
+			if(!eol)
+				eol = end;
+			string_ref line(pos, eol - pos);
+			pos = eol + 1;
+			if(!line.empty() && line[line.size() - 1] == '\r')
+				line = line.substr(0, line.size() - 1);
+			if(line.empty())
+				continue;
+
+			fields.clear();
+			size_t fieldStart = 0;
+			for(size_t i = 0; i <= line.size(); ++i)
+				if(i == line.size() || line[i] == ',')
+				{
+					fields.push_back(line.substr(fieldStart, i - fieldStart));
+					fieldStart = i + 1;
+				}
+
+			// first field is the via fingerprint, the rest are pairs of fingerprints
+			id_t via = findRelay(fingerprints, fields[0]);
+			if(via == NOT_FOUND)
+			{
+				++skippedRows[c];
+				continue;
+			}
+			for(size_t i = 1; i + 1 < fields.size(); i += 2)
+			{
+				id_t first = findRelay(fingerprints, fields[i]);
+				id_t second = findRelay(fingerprints, fields[i + 1]);
+				if(first == NOT_FOUND || second == NOT_FOUND)
+				{
+					++skippedPairs[c];
+					continue;
+				}
+				parsed[c].push_back(ParsedPair{ via, ViaPair{ first, second } });
+			}
+		}
+	});
+
+	// count pairs per via and chunk, so that chunks can be scattered in parallel keeping file order
+	std::vector<std::vector<uint64_t>> cursors(chunks, std::vector<uint64_t>(relaysCount, 0));
+	WorkManager::runAll(threads, chunks, [&](size_t c) {
+		for(const auto& entry : parsed[c])
+			++cursors[c][entry.via];
+	});
+
+	uint64_t total = 0;
+	for(size_t via = 0; via < relaysCount; ++via)
+	{
+		offsets[via] = total;
+		for(size_t c = 0; c < chunks; ++c)
+		{
+			uint64_t count = cursors[c][via];
+			cursors[c][via] = total;
+			total += count;
+		}
+	}
+	offsets[relaysCount] = total;
+
+	pairs.resize(total);
+	WorkManager::runAll(threads, chunks, [&](size_t c) {
+		for(const auto& entry : parsed[c])
+			pairs[cursors[c][entry.via]++] = entry.pair;
+		std::vector<ParsedPair>().swap(parsed[c]);
+	});
+
+	size_t rows = 0, unknownPairs = 0;
+	for(size_t c = 0; c < chunks; ++c)
+	{
+		rows += skippedRows[c];
+		unknownPairs += skippedPairs[c];
+	}
+	if(rows || unknownPairs)
+	{
+		clogsn("[Warning] Skipped " << rows << " via rows and " << unknownPairs << " pairs with fingerprints missing in consensus.");
+	}
+
+	return true;
+}
+
+bool ViaPairIndex::loadBinary(const std::string& fileName, const FingerprintIndex& fingerprints)
+{
+	MappedFile file;
+	if(!file.open(fileName) || file.size() < HEADER_SIZE || memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0)
+		return false;
+
+	const char* data = file.data();
+	uint32_t version, storedCount;
+	uint64_t storedPairs;
+	memcpy(&version, data + sizeof(MAGIC), sizeof(version));
+	memcpy(&storedCount, data + sizeof(MAGIC) + sizeof(version), sizeof(storedCount));
+	memcpy(&storedPairs, data + sizeof(MAGIC) + 2 * sizeof(uint32_t), sizeof(storedPairs));
+	if(version != VERSION)
+		return false;
+
+	// sections are 8-byte aligned relative to the (page aligned) start of the file
+	size_t n = storedCount;
+	const char* storedFingerprints = data + HEADER_SIZE;
+	const char* storedOffsets = data + align8(HEADER_SIZE + n * FINGERPRINT_LENGTH);
+	const char* storedPairsData = storedOffsets + (n + 1) * sizeof(uint64_t);
+	const char* storedReverseOffsets = storedPairsData + storedPairs * sizeof(ViaPair);
+	const char* storedPartners = storedReverseOffsets + (n + 1) * sizeof(uint64_t);
+	const char* storedVias = storedPartners + storedPairs * sizeof(id_t);
+	if(file.size() != (size_t)(storedVias - data) + storedPairs * sizeof(id_t))
+		return false;
+
+	// map stored relays to consensus relays; every consensus relay has to be covered
+	std::vector<id_t> translation(n);
+	size_t covered = 0;
+	bool identity = n == fingerprints.size();
+	for(size_t i = 0; i < n; ++i)
+	{
+		FingerprintIndex::digest_t digest;
+		memcpy(digest.data(), storedFingerprints + i * FINGERPRINT_LENGTH, FINGERPRINT_LENGTH);
+		size_t position = fingerprints.find(digest);
+		translation[i] = position == FingerprintIndex::NOT_FOUND ? NOT_FOUND : (id_t)position;
+		if(translation[i] != NOT_FOUND)
+			++covered;
+		identity = identity && translation[i] == i;
+	}
+	if(covered != fingerprints.size())
+		return false;
+
+	const uint64_t* rows = (const uint64_t*)storedOffsets;
+	const ViaPair* stored = (const ViaPair*)storedPairsData;
+	if(!validOffsets(rows, n, storedPairs))
+		return false;
+	for(uint64_t p = 0; p < storedPairs; ++p)
+		if(stored[p].first >= n || stored[p].second >= n)
+			return false;
+
+	if(identity)
+	{
+		// the file is used in place
+		const uint64_t* reverseRows = (const uint64_t*)storedReverseOffsets;
+		const id_t* partners = (const id_t*)storedPartners;
+		const id_t* vias = (const id_t*)storedVias;
+		if(!validOffsets(reverseRows, n, storedPairs))
+			return false;
+		for(uint64_t p = 0; p < storedPairs; ++p)
+			if(partners[p] >= n || vias[p] >= n)
+				return false;
+
+		file.adviseRandom();
+		mapping = std::move(file);
+		offsetsData = rows;
+		pairsData = stored;
+		reverseOffsetsData = reverseRows;
+		reversePartnersData = partners;
+		reverseViasData = vias;
+		pairsTotal = storedPairs;
+		return true;
+	}
+
+	// stored index was built for a different consensus; drop relays not present in this one
+	size_t relaysCount = fingerprints.size();
+	std::vector<uint64_t> counts(relaysCount + 1, 0);
+	for(size_t via = 0; via < n; ++via)
+		if(translation[via] != NOT_FOUND)
+			for(uint64_t p = rows[via]; p < rows[via + 1]; ++p)
+				if(translation[stored[p].first] != NOT_FOUND && translation[stored[p].second] != NOT_FOUND)
+					++counts[translation[via] + 1];
+	for(size_t via = 0; via < relaysCount; ++via)
+		counts[via + 1] += counts[via];
+
+	offsets = counts;
+	pairs.resize(offsets[relaysCount]);
+	for(size_t via = 0; via < n; ++via)
+		if(translation[via] != NOT_FOUND)
+			for(uint64_t p = rows[via]; p < rows[via + 1]; ++p)
+			{
+				id_t first = translation[stored[p].first];
+				id_t second = translation[stored[p].second];
+				if(first != NOT_FOUND && second != NOT_FOUND)
+					pairs[counts[translation[via]]++] = ViaPair{ first, second };
+			}
+	usePrivateStorage();
+	return true;
+}
+
+bool ViaPairIndex::save(const std::string& fileName, const FingerprintIndex& fingerprints) const
+{
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if(!file.is_open())
+		return false;
+
+	uint32_t count = (uint32_t)size();
+	uint64_t total = pairsCount();
+	file.write(MAGIC, sizeof(MAGIC));
+	file.write((const char*)&VERSION, sizeof(VERSION));
+	file.write((const char*)&count, sizeof(count));
+	file.write((const char*)&total, sizeof(total));
+	for(size_t i = 0; i < count; ++i)
+		file.write((const char*)fingerprints.getDigest(i).data(), FINGERPRINT_LENGTH);
+	const char padding[8] = { 0 };
+	size_t written = HEADER_SIZE + count * FINGERPRINT_LENGTH;
+	file.write(padding, align8(written) - written);
+	file.write((const char*)offsetsData, ((size_t)count + 1) * sizeof(uint64_t));
+	file.write((const char*)pairsData, total * sizeof(ViaPair));
+	file.write((const char*)reverseOffsetsData, ((size_t)count + 1) * sizeof(uint64_t));
+	file.write((const char*)reversePartnersData, total * sizeof(id_t));
+	file.write((const char*)reverseViasData, total * sizeof(id_t));
+	return file.good();
+}
+
+void ViaPairIndex::buildReverse(unsigned threads)
+{
+	size_t relaysCount = size();
+	reverseOffsets.assign(relaysCount + 1, 0);
+	for(const auto& pair : pairs)
+		++reverseOffsets[std::min(pair.first, pair.second) + 1];
+	for(size_t i = 0; i < relaysCount; ++i)
+		reverseOffsets[i + 1] += reverseOffsets[i];
+
+	// rows are indexed by the smaller relay, entries hold the greater relay and the via
+	std::vector<uint64_t> entries(pairs.size());
+	std::vector<uint64_t> cursors(reverseOffsets.begin(), reverseOffsets.end() - 1);
+	for(size_t via = 0; via < relaysCount; ++via)
+		for(uint64_t p = offsets[via]; p < offsets[via + 1]; ++p)
+		{
+			id_t low = std::min(pairs[p].first, pairs[p].second);
+			id_t high = std::max(pairs[p].first, pairs[p].second);
+			entries[cursors[low]++] = ((uint64_t)high << 32) | via;
+		}
+
+	reversePartners.resize(entries.size());
+	reverseVias.resize(entries.size());
+	size_t blocks = std::max(1u, threads) * 4;
+	WorkManager::runAll(threads, blocks, [&](size_t b) {
+		for(size_t row = b; row < relaysCount; row += blocks)
+		{
+			std::sort(entries.begin() + reverseOffsets[row], entries.begin() + reverseOffsets[row + 1]);
+			for(uint64_t e = reverseOffsets[row]; e < reverseOffsets[row + 1]; ++e)
+			{
+				reversePartners[e] = (id_t)(entries[e] >> 32);
+				reverseVias[e] = (id_t)entries[e];
+			}
+		}
+	});
+	usePrivateStorage();
+}
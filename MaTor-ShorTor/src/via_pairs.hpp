@@ -0,0 +1,185 @@
+#ifndef VIA_PAIRS_HPP
+#define VIA_PAIRS_HPP
+
+/** @file */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <thread>
+
+#include "fingerprint_index.hpp"
+#include "types/mapped_file.hpp"
+
+/**
+ * Pair of relays (positions in consensus) connected through a via relay.
+ */
+struct ViaPair
+{
+	uint32_t first; /**< First relay of the pair. */
+	uint32_t second; /**< Second relay of the pair. */
+};
+
+/**
+ * Index of [ShorTor] via relays, stored as compressed sparse rows (CSR).
+ * For every via relay it keeps the pairs of relays which may use it as a via (forward index),
+ * and for every (unordered) pair of relays the via relays it may use (reverse index).
+ * Relays are identified by their position in consensus.
+ *
+ * The index is read either from the all-pairs CSV file
+ * (rows of fingerprints: via, first relay of pair 1, second relay of pair 1, first relay of pair 2, ...)
+ * or from the binary sidecar file written next to it (see save()).
+ * Fingerprints unknown to the consensus are skipped.
+ *
+ * If the binary index was written for relays in the consensus order, it is not copied:
+ * the index refers to the read-only mapping of the file, so processes loading the same consensus
+ * share a single copy of the index in the page cache.
+ */
+class ViaPairIndex
+{
+	public:
+		typedef uint32_t id_t; /**< Relay position. */
+
+		/**
+		 * Contiguous read-only range of index entries.
+		 */
+		template <typename T>
+		class Range
+		{
+			public:
+				Range(const T* first, const T* last) : first(first), last(last) { }
+
+				const T* begin() const { return first; }
+				const T* end() const { return last; }
+				size_t size() const { return last - first; }
+				bool empty() const { return first == last; }
+				const T& operator[](size_t i) const { return first[i]; }
+
+			private:
+				const T* first; /**< First element of the range. */
+				const T* last; /**< Element after the last one. */
+		};
+
+		// constructors
+		/**
+		 * Creates index of given number of relays with no pairs.
+		 * @param relaysCount number of relays in consensus.
+		 */
+		ViaPairIndex(size_t relaysCount = 0);
+
+		/**
+		 * Loads via pairs for relays of a consensus.
+		 * If fileName is a binary index, or the sidecar fileName + ".bin" exists, is not older than fileName
+		 * and covers all consensus relays, the binary index is used.
+		 * Otherwise the CSV file is parsed in parallel and the sidecar is (re)written.
+		 * @param fileName name of the all-pairs CSV file (or of a binary index).
+		 * @param fingerprints fingerprints of consensus relays.
+		 * @param threads number of threads used for parsing.
+		 */
+		ViaPairIndex(const std::string& fileName, const FingerprintIndex& fingerprints,
+			unsigned threads = std::thread::hardware_concurrency());
+
+		ViaPairIndex(const ViaPairIndex&) = delete;
+		ViaPairIndex& operator=(const ViaPairIndex&) = delete;
+
+		// functions
+		/**
+		 * @return number of relays in the index.
+		 */
+		size_t size() const { return relaysCount; }
+
+		/**
+		 * @return total number of pairs in the index.
+		 */
+		size_t pairsCount() const { return pairsTotal; }
+
+		/**
+		 * @return true iff the index refers to a mapped binary index file (shared with other processes).
+		 */
+		bool isMapped() const { return mapping.is_open(); }
+
+		/**
+		 * @return approximate number of private bytes used by the index (mapped file is not counted).
+		 */
+		size_t memoryUsage() const
+		{
+			return (offsets.capacity() + reverseOffsets.capacity()) * sizeof(uint64_t) + pairs.capacity() * sizeof(ViaPair)
+				+ (reversePartners.capacity() + reverseVias.capacity()) * sizeof(id_t);
+		}
+
+		/**
+		 * @param via via relay's position in consensus.
+		 * @return pairs of relays which may use the relay as a via.
+		 */
+		Range<ViaPair> getPairs(size_t via) const
+		{
+			return Range<ViaPair>(pairsData + offsetsData[via], pairsData + offsetsData[via + 1]);
+		}
+
+		/**
+		 * @param first position of the first relay of a pair.
+		 * @param second position of the second relay of a pair.
+		 * @return via relays which may be used by the pair (in either order), sorted and possibly repeated.
+		 */
+		Range<id_t> getVias(size_t first, size_t second) const;
+
+		/**
+		 * Saves the index in binary format.
+		 * Format (native byte order): magic "MATORVIA", uint32 version, uint32 relays count n, uint64 pairs count m,
+		 * n fingerprints (20-byte digests), padding to 8 bytes, n + 1 uint64 row offsets, m pairs of uint32,
+		 * n + 1 uint64 reverse row offsets, m uint32 reverse partners, m uint32 reverse vias.
+		 * All positions are relative, so the file may be mapped at any address.
+		 * @param fileName name of the output file.
+		 * @param fingerprints fingerprints of consensus relays.
+		 * @return true iff the file was written successfully.
+		 */
+		bool save(const std::string& fileName, const FingerprintIndex& fingerprints) const;
+
+		/**
+		 * @param fileName name of the all-pairs CSV file.
+		 * @return name of the binary sidecar of the file.
+		 */
+		static std::string sidecarName(const std::string& fileName) { return fileName + ".bin"; }
+
+	private:
+		/**
+		 * Parses the all-pairs CSV file.
+		 * @return false if the file cannot be opened.
+		 */
+		bool loadCSV(const std::string& fileName, const FingerprintIndex& fingerprints, unsigned threads);
+
+		/**
+		 * Reads binary index, mapping its relays to the given fingerprints.
+		 * Index stored in consensus order is used in place (the file stays mapped),
+		 * otherwise forward index is translated to private storage.
+		 * @return false if the file is not a valid binary index or does not cover all fingerprints.
+		 */
+		bool loadBinary(const std::string& fileName, const FingerprintIndex& fingerprints);
+
+		/**
+		 * Builds reverse index from the forward one.
+		 */
+		void buildReverse(unsigned threads);
+
+		/**
+		 * Points the index to its private storage.
+		 */
+		void usePrivateStorage();
+
+		size_t relaysCount; /**< Number of relays. */
+		uint64_t pairsTotal; /**< Number of pairs. */
+		const uint64_t* offsetsData; /**< Row offsets of the forward index (private or mapped). */
+		const ViaPair* pairsData; /**< Pairs of the forward index (private or mapped). */
+		const uint64_t* reverseOffsetsData; /**< Row offsets of the reverse index (private or mapped). */
+		const id_t* reversePartnersData; /**< Greater relays of the reverse index (private or mapped). */
+		const id_t* reverseViasData; /**< Vias of the reverse index (private or mapped). */
+		MappedFile mapping; /**< Mapped binary index the index refers to (if any). */
+
+		std::vector<uint64_t> offsets; /**< Row offsets of the forward index (pairs of via i are in [offsets[i], offsets[i+1])). */
+		std::vector<ViaPair> pairs; /**< Pairs of the forward index, in order of appearance in the file. */
+		std::vector<uint64_t> reverseOffsets; /**< Row offsets of the reverse index, rows are indexed by the smaller relay of a pair. */
+		std::vector<id_t> reversePartners; /**< Greater relay of a pair, sorted within each row. */
+		std::vector<id_t> reverseVias; /**< Via relay used by the pair (parallel to reversePartners). */
+};
+
+#endif
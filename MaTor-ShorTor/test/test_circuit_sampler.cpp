@@ -0,0 +1,172 @@
+#define TEST_NAME "CircuitSampler"
+
+#include "stdafx.h"
+
+#include <scenario.hpp>
+#include <circuit_sampler.hpp>
+#include <generic_precise_anonymity.hpp>
+
+#include <atomic>
+
+#define CONSENSUS_PATH DATAPATH "2014-10-04-05-00-00-consensus-filtered-fast"
+
+/**
+ * Path selection counting evaluations of entry and middle probabilities of another one.
+ * Rows are computed from single probabilities (the default), so they are counted as well.
+ */
+class CountingPathSelection : public PathSelection
+{
+	public:
+		CountingPathSelection(const PathSelection& pathSelection)
+			: PathSelection(nullptr, nullptr, nullptr, pathSelection.getConsensus()), pathSelection(pathSelection), evaluations(0) { }
+
+		probability_t exitProb(size_t exit) const
+		{
+			return pathSelection.exitProb(exit);
+		}
+
+		probability_t entryProb(size_t entry, size_t exit) const
+		{
+			++evaluations;
+			return pathSelection.entryProb(entry, exit);
+		}
+
+		probability_t middleProb(size_t middle, size_t entry, size_t exit) const
+		{
+			++evaluations;
+			return pathSelection.middleProb(middle, entry, exit);
+		}
+
+		void probabilityBounds(probability_t* entryBounds, probability_t* middleBounds, unsigned threads) const
+		{
+			pathSelection.probabilityBounds(entryBounds, middleBounds, threads);
+		}
+
+		const PathSelection& pathSelection; /**< Path selection giving the probabilities. */
+		mutable std::atomic<uint64_t> evaluations; /**< Number of evaluated entry and middle probabilities. */
+};
+
+struct CircuitSamplerFixture
+{
+	Consensus consensus;
+	size_t size;
+	std::shared_ptr<SenderSpec> senderA, senderB;
+	std::shared_ptr<RecipientSpec> recipient1, recipient2;
+
+	// observations of the adversary (as in MATor::preparePreciseCalculation())
+	const_vector<const_vector<bool>> observedNodes;
+	const_vector<bool> observedSenderA, observedSenderB, observedRecipient1, observedRecipient2;
+
+	CircuitSamplerFixture() : consensus(CONSENSUS_PATH, "", "", false), size(consensus.getSize()),
+		senderA(std::make_shared<SenderSpec>("144.118.66.83", 39.9597, -75.1968)),
+		senderB(std::make_shared<SenderSpec>("85.10.20.30", 52.52, 13.40)),
+		recipient1(std::make_shared<RecipientSpec>("130.83.47.181", 49.8719, 8.6484)),
+		recipient2(std::make_shared<RecipientSpec>("8.8.8.8", 37.4, -122.1)),
+		observedNodes(size, size, false), observedSenderA(size, false), observedSenderB(size, false),
+		observedRecipient1(size, false), observedRecipient2(size, false)
+	{
+		recipient1->ports.insert(443);
+		recipient2->ports.insert(443);
+		recipient2->ports.insert(6667);
+	}
+
+	/**
+	 * Compromises a relay.
+	 */
+	void compromise(size_t relay)
+	{
+		for(size_t j = 0; j < size; ++j)
+			observedNodes[relay][j] = observedNodes[j][relay] = true;
+		observedSenderA[relay] = observedSenderB[relay] = true;
+		observedRecipient1[relay] = observedRecipient2[relay] = true;
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(CircuitSamplerSuite, CircuitSamplerFixture)
+
+BOOST_AUTO_TEST_CASE(CircuitSampler_MatchesPrecise)
+{
+	auto specA = std::make_shared<PSTorSpec>();
+	auto specB = std::make_shared<PSUniformSpec>();
+	auto psA1 = Scenario::makePathSelection(specA, senderA, recipient1, consensus);
+	auto psA2 = Scenario::makePathSelection(specA, senderA, recipient2, consensus);
+	auto psB1 = Scenario::makePathSelection(specB, senderB, recipient1, consensus);
+	auto psB2 = Scenario::makePathSelection(specB, senderB, recipient2, consensus);
+	for(size_t relay = 0; relay < size; relay += 5)
+		compromise(relay);
+
+	GenericPreciseAnonymity precise(consensus, *psA1, *psA2, *psB1, *psB2, observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2);
+	CircuitSampler sampler(consensus, *psA1, *psA2, *psB1, *psB2);
+	CircuitSampler::Settings settings;
+	settings.targetError = 0.002;
+	CircuitSampler::Estimate estimate = sampler.estimate(observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2, settings);
+
+	// the seed is fixed, estimates are deterministic and within twice the (95%) confidence interval
+	BOOST_CHECK(estimate.samples > 0);
+	BOOST_CHECK(estimate.sender.halfWidth <= settings.targetError);
+	BOOST_CHECK(estimate.recipient.halfWidth <= settings.targetError);
+	BOOST_CHECK(estimate.relationship.halfWidth <= settings.targetError);
+	BOOST_CHECK_SMALL(estimate.sender.delta - precise.senderAnonymity(), 2 * estimate.sender.halfWidth + 1e-9);
+	BOOST_CHECK_SMALL(estimate.recipient.delta - precise.recipientAnonymity(), 2 * estimate.recipient.halfWidth + 1e-9);
+	BOOST_CHECK_SMALL(estimate.relationship.delta - precise.relationshipAnonymity(), 2 * estimate.relationship.halfWidth + 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(CircuitSampler_Reproducible)
+{
+	auto spec = std::make_shared<PSTorSpec>();
+	auto ps1 = Scenario::makePathSelection(spec, senderA, recipient1, consensus);
+	auto ps2 = Scenario::makePathSelection(spec, senderA, recipient2, consensus);
+	compromise(1);
+	compromise(4);
+
+	// senders with the same path selection can not be distinguished without observing them
+	CircuitSampler sampler(consensus, *ps1, *ps2, *ps1, *ps2);
+	CircuitSampler::Settings settings;
+	settings.seed = 42;
+	settings.maxSamples = 1 << 18;
+	settings.threads = 1;
+	CircuitSampler::Estimate single = sampler.estimate(observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2, settings);
+	settings.threads = 4;
+	CircuitSampler::Estimate parallel = sampler.estimate(observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2, settings);
+
+	// results depend on the seed, not on the number of threads
+	BOOST_CHECK_EQUAL(single.samples, parallel.samples);
+	BOOST_CHECK_EQUAL(single.sender.delta, parallel.sender.delta);
+	BOOST_CHECK_EQUAL(single.recipient.delta, parallel.recipient.delta);
+	BOOST_CHECK_EQUAL(single.relationship.delta, parallel.relationship.delta);
+	BOOST_CHECK_EQUAL(single.relationship.halfWidth, parallel.relationship.halfWidth);
+
+	settings.seed = 43;
+	CircuitSampler::Estimate other = sampler.estimate(observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2, settings);
+	BOOST_CHECK(other.recipient.delta != single.recipient.delta);
+}
+
+BOOST_AUTO_TEST_CASE(CircuitSampler_UnseenObservations)
+{
+	auto spec = std::make_shared<PSTorSpec>();
+	auto ps1 = Scenario::makePathSelection(spec, senderA, recipient1, consensus);
+	auto ps2 = Scenario::makePathSelection(spec, senderA, recipient2, consensus);
+	CountingPathSelection counting1(*ps1), counting2(*ps2);
+	compromise(1);
+
+	// nearly every circuit is observed as no relay (relationship anonymity), just its guard or just its exit,
+	// masses of such observations cost few evaluations per guard and exit, not one for every circuit
+	CircuitSampler sampler(consensus, counting1, counting2, counting1, counting2);
+	CircuitSampler::Settings settings;
+	settings.chunkSamples = 1 << 10;
+	settings.chunksPerBatch = 1;
+	settings.maxSamples = 1 << 10;
+	settings.threads = 2;
+	counting1.evaluations = counting2.evaluations = 0;
+	CircuitSampler::Estimate estimate = sampler.estimate(observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2, settings);
+	BOOST_CHECK_EQUAL(estimate.samples, 1 << 10);
+
+	// masses of two scenarios for each path selection, with an entry and two middle probabilities for every guard and exit
+	// (drawn circuits add a few evaluations each)
+	uint64_t bound = 2 * 3 * size * size + 64 * estimate.samples;
+	BOOST_CHECK_LE(counting1.evaluations, bound);
+	BOOST_CHECK_LE(counting2.evaluations, bound);
+	BOOST_CHECK(counting1.evaluations < size * size * size);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,101 @@
+#define TEST_NAME "ConsensusCache"
+
+#include "stdafx.h"
+
+#include <consensus_cache.hpp>
+
+#include <fstream>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#define CONSENSUS_PATH DATAPATH "test_consensus.txt" // Made To Measure(TM)
+#define COPY_PATH "test_consensus_cache.txt" // written by the fixture
+
+struct ConsensusCacheFixture
+{
+	ConsensusCache& cache;
+
+	ConsensusCacheFixture() : cache(ConsensusCache::instance())
+	{
+		cache.clear();
+		cache.setBudget(ConsensusCache::DEFAULT_BUDGET);
+		copy();
+	}
+
+	~ConsensusCacheFixture()
+	{
+		cache.clear();
+		cache.setBudget(ConsensusCache::DEFAULT_BUDGET);
+		std::remove(COPY_PATH);
+	}
+
+	void copy(const std::string& suffix = "")
+	{
+		std::ifstream input(CONSENSUS_PATH, std::ios::binary);
+		std::ofstream output(COPY_PATH, std::ios::binary);
+		output << input.rdbuf() << suffix;
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(ConsensusCacheSuite, ConsensusCacheFixture)
+
+BOOST_AUTO_TEST_CASE(ConsensusCache_Shared)
+{
+	auto first = cache.get(CONSENSUS_PATH, "", "", false);
+	auto second = cache.get(CONSENSUS_PATH, "", "", false);
+	BOOST_CHECK(first == second);
+	BOOST_CHECK_EQUAL(first->getSize(), 5);
+	BOOST_CHECK_EQUAL(cache.size(), 1);
+	BOOST_CHECK_EQUAL(cache.memoryUsage(), first->memoryUsage());
+
+	// different switch, different consensus
+	auto vias = cache.get(CONSENSUS_PATH, "", "", true);
+	BOOST_CHECK(vias != first);
+	BOOST_CHECK_EQUAL(cache.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusCache_Concurrent)
+{
+	std::vector<std::shared_ptr<const Consensus>> loaded(8);
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < loaded.size(); ++i)
+		threads.emplace_back([&, i]() { loaded[i] = cache.get(CONSENSUS_PATH, "", "", false); });
+	for(auto& thread : threads)
+		thread.join();
+	for(const auto& consensus : loaded)
+		BOOST_CHECK(consensus == loaded[0]);
+	BOOST_CHECK_EQUAL(cache.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusCache_ModifiedFile)
+{
+	auto first = cache.get(COPY_PATH, "", "", false);
+	copy("\n");
+	auto second = cache.get(COPY_PATH, "", "", false);
+	BOOST_CHECK(first != second);
+	BOOST_CHECK_EQUAL(second->getSize(), first->getSize());
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusCache_Budget)
+{
+	auto first = cache.get(CONSENSUS_PATH, "", "", false);
+	cache.setBudget(first->memoryUsage());
+	auto second = cache.get(COPY_PATH, "", "", false);
+	// least recently used consensus is dropped, but stays valid for its holders
+	BOOST_CHECK_EQUAL(cache.size(), 1);
+	BOOST_CHECK_EQUAL(first->getSize(), 5);
+	BOOST_CHECK(cache.get(COPY_PATH, "", "", false) == second);
+
+	cache.setBudget(0);
+	BOOST_CHECK_EQUAL(cache.size(), 0);
+	BOOST_CHECK_EQUAL(cache.memoryUsage(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusCache_MissingFile)
+{
+	BOOST_CHECK_THROW(cache.get("nonexistent_consensus.txt", "", "", false), consensus_exception);
+	BOOST_CHECK_EQUAL(cache.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
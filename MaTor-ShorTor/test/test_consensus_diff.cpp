@@ -0,0 +1,176 @@
+#define TEST_NAME "ConsensusDiff"
+
+#include "stdafx.h"
+
+#include <consensus_diff.hpp>
+#include <relationship_manager.hpp>
+#include <relay_metadata.hpp>
+#include <asmap.hpp>
+#include <sender_spec.hpp>
+#include <recipient_spec.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#define CONSENSUS_PATH DATAPATH "test_consensus.txt" // Made To Measure(TM)
+#define DB_PATH DATAPATH "test_database.sqlite" // Made To Measure(TM)
+#define NEXT_CONSENSUS_PATH "test_consensus_diff.txt" // written by the fixture
+#define NETWORK_PATH "test_network.txt" // written by ConsensusDiff_ASRelations
+
+struct ConsensusDiffFixture
+{
+	Consensus old;
+	std::unique_ptr<Consensus> next;
+
+	/**
+	 * Writes the next consensus: relay 0xcaca0 leaves, GoElephantGoGoGo moves to subnet of torpidsUShostwinds
+	 * and a new relay joins subnet of PetitOignonVert.
+	 */
+	ConsensusDiffFixture() : old(CONSENSUS_PATH, DB_PATH, "", false)
+	{
+		std::ifstream input(CONSENSUS_PATH, std::ios::binary);
+		std::ostringstream output;
+		std::string line;
+		bool skip = false;
+		while(std::getline(input, line))
+		{
+			if(line.compare(0, 2, "r ") == 0)
+				skip = line.find(" 0xcaca0 ") != std::string::npos;
+			else if(line.compare(0, 16, "directory-footer") == 0)
+			{
+				output << "r newcomer AAAAAAAAAAAAAAAAAAAAAAAAAAA AAAAAAAAAAAAAAAAAAAAAAAAAAA 2014-10-20 18:00:00 176.221.46.1 9001 0\n";
+				output << "s Fast Guard Running Stable Valid\n";
+				output << "w Bandwidth=500\n";
+				output << "p reject 1-65535\n";
+				skip = false;
+			}
+			if(skip)
+				continue;
+			size_t address = line.find(" 82.209.187.254 ");
+			if(address != std::string::npos)
+				line.replace(address, 16, " 192.236.132.1 ");
+			output << line << "\n";
+		}
+		std::ofstream(NEXT_CONSENSUS_PATH, std::ios::binary) << output.str();
+		next = std::unique_ptr<Consensus>(new Consensus(NEXT_CONSENSUS_PATH, DB_PATH, "", false));
+	}
+
+	~ConsensusDiffFixture()
+	{
+		std::remove(NEXT_CONSENSUS_PATH);
+		std::remove(RelayMetadataFile::sidecarName(NEXT_CONSENSUS_PATH).c_str());
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(ConsensusDiffSuite, ConsensusDiffFixture)
+
+BOOST_AUTO_TEST_CASE(ConsensusDiff_Mapping)
+{
+	BOOST_REQUIRE_EQUAL(old.getSize(), 5);
+	BOOST_REQUIRE_EQUAL(next->getSize(), 5);
+
+	ConsensusDiff diff(old, *next);
+	BOOST_REQUIRE_EQUAL(diff.size(), 5);
+	BOOST_CHECK_EQUAL(diff.oldSize(), 5);
+	BOOST_CHECK_EQUAL(diff.getOldPosition(0), 0);
+	BOOST_CHECK_EQUAL(diff.getOldPosition(1), 1);
+	BOOST_CHECK_EQUAL(diff.getOldPosition(2), 3);
+	BOOST_CHECK_EQUAL(diff.getOldPosition(3), 4);
+	BOOST_CHECK_EQUAL(diff.getOldPosition(4), FingerprintIndex::NOT_FOUND);
+
+	BOOST_REQUIRE_EQUAL(diff.getRemoved().size(), 1);
+	BOOST_CHECK_EQUAL(diff.getRemoved()[0], 2);
+
+	std::vector<size_t> changed = { 2, 4 };
+	BOOST_CHECK(diff.getChanged() == changed);
+	BOOST_CHECK(!diff.isChanged(0));
+	BOOST_CHECK(diff.isChanged(2));
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusDiff_SubnetGroups)
+{
+	for(const Consensus* consensus : { &old, next.get() })
+	{
+		SubnetRelations relations(*consensus);
+		const RelayTable& table = consensus->getRelayTable();
+		size_t size = consensus->getSize(), members = 0;
+		for(size_t i = 0; i < size; ++i)
+			for(size_t j = 0; j < size; ++j)
+			{
+				const IP& address = consensus->getRelay(i).getAddress();
+				BOOST_CHECK_EQUAL(relations.exitEntryRelated(i, j), address.isSubnet(consensus->getRelay(j).getAddress()) || consensus->isRelated(i, j));
+			}
+		for(size_t s = 0; s < table.subnetsCount(); ++s)
+			for(const uint32_t* member = table.subnetBegin(s); member != table.subnetEnd(s); ++member, ++members)
+				BOOST_CHECK_EQUAL(table.getSubnetID(*member), s);
+		BOOST_CHECK_EQUAL(members, size);
+	}
+	SubnetRelations nextRelations(*next);
+	BOOST_CHECK(nextRelations.exitEntryRelated(0, 2));
+	BOOST_CHECK(nextRelations.exitEntryRelated(1, 4));
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusDiff_ASRelations)
+{
+	// every route crosses AS of its relay, route exit 0 - recipient crosses also AS of entry 3
+	auto sender = std::make_shared<SenderSpec>("1.1.1.1");
+	auto recipient = std::make_shared<RecipientSpec>("2.2.2.2");
+	size_t size = old.getSize();
+	{
+		std::ofstream network(NETWORK_PATH);
+		for(size_t i = 0; i < size; ++i)
+		{
+			std::string address = old.getRelay(i).getAddress();
+			network << "1.1.1.1\t" << address << "\tAS1 E" << i << "\n";
+			network << address << "\t2.2.2.2\tAS2 X" << i << (i == 0 ? " E3" : "") << "\n";
+		}
+	}
+	auto asmap = std::make_shared<ASMap>(old, sender, sender, recipient, recipient, NETWORK_PATH);
+	std::remove(NETWORK_PATH);
+	std::remove("debug.txt");
+	BOOST_CHECK_EQUAL(asmap->as_count(), 2 + 2 * size);
+	
+	SubnetRelations subnet(old);
+	ASRelations relations(old, sender->address, recipient->address, asmap);
+	ASRelations withoutMap(old, sender->address, recipient->address);
+	std::vector<uint64_t> row(PackedSymmetricMatrix<bool>::wordsFor(size));
+	for(size_t i = 0; i < size; ++i)
+	{
+		for(size_t j = 0; j < size; ++j)
+		{
+			bool expected = subnet.exitEntryRelated(i, j) || (i == 0 && j == 3);
+			BOOST_CHECK_EQUAL(relations.exitEntryRelated(i, j), expected);
+			BOOST_CHECK_EQUAL(withoutMap.exitEntryRelated(i, j), subnet.exitEntryRelated(i, j));
+		}
+		relations.relatedRow(RelationshipManager::Relation::EXIT_ENTRY, i, size, row.data());
+		for(size_t j = 0; j < size; ++j)
+			BOOST_CHECK_EQUAL((bool)((row[j / 64] >> (j % 64)) & 1), relations.exitEntryRelated(i, j));
+	}
+	
+	// relations of another consensus are not taken from the map
+	ASRelations other(*next, sender->address, recipient->address, asmap);
+	SubnetRelations nextSubnet(*next);
+	for(size_t i = 0; i < next->getSize(); ++i)
+		for(size_t j = 0; j < next->getSize(); ++j)
+			BOOST_CHECK_EQUAL(other.exitEntryRelated(i, j), nextSubnet.exitEntryRelated(i, j));
+	
+	// only exit 0 is possible, so entry 3 can not be chosen
+	std::vector<bool> exitPossible(size, false), entryPossible(size, true);
+	exitPossible[0] = true;
+	relations.assignConstraints(exitPossible, entryPossible);
+	BOOST_CHECK(exitPossible[0]);
+	BOOST_CHECK(!entryPossible[3]);
+	for(size_t j = 0; j < size; ++j)
+		BOOST_CHECK_EQUAL(entryPossible[j], !relations.exitEntryRelated(0, j));
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusDiff_Identical)
+{
+	Consensus same(old);
+	ConsensusDiff diff(old, same);
+	BOOST_CHECK(diff.getChanged().empty());
+	BOOST_CHECK(diff.getRemoved().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,85 @@
+#define TEST_NAME "ConsensusParser"
+
+#include "stdafx.h"
+
+#include <consensus.hpp>
+
+#define CONSENSUS_PATH DATAPATH "2014-10-04-05-00-00-consensus-filtered"
+
+struct ConsensusParserFixture
+{
+	Consensus c;
+
+	ConsensusParserFixture() : c(CONSENSUS_PATH, "", "", false) {} // no database, no vias
+};
+
+BOOST_FIXTURE_TEST_SUITE(ConsensusParserSuite, ConsensusParserFixture)
+
+BOOST_AUTO_TEST_CASE(ConsensusParser_Relays)
+{
+	BOOST_REQUIRE_EQUAL(c.getSize(), 1009);
+
+	const Relay& first = c.getRelay(0);
+	BOOST_CHECK_EQUAL(first.getName(), "TelosTorExit5");
+	BOOST_CHECK_EQUAL(first.getFingerprint(), "0078FFEABB3B87512DD6701C2930D8FCA128F97D");
+	BOOST_CHECK_EQUAL(first.getPublishedDate(), "2014-10-03 23:23:47");
+	BOOST_CHECK_EQUAL(std::string(first.getAddress()), "62.210.74.143");
+	BOOST_CHECK_EQUAL(first.getVersion(), "0.2.5.8-rc");
+	BOOST_CHECK_EQUAL(first.getBandwidth(), 31800);
+	BOOST_CHECK_EQUAL(first.getFlags(), RelayFlag::EXIT | RelayFlag::FAST | RelayFlag::GUARD | RelayFlag::HS_DIR |
+		RelayFlag::RUNNING | RelayFlag::STABLE | RelayFlag::V2_DIR | RelayFlag::VALID);
+
+	BOOST_CHECK_EQUAL(c.getRelay(1).getName(), "metwork2");
+	BOOST_CHECK_EQUAL(c.getRelay(1).hasFlags(RelayFlag::EXIT), false);
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusParser_Weights)
+{
+	BOOST_CHECK_EQUAL(c.getMaxModifier(), 10000);
+	BOOST_CHECK_EQUAL(c.getWeightModifier(RelayRole::EXIT_ROLE, RelayFlag::GUARD | RelayFlag::EXIT), 8397);
+	BOOST_CHECK_EQUAL(c.getWeightModifier(RelayRole::ENTRY_ROLE, RelayFlag::GUARD), 6361);
+	BOOST_CHECK_EQUAL(c.getWeightModifier(RelayRole::MIDDLE_ROLE, RelayFlag::EXIT), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusParser_RelayTable)
+{
+	const RelayTable& table = c.getRelayTable();
+	BOOST_REQUIRE_EQUAL(table.size(), c.getSize());
+	for(size_t i = 0; i < c.getSize(); ++i)
+	{
+		const Relay& relay = c.getRelay(i);
+		BOOST_CHECK_EQUAL(table.getFlags(i), relay.getFlags());
+		BOOST_CHECK_EQUAL(table.getBandwidth(i), relay.getBandwidth());
+		BOOST_CHECK_EQUAL(table.getPrefix(i), relay.getSubnet());
+		BOOST_CHECK_EQUAL(table.getCountries()[table.getCountryID(i)], relay.getCountry());
+	}
+
+	c.forceSetRelayFlag(0, RelayFlag::BAD_EXIT, true);
+	BOOST_CHECK(table.hasFlags(0, RelayFlag::BAD_EXIT | RelayFlag::EXIT));
+	BOOST_CHECK_EQUAL(table.findCountryID("no such country"), RelayTable::NOT_FOUND);
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusParser_FingerprintIndex)
+{
+	for(size_t i = 0; i < c.getSize(); ++i)
+		BOOST_CHECK_EQUAL(c.findRelayIndexByFingerprint(c.getRelay(i).getFingerprint()), i);
+
+	BOOST_CHECK_EQUAL(c.findRelayIndexByFingerprint("0078ffeabb3b87512dd6701c2930d8fca128f97d"), 0);
+	BOOST_CHECK_EQUAL(c.findRelayIndexByFingerprint("0000000000000000000000000000000000000000"), FingerprintIndex::NOT_FOUND);
+	BOOST_CHECK_EQUAL(c.findRelayIndexByFingerprint("0078FFEABB3B87512DD6701C2930D8FCA128F97"), FingerprintIndex::NOT_FOUND);
+	BOOST_CHECK_EQUAL(c.findRelayIndexByFingerprint("0078FFEABB3B87512DD6701C2930D8FCA128F97X"), FingerprintIndex::NOT_FOUND);
+	BOOST_CHECK(c.findRelayByFingerprint("") == nullptr);
+
+	std::vector<int64_t> positions = c.getFingerprintIndex().findAll({ c.getRelay(5).getFingerprint(), "nonsense", c.getRelay(1).getFingerprint() });
+	BOOST_REQUIRE_EQUAL(positions.size(), 3);
+	BOOST_CHECK_EQUAL(positions[0], 5);
+	BOOST_CHECK_EQUAL(positions[1], -1);
+	BOOST_CHECK_EQUAL(positions[2], 1);
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusParser_MissingFile)
+{
+	BOOST_CHECK_THROW(Consensus(DATAPATH "no-such-consensus", "", "", false), consensus_exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
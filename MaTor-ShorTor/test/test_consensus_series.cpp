@@ -0,0 +1,70 @@
+#define TEST_NAME "ConsensusSeries"
+
+#include "stdafx.h"
+
+#include <consensus_series.hpp>
+
+#define CONSENSUS_PATH DATAPATH "test_consensus.txt" // Made To Measure(TM)
+#define DB_PATH DATAPATH "test_database.sqlite" // Made To Measure(TM)
+
+struct ConsensusSeriesFixture
+{
+	ConsensusSeries series;
+
+	ConsensusSeriesFixture() : series({ CONSENSUS_PATH, CONSENSUS_PATH, CONSENSUS_PATH }, DB_PATH, 2) {}
+};
+
+BOOST_FIXTURE_TEST_SUITE(ConsensusSeriesSuite, ConsensusSeriesFixture)
+
+BOOST_AUTO_TEST_CASE(ConsensusSeries_MatchesSingleConsensus)
+{
+	Consensus single(CONSENSUS_PATH, DB_PATH, "", false);
+
+	BOOST_REQUIRE_EQUAL(series.size(), 3);
+	for(size_t c = 0; c < series.size(); ++c)
+	{
+		const Consensus& consensus = *series.get(c);
+		BOOST_REQUIRE_EQUAL(consensus.getSize(), single.getSize());
+		BOOST_CHECK_EQUAL(consensus.getValidAfter(), single.getValidAfter());
+		for(size_t i = 0; i < single.getSize(); ++i)
+		{
+			BOOST_CHECK_EQUAL(consensus.getRelay(i).getCountry(), single.getRelay(i).getCountry());
+			BOOST_CHECK_EQUAL(consensus.getRelay(i).getASNumber(), single.getRelay(i).getASNumber());
+			BOOST_CHECK_EQUAL(consensus.getRelay(i).getAveragedBandwidth(), single.getRelay(i).getAveragedBandwidth());
+			BOOST_CHECK_EQUAL(consensus.getRelay(i).getPolicy().size(), single.getRelay(i).getPolicy().size());
+			for(size_t j = 0; j <= i; ++j)
+				BOOST_CHECK_EQUAL(consensus.isRelated(i, j), single.isRelated(i, j));
+		}
+	}
+
+	BOOST_CHECK_EQUAL(series.get(0)->getRelay(0).getCountry(), "US");
+	BOOST_CHECK(series.get(0)->isRelated(0, 1));
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusSeries_Families)
+{
+	const Consensus& consensus = *series.get(1);
+	for(size_t i = 0; i < consensus.getSize(); ++i)
+	{
+		std::vector<uint32_t> family = consensus.getFamily(i);
+		BOOST_CHECK(std::is_sorted(family.begin(), family.end()));
+		for(size_t j = 0; j < consensus.getSize(); ++j)
+		{
+			BOOST_CHECK_EQUAL(consensus.isRelated(i, j), std::find(family.begin(), family.end(), j) != family.end());
+			BOOST_CHECK_EQUAL(consensus.isRelated(i, j), consensus.isRelated(j, i));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ConsensusSeries_SharesDescriptors)
+{
+	const Consensus& first = *series.get(0);
+	const Consensus& second = *series.get(2);
+	for(size_t i = 0; i < first.getSize(); ++i)
+		BOOST_CHECK(first.getRelay(i).getDescriptor() == second.getRelay(i).getDescriptor());
+
+	BOOST_CHECK_EQUAL(series.descriptorCount(), first.getSize());
+	BOOST_CHECK_LE(series.policyCount(), series.descriptorCount());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,7 +4,11 @@
 
 #include <db_connection.hpp>
 
+#include <fstream>
+#include <cstdio>
+
 #define DB_PATH DATAPATH "test_database.sqlite" // Made To Measure(TM)
+#define DB_COPY_PATH "test_database_copy.sqlite" // written by the test
 #define CONSENSUS_DATE "2014-10-21 02:00:00"
 
 bool isDBOpenException(db_exception const& ex) { return ex.why() == db_exception::reason::DB_OPEN; }
@@ -35,16 +39,30 @@ struct TestConnection
 		};
 	}
 
-	bool TestAreRelated(const std::string& nodeA, const std::string& nodeB, const QueryResult& families)
+	bool TestAreRelated(size_t nodeA, size_t nodeB, const std::vector<DBConnection::FamilyRecord>& families)
 	{
 		for (auto family : families) {
-			if ((family[0] == nodeA && family[1] == nodeB) || (family[1] == nodeA && family[0] == nodeB)) {
+			if ((family.first == nodeA && family.second == nodeB) || (family.second == nodeA && family.first == nodeB)) {
 				return true;
 			}
 		}
 
 		return false;
 	}
+
+	size_t countIndexes(sqlite3* database)
+	{
+		size_t count = 0;
+		for (const auto& name : DBConnection::indexNames()) {
+			std::string query = "SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = '" + name + "'";
+			sqlite3_stmt* statement = NULL;
+			BOOST_REQUIRE_EQUAL(sqlite3_prepare_v2(database, query.c_str(), -1, &statement, NULL), SQLITE_OK);
+			if (sqlite3_step(statement) == SQLITE_ROW)
+				++count;
+			sqlite3_finalize(statement);
+		}
+		return count;
+	}
 };
 
 BOOST_FIXTURE_TEST_SUITE(DBConnectionSuite, TestConnection)
@@ -57,47 +75,67 @@ BOOST_AUTO_TEST_CASE(DBConnection_Initialization)
 	// TODO: add tests for mator-db db creation
 }
 
-BOOST_AUTO_TEST_CASE(ReadRelaysInfo)
+BOOST_AUTO_TEST_CASE(ReadRelays)
 {
-	QueryResult relays;
-	relays = db.readRelaysInfo(fingerprints.begin(), fingerprints.end());
-
-	BOOST_REQUIRE_EQUAL(relays.size(), 13);
-
-	Row get = relays[0];
-	Row expected = {
-		"30427B9A4A5A98367829BF19AD1DCADD7E0F541C",
-		"13631488",
-		"Linux",
-		"reject *:*\n",
-		"US",
-		"36.1554",
-		"-95.9939",
-		"54290",
-		"HOSTWINDS - Hostwinds LLC.,US"
-	};
-
-	for (int i = 0; i < expected.size(); ++i)
-	{
-		BOOST_REQUIRE_EQUAL(expected[i], get[i]);
-	}
+	DBConnection::RelaysInfo info = db.readRelays(fingerprints);
+
+	BOOST_REQUIRE_EQUAL(info.descriptors.size(), 13);
+
+	const DBConnection::DescriptorRecord& get = info.descriptors[0];
+	BOOST_REQUIRE_EQUAL(get.position, 0);
+	BOOST_REQUIRE_EQUAL(get.averagedBandwidth, 13631488);
+	BOOST_REQUIRE_EQUAL(get.platform, "Linux");
+	BOOST_REQUIRE_EQUAL(get.exitPolicy, "reject *:*\n");
+	BOOST_REQUIRE_EQUAL(get.country, "US");
+	BOOST_REQUIRE_CLOSE(get.latitude, 36.1554f, 1e-4);
+	BOOST_REQUIRE_CLOSE(get.longitude, -95.9939f, 1e-4);
+	BOOST_REQUIRE_EQUAL(get.ASNumber, "54290");
+	BOOST_REQUIRE_EQUAL(get.ASName, "HOSTWINDS - Hostwinds LLC.,US");
+
+	for (size_t i = 1; i < info.descriptors.size(); ++i)
+		BOOST_REQUIRE(info.descriptors[i - 1].position <= info.descriptors[i].position);
 }
 
 BOOST_AUTO_TEST_CASE(ReadFamilies)
 {
-	QueryResult families;
-	families = db.readFamilies();
+	std::vector<DBConnection::FamilyRecord> families = db.readRelays(fingerprints).families;
 
 	std::cout << "Families size: " << families.size() << std::endl;
 
 	BOOST_REQUIRE_EQUAL(families.size(), 4);
 
-	BOOST_REQUIRE_EQUAL(TestAreRelated("30427B9A4A5A98367829BF19AD1DCADD7E0F541C", "2A6E08AE74372282F80B56CAB0B350E03B13DA7F", families), true);
-	BOOST_REQUIRE_EQUAL(TestAreRelated("30427B9A4A5A98367829BF19AD1DCADD7E0F541C", "1AFD9C8FF9AB802AEA89487AE8DF36EC736A4EEE", families), true);
-	BOOST_REQUIRE_EQUAL(TestAreRelated("30427B9A4A5A98367829BF19AD1DCADD7E0F541C", "BFEEBAC4BC06E0CC12F600E5B77A1B08A687CCB3", families), true);
-	BOOST_REQUIRE_EQUAL(TestAreRelated("CF01EB12EE0D8EF198F55AB530C6783E8E6BBB8B", "81D8BDAEB86E16AAEC2EB4A395A791E43A73C351", families), true);
+	// positions of fingerprints in the fixture
+	BOOST_REQUIRE_EQUAL(TestAreRelated(0, 1, families), true);
+	BOOST_REQUIRE_EQUAL(TestAreRelated(0, 2, families), true);
+	BOOST_REQUIRE_EQUAL(TestAreRelated(0, 3, families), true);
+	BOOST_REQUIRE_EQUAL(TestAreRelated(8, 9, families), true);
 	
-	BOOST_REQUIRE_EQUAL(TestAreRelated("993E5DD06573565D0112F4CC77D9B4CD016AE0FB", "81D8BDAEB86E16AAEC2EB4A395A791E43A73C351", families), false);
+	BOOST_REQUIRE_EQUAL(TestAreRelated(6, 9, families), false);
+
+	// only queried relays are returned
+	std::vector<std::string> subset(fingerprints.begin(), fingerprints.begin() + 4);
+	BOOST_REQUIRE_EQUAL(db.readRelays(subset).families.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(CreateIndexes)
+{
+	{
+		std::ifstream input(DB_PATH, std::ios::binary);
+		std::ofstream output(DB_COPY_PATH, std::ios::binary);
+		output << input.rdbuf();
+	}
+	sqlite3* database = NULL;
+	BOOST_REQUIRE_EQUAL(sqlite3_open(DB_COPY_PATH, &database), SQLITE_OK);
+	for (const auto& name : DBConnection::indexNames())
+		BOOST_REQUIRE_EQUAL(sqlite3_exec(database, ("DROP INDEX IF EXISTS " + name).c_str(), NULL, NULL, NULL), SQLITE_OK);
+	BOOST_REQUIRE_EQUAL(countIndexes(database), 0);
+
+	DBConnection copy(DB_COPY_PATH, CONSENSUS_DATE);
+	BOOST_CHECK_EQUAL(countIndexes(database), DBConnection::indexNames().size());
+	BOOST_CHECK_EQUAL(copy.readRelays(fingerprints).descriptors.size(), 13);
+
+	sqlite3_close(database);
+	std::remove(DB_COPY_PATH);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,80 @@
+#define TEST_NAME "ExitPolicy"
+
+#include "stdafx.h"
+
+#include <exit_policy.hpp>
+#include <relay_table.hpp>
+
+struct ExitPolicyFixture
+{
+	Relay relay;
+
+	ExitPolicyFixture() : relay(0, "IPredator", "BC630CBBB518BE7E9F4E09712AB0269E9DC7D626", "2014-10-21 02:12:34", "197.231.221.211",
+		RelayFlag::EXIT, 12345, "0.2.6.10") { }
+
+	/**
+	 * Checks that compiled policy agrees with Relay::supportsConnection on every port of the addresses.
+	 */
+	void checkAgainstRelay(const std::vector<std::string>& addresses)
+	{
+		ExitPolicy policy(relay.getPolicy());
+		for(const auto& address : addresses)
+		{
+			IP ip(address);
+			size_t mismatches = 0;
+			for(uint32_t port = 0; port <= 65535; ++port)
+				if(policy.supports(ip, (uint16_t)port) != relay.supportsConnection(ip, (uint16_t)port))
+					++mismatches;
+			BOOST_CHECK_MESSAGE(mismatches == 0, address << ": " << mismatches << " ports differ");
+		}
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(ExitPolicySuite, ExitPolicyFixture)
+
+BOOST_AUTO_TEST_CASE(ExitPolicy_Empty)
+{
+	ExitPolicy policy(relay.getPolicy());
+	BOOST_CHECK(policy.supports(IP("8.8.8.8"), 80));
+	BOOST_CHECK(policy.supports(IP("8.8.8.8"), 0));
+}
+
+BOOST_AUTO_TEST_CASE(ExitPolicy_Ports)
+{
+	relay.addPolicy("accept *:80\nreject *:1-1023\naccept *:1000-2000\nreject *:*");
+	ExitPolicy policy(relay.getPolicy());
+	BOOST_CHECK(policy.supports(IP("8.8.8.8"), 80));
+	BOOST_CHECK(!policy.supports(IP("8.8.8.8"), 443));
+	BOOST_CHECK(!policy.supports(IP("8.8.8.8"), 1000));
+	BOOST_CHECK(policy.supports(IP("8.8.8.8"), 1024));
+	BOOST_CHECK(!policy.supports(IP("8.8.8.8"), 2001));
+	checkAgainstRelay({ "8.8.8.8", "10.1.2.3", "*" });
+}
+
+BOOST_AUTO_TEST_CASE(ExitPolicy_Addresses)
+{
+	relay.addPolicy("reject 0.0.0.0/8:*\nreject 10.0.0.0/8:*\nreject 10.1.0.0/16:443\naccept 10.1.2.0/24:22\n"
+		"reject 197.231.221.211:*\naccept *:20-23\naccept *:443\nreject *:*");
+	ExitPolicy policy(relay.getPolicy());
+	BOOST_CHECK(!policy.supports(IP("10.1.2.3"), 22));
+	BOOST_CHECK(!policy.supports(IP("197.231.221.211"), 443));
+	BOOST_CHECK(policy.supports(IP("8.8.8.8"), 443));
+	BOOST_CHECK(!policy.supports(IP("8.8.8.8"), 80));
+	checkAgainstRelay({ "8.8.8.8", "10.1.2.3", "10.2.0.1", "0.1.2.3", "197.231.221.211", "197.231.221.0/24", "*" });
+}
+
+BOOST_AUTO_TEST_CASE(ExitPolicy_Interned)
+{
+	std::vector<Relay> relays(3, relay);
+	relays[0].addPolicy("accept *:80\nreject *:*");
+	relays[1].addPolicy("accept *:80\nreject *:*"); // parsed separately, equal entries
+	relays[2].addPolicy("accept *:443\nreject *:*");
+	RelayTable table(relays);
+	BOOST_CHECK_EQUAL(table.policiesCount(), 2);
+	BOOST_CHECK_EQUAL(table.getPolicyID(0), table.getPolicyID(1));
+	BOOST_CHECK(table.getPolicyID(0) != table.getPolicyID(2));
+	BOOST_CHECK(table.getPolicy(table.getPolicyID(2)).supports(IP("8.8.8.8"), 443));
+	BOOST_CHECK(!table.getPolicy(table.getPolicyID(2)).supports(IP("8.8.8.8"), 80));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
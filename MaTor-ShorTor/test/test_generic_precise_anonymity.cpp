@@ -0,0 +1,186 @@
+#define TEST_NAME "GenericPreciseAnonymity"
+
+#include "stdafx.h"
+
+#include <scenario.hpp>
+#include <generic_precise_anonymity.hpp>
+
+#include <fstream>
+#include <map>
+#include <array>
+#include <cstdio>
+
+#define CONSENSUS_PATH DATAPATH "2014-10-04-05-00-00-consensus-filtered-fast"
+#define VIAS_PATH "test_precise_via_pairs.csv" // written by the fixture
+#define NONE ((size_t)-1)
+
+struct GenericPreciseAnonymityFixture
+{
+	Consensus plain;
+	size_t size;
+	std::vector<size_t> vias;
+	std::map<std::pair<size_t, size_t>, std::vector<size_t>> pairVias;
+	std::shared_ptr<SenderSpec> senderA, senderB;
+	std::shared_ptr<RecipientSpec> recipient1, recipient2;
+
+	const_vector<const_vector<bool>> observedNodes;
+	const_vector<bool> observedSenderA, observedSenderB, observedRecipient1, observedRecipient2;
+
+	GenericPreciseAnonymityFixture() : plain(CONSENSUS_PATH, "", "", false), size(plain.getSize()),
+		senderA(std::make_shared<SenderSpec>("144.118.66.83", 39.9597, -75.1968)),
+		senderB(std::make_shared<SenderSpec>("85.10.20.30", 52.52, 13.40)),
+		recipient1(std::make_shared<RecipientSpec>("130.83.47.181", 49.8719, 8.6484)),
+		recipient2(std::make_shared<RecipientSpec>("8.8.8.8", 37.4, -122.1)),
+		observedNodes(size, size, false), observedSenderA(size, false), observedSenderB(size, false),
+		observedRecipient1(size, false), observedRecipient2(size, false)
+	{
+		recipient1->ports.insert(443);
+		recipient2->ports.insert(443);
+		recipient2->ports.insert(6667);
+
+		// vias 5 and 9 share some of their pairs (which then use either of them)
+		vias = { 5, 9, 17 };
+		std::remove(ViaPairIndex::sidecarName(VIAS_PATH).c_str());
+		std::ofstream file(VIAS_PATH, std::ios::binary);
+		for(size_t via : vias)
+		{
+			file << plain.getRelay(via).getFingerprint();
+			for(size_t first = via % 4; first < size; first += 3)
+			{
+				size_t second = (first * 7 + 11) % size;
+				if(first == second || first == via || second == via)
+					continue;
+				file << "," << plain.getRelay(first).getFingerprint() << "," << plain.getRelay(second).getFingerprint();
+				pairVias[std::make_pair(std::min(first, second), std::max(first, second))].push_back(via);
+			}
+			file << "\n";
+		}
+	}
+
+	~GenericPreciseAnonymityFixture()
+	{
+		std::remove(VIAS_PATH);
+		std::remove(ViaPairIndex::sidecarName(VIAS_PATH).c_str());
+	}
+
+	/**
+	 * Compromises a relay.
+	 */
+	void compromise(size_t relay)
+	{
+		for(size_t j = 0; j < size; ++j)
+			observedNodes[relay][j] = observedNodes[j][relay] = true;
+		observedSenderA[relay] = observedSenderB[relay] = true;
+		observedRecipient1[relay] = observedRecipient2[relay] = true;
+	}
+
+	/**
+	 * @return probability that the link between two relays (possibly using vias) is observed.
+	 */
+	double linkObserved(size_t first, size_t second)
+	{
+		auto found = pairVias.find(std::make_pair(std::min(first, second), std::max(first, second)));
+		if(found == pairVias.end())
+			return observedNodes[first][second];
+		double observed = 0;
+		for(size_t via : found->second)
+			observed += observedNodes[first][via] || observedNodes[via][second];
+		return observed / found->second.size();
+	}
+
+	/**
+	 * Computes sender anonymity by enumerating every circuit and every observation of its links.
+	 */
+	double bruteForceSenderAnonymity(const PathSelection& psA, const PathSelection& psB)
+	{
+		const PathSelection* pathSelections[2] = { &psA, &psB };
+		const const_vector<bool>* observedSenders[2] = { &observedSenderA, &observedSenderB };
+		std::map<std::array<size_t, 4>, std::array<double, 2>> observations;
+		std::vector<probability_t> entryRow(size), middleRow(size);
+		for(size_t sender = 0; sender < 2; ++sender)
+		{
+			const PathSelection& pathSelection = *pathSelections[sender];
+			for(size_t x = 0; x < size; ++x)
+			{
+				double exitProb = pathSelection.exitProb(x);
+				if(!(exitProb > 0))
+					continue;
+				pathSelection.entryProbRow(x, entryRow.data());
+				for(size_t g = 0; g < size; ++g)
+				{
+					if(g == x || !(entryRow[g] > 0))
+						continue;
+					pathSelection.middleProbRow(g, x, middleRow.data());
+					bool SG = (*observedSenders[sender])[g];
+					for(size_t m = 0; m < size; ++m)
+					{
+						double circuitProb = exitProb * entryRow[g] * middleRow[m];
+						if(m == g || m == x || !(circuitProb > 0))
+							continue;
+						double linkGM = linkObserved(g, m), linkMX = linkObserved(m, x);
+						for(int link = 0; link < 4; ++link)
+						{
+							bool GM = link & 1, MX = link & 2;
+							double share = (GM ? linkGM : 1 - linkGM) * (MX ? linkMX : 1 - linkMX);
+							if(!(share > 0))
+								continue;
+							// the recipient is the same in both scenarios, the exit is always seen
+							std::array<size_t, 4> observation = { SG ? sender : NONE, SG || GM ? g : NONE, GM || MX ? m : NONE, x };
+							observations[observation][sender] += circuitProb * share;
+						}
+					}
+				}
+			}
+		}
+		double delta = 0;
+		for(auto& observation : observations)
+			delta += std::max(observation.second[0] - observation.second[1], 0.0);
+		return delta;
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(GenericPreciseAnonymitySuite, GenericPreciseAnonymityFixture)
+
+BOOST_AUTO_TEST_CASE(GenericPreciseAnonymity_UnobservedViasChangeNothing)
+{
+	Consensus withVias(CONSENSUS_PATH, "", VIAS_PATH, true);
+	auto spec = std::make_shared<PSUniformSpec>();
+	for(size_t relay = 1; relay < size; relay += 7)
+		compromise(relay);
+	for(size_t via : vias)
+		BOOST_REQUIRE(!observedSenderA[via]);
+
+	// links through unobserved vias are observed exactly when the relays of the link are
+	auto psA1 = Scenario::makePathSelection(spec, senderA, recipient1, plain);
+	auto psA2 = Scenario::makePathSelection(spec, senderA, recipient2, plain);
+	auto psB1 = Scenario::makePathSelection(spec, senderB, recipient1, plain);
+	auto psB2 = Scenario::makePathSelection(spec, senderB, recipient2, plain);
+	GenericPreciseAnonymity direct(plain, *psA1, *psA2, *psB1, *psB2, observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2);
+	GenericPreciseAnonymity routed(withVias, *psA1, *psA2, *psB1, *psB2, observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2);
+	BOOST_CHECK_CLOSE(routed.senderAnonymity(), direct.senderAnonymity(), 1e-9);
+	BOOST_CHECK_CLOSE(routed.recipientAnonymity(), direct.recipientAnonymity(), 1e-9);
+	BOOST_CHECK_CLOSE(routed.relationshipAnonymity(), direct.relationshipAnonymity(), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(GenericPreciseAnonymity_ObservedViasMatchEnumeration)
+{
+	Consensus withVias(CONSENSUS_PATH, "", VIAS_PATH, true);
+	auto spec = std::make_shared<PSTorSpec>();
+	auto psA1 = Scenario::makePathSelection(spec, senderA, recipient1, plain);
+	auto psA2 = Scenario::makePathSelection(spec, senderA, recipient2, plain);
+	auto psB1 = Scenario::makePathSelection(spec, senderB, recipient1, plain);
+	auto psB2 = Scenario::makePathSelection(spec, senderB, recipient2, plain);
+	compromise(vias[0]);
+	compromise(40);
+	compromise(41);
+
+	GenericPreciseAnonymity direct(plain, *psA1, *psA2, *psB1, *psB2, observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2);
+	GenericPreciseAnonymity routed(withVias, *psA1, *psA2, *psB1, *psB2, observedNodes, observedSenderA, observedSenderB, observedRecipient1, observedRecipient2);
+	BOOST_CHECK_CLOSE(routed.senderAnonymity(), bruteForceSenderAnonymity(*psA1, *psB1), 1e-6);
+
+	// an observed via reveals links it relays
+	BOOST_CHECK_GT(routed.senderAnonymity(), direct.senderAnonymity());
+	BOOST_CHECK_GT(routed.relationshipAnonymity(), direct.relationshipAnonymity());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,128 @@
+#define TEST_NAME "GenericWorstCaseAnonymity"
+
+#include "stdafx.h"
+
+#include <scenario.hpp>
+#include <adversary.hpp>
+#include <generic_worst_case_anonymity.hpp>
+
+#define CONSENSUS_PATH DATAPATH "2014-10-04-05-00-00-consensus-filtered-fast"
+
+/**
+ * Path selection whose probabilities depend only on groups of relays (relay index modulo number of groups).
+ * Relays of the same group are never used together in a circuit.
+ */
+class GroupedPathSelection : public PathSelection
+{
+	public:
+		GroupedPathSelection(const Consensus& consensus, size_t groupCount, size_t seed)
+			: PathSelection(nullptr, nullptr, nullptr, consensus), groupCount(groupCount),
+			exitWeight(groupCount), entryWeight(groupCount), middleWeight(groupCount)
+		{
+			for(size_t g = 0; g < groupCount; ++g)
+			{
+				exitWeight[g] = (g * 7 + seed) % 11 + 1;
+				entryWeight[g] = (g * 5 + seed) % 13 + 1;
+				middleWeight[g] = (g * 3 + seed) % 5 + 1;
+			}
+		}
+
+		probability_t exitProb(size_t exit) const
+		{
+			return exitWeight[group(exit)] / sum(exitWeight, groupCount, groupCount);
+		}
+
+		probability_t entryProb(size_t entry, size_t exit) const
+		{
+			if(group(entry) == group(exit))
+				return 0;
+			return entryWeight[group(entry)] / sum(entryWeight, group(exit), groupCount);
+		}
+
+		probability_t middleProb(size_t middle, size_t entry, size_t exit) const
+		{
+			if(group(middle) == group(entry) || group(middle) == group(exit) || group(entry) == group(exit))
+				return 0;
+			return middleWeight[group(middle)] / sum(middleWeight, group(entry), group(exit));
+		}
+
+		size_t relayGroups(std::vector<size_t>& groups) const
+		{
+			size_t size = consensus.getSize();
+			groups.resize(size);
+			for(size_t i = 0; i < size; ++i)
+				groups[i] = group(i);
+			return groupCount;
+		}
+
+	private:
+		size_t group(size_t relay) const
+		{
+			return relay % groupCount;
+		}
+
+		/**
+		 * Sums weights of all relays outside of two excluded groups.
+		 */
+		double sum(const std::vector<double>& weights, size_t excluded1, size_t excluded2) const
+		{
+			double result = 0;
+			for(size_t i = 0; i < consensus.getSize(); ++i)
+				if(group(i) != excluded1 && group(i) != excluded2)
+					result += weights[group(i)];
+			return result;
+		}
+
+		size_t groupCount;
+		std::vector<double> exitWeight, entryWeight, middleWeight;
+};
+
+BOOST_AUTO_TEST_SUITE(GenericWorstCaseAnonymitySuite)
+
+BOOST_AUTO_TEST_CASE(GenericWorstCaseAnonymity_GroupedMatchesPerRelay)
+{
+	Consensus consensus(CONSENSUS_PATH, "", "", false);
+	GroupedPathSelection psA1(consensus, 6, 1), psA2(consensus, 6, 2), psB1(consensus, 4, 3), psB2(consensus, 4, 4);
+	GenericWorstCaseAnonymity grouped(consensus, psA1, psA2, psB1, psB2, 1, true);
+	GenericWorstCaseAnonymity perRelay(consensus, psA1, psA2, psB1, psB2, 1, false);
+
+	KofNAdversary adversary;
+	adversary.getCostmap().commit(consensus.getRelays());
+	for(double budget : { 1.0, 5.0, 20.0 })
+	{
+		adversary.setBudget(budget);
+		BOOST_CHECK_CLOSE(grouped.senderAnonymity(adversary), perRelay.senderAnonymity(adversary), 1e-9);
+		BOOST_CHECK_CLOSE(grouped.recipientAnonymity(adversary), perRelay.recipientAnonymity(adversary), 1e-9);
+		BOOST_CHECK_CLOSE(grouped.relationshipAnonymity(adversary), perRelay.relationshipAnonymity(adversary), 1e-9);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(GenericWorstCaseAnonymity_LASTorGroupsShareProbabilities)
+{
+	Consensus consensus(DATAPATH "test_consensus.txt", DATAPATH "test_database.sqlite", "", false);
+	auto sender = std::make_shared<SenderSpec>("144.118.66.83", 39.9597, -75.1968);
+	auto recipient = std::make_shared<RecipientSpec>("130.83.47.181", 49.8719, 8.6484);
+	recipient->ports.insert(443);
+	auto pathSelection = Scenario::makePathSelection(std::make_shared<PSLASTorSpec>(0.5, 10), sender, recipient, consensus);
+
+	// relays of the same group are selected with the same probability in every role
+	std::vector<size_t> groups;
+	size_t groupCount = pathSelection->relayGroups(groups);
+	size_t size = consensus.getSize();
+	BOOST_REQUIRE_EQUAL(groups.size(), size);
+	for(size_t i = 0; i < size; ++i)
+	{
+		BOOST_REQUIRE(groups[i] < groupCount);
+		for(size_t j = 0; j < size; ++j)
+		{
+			if(i == j || groups[i] != groups[j])
+				continue;
+			BOOST_CHECK_EQUAL(pathSelection->exitProb(i), pathSelection->exitProb(j));
+			for(size_t other = 0; other < size; ++other)
+				if(other != i && other != j)
+					BOOST_CHECK_EQUAL(pathSelection->entryProb(i, other), pathSelection->entryProb(j, other));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -128,3 +128,24 @@ BOOST_AUTO_TEST_CASE(MATor_DevTest) {
 	BOOST_CHECK_GE(result, 0.0);
 	BOOST_CHECK_LE(result, 1.0);
 }
+
+BOOST_AUTO_TEST_CASE(MATor_SharedPathSelections) {
+	// both senders are the same, path selections of identical scenarios are computed once
+	shared_ptr<SenderSpec> sender1 = make_shared<SenderSpec>(IP("144.118.66.83"), 39.9597, -75.1968);
+	shared_ptr<SenderSpec> sender2 = make_shared<SenderSpec>(IP("144.118.66.83"), 39.9597, -75.1968);
+	shared_ptr<RecipientSpec> recipient1 = make_shared<RecipientSpec>(IP("130.83.47.181"), 49.8719, 8.6484);
+	shared_ptr<RecipientSpec> recipient2 = make_shared<RecipientSpec>(IP("134.58.64.12"), 50.8796, 4.7009);
+	recipient1->ports.insert(443);
+	recipient2->ports.insert(80);
+	std::shared_ptr<Consensus> consensus = make_shared<Consensus>(DATAPATH "test_consensus.txt", DATAPATH "test_database.sqlite", "", false);
+
+	MATor mator(sender1, sender2, recipient1, recipient2, make_shared<PSTorSpec>(), make_shared<PSTorSpec>(), consensus);
+	BOOST_CHECK(mator.getPathSelection(false, false) == mator.getPathSelection(true, false));
+	BOOST_CHECK(mator.getPathSelection(false, true) == mator.getPathSelection(true, true));
+	BOOST_CHECK(mator.getPathSelection(false, false) != mator.getPathSelection(false, true));
+
+	// another path selection algorithm of sender B gives its own path selections
+	mator.setPathSelectionSpec2(make_shared<PSUniformSpec>());
+	BOOST_CHECK(mator.getPathSelection(false, false) != mator.getPathSelection(true, false));
+	BOOST_CHECK(mator.getPathSelection(false, true) != mator.getPathSelection(true, true));
+}
@@ -0,0 +1,157 @@
+#define TEST_NAME "PathSelectionRows"
+
+#include "stdafx.h"
+
+#include <scenario.hpp>
+#include <asmap.hpp>
+
+#include <fstream>
+#include <cstdio>
+
+#define CONSENSUS_PATH DATAPATH "test_consensus.txt" // Made To Measure(TM)
+#define DB_PATH DATAPATH "test_database.sqlite" // Made To Measure(TM)
+#define FAST_CONSENSUS_PATH DATAPATH "2014-10-04-05-00-00-consensus-filtered-fast"
+#define NETWORK_PATH "test_rows_network.txt" // written by PathSelectionRows_ASConstraints
+
+struct PathSelectionRowsFixture
+{
+	Consensus consensus;
+	std::shared_ptr<SenderSpec> sender;
+	std::shared_ptr<RecipientSpec> recipient;
+
+	PathSelectionRowsFixture() : consensus(CONSENSUS_PATH, DB_PATH, "", false),
+		sender(std::make_shared<SenderSpec>("144.118.66.83", 39.9597, -75.1968)),
+		recipient(std::make_shared<RecipientSpec>("130.83.47.181", 49.8719, 8.6484))
+	{
+		recipient->ports.insert(443);
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(PathSelectionRowsSuite, PathSelectionRowsFixture)
+
+BOOST_AUTO_TEST_CASE(PathSelectionRows_MatchProbabilities)
+{
+	std::vector<std::shared_ptr<PathSelectionSpec>> specs = {
+		std::make_shared<PSTorSpec>(),
+		std::make_shared<PSUniformSpec>(),
+		std::make_shared<PSSelektorSpec>(),
+		std::make_shared<PSDistribuTorSpec>(0.5),
+		std::make_shared<PSLASTorSpec>(0.5, 10),
+		std::make_shared<PSTorSpec>(true)
+	};
+	size_t size = consensus.getSize();
+	std::vector<probability_t> exitRow(size), entryRow(size), middleRow(size);
+	for(auto& spec : specs)
+	{
+		auto pathSelection = Scenario::makePathSelection(spec, sender, recipient, consensus);
+
+		// rows hold exactly the probabilities computed relay by relay
+		pathSelection->exitProbRow(exitRow.data());
+		for(size_t exit = 0; exit < size; ++exit)
+		{
+			BOOST_CHECK_EQUAL(exitRow[exit], pathSelection->exitProb(exit));
+			pathSelection->entryProbRow(exit, entryRow.data());
+			for(size_t entry = 0; entry < size; ++entry)
+			{
+				BOOST_CHECK_EQUAL(entryRow[entry], pathSelection->entryProb(entry, exit));
+				if(entry == exit)
+					continue;
+				pathSelection->middleProbRow(entry, exit, middleRow.data());
+				for(size_t middle = 0; middle < size; ++middle)
+					BOOST_CHECK_EQUAL(middleRow[middle], pathSelection->middleProb(middle, entry, exit));
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PathSelectionRows_ASConstraints)
+{
+	// the route of the first exit to the recipient crosses the AS of every relay, so no entry can be used with it
+	Consensus fast(FAST_CONSENSUS_PATH, "", "", false);
+	size_t size = fast.getSize();
+	auto plain = Scenario::makePathSelection(std::make_shared<PSTorSpec>(), sender, recipient, fast);
+	std::vector<size_t> exits;
+	for(size_t i = 0; i < size; ++i)
+		if(plain->exitProb(i) > 0)
+			exits.push_back(i);
+	BOOST_REQUIRE(exits.size() >= 2);
+	{
+		std::ofstream network(NETWORK_PATH);
+		for(size_t i = 0; i < size; ++i)
+		{
+			std::string address = fast.getRelay(i).getAddress();
+			network << (std::string)sender->address << "\t" << address << "\tAS1 E" << i << "\n";
+			network << address << "\t" << (std::string)recipient->address << "\tAS2 X" << i;
+			if(i == exits[0])
+				for(size_t j = 0; j < size; ++j)
+					network << " E" << j;
+			network << "\n";
+		}
+	}
+	auto asmap = std::make_shared<ASMap>(fast, sender, sender, recipient, recipient, NETWORK_PATH);
+	std::remove(NETWORK_PATH);
+	std::remove("debug.txt");
+
+	// the map is tied to the consensus content, not to the consensus object
+	BOOST_CHECK(asmap->built_for(Consensus(FAST_CONSENSUS_PATH, "", "", false)));
+	BOOST_CHECK(!asmap->built_for(consensus));
+
+	std::vector<std::shared_ptr<PathSelectionSpec>> specs = {
+		std::make_shared<PSTorSpec>(true),
+		std::make_shared<PSUniformSpec>(true),
+		std::make_shared<PSDistribuTorSpec>(0.5, true)
+	};
+	for(auto& spec : specs)
+	{
+		// the exit is pruned and every remaining exit has entries to choose from
+		auto pathSelection = Scenario::makePathSelection(spec, sender, recipient, fast, asmap);
+		BOOST_CHECK_EQUAL(pathSelection->exitProb(exits[0]), 0);
+		double exitSum = 0;
+		for(size_t exit = 0; exit < size; ++exit)
+		{
+			double exitProb = pathSelection->exitProb(exit);
+			exitSum += exitProb;
+			if(!(exitProb > 0))
+				continue;
+			double entrySum = 0;
+			for(size_t entry = 0; entry < size; ++entry)
+				entrySum += pathSelection->entryProb(entry, exit);
+			BOOST_CHECK_CLOSE(entrySum, 1, 1e-9);
+		}
+		BOOST_CHECK_CLOSE(exitSum, 1, 1e-9);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PathSelectionRows_ProbabilityBounds)
+{
+	// bounds derived from weights hold for all circuits and are close to the greatest probabilities
+	Consensus fast(FAST_CONSENSUS_PATH, "", "", false);
+	std::vector<std::pair<std::shared_ptr<PathSelectionSpec>, const Consensus*>> specs = {
+		{ std::make_shared<PSTorSpec>(), &fast },
+		{ std::make_shared<PSUniformSpec>(), &fast },
+		{ std::make_shared<PSDistribuTorSpec>(0.5), &fast },
+		{ std::make_shared<PSLASTorSpec>(0.5, 10), &consensus }
+	};
+	for(auto& spec : specs)
+	{
+		const Consensus& current = *spec.second;
+		size_t size = current.getSize();
+		auto pathSelection = Scenario::makePathSelection(spec.first, sender, recipient, current);
+		std::vector<probability_t> entryBounds(size), middleBounds(size), entryMaxima(size), middleMaxima(size);
+		pathSelection->probabilityBounds(entryBounds.data(), middleBounds.data(), 4);
+		pathSelection->PathSelection::probabilityBounds(entryMaxima.data(), middleMaxima.data(), 4);
+		double entrySum = 0, middleSum = 0, entryMaximaSum = 0, middleMaximaSum = 0;
+		for(size_t i = 0; i < size; ++i)
+		{
+			BOOST_CHECK_GE(entryBounds[i] * (1 + 1e-12), entryMaxima[i]);
+			BOOST_CHECK_GE(middleBounds[i] * (1 + 1e-12), middleMaxima[i]);
+			entrySum += entryBounds[i];
+			middleSum += middleBounds[i];
+			entryMaximaSum += entryMaxima[i];
+			middleMaximaSum += middleMaxima[i];
+		}
+		BOOST_CHECK_LE(entrySum * middleSum, 1.1 * entryMaximaSum * middleMaximaSum);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,158 @@
+#define TEST_NAME "PathSelectionSnapshot"
+
+#include "stdafx.h"
+
+#include <scenario.hpp>
+#include <path_selection_snapshot.hpp>
+#include <relationship_manager.hpp>
+
+#include <fstream>
+#include <cstdio>
+#include <thread>
+
+#define CONSENSUS_PATH DATAPATH "test_consensus.txt" // Made To Measure(TM)
+#define DB_PATH DATAPATH "test_database.sqlite" // Made To Measure(TM)
+#define SNAPSHOT_DIRECTORY "."
+
+struct PathSelectionSnapshotFixture
+{
+	Consensus consensus;
+	std::shared_ptr<SenderSpec> sender;
+	std::shared_ptr<RecipientSpec> recipient;
+
+	PathSelectionSnapshotFixture() : consensus(CONSENSUS_PATH, DB_PATH, "", false),
+		sender(std::make_shared<SenderSpec>("144.118.66.83", 39.9597, -75.1968)),
+		recipient(std::make_shared<RecipientSpec>("130.83.47.181", 49.8719, 8.6484))
+	{
+		recipient->ports.insert(443);
+		recipient->ports.insert(80);
+	}
+
+	/**
+	 * @return name of the snapshot file of the path selection.
+	 */
+	std::string snapshotFile(std::shared_ptr<PathSelectionSpec> spec)
+	{
+		return PathSelectionSnapshot::fileName(SNAPSHOT_DIRECTORY, PathSelectionSnapshot::makeKey(consensus, Scenario::getKey(spec, sender, recipient)));
+	}
+
+	/**
+	 * Checks that both path selections give exactly the same probabilities.
+	 */
+	void checkEqual(const PathSelection& expected, const PathSelection& actual)
+	{
+		size_t size = consensus.getSize();
+		for(size_t exit = 0; exit < size; ++exit)
+		{
+			BOOST_CHECK_EQUAL(expected.exitProb(exit), actual.exitProb(exit));
+			for(size_t entry = 0; entry < size; ++entry)
+			{
+				BOOST_CHECK_EQUAL(expected.entryProb(entry, exit), actual.entryProb(entry, exit));
+				if(entry != exit)
+					for(size_t middle = 0; middle < size; ++middle)
+						BOOST_CHECK_EQUAL(expected.middleProb(middle, entry, exit), actual.middleProb(middle, entry, exit));
+			}
+		}
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(PathSelectionSnapshotSuite, PathSelectionSnapshotFixture)
+
+BOOST_AUTO_TEST_CASE(PathSelectionSnapshot_Restore)
+{
+	std::vector<std::shared_ptr<PathSelectionSpec>> specs = {
+		std::make_shared<PSTorSpec>(),
+		std::make_shared<PSUniformSpec>(),
+		std::make_shared<PSSelektorSpec>(),
+		std::make_shared<PSDistribuTorSpec>(0.5),
+		std::make_shared<PSLASTorSpec>(0.5, 10)
+	};
+	for(auto& spec : specs)
+	{
+		std::string fileName = snapshotFile(spec);
+		std::remove(fileName.c_str());
+		auto relations = Scenario::makeRelations(spec, sender, recipient, consensus);
+
+		// the first path selection is computed and saved, the second one is restored
+		auto computed = Scenario::makeFromRelations(spec, sender, recipient, consensus, relations, SNAPSHOT_DIRECTORY);
+		BOOST_REQUIRE(std::ifstream(fileName).good());
+		auto restored = Scenario::makeFromRelations(spec, sender, recipient, consensus, relations, SNAPSHOT_DIRECTORY);
+		BOOST_CHECK(computed != restored);
+		checkEqual(*computed, *restored);
+
+		PathSelectionSnapshot snapshot;
+		PathSelectionSnapshot::Key key = PathSelectionSnapshot::makeKey(consensus, Scenario::getKey(spec, sender, recipient));
+		BOOST_CHECK(snapshot.load(fileName, key, spec->getType()));
+		BOOST_CHECK(!snapshot.load(fileName, key, PS_AS_TOR));
+		std::remove(fileName.c_str());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PathSelectionSnapshot_Invalid)
+{
+	auto spec = std::make_shared<PSTorSpec>();
+	std::string fileName = snapshotFile(spec);
+	auto relations = Scenario::makeRelations(spec, sender, recipient, consensus);
+	auto computed = Scenario::makeFromRelations(spec, sender, recipient, consensus, relations, SNAPSHOT_DIRECTORY);
+
+	// damaged snapshot is not loaded, path selection is computed (and saved) again
+	{
+		std::fstream file(fileName, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(-1, std::ios::end);
+		file.put('x');
+	}
+	PathSelectionSnapshot snapshot;
+	PathSelectionSnapshot::Key key = PathSelectionSnapshot::makeKey(consensus, Scenario::getKey(spec, sender, recipient));
+	BOOST_CHECK(!snapshot.load(fileName, key, PS_TOR));
+	auto recomputed = Scenario::makeFromRelations(spec, sender, recipient, consensus, relations, SNAPSHOT_DIRECTORY);
+	checkEqual(*computed, *recomputed);
+	BOOST_CHECK(snapshot.load(fileName, key, PS_TOR));
+
+	// snapshot of another path selection does not restore this one
+	PathSelectionSnapshot lastor;
+	Scenario::makeFromRelations(std::make_shared<PSLASTorSpec>(0.5, 10), sender, recipient, consensus, relations)->saveState(lastor);
+	BOOST_CHECK(lastor.save(fileName, key, PS_TOR));
+	auto restored = Scenario::makeFromRelations(spec, sender, recipient, consensus, relations, SNAPSHOT_DIRECTORY);
+	checkEqual(*computed, *restored);
+	std::remove(fileName.c_str());
+
+	// snapshots are keyed by the scenario
+	auto otherSender = std::make_shared<SenderSpec>("1.1.1.1", 39.9597, -75.1968);
+	BOOST_CHECK(fileName != PathSelectionSnapshot::fileName(SNAPSHOT_DIRECTORY,
+		PathSelectionSnapshot::makeKey(consensus, Scenario::getKey(spec, otherSender, recipient))));
+
+	// and by the content of the consensus, kept up to date when relays change
+	Consensus reloaded(CONSENSUS_PATH, DB_PATH, "", false);
+	BOOST_CHECK_EQUAL(reloaded.getContentHash(), consensus.getContentHash());
+	reloaded.forceSetRelayFlag(0, RelayFlag::BAD_EXIT, !reloaded.getRelay(0).hasFlags(RelayFlag::BAD_EXIT));
+	BOOST_CHECK(reloaded.getContentHash() != consensus.getContentHash());
+	BOOST_CHECK(fileName != PathSelectionSnapshot::fileName(SNAPSHOT_DIRECTORY,
+		PathSelectionSnapshot::makeKey(reloaded, Scenario::getKey(spec, sender, recipient))));
+}
+
+BOOST_AUTO_TEST_CASE(PathSelectionSnapshot_ConcurrentSave)
+{
+	auto spec = std::make_shared<PSTorSpec>();
+	std::string fileName = snapshotFile(spec);
+	PathSelectionSnapshot::Key key = PathSelectionSnapshot::makeKey(consensus, Scenario::getKey(spec, sender, recipient));
+	PathSelectionSnapshot snapshot;
+	Scenario::makePathSelection(spec, sender, recipient, consensus)->saveState(snapshot);
+
+	// threads of one process saving the same snapshot never write to the same temporary file
+	std::vector<std::thread> threads;
+	std::vector<char> saved(8, false);
+	for(size_t i = 0; i < saved.size(); ++i)
+		threads.emplace_back([&, i]() {
+			for(int round = 0; round < 20; ++round)
+				saved[i] = snapshot.save(fileName, key, PS_TOR) && (round == 0 || saved[i]);
+		});
+	for(std::thread& thread : threads)
+		thread.join();
+	for(char ok : saved)
+		BOOST_CHECK(ok);
+	PathSelectionSnapshot loaded;
+	BOOST_CHECK(loaded.load(fileName, key, PS_TOR));
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,260 @@
+#define TEST_NAME "PSLatency"
+
+#include "stdafx.h"
+
+#include <scenario.hpp>
+#include <ps_latency.hpp>
+#include <path_selection_snapshot.hpp>
+#include <asmap.hpp>
+
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <limits>
+
+#define CONSENSUS_PATH DATAPATH "2014-10-04-05-00-00-consensus-filtered-fast"
+#define LATENCY_PATH "test_latency_matrix.bin" // written by the fixture
+#define LATENCY32_PATH "test_latency_matrix32.bin" // written by the fixture
+#define SNAPSHOT_DIRECTORY "."
+#define NETWORK_PATH "test_latency_network.txt" // written by PSLatency_ASConstraints
+#define UNKNOWN_FINGERPRINT "0000000000000000000000000000000000000000"
+
+struct PSLatencyFixture
+{
+	Consensus consensus;
+	size_t size;
+	std::shared_ptr<SenderSpec> sender;
+	std::shared_ptr<RecipientSpec> recipient;
+
+	/**
+	 * Writes latency matrices of all consensus relays but the last one (and of an unknown relay).
+	 */
+	PSLatencyFixture() : consensus(CONSENSUS_PATH, "", "", false), size(consensus.getSize()),
+		sender(std::make_shared<SenderSpec>("144.118.66.83", 39.9597, -75.1968)),
+		recipient(std::make_shared<RecipientSpec>("130.83.47.181", 49.8719, 8.6484))
+	{
+		recipient->ports.insert(443);
+
+		std::vector<std::string> fingerprints;
+		for(size_t i = 0; i + 1 < size; ++i)
+			fingerprints.push_back(consensus.getRelay(i).getFingerprint());
+		fingerprints.push_back(UNKNOWN_FINGERPRINT);
+		std::vector<float> rtts;
+		for(size_t i = 0; i < fingerprints.size(); ++i)
+			for(size_t j = i + 1; j < fingerprints.size(); ++j)
+				rtts.push_back(j + 1 < fingerprints.size() ? expectedRtt(i, j) : 1000);
+		LatencyMatrix::save(LATENCY_PATH, fingerprints, rtts, LatencyMatrix::FLOAT16);
+		LatencyMatrix::save(LATENCY32_PATH, fingerprints, rtts, LatencyMatrix::FLOAT32);
+	}
+
+	~PSLatencyFixture()
+	{
+		std::remove(LATENCY_PATH);
+		std::remove(LATENCY32_PATH);
+	}
+
+	/**
+	 * @return whether the round trip time of a pair of consensus relays is unknown.
+	 */
+	static bool unknown(size_t first, size_t second)
+	{
+		return (first + second) % 17 == 0;
+	}
+
+	/**
+	 * @return round trip time written for a pair of consensus relays (NaN for unknown ones).
+	 */
+	static float expectedRtt(size_t first, size_t second)
+	{
+		if(unknown(first, second))
+			return std::numeric_limits<float>::quiet_NaN();
+		return 10 + (first * 37 + second * 11) % 290 + 0.25f;
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(PSLatencySuite, PSLatencyFixture)
+
+BOOST_AUTO_TEST_CASE(LatencyMatrix_HalfPrecision)
+{
+	for(float value : { 0.0f, 1.0f, -2.5f, 0.25f, 1000.0f, 65504.0f, std::ldexp(1.0f, -24) })
+		BOOST_CHECK_EQUAL(LatencyMatrix::halfToFloat(LatencyMatrix::floatToHalf(value)), value);
+	BOOST_CHECK_CLOSE(LatencyMatrix::halfToFloat(LatencyMatrix::floatToHalf(123.456f)), 123.456f, 0.05);
+	BOOST_CHECK_EQUAL(LatencyMatrix::floatToHalf(1e6f), 0x7c00); // infinity
+	BOOST_CHECK_EQUAL(LatencyMatrix::floatToHalf(std::numeric_limits<float>::quiet_NaN()), 0x7e00);
+}
+
+BOOST_AUTO_TEST_CASE(LatencyMatrix_Load)
+{
+	LatencyMatrix half, single;
+	BOOST_REQUIRE(half.load(LATENCY_PATH, consensus.getFingerprintIndex()));
+	BOOST_REQUIRE(single.load(LATENCY32_PATH, consensus.getFingerprintIndex()));
+	BOOST_CHECK_EQUAL(single.storedRelays(), size);
+	BOOST_CHECK_EQUAL(single.maxRtt(), 1000);
+	BOOST_CHECK_EQUAL(half.maxRtt(), 1000);
+
+	// unknown round trip times are the greatest known one
+	for(size_t i = 0; i + 1 < size; ++i)
+	{
+		BOOST_CHECK_EQUAL(single.rtt(i, i), 1000);
+		BOOST_CHECK_EQUAL(single.rtt(i, size - 1), 1000);
+		for(size_t j = i + 1; j + 1 < size; ++j)
+		{
+			if(unknown(i, j))
+			{
+				BOOST_CHECK_EQUAL(single.rtt(i, j), 1000);
+				BOOST_CHECK_EQUAL(half.rtt(j, i), 1000);
+				continue;
+			}
+			float expected = expectedRtt(i, j);
+			BOOST_CHECK_EQUAL(single.rtt(i, j), expected);
+			BOOST_CHECK_EQUAL(single.rtt(j, i), expected);
+			BOOST_CHECK_CLOSE(half.rtt(j, i), expected, 0.1);
+		}
+	}
+
+	LatencyMatrix missing;
+	BOOST_CHECK(!missing.load("nonexistent_latency_matrix.bin", consensus.getFingerprintIndex()));
+	BOOST_CHECK(!missing.load(CONSENSUS_PATH, consensus.getFingerprintIndex()));
+	BOOST_CHECK(!missing.loaded());
+}
+
+BOOST_AUTO_TEST_CASE(PSLatency_MiddleProbabilities)
+{
+	auto pathSelection = Scenario::makePathSelection(std::make_shared<PSLatencySpec>(LATENCY_PATH, 0.8), sender, recipient, consensus);
+	std::vector<probability_t> row(size);
+	for(size_t exit = 0; exit < size; exit += 3)
+	{
+		if(!(pathSelection->exitProb(exit) > 0))
+			continue;
+		for(size_t entry = 1; entry < size; entry += 5)
+		{
+			if(!(pathSelection->entryProb(entry, exit) > 0))
+				continue;
+			pathSelection->middleProbRow(entry, exit, row.data());
+			double sum = 0;
+			for(size_t middle = 0; middle < size; ++middle)
+			{
+				BOOST_CHECK_CLOSE(row[middle], pathSelection->middleProb(middle, entry, exit), 1e-9);
+				sum += row[middle];
+			}
+			BOOST_CHECK_CLOSE(sum, 1, 1e-9);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PSLatency_LatencyScalesTorWeights)
+{
+	auto tor = Scenario::makePathSelection(std::make_shared<PSTorSpec>(), sender, recipient, consensus);
+	auto unbiased = Scenario::makePathSelection(std::make_shared<PSLatencySpec>(LATENCY_PATH, 0), sender, recipient, consensus);
+	auto biased = Scenario::makePathSelection(std::make_shared<PSLatencySpec>(LATENCY_PATH, 1), sender, recipient, consensus);
+	LatencyMatrix latencies;
+	BOOST_REQUIRE(latencies.load(LATENCY_PATH, consensus.getFingerprintIndex()));
+	auto latency = [&](size_t first, size_t second) { return latencies.rtt(first, second); };
+
+	for(size_t exit = 0; exit < size; exit += 4)
+	{
+		BOOST_CHECK_CLOSE(unbiased->exitProb(exit), tor->exitProb(exit), 1e-9);
+		BOOST_CHECK_CLOSE(biased->exitProb(exit), tor->exitProb(exit), 1e-9);
+		for(size_t entry = 1; entry < size; entry += 7)
+		{
+			BOOST_CHECK_CLOSE(unbiased->entryProb(entry, exit), tor->entryProb(entry, exit), 1e-9);
+			if(!(tor->entryProb(entry, exit) > 0))
+				continue;
+
+			// relative to Tor, middles are preferred by the latency of the circuit
+			size_t fastest = size, slowest = size;
+			for(size_t middle = 0; middle < size; ++middle)
+			{
+				BOOST_CHECK_CLOSE(unbiased->middleProb(middle, entry, exit), tor->middleProb(middle, entry, exit), 1e-9);
+				if(!(tor->middleProb(middle, entry, exit) > 0))
+					continue;
+				double circuitLatency = latency(entry, middle) + latency(middle, exit);
+				if(fastest == size || circuitLatency < latency(entry, fastest) + latency(fastest, exit))
+					fastest = middle;
+				if(slowest == size || circuitLatency > latency(entry, slowest) + latency(slowest, exit))
+					slowest = middle;
+			}
+			BOOST_REQUIRE(fastest != size);
+			if(latency(entry, fastest) + latency(fastest, exit) < latency(entry, slowest) + latency(slowest, exit))
+				BOOST_CHECK_GT(biased->middleProb(fastest, entry, exit) / tor->middleProb(fastest, entry, exit),
+					biased->middleProb(slowest, entry, exit) / tor->middleProb(slowest, entry, exit));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PSLatency_Snapshot)
+{
+	auto spec = std::make_shared<PSLatencySpec>(LATENCY_PATH, 0.5);
+	std::string fileName = PathSelectionSnapshot::fileName(SNAPSHOT_DIRECTORY,
+		PathSelectionSnapshot::makeKey(consensus, Scenario::getKey(spec, sender, recipient)));
+	std::remove(fileName.c_str());
+	auto relations = Scenario::makeRelations(spec, sender, recipient, consensus);
+
+	auto computed = Scenario::makeFromRelations(spec, sender, recipient, consensus, relations, SNAPSHOT_DIRECTORY);
+	BOOST_REQUIRE(std::ifstream(fileName).good());
+	auto restored = Scenario::makeFromRelations(spec, sender, recipient, consensus, relations, SNAPSHOT_DIRECTORY);
+	BOOST_CHECK(computed != restored);
+	for(size_t exit = 0; exit < size; exit += 5)
+	{
+		BOOST_CHECK_EQUAL(computed->exitProb(exit), restored->exitProb(exit));
+		for(size_t entry = 0; entry < size; entry += 3)
+		{
+			BOOST_CHECK_EQUAL(computed->entryProb(entry, exit), restored->entryProb(entry, exit));
+			if(entry != exit)
+				for(size_t middle = 0; middle < size; ++middle)
+					BOOST_CHECK_EQUAL(computed->middleProb(middle, entry, exit), restored->middleProb(middle, entry, exit));
+		}
+	}
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(PSLatency_ASConstraints)
+{
+	// the route of the first exit to the recipient crosses the AS of every relay, so no entry can be used with it
+	auto plain = Scenario::makePathSelection(std::make_shared<PSLatencySpec>(LATENCY_PATH, 0.5), sender, recipient, consensus);
+	std::vector<size_t> exits;
+	for(size_t i = 0; i < size; ++i)
+		if(plain->exitProb(i) > 0)
+			exits.push_back(i);
+	BOOST_REQUIRE(exits.size() >= 2);
+	{
+		std::ofstream network(NETWORK_PATH);
+		for(size_t i = 0; i < size; ++i)
+		{
+			std::string address = consensus.getRelay(i).getAddress();
+			network << (std::string)sender->address << "\t" << address << "\tAS1 E" << i << "\n";
+			network << address << "\t" << (std::string)recipient->address << "\tAS2 X" << i;
+			if(i == exits[0])
+				for(size_t j = 0; j < size; ++j)
+					network << " E" << j;
+			network << "\n";
+		}
+	}
+	auto asmap = std::make_shared<ASMap>(consensus, sender, sender, recipient, recipient, NETWORK_PATH);
+	std::remove(NETWORK_PATH);
+	std::remove("debug.txt");
+
+	auto pathSelection = Scenario::makePathSelection(std::make_shared<PSLatencySpec>(LATENCY_PATH, 0.5, true), sender, recipient, consensus, asmap);
+	BOOST_CHECK_EQUAL(pathSelection->exitProb(exits[0]), 0);
+	double exitSum = 0;
+	for(size_t exit = 0; exit < size; ++exit)
+	{
+		double exitProb = pathSelection->exitProb(exit);
+		exitSum += exitProb;
+		if(!(exitProb > 0))
+			continue;
+		double entrySum = 0;
+		for(size_t entry = 0; entry < size; ++entry)
+			entrySum += pathSelection->entryProb(entry, exit);
+		BOOST_CHECK_CLOSE(entrySum, 1, 1e-9);
+	}
+	BOOST_CHECK_CLOSE(exitSum, 1, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(PSLatency_InvalidSpecification)
+{
+	BOOST_CHECK_THROW(Scenario::makePathSelection(std::make_shared<PSLatencySpec>(LATENCY_PATH, 1.5), sender, recipient, consensus), latency_init_exception);
+	BOOST_CHECK_THROW(Scenario::makePathSelection(std::make_shared<PSLatencySpec>("nonexistent_latency_matrix.bin", 0.5), sender, recipient, consensus), latency_init_exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
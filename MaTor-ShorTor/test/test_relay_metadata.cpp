@@ -0,0 +1,151 @@
+#define TEST_NAME "RelayMetadata"
+
+#include "stdafx.h"
+
+#include <consensus.hpp>
+#include <relay_metadata.hpp>
+#include <db_connection.hpp>
+
+#include <fstream>
+#include <cstdio>
+
+#define CONSENSUS_PATH DATAPATH "test_consensus.txt" // Made To Measure(TM)
+#define DB_PATH DATAPATH "test_database.sqlite" // Made To Measure(TM)
+#define CONSENSUS_COPY_PATH "test_relay_metadata.txt" // written by the fixture
+#define DB_COPY_PATH "test_relay_metadata.sqlite" // written by the fixture
+
+struct RelayMetadataFixture
+{
+	std::string sidecar;
+
+	RelayMetadataFixture() : sidecar(RelayMetadataFile::sidecarName(CONSENSUS_COPY_PATH))
+	{
+		std::remove(sidecar.c_str());
+		copy(CONSENSUS_PATH, CONSENSUS_COPY_PATH);
+		copy(DB_PATH, DB_COPY_PATH);
+	}
+
+	~RelayMetadataFixture()
+	{
+		std::remove(sidecar.c_str());
+		std::remove(CONSENSUS_COPY_PATH);
+		std::remove(DB_COPY_PATH);
+	}
+
+	void copy(const char* from, const char* to)
+	{
+		std::ifstream input(from, std::ios::binary);
+		std::ofstream output(to, std::ios::binary);
+		output << input.rdbuf();
+	}
+
+	RelayMetadataFile::Key key(const Consensus& consensus)
+	{
+		return RelayMetadataFile::makeKey(consensus.getFingerprintIndex(), consensus.getValidAfter(), DB_COPY_PATH);
+	}
+
+	void checkEqual(const Consensus& loaded, const Consensus& expected)
+	{
+		BOOST_REQUIRE_EQUAL(loaded.getSize(), expected.getSize());
+		for(size_t i = 0; i < loaded.getSize(); ++i)
+		{
+			const Relay& a = loaded.getRelay(i);
+			const Relay& b = expected.getRelay(i);
+			BOOST_CHECK_EQUAL(a.getAveragedBandwidth(), b.getAveragedBandwidth());
+			BOOST_CHECK_EQUAL(a.getCountry(), b.getCountry());
+			BOOST_CHECK_EQUAL(a.getASNumber(), b.getASNumber());
+			BOOST_CHECK_EQUAL(a.getASName(), b.getASName());
+			BOOST_CHECK_EQUAL(a.getPlatform(), b.getPlatform());
+			BOOST_CHECK_EQUAL(a.getLatitude(), b.getLatitude());
+			BOOST_CHECK_EQUAL(a.getLongitude(), b.getLongitude());
+			BOOST_REQUIRE_EQUAL(a.getPolicy().size(), b.getPolicy().size());
+			for(size_t p = 0; p < a.getPolicy().size(); ++p)
+			{
+				BOOST_CHECK_EQUAL(a.getPolicy()[p].isAccept, b.getPolicy()[p].isAccept);
+				BOOST_CHECK(a.getPolicy()[p].address == b.getPolicy()[p].address);
+				BOOST_CHECK_EQUAL(a.getPolicy()[p].portBegin, b.getPolicy()[p].portBegin);
+				BOOST_CHECK_EQUAL(a.getPolicy()[p].portEnd, b.getPolicy()[p].portEnd);
+			}
+			BOOST_CHECK(loaded.getFamily(i) == expected.getFamily(i));
+			for(size_t j = 0; j < loaded.getSize(); ++j)
+				BOOST_CHECK_EQUAL(loaded.isRelated(i, j), expected.isRelated(i, j));
+		}
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(RelayMetadataSuite, RelayMetadataFixture)
+
+BOOST_AUTO_TEST_CASE(RelayMetadata_Sidecar)
+{
+	Consensus fromDB(CONSENSUS_COPY_PATH, DB_COPY_PATH, "", false);
+	BOOST_REQUIRE(std::ifstream(sidecar).good());
+	BOOST_CHECK_EQUAL(fromDB.getRelay(0).getCountry(), "US");
+
+	// consensus without database information gets it from the sidecar
+	Consensus empty(CONSENSUS_COPY_PATH, "", "", false);
+	std::vector<Relay> relays = empty.getRelays();
+	std::vector<std::vector<uint32_t>> families;
+	BOOST_REQUIRE(RelayMetadataFile::load(sidecar, key(empty), relays, families));
+	BOOST_CHECK_EQUAL(relays[0].getCountry(), "US");
+	BOOST_CHECK(families[0] == fromDB.getFamily(0));
+
+	Consensus fromSidecar(CONSENSUS_COPY_PATH, DB_COPY_PATH, "", false);
+	checkEqual(fromSidecar, fromDB);
+}
+
+BOOST_AUTO_TEST_CASE(RelayMetadata_Stale)
+{
+	Consensus fromDB(CONSENSUS_COPY_PATH, DB_COPY_PATH, "", false);
+	std::vector<Relay> relays = fromDB.getRelays();
+	std::vector<std::vector<uint32_t>> families;
+
+	// different consensus
+	RelayMetadataFile::Key otherConsensus = RelayMetadataFile::makeKey(fromDB.getFingerprintIndex(), "2014-10-21 03:00:00", DB_COPY_PATH);
+	BOOST_CHECK(!RelayMetadataFile::load(sidecar, otherConsensus, relays, families));
+
+	// database rewritten
+	RelayMetadataFile::Key before = key(fromDB);
+	copy(DB_PATH, DB_COPY_PATH);
+	RelayMetadataFile::Key after = key(fromDB);
+	if(after == before) // file system with coarse timestamps
+		return;
+	BOOST_CHECK(!RelayMetadataFile::load(sidecar, after, relays, families));
+	Consensus reloaded(CONSENSUS_COPY_PATH, DB_COPY_PATH, "", false);
+	checkEqual(reloaded, fromDB);
+	BOOST_CHECK(RelayMetadataFile::load(sidecar, key(reloaded), relays, families));
+}
+
+BOOST_AUTO_TEST_CASE(RelayMetadata_Corrupted)
+{
+	Consensus fromDB(CONSENSUS_COPY_PATH, DB_COPY_PATH, "", false);
+	std::string content;
+	{
+		std::ifstream input(sidecar, std::ios::binary);
+		content.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	}
+	std::ofstream(sidecar, std::ios::binary) << content.substr(0, content.size() - 1);
+
+	std::vector<Relay> relays = fromDB.getRelays();
+	std::vector<std::vector<uint32_t>> families;
+	BOOST_CHECK(!RelayMetadataFile::load(sidecar, key(fromDB), relays, families));
+
+	// database is queried again and the sidecar rewritten
+	Consensus reloaded(CONSENSUS_COPY_PATH, DB_COPY_PATH, "", false);
+	checkEqual(reloaded, fromDB);
+	BOOST_CHECK(RelayMetadataFile::load(sidecar, key(fromDB), relays, families));
+}
+
+BOOST_AUTO_TEST_CASE(RelayMetadata_MissingDatabase)
+{
+	try
+	{
+		Consensus missing(CONSENSUS_COPY_PATH, "nonexistent_database.sqlite", "", false);
+		BOOST_FAIL("missing database accepted");
+	}
+	catch(const db_exception& ex)
+	{
+		BOOST_CHECK_EQUAL(ex.why(), db_exception::DB_MISSING);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,52 @@
+#define TEST_NAME Types
+
+#include "stdafx.h"
+
+#include <vector>
+
+#include <types/alias_table.hpp>
+
+#define GRID_PER_INDEX 10000 // uniform numbers per index of the table
+
+BOOST_AUTO_TEST_SUITE(AliasTableSuite)
+
+BOOST_AUTO_TEST_CASE(AliasTable_Distribution)
+{
+	std::vector<double> weights = { 5, 0, 1, 3.5, 0, 0.5, 10, 2 };
+	double sum = 0;
+	for(double weight : weights)
+		sum += weight;
+	AliasTable table(weights.data(), weights.size());
+	BOOST_REQUIRE(!table.empty());
+	BOOST_CHECK_CLOSE(table.total(), sum, 1e-9);
+
+	// uniform numbers spread evenly over [0, 1) hit every index with its probability
+	size_t grid = weights.size() * GRID_PER_INDEX;
+	std::vector<size_t> hits(weights.size(), 0);
+	for(size_t k = 0; k < grid; ++k)
+	{
+		size_t index = table.sample((k + 0.5) / grid);
+		BOOST_REQUIRE(index < weights.size());
+		++hits[index];
+	}
+	for(size_t i = 0; i < weights.size(); ++i)
+	{
+		if(weights[i] == 0)
+			BOOST_CHECK_EQUAL(hits[i], 0);
+		BOOST_CHECK_SMALL((double)hits[i] / grid - weights[i] / sum, 1.0 / GRID_PER_INDEX);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(AliasTable_Degenerate)
+{
+	std::vector<double> zeros(4, 0);
+	BOOST_CHECK(AliasTable(zeros.data(), zeros.size()).empty());
+	BOOST_CHECK(AliasTable().empty());
+
+	std::vector<double> single = { 0, 0, 7, 0 };
+	AliasTable table(single.data(), single.size());
+	for(double u : { 0.0, 0.1, 0.49, 0.5, 0.75, 0.999999 })
+		BOOST_CHECK_EQUAL(table.sample(u), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
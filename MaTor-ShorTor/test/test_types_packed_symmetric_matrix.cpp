@@ -0,0 +1,176 @@
+#define TEST_NAME Types
+
+#include "stdafx.h"
+#include <stdlib.h>
+#include <ctime>
+
+#include <types/packed_symmetric_matrix.hpp>
+
+#define MATRIX_SIZE 15 // Must be >= 2
+
+struct PackedMatrices
+{
+	PackedSymmetricMatrix <int> m; // Non-diagonal symmetric matrix
+	PackedSymmetricMatrix <int> d; // Diagonal symmetric matrix
+	PackedSymmetricMatrix <int> g; // Graph-like matrix
+	SymmetricMatrix <int> reference; // The same values as m
+
+	PackedMatrices() : m(MATRIX_SIZE, false), d(MATRIX_SIZE, true), g(MATRIX_SIZE, true, true), reference(MATRIX_SIZE, false)
+	{
+		srand (time(NULL));
+
+		// Filling matrices m & d with random values
+		for (int i = 0; i < MATRIX_SIZE; ++i)
+		{
+			for (int j = i; j < MATRIX_SIZE; ++j)
+			{
+				if (i != j) {
+					reference[i][j] = m[i][j] = rand() % 100;
+				}
+
+				d[i][j] = rand() % 100;
+			}
+		}
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(PackedSymmetricMatrixSuite, PackedMatrices)
+
+BOOST_AUTO_TEST_CASE(Packed_Integrity)
+{
+	// Check if symmetric values are the same
+	for (int i = 0; i < MATRIX_SIZE; ++i)
+	{
+		for (int j = 0; j < MATRIX_SIZE; ++j)
+		{
+			if (i != j) {
+				BOOST_CHECK_EQUAL(m[i][j], m[j][i]);
+				BOOST_CHECK_EQUAL(m.get(i, j), reference.get(i, j));
+			}
+
+			BOOST_CHECK_EQUAL(d[i][j], d[j][i]);
+		}
+	}
+
+	// Check sizes and counts
+	BOOST_CHECK_EQUAL(m.size(), MATRIX_SIZE);
+	BOOST_CHECK_EQUAL(m.count(), ((MATRIX_SIZE * MATRIX_SIZE) - MATRIX_SIZE) / 2);
+	BOOST_CHECK_EQUAL(d.count(), (((MATRIX_SIZE * MATRIX_SIZE) - MATRIX_SIZE) / 2) + MATRIX_SIZE);
+	BOOST_CHECK_EQUAL(g.count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Packed_Rows)
+{
+	// rows are contiguous and aligned
+	BOOST_CHECK_EQUAL((size_t)m.row(0) % PackedSymmetricMatrix<int>::ALIGNMENT, 0);
+	BOOST_CHECK_EQUAL((size_t)d.row(0) % PackedSymmetricMatrix<int>::ALIGNMENT, 0);
+	for (int i = 0; i + 2 < MATRIX_SIZE; ++i)
+		BOOST_CHECK_EQUAL(&m.get(i, MATRIX_SIZE - 1) + 1, &m.get(i + 1, i + 2));
+	for (int i = 0; i + 1 < MATRIX_SIZE; ++i)
+		BOOST_CHECK_EQUAL(&d.get(i, MATRIX_SIZE - 1) + 1, &d.get(i + 1, i + 1));
+
+	for (int i = 0; i < MATRIX_SIZE; ++i)
+	{
+		const int* row = m.row(i);
+		for (int j = i + 1; j < MATRIX_SIZE; ++j)
+			BOOST_CHECK_EQUAL(row[j], reference.get(i, j));
+
+		d.row(i)[i] = i;
+		BOOST_CHECK_EQUAL(d[i][i], i);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Packed_Defined)
+{
+	BOOST_CHECK(m.defined(0, 1));
+	BOOST_CHECK(!m.defined(0, 0));
+	BOOST_CHECK(!m.defined(0, MATRIX_SIZE));
+	BOOST_CHECK(!g.defined(1, 0));
+
+	g.set(1, 0, 42);
+	g.set(2, 2, 43);
+	BOOST_CHECK(g.defined(0, 1));
+	BOOST_CHECK(g.defined(2, 2));
+	BOOST_CHECK(!g.defined(1, 1));
+	BOOST_CHECK_EQUAL(g.count(), 2);
+	BOOST_CHECK_EQUAL(g[0][1], 42);
+
+	// copies and moves keep cells and defined flags
+	PackedSymmetricMatrix<int> copy(g);
+	PackedSymmetricMatrix<int> moved(std::move(copy));
+	BOOST_CHECK_EQUAL(moved.count(), 2);
+	BOOST_CHECK_EQUAL(moved[2][2], 43);
+	moved = m;
+	BOOST_CHECK_EQUAL(moved[3][4], m[3][4]);
+}
+
+BOOST_AUTO_TEST_CASE(Packed_Exceptions)
+{
+	bool catched(false);
+
+	try {
+		d.at(MATRIX_SIZE, MATRIX_SIZE) = 42;
+	} catch(symmetric_matrix_exception& e) {
+		catched = true;
+	}
+	BOOST_CHECK(catched);
+
+	catched = false;
+	try {
+		m.at(0, 0) = 42;
+	} catch(symmetric_matrix_exception& e) {
+		catched = true;
+	}
+	BOOST_CHECK(catched);
+}
+
+BOOST_AUTO_TEST_CASE(Packed_Bits)
+{
+	const size_t size = 130; // three words per row
+	PackedSymmetricMatrix<bool> a(size, true), b(size, true);
+	BOOST_CHECK_EQUAL(a.words(), 3);
+	a.set(3, 70, true);
+	a.set(3, 129, true);
+	b.set(3, 1, true);
+	b.set(5, 5, true);
+	BOOST_CHECK(a.get(70, 3));
+	BOOST_CHECK(a[129][3]);
+	BOOST_CHECK(!a.get(3, 4));
+	BOOST_CHECK_EQUAL(a.rowCount(3), 2);
+
+	a.unite(b);
+	BOOST_CHECK(a.get(1, 3));
+	BOOST_CHECK(a.get(5, 5));
+	BOOST_CHECK_EQUAL(a.rowCount(3), 3);
+
+	std::vector<size_t> columns;
+	a.forEachInRow(3, nullptr, [&](size_t j) { columns.push_back(j); });
+	BOOST_CHECK(columns == std::vector<size_t>({ 1, 70, 129 }));
+
+	std::vector<uint64_t> mask(a.words(), ~(uint64_t)0);
+	mask[1] = 0;
+	columns.clear();
+	a.forEachInRow(3, mask.data(), [&](size_t j) { columns.push_back(j); });
+	BOOST_CHECK(columns == std::vector<size_t>({ 1, 129 }));
+
+	a.set(70, 3, false);
+	BOOST_CHECK(!a.get(3, 70));
+
+	// resizing keeps cells of both orders
+	a.resize(200);
+	BOOST_CHECK(a.get(3, 129));
+	BOOST_CHECK(!a.get(3, 199));
+	a.resize(100);
+	BOOST_CHECK_EQUAL(a.rowCount(3), 1);
+	BOOST_CHECK(a.get(5, 5));
+
+	bool catched(false);
+	try {
+		a.at(100, 0);
+	} catch(symmetric_matrix_exception& e) {
+		catched = true;
+	}
+	BOOST_CHECK(catched);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
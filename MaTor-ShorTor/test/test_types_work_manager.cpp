@@ -4,6 +4,8 @@
 
 #include <types/work_manager.hpp>
 
+#include <atomic>
+
 #define TASKS_NUM 15
 
 struct WorkManagerFixture {
@@ -34,4 +36,38 @@ BOOST_AUTO_TEST_CASE(DoingItsJob)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(Nested)
+{
+	// tasks may run work managers of their own
+	int testArray [TASKS_NUM][TASKS_NUM] = { };
+
+	WorkManager::runAll(4, TASKS_NUM, [&testArray](size_t i) {
+		WorkManager::runAll(4, TASKS_NUM, [&testArray, i](size_t j) {
+			testArray[i][j]++;
+		});
+	});
+
+	for (int i = 0; i < TASKS_NUM; ++i)
+		for (int j = 0; j < TASKS_NUM; ++j)
+			BOOST_CHECK_EQUAL(testArray[i][j], 1);
+}
+
+BOOST_AUTO_TEST_CASE(Budget)
+{
+	// work managers started within a budget (and their nested ones) never exceed it
+	std::atomic<unsigned> nestedThreads(0);
+	{
+		WorkManager::Budget budget(4);
+		BOOST_CHECK_EQUAL(WorkManager(8).getHardwareConcurrency(), 4);
+		BOOST_CHECK_LE(WorkManager().getHardwareConcurrency(), 4);
+		WorkManager::runAll(2, TASKS_NUM, [&nestedThreads](size_t) {
+			unsigned threads = WorkManager(8).getHardwareConcurrency();
+			if(threads > nestedThreads)
+				nestedThreads = threads;
+		});
+	}
+	BOOST_CHECK_EQUAL(nestedThreads, 2);
+	BOOST_CHECK_EQUAL(WorkManager(8).getHardwareConcurrency(), 8);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
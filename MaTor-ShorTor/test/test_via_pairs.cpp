@@ -0,0 +1,114 @@
+#define TEST_NAME "ViaPairs"
+
+#include "stdafx.h"
+
+#include <consensus.hpp>
+#include <via_pairs.hpp>
+
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+#define CONSENSUS_PATH DATAPATH "test_consensus.txt" // Made To Measure(TM)
+#define VIAS_PATH "test_via_pairs.csv" // written by the fixture
+#define UNKNOWN_FINGERPRINT "0000000000000000000000000000000000000000"
+
+struct ViaPairsFixture
+{
+	Consensus c;
+	std::vector<std::string> fingerprints;
+
+	ViaPairsFixture() : c(CONSENSUS_PATH, "", "", false)
+	{
+		for(const Relay& relay : c.getRelays())
+			fingerprints.push_back(relay.getFingerprint());
+
+		std::remove(ViaPairIndex::sidecarName(VIAS_PATH).c_str());
+		std::ofstream file(VIAS_PATH, std::ios::binary);
+		const std::vector<std::string>& f = fingerprints;
+		file << f[0] << "," << f[1] << "," << f[2] << "," << f[3] << "," << UNKNOWN_FINGERPRINT << "," << f[2] << "," << f[1] << "\n";
+		file << UNKNOWN_FINGERPRINT << "," << f[1] << "," << f[2] << "\n";
+		file << f[4] << "," << f[1] << "," << f[2] << "," << f[3] << "\r\n";
+	}
+
+	~ViaPairsFixture()
+	{
+		std::remove(VIAS_PATH);
+		std::remove(ViaPairIndex::sidecarName(VIAS_PATH).c_str());
+	}
+
+	void checkIndex(const ViaPairIndex& index, const std::vector<size_t>& position)
+	{
+		BOOST_REQUIRE_EQUAL(index.size(), fingerprints.size());
+		BOOST_CHECK_EQUAL(index.pairsCount(), 3);
+
+		auto pairs = index.getPairs(position[0]);
+		BOOST_REQUIRE_EQUAL(pairs.size(), 2);
+		BOOST_CHECK_EQUAL(pairs[0].first, position[1]);
+		BOOST_CHECK_EQUAL(pairs[0].second, position[2]);
+		BOOST_CHECK_EQUAL(pairs[1].first, position[2]);
+		BOOST_CHECK_EQUAL(pairs[1].second, position[1]);
+		BOOST_CHECK_EQUAL(index.getPairs(position[4]).size(), 1);
+		BOOST_CHECK(index.getPairs(position[1]).empty());
+
+		std::vector<size_t> expected = { position[0], position[0], position[4] };
+		std::sort(expected.begin(), expected.end());
+		auto vias = index.getVias(position[2], position[1]);
+		BOOST_REQUIRE_EQUAL(vias.size(), 3);
+		for(size_t i = 0; i < vias.size(); ++i)
+			BOOST_CHECK_EQUAL(vias[i], expected[i]);
+		BOOST_CHECK(index.getVias(position[1], position[3]).empty());
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(ViaPairsSuite, ViaPairsFixture)
+
+BOOST_AUTO_TEST_CASE(ViaPairs_CSV)
+{
+	std::vector<size_t> identity(fingerprints.size());
+	for(size_t i = 0; i < identity.size(); ++i)
+		identity[i] = i;
+
+	ViaPairIndex index(VIAS_PATH, FingerprintIndex(fingerprints), 2);
+	checkIndex(index, identity);
+
+	// sidecar written by the CSV import is a valid index on its own
+	ViaPairIndex binary(ViaPairIndex::sidecarName(VIAS_PATH), FingerprintIndex(fingerprints), 2);
+	checkIndex(binary, identity);
+	BOOST_CHECK(!index.isMapped());
+	BOOST_CHECK(binary.isMapped());
+
+	// mapped index can be saved again
+	BOOST_REQUIRE(binary.save(VIAS_PATH, FingerprintIndex(fingerprints)));
+	ViaPairIndex resaved(VIAS_PATH, FingerprintIndex(fingerprints), 2);
+	checkIndex(resaved, identity);
+}
+
+BOOST_AUTO_TEST_CASE(ViaPairs_SidecarRemapped)
+{
+	ViaPairIndex csvImport(VIAS_PATH, FingerprintIndex(fingerprints), 2);
+
+	// consensus with relays in different order reuses the sidecar
+	std::vector<std::string> reversed(fingerprints.rbegin(), fingerprints.rend());
+	std::vector<size_t> position(fingerprints.size());
+	for(size_t i = 0; i < position.size(); ++i)
+		position[i] = position.size() - 1 - i;
+
+	ViaPairIndex index(VIAS_PATH, FingerprintIndex(reversed), 2);
+	checkIndex(index, position);
+	BOOST_CHECK(!index.isMapped());
+}
+
+BOOST_AUTO_TEST_CASE(ViaPairs_Consensus)
+{
+	Consensus withVias(CONSENSUS_PATH, "", VIAS_PATH, true);
+	BOOST_CHECK_EQUAL(withVias.getPairsForVia(0).size(), 2);
+	BOOST_CHECK_EQUAL(withVias.getViasForPair(1, 2).size(), 3);
+
+	Consensus copy(withVias);
+	BOOST_CHECK_EQUAL(copy.getPairsForVia(4).size(), 1);
+
+	BOOST_CHECK(c.getPairsForVia(0).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()